@@ -42,6 +42,11 @@ local glPopAttrib  = gl.PopAttrib
 local glPushAttrib = gl.PushAttrib
 local section = 'widgets.lua'
 
+-- the engine keeps one filter per call-in for the whole handle, widgets
+-- go through widgetHandler:SetCallInFilter so theirs can be combined
+local SetCallInFilter = Script.SetCallInFilter
+Script.SetCallInFilter = nil
+
 
 --------------------------------------------------------------------------------
 
@@ -92,6 +97,8 @@ widgetHandler = {
   tweakMode = false,
   tweakKeys = {},
 
+  callInFilters = {}, -- [callInName][widget] = filter
+
   xViewSize    = 1,
   yViewSize    = 1,
   xViewSizeOld = 1,
@@ -546,6 +553,9 @@ function widgetHandler:NewWidget()
   wh.RemoveCallIn = function (_, name)
     self:RemoveWidgetCallIn(name, widget)
   end
+  wh.SetCallInFilter = function (_, name, filter)
+    return self:SetWidgetCallInFilter(name, widget, filter)
+  end
 
   wh.AddAction    = function (_, cmd, func, data, types)
     return self.actionHandler:AddAction(widget, cmd, func, data, types)
@@ -793,6 +803,9 @@ function widgetHandler:RemoveWidget(widget)
   for _,listname in ipairs(callInLists) do
     ArrayRemove(self[listname..'List'], widget)
   end
+  for _,filters in pairs(self.callInFilters) do
+    filters[widget] = nil
+  end
   self:UpdateCallIns()
 
   if (widget.whInfo.basename == SELECTOR_BASENAME) then
@@ -822,6 +835,7 @@ function widgetHandler:UpdateCallIn(name)
   else
     _G[name] = nil
   end
+  self:UpdateCallInFilter(name)
   Script.UpdateCallIn(name)
 end
 
@@ -862,6 +876,90 @@ function widgetHandler:UpdateCallIns()
 end
 
 
+--------------------------------------------------------------------------------
+--
+--  call-in filters
+--
+--  the handle gets the union of the filters of all widgets in a call-in's
+--  list, or none if one of them has none; so a widget can still be called
+--  for units outside its own filter when another widget wants them
+--
+
+local function MergeFilterSet(merged, set)
+  if (merged == nil or type(set) ~= 'table') then
+    return nil
+  end
+  -- either {id1, id2, ...} or {[id1] = true, [id2] = true, ...}
+  for k,v in pairs(set) do
+    if (v == true) then
+      merged[k] = true
+    elseif (type(v) == 'number') then
+      merged[v] = true
+    end
+  end
+  return merged
+end
+
+
+local function MergeCallInFilters(ciList, filters)
+  if (ciList == nil or #ciList == 0) then
+    return nil
+  end
+
+  local unitDefIDs = {}
+  local teamIDs = {}
+
+  for _,w in ipairs(ciList) do
+    local filter = filters[w]
+    if (filter == nil) then
+      return nil
+    end
+    unitDefIDs = MergeFilterSet(unitDefIDs, filter.unitDefIDs)
+    teamIDs    = MergeFilterSet(teamIDs,    filter.teamIDs)
+  end
+
+  if (unitDefIDs == nil and teamIDs == nil) then
+    return nil
+  end
+  return { unitDefIDs = unitDefIDs, teamIDs = teamIDs }
+end
+
+
+function widgetHandler:UpdateCallInFilter(name)
+  local filters = self.callInFilters[name]
+  if (filters == nil) then
+    return true
+  end
+
+  -- a nil filter also clears the one left by the last widget to drop its own
+  if (next(filters) == nil) then
+    self.callInFilters[name] = nil
+  end
+
+  return SetCallInFilter(name, MergeCallInFilters(self[name .. 'List'], filters))
+end
+
+
+function widgetHandler:SetWidgetCallInFilter(name, w, filter)
+  local filters = self.callInFilters[name] or {}
+
+  if (type(filter) == 'table') then
+    filters[w] = filter
+  else
+    filters[w] = nil
+  end
+
+  self.callInFilters[name] = filters
+
+  if (not self:UpdateCallInFilter(name)) then
+    -- not a filterable call-in
+    self.callInFilters[name] = nil
+    return false
+  end
+  return true
+end
+
+
 function widgetHandler:SelectorActive()
   for _,w in ipairs(self.widgets) do
     if (w.whInfo.basename == SELECTOR_BASENAME) then
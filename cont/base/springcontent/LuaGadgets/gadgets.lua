@@ -40,6 +40,11 @@ VFS.Include(HANDLER_DIR .. 'callins.lua',   nil, VFSMODE)
 
 local actionHandler = VFS.Include(HANDLER_DIR .. 'actions.lua', nil, VFSMODE)
 
+-- the engine keeps one filter per call-in for the whole handle, gadgets
+-- go through gadgetHandler:SetCallInFilter so theirs can be combined
+local SetCallInFilter = Script.SetCallInFilter
+Script.SetCallInFilter = nil
+
 
 --------------------------------------------------------------------------------
 
@@ -74,6 +79,8 @@ gadgetHandler = {
 
   CMDIDs = {},
 
+  callInFilters = {}, -- [callInName][gadget] = filter
+
   xViewSize    = 1,
   yViewSize    = 1,
   xViewSizeOld = 1,
@@ -304,6 +311,9 @@ function gadgetHandler:NewGadget()
   gh.RemoveCallIn = function (_, name)
     self:RemoveGadgetCallIn(name, gadget)
   end
+  gh.SetCallInFilter = function (_, name, filter)
+    return self:SetGadgetCallInFilter(name, gadget, filter)
+  end
 
   gh.RegisterCMDID = function(_, id)
     self:RegisterCMDID(gadget, id)
@@ -505,6 +515,9 @@ function gadgetHandler:RemoveGadget(gadget)
   for _,listname in ipairs(CALLIN_LIST) do
     ArrayRemove(self[listname..'List'], gadget)
   end
+  for _,filters in pairs(self.callInFilters) do
+    filters[gadget] = nil
+  end
 
   for id,g in pairs(self.CMDIDs) do
     if (g == gadget) then
@@ -536,6 +549,7 @@ function gadgetHandler:UpdateCallIn(name)
     end
   end
 
+  self:UpdateCallInFilter(name)
   Script.UpdateCallIn(name)
 end
 
@@ -576,6 +590,90 @@ function gadgetHandler:UpdateCallIns()
 end
 
 
+--------------------------------------------------------------------------------
+--
+--  call-in filters
+--
+--  the handle gets the union of the filters of all gadgets in a call-in's
+--  list, or none if one of them has none; so a gadget can still be called
+--  for units outside its own filter when another gadget wants them
+--
+
+local function MergeFilterSet(merged, set)
+  if (merged == nil or type(set) ~= 'table') then
+    return nil
+  end
+  -- either {id1, id2, ...} or {[id1] = true, [id2] = true, ...}
+  for k,v in pairs(set) do
+    if (v == true) then
+      merged[k] = true
+    elseif (type(v) == 'number') then
+      merged[v] = true
+    end
+  end
+  return merged
+end
+
+
+local function MergeCallInFilters(ciList, filters)
+  if (ciList == nil or #ciList == 0) then
+    return nil
+  end
+
+  local unitDefIDs = {}
+  local teamIDs = {}
+
+  for _,g in ipairs(ciList) do
+    local filter = filters[g]
+    if (filter == nil) then
+      return nil
+    end
+    unitDefIDs = MergeFilterSet(unitDefIDs, filter.unitDefIDs)
+    teamIDs    = MergeFilterSet(teamIDs,    filter.teamIDs)
+  end
+
+  if (unitDefIDs == nil and teamIDs == nil) then
+    return nil
+  end
+  return { unitDefIDs = unitDefIDs, teamIDs = teamIDs }
+end
+
+
+function gadgetHandler:UpdateCallInFilter(name)
+  local filters = self.callInFilters[name]
+  if (filters == nil) then
+    return true
+  end
+
+  -- a nil filter also clears the one left by the last gadget to drop its own
+  if (next(filters) == nil) then
+    self.callInFilters[name] = nil
+  end
+
+  return SetCallInFilter(name, MergeCallInFilters(self[name .. 'List'], filters))
+end
+
+
+function gadgetHandler:SetGadgetCallInFilter(name, g, filter)
+  local filters = self.callInFilters[name] or {}
+
+  if (type(filter) == 'table') then
+    filters[g] = filter
+  else
+    filters[g] = nil
+  end
+
+  self.callInFilters[name] = filters
+
+  if (not self:UpdateCallInFilter(name)) then
+    -- not a filterable call-in
+    self.callInFilters[name] = nil
+    return false
+  end
+  return true
+end
+
+
 --------------------------------------------------------------------------------
 --------------------------------------------------------------------------------
 
@@ -43,6 +43,7 @@
 #include "Rendering/HUDDrawer.h"
 #include "Rendering/IconHandler.h"
 #include "Rendering/TeamHighlight.h"
+#include "Rendering/VerticalSync.h"
 #include "Rendering/UnitDrawer.h"
 #include "Rendering/Map/InfoTexture/IInfoTextureHandler.h"
 #include "Rendering/Textures/NamedTextures.h"
@@ -53,6 +54,7 @@
 #include "Lua/LuaRules.h"
 #include "Lua/LuaOpenGL.h"
 #include "Lua/LuaParser.h"
+#include "Lua/LuaProfiler.h"
 #include "Lua/LuaSyncedRead.h"
 #include "Lua/LuaUI.h"
 #include "Map/MapDamage.h"
@@ -120,6 +122,7 @@
 #include "System/Sound/ISoundChannels.h"
 #include "System/Sync/DumpState.h"
 #include "System/TimeProfiler.h"
+#include "System/TimeUtil.h"
 
 
 #undef CreateDirectory
@@ -784,6 +787,11 @@ void CGame::LoadSkirmishAIs()
 
 void CGame::LoadFinalize()
 {
+	if (configHandler->GetBool("LuaProfiler")) {
+		luaProfiler.Reset();
+		luaProfiler.Enable(true);
+	}
+
 	if (saveFileHandler == nullptr) {
 		ENTER_SYNCED_CODE();
 		eventHandler.GamePreload();
@@ -832,6 +840,12 @@ void CGame::KillLua(bool dtor)
 	LOG("[Game::%s][0] dtor=%d loadscreen=%p", __func__, dtor, loadscreen);
 	CLoadScreen::DeleteInstance();
 
+	if (luaProfiler.IsEnabled()) {
+		luaProfiler.Dump("luaprofile-" + CTimeUtil::GetCurrentTimeStr());
+		luaProfiler.Enable(false);
+		luaProfiler.Reset();
+	}
+
 	// kill LuaUI here, various handler pointers are invalid in ~GuiHandler
 	LOG("[Game::%s][3] dtor=%d luaUI=%p", __func__, dtor, luaUI);
 	CLuaUI::FreeHandler();
@@ -1358,6 +1372,16 @@ bool CGame::Draw() {
 	eventHandler.DbgTimingInfo(TIMING_VIDEO, currentTimePreDraw, currentTimePostDraw);
 	globalRendering->SetGLTimeStamp(CGlobalRendering::FRAME_END_TIME_QUERY_IDX);
 
+	{
+		// SwapBuffers would block until the next vblank, spend most of that on
+		// Lua GC instead; the margin keeps the swap itself from missing it
+		const float swapPeriod = verticalSync->GetSwapPeriod();
+		const spring_time idleEndTime = globalRendering->lastSwapTime + spring_msecs(swapPeriod * 0.75f);
+
+		if (swapPeriod > 0.0f && (idleEndTime - spring_gettime()).toMilliSecsf() >= 1.0f)
+			CLuaHandle::CollectGarbageIdle(idleEndTime);
+	}
+
 	return true;
 }
 
@@ -1554,7 +1578,13 @@ void CGame::SimFrame() {
 		const float msecSleepTime = (msecMaxSimFrameTime - msecDifSimFrameTime) * 0.5f;
 
 		if (msecSleepTime > 0.0f) {
-			spring_sleep(spring_msecs(msecSleepTime));
+			// let Lua GC use the wait first
+			CLuaHandle::CollectGarbageIdle(lastSimFrameTime + spring_msecs(msecSleepTime));
+
+			const float msecIdleTime = (spring_gettime() - lastSimFrameTime).toMilliSecsf();
+
+			if (msecSleepTime > msecIdleTime)
+				spring_sleep(spring_msecs(msecSleepTime - msecIdleTime));
 		}
 	}
 	#endif
@@ -38,6 +38,7 @@
 #include "System/EventHandler.h"
 #include "System/SpringMath.h"
 #include "System/Sound/ISoundChannels.h"
+#include "System/Threading/ThreadPool.h"
 
 
 static CGameHelper gGameHelper;
@@ -632,10 +633,43 @@ namespace {
 
 
 
-size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets)
+// per-thread query batch for GatherWeaponTargets calls that come without one
+static std::array<QuadFieldBatchQuery, ThreadPool::MAX_THREADS> weaponTargetBatches;
+
+static float GetWeaponTargetScanRadius(const CWeapon* weapon)
 {
-	const CUnit*  weaponOwner = weapon->owner;
-	const CUnit* lastAttacker = ((weaponOwner->lastAttackFrame + 200) <= gs->frameNum) ? weaponOwner->lastAttacker : nullptr;
+	const float aimPosHeight = weapon->aimFromPos.y;
+	const float minMapHeight = std::max(0.0f, readMap->GetCurrMinHeight());
+
+	// find theoretical maximum range based on height above lowest point on map
+	// return (weapon->GetRange2D(weapon->autoTargetRangeBoost, (minMapHeight - aimPosHeight) * weapon->weaponDef->heightmod));
+	return (weapon->range + weapon->autoTargetRangeBoost + (aimPosHeight - minMapHeight) * weapon->weaponDef->heightmod);
+}
+
+size_t CGameHelper::AddWeaponTargetQuery(const CWeapon* weapon, QuadFieldBatchQuery& batch)
+{
+	return (batch.AddSphere(weapon->owner->pos, GetWeaponTargetScanRadius(weapon), false));
+}
+
+void CGameHelper::GatherWeaponTargets(const CWeapon* weapon, std::vector<SWeaponTargetCandidate>& candidates)
+{
+	QuadFieldBatchQuery& batch = weaponTargetBatches[ThreadPool::GetThreadNum()];
+
+	batch.Clear();
+
+	const size_t query = AddWeaponTargetQuery(weapon, batch);
+
+	quadField.GetUnitsExact(batch);
+	GatherWeaponTargets(weapon, batch, query, candidates);
+}
+
+void CGameHelper::GatherWeaponTargets(
+	const CWeapon* weapon,
+	const QuadFieldBatchQuery& batch,
+	size_t query,
+	std::vector<SWeaponTargetCandidate>& candidates
+) {
+	const CUnit* weaponOwner = weapon->owner;
 
 	const      WeaponDef* weaponDef = weapon->weaponDef;
 	const DynDamageArray* weaponDmg = weapon->damages;
@@ -644,7 +678,6 @@ size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* av
 	const float3 testPos;
 
 	const float aimPosHeight = weapon->aimFromPos.y;
-	const float minMapHeight = std::max(0.0f, readMap->GetCurrMinHeight());
 
 	// how much damage the weapon deals over 1 second
 	const float secDamage = weaponDmg->GetDefault() * weapon->salvoSize / weapon->reloadTime * GAME_SPEED;
@@ -652,98 +685,112 @@ size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* av
 
 	const float  baseRange = weapon->range;
 	const float rangeBoost = weapon->autoTargetRangeBoost;
-	// find theoretical maximum range based on height above lowest point on map
-	// const float scanRadius = weapon->GetRange2D(rangeBoost, (minMapHeight - aimPosHeight) * heightMod);
-	const float scanRadius = baseRange + rangeBoost + (aimPosHeight - minMapHeight) * heightMod;
 
-	// [0] := default, [1,2,3,4,5,6] := target is {avoidee, in bad category, crashing, last attacker, paralyzed, outside unboosted range}
-	constexpr float tgtPriorityMults[] = {1.0f, 10.0f, 100.0f, 1000.0f, 0.5f, 4.0f, 100000.0f};
+	// [0] := default, [1,2,3] := target is {in radar, paralyzed, outside unboosted range}
+	constexpr float tgtPriorityMults[] = {1.0f, 10.0f, 4.0f, 100000.0f};
 
 	const bool paralyzer = (weaponDmg->paralyzeDamageTime != 0);
 
-	// copy on purpose since the below calls lua
-	QuadFieldQuery qfQuery;
-	quadField.GetQuads(qfQuery, ownerPos, scanRadius);
-
-	targets.clear();
-	targets.reserve(32);
+	candidates.clear();
+	candidates.reserve(32);
 
-	const int tempNum = gs->GetTempNum();
+	// the query (see AddWeaponTargetQuery) already rejected units whose
+	// footprint lies outside the maximum scan radius, from their spans
+	for (auto iter = batch.GetResultsBegin(query), end = batch.GetResultsEnd(query); iter != end; ++iter) {
+		CUnit* targetUnit = *iter;
 
-	for (int t = 0; t < teamHandler.ActiveAllyTeams(); ++t) {
-		if (teamHandler.Ally(weaponOwner->allyteam, t))
+		if (teamHandler.Ally(weaponOwner->allyteam, targetUnit->allyteam))
 			continue;
 
-		for (const int qi: *qfQuery.quads) {
-			const std::vector<CUnit*>& allyTeamUnits = quadField.GetQuad(qi).teamUnits[t];
+		if (!weapon->TestTarget(testPos, SWeaponTarget(targetUnit)))
+			continue;
 
-			for (CUnit* targetUnit: allyTeamUnits) {
-				if (targetUnit->tempNum == tempNum)
-					continue;
+		const unsigned short targetLOSState = targetUnit->losStatus[weaponOwner->allyteam];
 
-				targetUnit->tempNum = tempNum;
+		float targetPriority = tgtPriorityMults[0];
+		float3 targetPos;
 
-				if (!weapon->TestTarget(testPos, SWeaponTarget(targetUnit)))
-					continue;
+		if (targetLOSState & LOS_INLOS) {
+			targetPos = targetUnit->aimPos;
+		} else if (targetLOSState & LOS_INRADAR) {
+			targetPos = weapon->GetUnitPositionWithError(targetUnit);
+			targetPriority *= tgtPriorityMults[1];
+		} else {
+			continue;
+		}
 
-				const unsigned short targetLOSState = targetUnit->losStatus[weaponOwner->allyteam];
+		const float modRange = weapon->GetRange2D(rangeBoost, (targetPos.y - aimPosHeight) * heightMod);
+		const float sqDist2D = ownerPos.SqDistance2D(targetPos);
 
-				float targetPriority = tgtPriorityMults[(targetUnit == avoidUnit) * 1];
-				float3 targetPos;
+		if (sqDist2D > Square(modRange))
+			continue;
 
-				if (targetLOSState & LOS_INLOS) {
-					targetPos = targetUnit->aimPos;
-				} else if (targetLOSState & LOS_INRADAR) {
-					targetPos = weapon->GetUnitPositionWithError(targetUnit);
-					targetPriority *= tgtPriorityMults[1];
-				} else {
-					continue;
-				}
+		const float dist2D = math::sqrt(sqDist2D);
+		const float rangeMul = (dist2D * weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
 
-				const float modRange = weapon->GetRange2D(rangeBoost, (targetPos.y - aimPosHeight) * heightMod);
-				const float sqDist2D = ownerPos.SqDistance2D(targetPos);
+		targetPriority *= rangeMul;
+		targetPriority *= tgtPriorityMults[(dist2D > baseRange) * 3];
 
-				if (sqDist2D > Square(modRange))
-					continue;
+		if (targetLOSState & LOS_INLOS) {
+			targetPriority *= (secDamage + targetUnit->health);
 
-				const float dist2D = math::sqrt(sqDist2D);
-				const float rangeMul = (dist2D * weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
-				const float damageMul = weaponDmg->Get(targetUnit->armorType) * targetUnit->curArmorMultiple;
+			if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health))
+				targetPriority *= tgtPriorityMults[2];
+		} else {
+			targetPriority *= (secDamage + 10000.0f);
+		}
 
-				targetPriority *= rangeMul;
-				targetPriority *= tgtPriorityMults[(dist2D > baseRange) * 6];
+		candidates.push_back({targetUnit, targetPriority, targetLOSState});
+	}
+}
 
-				if (targetLOSState & LOS_INLOS) {
-					targetPriority *= (secDamage + targetUnit->health);
+size_t CGameHelper::GenerateWeaponTargets(
+	const CWeapon* weapon,
+	const CUnit* avoidUnit,
+	const std::vector<SWeaponTargetCandidate>& candidates,
+	std::vector<std::pair<float, CUnit*>>& targets
+) {
+	const CUnit*  weaponOwner = weapon->owner;
+	const CUnit* lastAttacker = ((weaponOwner->lastAttackFrame + 200) <= gs->frameNum) ? weaponOwner->lastAttacker : nullptr;
 
-					if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health))
-						targetPriority *= tgtPriorityMults[5];
+	const      WeaponDef* weaponDef = weapon->weaponDef;
+	const DynDamageArray* weaponDmg = weapon->damages;
 
-					if (weapon->hasTargetWeight)
-						targetPriority *= weapon->TargetWeight(targetUnit);
+	// [0] := default, [1,2,3,4] := target is {avoidee, in bad category, crashing, last attacker}
+	constexpr float tgtPriorityMults[] = {1.0f, 10.0f, 100.0f, 1000.0f, 0.5f};
 
-				} else {
-					targetPriority *= (secDamage + 10000.0f);
-				}
+	targets.clear();
+	targets.reserve(candidates.size());
 
-				if (targetLOSState & LOS_PREVLOS) {
-					targetPriority /= (damageMul * targetUnit->power * (0.7f + gsRNG.NextFloat() * 0.6f));
-					targetPriority *= tgtPriorityMults[((targetUnit->category & weapon->badTargetCategory) != 0) * 2];
-					targetPriority *= tgtPriorityMults[(targetUnit->IsCrashing()) * 3];
-					targetPriority *= tgtPriorityMults[(targetUnit == lastAttacker) * 4];
-				}
+	// NOTE:
+	//   candidates are visited in the order GatherWeaponTargets found them,
+	//   which keeps the sequence of RNG draws and Lua calls deterministic
+	for (size_t i = 0, n = candidates.size(); i < n; i++, assert(n == candidates.size())) {
+		const SWeaponTargetCandidate& candidate = candidates[i];
+		CUnit* targetUnit = candidate.unit;
+
+		// an earlier AllowWeaponTarget call may have killed it; units are only freed at the end of the frame
+		if (targetUnit->isDead && modInfo.fireAtKilled == 0)
+			continue;
 
-				const bool allowTarget = eventHandler.AllowWeaponTarget(weaponOwner->id, targetUnit->id, weapon->weaponNum, weaponDef->id, &targetPriority);
+		float targetPriority = candidate.priority * tgtPriorityMults[(targetUnit == avoidUnit) * 1];
 
-				// Lua call may have changed tempNum, so needs to be set again
-				targetUnit->tempNum = tempNum;
+		if ((candidate.losStatus & LOS_INLOS) && weapon->hasTargetWeight)
+			targetPriority *= weapon->TargetWeight(targetUnit);
 
-				if (!allowTarget)
-					continue;
+		if (candidate.losStatus & LOS_PREVLOS) {
+			const float damageMul = weaponDmg->Get(targetUnit->armorType) * targetUnit->curArmorMultiple;
 
-				targets.emplace_back(targetPriority, targetUnit);
-			}
+			targetPriority /= (damageMul * targetUnit->power * (0.7f + gsRNG.NextFloat() * 0.6f));
+			targetPriority *= tgtPriorityMults[((targetUnit->category & weapon->badTargetCategory) != 0) * 2];
+			targetPriority *= tgtPriorityMults[(targetUnit->IsCrashing()) * 3];
+			targetPriority *= tgtPriorityMults[(targetUnit == lastAttacker) * 4];
 		}
+
+		if (!eventHandler.AllowWeaponTarget(weaponOwner->id, targetUnit->id, weapon->weaponNum, weaponDef->id, &targetPriority))
+			continue;
+
+		targets.emplace_back(targetPriority, targetUnit);
 	}
 
 	std::stable_sort(targets.begin(), targets.end(), [](const std::pair<float, CUnit*>& a, const std::pair<float, CUnit*>& b) { return (a.first < b.first); });
@@ -843,7 +890,7 @@ void CGameHelper::BuggerOff(float3 pos, float radius, bool spherical, bool force
 {
 	// copy on purpose since BuggerOff can call risky stuff
 	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius + SQUARE_SIZE, spherical);
+	quadField.GetUnitsExactSpans(qfQuery, pos, radius + SQUARE_SIZE, spherical);
 	const int allyTeamId = teamHandler.AllyTeam(teamId);
 
 	for (CUnit* u: *qfQuery.units) {
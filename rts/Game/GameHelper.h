@@ -6,6 +6,7 @@
 #include "Sim/Misc/DamageArray.h"
 #include "Sim/Projectiles/ExplosionListener.h"
 #include "Sim/Units/CommandAI/Command.h"
+#include "Sim/Weapons/WeaponTarget.h"
 #include "System/float3.h"
 #include "System/type2.h"
 
@@ -21,6 +22,7 @@ class CMobileCAI;
 struct UnitDef;
 struct MoveDef;
 struct BuildInfo;
+struct QuadFieldBatchQuery;
 
 struct CExplosionParams {
 	const float3 pos;
@@ -126,7 +128,24 @@ public:
 		bool synced = false
 	);
 
-	static size_t GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets);
+	// read-only and thread-safe; GenerateWeaponTargets must be called
+	// (serially) on the result to obtain the final target priorities
+	// the batched variant reads the units found by query (added with
+	// AddWeaponTargetQuery) of a batch already run by the QuadField
+	static size_t AddWeaponTargetQuery(const CWeapon* weapon, QuadFieldBatchQuery& batch);
+	static void GatherWeaponTargets(const CWeapon* weapon, std::vector<SWeaponTargetCandidate>& candidates);
+	static void GatherWeaponTargets(
+		const CWeapon* weapon,
+		const QuadFieldBatchQuery& batch,
+		size_t query,
+		std::vector<SWeaponTargetCandidate>& candidates
+	);
+	static size_t GenerateWeaponTargets(
+		const CWeapon* weapon,
+		const CUnit* avoidUnit,
+		const std::vector<SWeaponTargetCandidate>& candidates,
+		std::vector<std::pair<float, CUnit*>>& targets
+	);
 
 	void Init();
 	void Update();
@@ -45,6 +45,7 @@
 #include "Game/UI/PlayerRoster.h"
 
 #include "Lua/LuaOpenGL.h"
+#include "Lua/LuaProfiler.h"
 #include "Lua/LuaUI.h"
 
 #include "Map/Ground.h"
@@ -93,6 +94,7 @@
 #include "System/GlobalConfig.h"
 #include "System/SafeUtil.h"
 #include "System/TimeProfiler.h"
+#include "System/TimeUtil.h"
 #include "System/Log/ILog.h"
 #include "System/Config/ConfigHandler.h"
 #include "System/FileSystem/SimpleParser.h"
@@ -1452,6 +1454,46 @@ public:
 };
 
 
+class LuaProfilerActionExecutor: public IUnsyncedActionExecutor {
+public:
+	LuaProfilerActionExecutor() : IUnsyncedActionExecutor(
+		"LuaProfiler",
+		"Profile Lua callins: start, stop, reset, print [N], or dump [name] to <name>.txt and <name>.folded (flame-graph input)"
+	) {
+	}
+
+	bool Execute(const UnsyncedAction& action) const final {
+		const std::vector<std::string>& args = _local_strSpaceTokenize(action.GetArgs());
+
+		if (args.empty())
+			return false;
+
+		switch (hashString(args[0].c_str())) {
+			case hashString("start"): {
+				luaProfiler.Enable(true);
+			} break;
+			case hashString("stop"): {
+				luaProfiler.Enable(false);
+			} break;
+			case hashString("reset"): {
+				luaProfiler.Reset();
+			} break;
+			case hashString("print"): {
+				luaProfiler.PrintStats((args.size() > 1)? atoi(args[1].c_str()): 20);
+			} break;
+			case hashString("dump"): {
+				luaProfiler.Dump((args.size() > 1)? args[1]: ("luaprofile-" + CTimeUtil::GetCurrentTimeStr()));
+			} break;
+			default: {
+				LOG_L(L_WARNING, "/%s: unknown argument \"%s\"", GetCommand().c_str(), args[0].c_str());
+			} break;
+		}
+
+		return true;
+	}
+};
+
+
 
 
 class GameInfoActionExecutor : public IUnsyncedActionExecutor {
@@ -3432,6 +3474,7 @@ void UnsyncedGameCommands::AddDefaultActionExecutors()
 	AddActionExecutor(AllocActionExecutor<NoLuaDrawActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<LuaUIActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<LuaGarbageCollectControlExecutor>());
+	AddActionExecutor(AllocActionExecutor<LuaProfilerActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<MiniMapActionExecutor>());
 	AddActionExecutor(AllocActionExecutor<GroundDecalsActionExecutor>());
 
@@ -98,6 +98,7 @@ public:
 
 	SLuaAllocState allocState;
 	SLuaGarbageCollectCtrl gcCtrl;
+	SLuaGarbageCollectStats gcStats;
 
 #if (!defined(UNITSYNC) && !defined(DEDICATED))
 	// NOTE:
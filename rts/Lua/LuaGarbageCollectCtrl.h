@@ -3,8 +3,11 @@
 #ifndef SPRING_LUA_GARBAGE_COLLECT_CTRL_H
 #define SPRING_LUA_GARBAGE_COLLECT_CTRL_H
 
+#include <cstdint>
 #include <limits>
 
+#include "System/Misc/SpringTime.h"
+
 struct SLuaGarbageCollectCtrl {
 	// maximum number of lua_gc calls made in each CollectGarbage loop
 	int itersPerBatch = std::numeric_limits<int>::max();
@@ -22,5 +25,20 @@ struct SLuaGarbageCollectCtrl {
 	float baseMemLoadMult = 0.0f;
 };
 
+struct SLuaGarbageCollectStats {
+	// handle's allocated bytes at the end of the previous CollectGarbage call
+	std::int64_t prevAllocedBytes = 0;
+	std::uint64_t numCycles = 0;
+
+	// collector work owed for allocations made since, in KB; negative
+	// when idle-time calls have worked ahead of the allocation rate
+	float debt = 0.0f;
+	// heap growth between calls, smoothed, in KB per second
+	float growthRate = 0.0f;
+
+	spring_time prevCallTime;
+	spring_time totalTime;
+};
+
 #endif
 
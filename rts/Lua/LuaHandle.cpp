@@ -10,6 +10,7 @@
 #include "LuaConfig.h"
 #include "LuaHashString.h"
 #include "LuaOpenGL.h"
+#include "LuaProfiler.h"
 #include "LuaBitOps.h"
 #include "LuaMathExtra.h"
 #include "LuaUtils.h"
@@ -28,6 +29,7 @@
 #include "Sim/Features/FeatureDef.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitDef.h"
+#include "Sim/Units/UnitDefHandler.h"
 #include "Sim/Weapons/Weapon.h"
 #include "Sim/Weapons/WeaponDef.h"
 #include "System/creg/SerializeLuaState.h"
@@ -38,6 +40,7 @@
 #include "System/Rectangle.h"
 #include "System/ScopedFPUSettings.h"
 #include "System/StringUtil.h"
+#include "System/TimeProfiler.h"
 #include "System/Log/ILog.h"
 #include "System/Input/KeyInput.h"
 #include "System/Platform/SDL1_keysym.h"
@@ -52,7 +55,7 @@
 #include <string>
 
 
-CONFIG(float, LuaGarbageCollectionMemLoadMult).defaultValue(1.33f).minimumValue(1.0f).maximumValue(100.0f);
+CONFIG(float, LuaGarbageCollectionMemLoadMult).defaultValue(1.33f).minimumValue(1.0f).maximumValue(100.0f).description("Extra collector work per allocated byte when Lua memory usage nears its limit.");
 CONFIG(float, LuaGarbageCollectionRunTimeMult).defaultValue(5.0f).minimumValue(1.0f).description("in milliseconds");
 
 
@@ -61,6 +64,7 @@ static spring::unsynced_set<const luaContextData*>  UNSYNCED_LUAHANDLE_CONTEXTS;
 const  spring::unsynced_set<const luaContextData*>*          LUAHANDLE_CONTEXTS[2] = {&UNSYNCED_LUAHANDLE_CONTEXTS, &SYNCED_LUAHANDLE_CONTEXTS};
 
 bool CLuaHandle::devMode = false;
+spring_time CLuaHandle::gcIdleEndTime = spring_notime;
 
 
 /******************************************************************************/
@@ -108,6 +112,13 @@ CLuaHandle::CLuaHandle(const string& _name, int _order, bool _userMode, bool _sy
 	D.gcCtrl.baseMemLoadMult = configHandler->GetFloat("LuaGarbageCollectionMemLoadMult");
 	D.gcCtrl.baseRunTimeMult = configHandler->GetFloat("LuaGarbageCollectionRunTimeMult");
 
+	gcTimerName = "Lua::CollectGarbage::" + name + ((_synced)? "::Synced": "::Unsynced");
+	gcCounterNames[0] = gcTimerName + "::HeapKB";
+	gcCounterNames[1] = gcTimerName + "::GrowthKBps";
+	gcCounterNames[2] = gcTimerName + "::DebtKB";
+
+	CTimeProfiler::RegisterTimer(gcTimerName.c_str());
+
 	L = LUA_OPEN(&D);
 	L_GC = lua_newthread(L);
 
@@ -128,6 +139,8 @@ CLuaHandle::~CLuaHandle()
 	// KillLua() must be called before us!
 	assert(!IsValid());
 	assert(!eventHandler.HasClient(this));
+
+	CTimeProfiler::UnRegisterTimer(gcTimerName.c_str());
 }
 
 
@@ -320,10 +333,20 @@ int CLuaHandle::RunCallInTraceback(
 			}
 
 			top = lua_gettop(state);
+
+			const bool profile = luaProfiler.IsEnabled();
+
+			if (profile)
+				luaProfiler.BeginCallIn(state, handle->GetName(), GetHandleSynced(state), luaFunc);
+
 			// note1: disable GC outside of this scope to prevent sync errors and similar
 			// note2: we collect garbage now in its own callin "CollectGarbage"
 			// lua_gc(L, LUA_GCRESTART, 0);
 			error = lua_pcall(state, nInArgs, nOutArgs, errFuncIdx);
+
+			if (profile)
+				luaProfiler.EndCallIn();
+
 			// only run GC inside of "SetHandleRunning(L, true) ... SetHandleRunning(L, false)"!
 			lua_gc(state, LUA_GCSTOP, 0);
 
@@ -2506,67 +2529,109 @@ void CLuaHandle::CollectGarbage(bool forced)
 	const float gcMemLoadMult = D.gcCtrl.baseMemLoadMult;
 	const float gcRunTimeMult = D.gcCtrl.baseRunTimeMult;
 
-	if (!forced && spring_lua_alloc_skip_gc(gcMemLoadMult))
-		return;
+	SLuaGarbageCollectStats& gcStats = D.gcStats;
 
-	LUA_CALL_IN_CHECK_NAMED(L, (GetLuaContextData(L)->synced)? "Lua::CollectGarbage::Synced": "Lua::CollectGarbage::Unsynced");
+	const spring_time startTime = spring_gettime();
+	const spring_time deltaTime = startTime - gcStats.prevCallTime;
 
-	lua_lock(L_GC);
-	SetHandleRunning(L_GC, true);
+	const bool idleCall = (gcIdleEndTime > startTime);
 
-	// note: total footprint INCLUDING garbage, in KB
-	int  gcMemFootPrint = lua_gc(L_GC, LUA_GCCOUNT, 0);
-	int  gcItersInBatch = 0;
-	int& gcStepsPerIter = D.gcCtrl.numStepsPerIter;
+	{
+		// the collector only runs in here, so net growth since the previous call
+		// is (nearly) all the handle allocated; owe work in proportion as Lua's
+		// own incremental GC would, paying it off evenly instead of in bursts
+		const std::int64_t heapGrowth = std::int64_t(D.allocState.allocedBytes.load()) - gcStats.prevAllocedBytes;
+		const float heapGrowthKB = heapGrowth / 1024.0f;
 
-	// if gc runs at a fixed rate, the upper limit to base runtime will
-	// quickly be reached since Lua's footprint can easily exceed 100MB
-	// and OOM exceptions become a concern when catching up
-	// OTOH if gc is tied to sim-speed the increased number of calls can
-	// mean too much time is spent on it, must weigh the per-call period
-	const float gcSpeedFactor = Clamp(gs->speedFactor * (1 - gs->PreSimFrame()) * (1 - gs->paused), 1.0f, 50.0f);
-	const float gcBaseRunTime = smoothstep(10.0f, 100.0f, gcMemFootPrint / 1024);
-	const float gcLoopRunTime = Clamp((gcBaseRunTime * gcRunTimeMult) / gcSpeedFactor, D.gcCtrl.minLoopRunTime, D.gcCtrl.maxLoopRunTime);
+		gcStats.debt += (std::max(heapGrowthKB, 0.0f) * (1.0f + gcMemLoadMult * spring_lua_alloc_get_load()));
+		gcStats.growthRate = mix(gcStats.growthRate, heapGrowthKB / std::max(deltaTime.toSecsf(), 0.001f), 0.1f);
+		gcStats.prevCallTime = startTime;
+	}
 
-	const spring_time startTime = spring_gettime();
-	const spring_time   endTime = startTime + spring_msecs(gcLoopRunTime);
+	// idle calls may also work ahead for frames that have no time to spare
+	if (forced || idleCall || gcStats.debt > 0.0f) {
+		LUA_CALL_IN_CHECK_NAMED(L, (GetLuaContextData(L)->synced)? "Lua::CollectGarbage::Synced": "Lua::CollectGarbage::Unsynced");
+		ScopedTimer gcTimer(hashString(gcTimerName.c_str()));
+
+		lua_lock(L_GC);
+		SetHandleRunning(L_GC, true);
+
+		// note: total footprint INCLUDING garbage, in KB
+		int  gcMemFootPrint = lua_gc(L_GC, LUA_GCCOUNT, 0);
+		int  gcItersInBatch = 0;
+		int& gcStepsPerIter = D.gcCtrl.numStepsPerIter;
+
+		// if gc runs at a fixed rate, the upper limit to base runtime will
+		// quickly be reached since Lua's footprint can easily exceed 100MB
+		// and OOM exceptions become a concern when catching up
+		// OTOH if gc is tied to sim-speed the increased number of calls can
+		// mean too much time is spent on it, must weigh the per-call period
+		// (debt the budget does not cover carries over to the next call)
+		const float gcSpeedFactor = Clamp(gs->speedFactor * (1 - gs->PreSimFrame()) * (1 - gs->paused), 1.0f, 50.0f);
+		const float gcBaseRunTime = smoothstep(10.0f, 100.0f, gcMemFootPrint / 1024);
+		const float gcLoopRunTime = Clamp((gcBaseRunTime * gcRunTimeMult) / gcSpeedFactor, D.gcCtrl.minLoopRunTime, D.gcCtrl.maxLoopRunTime);
+
+		// working ahead is bounded by a full cycle's worth
+		const float    minDebt = -gcMemFootPrint * idleCall;
+		const spring_time endTime = (idleCall)? gcIdleEndTime: (startTime + spring_msecs(gcLoopRunTime));
+
+		// perform GC steps until the debt is paid, time runs out or iteration-limit is reached
+		while (forced || (gcItersInBatch < D.gcCtrl.itersPerBatch && gcStats.debt > minDebt && spring_gettime() < endTime)) {
+			gcItersInBatch++;
+			gcStats.debt -= gcStepsPerIter;
+
+			if (!lua_gc(L_GC, LUA_GCSTEP, gcStepsPerIter))
+				continue;
+
+			// garbage-collection cycle finished
+			const int gcMemFootPrintNow = lua_gc(L_GC, LUA_GCCOUNT, 0);
+			const int gcMemFootPrintDif = gcMemFootPrintNow - gcMemFootPrint;
+
+			gcMemFootPrint = gcMemFootPrintNow;
+			gcStats.numCycles++;
+
+			// early-exit if cycle didn't free any memory
+			if (gcMemFootPrintDif == 0)
+				break;
+		}
 
-	// perform GC cycles until time runs out or iteration-limit is reached
-	while (forced || (gcItersInBatch < D.gcCtrl.itersPerBatch && spring_gettime() < endTime)) {
-		gcItersInBatch++;
+		// don't collect garbage outside of CollectGarbage
+		lua_gc(L_GC, LUA_GCSTOP, 0);
+		SetHandleRunning(L_GC, false);
+		lua_unlock(L_GC);
 
-		if (!lua_gc(L_GC, LUA_GCSTEP, gcStepsPerIter))
-			continue;
 
-		// garbage-collection cycle finished
-		const int gcMemFootPrintNow = lua_gc(L_GC, LUA_GCCOUNT, 0);
-		const int gcMemFootPrintDif = gcMemFootPrintNow - gcMemFootPrint;
+		const spring_time finishTime = spring_gettime();
 
-		gcMemFootPrint = gcMemFootPrintNow;
+		if (gcStepsPerIter > 1 && gcItersInBatch > 0) {
+			// runtime optimize number of steps to process in a batch
+			const float avgLoopIterTime = (finishTime - startTime).toMilliSecsf() / gcItersInBatch;
 
-		// early-exit if cycle didn't free any memory
-		if (gcMemFootPrintDif == 0)
-			break;
-	}
+			gcStepsPerIter -= (avgLoopIterTime > (gcRunTimeMult * 0.150f));
+			gcStepsPerIter += (avgLoopIterTime < (gcRunTimeMult * 0.075f));
+			gcStepsPerIter  = Clamp(gcStepsPerIter, D.gcCtrl.minStepsPerIter, D.gcCtrl.maxStepsPerIter);
+		}
 
-	// don't collect garbage outside of CollectGarbage
-	lua_gc(L_GC, LUA_GCSTOP, 0);
-	SetHandleRunning(L_GC, false);
-	lua_unlock(L_GC);
+		if (forced)
+			gcStats.debt = 0.0f;
 
+		gcStats.totalTime += (finishTime - startTime);
 
-	const spring_time finishTime = spring_gettime();
+		eventHandler.DbgTimingInfo(TIMING_GC, startTime, finishTime);
+	}
 
-	if (gcStepsPerIter > 1 && gcItersInBatch > 0) {
-		// runtime optimize number of steps to process in a batch
-		const float avgLoopIterTime = (finishTime - startTime).toMilliSecsf() / gcItersInBatch;
+	gcStats.prevAllocedBytes = D.allocState.allocedBytes.load();
 
-		gcStepsPerIter -= (avgLoopIterTime > (gcRunTimeMult * 0.150f));
-		gcStepsPerIter += (avgLoopIterTime < (gcRunTimeMult * 0.075f));
-		gcStepsPerIter  = Clamp(gcStepsPerIter, D.gcCtrl.minStepsPerIter, D.gcCtrl.maxStepsPerIter);
-	}
+	profiler.SetCounter(gcCounterNames[0].c_str(), gcStats.prevAllocedBytes / 1024);
+	profiler.SetCounter(gcCounterNames[1].c_str(), gcStats.growthRate);
+	profiler.SetCounter(gcCounterNames[2].c_str(), gcStats.debt);
+}
 
-	eventHandler.DbgTimingInfo(TIMING_GC, startTime, finishTime);
+void CLuaHandle::CollectGarbageIdle(spring_time endTime)
+{
+	gcIdleEndTime = endTime;
+	eventHandler.CollectGarbage(false);
+	gcIdleEndTime = spring_notime;
 }
 
 /******************************************************************************/
@@ -2578,6 +2643,7 @@ bool CLuaHandle::AddBasicCalls(lua_State* L)
 	lua_newtable(L); {
 		HSTR_PUSH_CFUNC(L, "Kill",            KillActiveHandle);
 		HSTR_PUSH_CFUNC(L, "UpdateCallIn",    CallOutUpdateCallIn);
+		HSTR_PUSH_CFUNC(L, "SetCallInFilter", CallOutSetCallInFilter);
 		HSTR_PUSH_CFUNC(L, "GetName",         CallOutGetName);
 		HSTR_PUSH_CFUNC(L, "GetSynced",       CallOutGetSynced);
 		HSTR_PUSH_CFUNC(L, "GetFullCtrl",     CallOutGetFullCtrl);
@@ -2702,6 +2768,9 @@ int CLuaHandle::CallOutGetCallInList(lua_State* L)
 			lua_pushliteral(L, "controller");
 			lua_pushboolean(L, eventHandler.IsController(event));
 			lua_rawset(L, -3);
+			lua_pushliteral(L, "filterable");
+			lua_pushboolean(L, eventHandler.IsFilterable(event));
+			lua_rawset(L, -3);
 		}
 		lua_rawset(L, -3);
 	}
@@ -2719,5 +2788,52 @@ int CLuaHandle::CallOutUpdateCallIn(lua_State* L)
 }
 
 
+static void ParseCallInFilterSet(lua_State* L, int table, const char* key, int maxID, std::vector<bool>& set)
+{
+	lua_getfield(L, table, key);
+
+	if (lua_istable(L, -1)) {
+		// either {id1, id2, ...} or {[id1] = true, [id2] = true, ...}
+		for (lua_pushnil(L); lua_next(L, -2) != 0; lua_pop(L, 1)) {
+			int id = -1;
+
+			if (lua_israwnumber(L, -1)) {
+				id = lua_toint(L, -1);
+			} else if (lua_isboolean(L, -1) && lua_toboolean(L, -1) && lua_israwnumber(L, -2)) {
+				id = lua_toint(L, -2);
+			}
+
+			if (id < 0 || id > maxID)
+				continue;
+
+			set.resize(std::max(set.size(), size_t(id + 1)), false);
+			set[id] = true;
+		}
+
+		// an empty set does not restrict, make one that matches nothing
+		if (set.empty())
+			set.resize(1, false);
+	}
+
+	lua_pop(L, 1);
+}
+
+int CLuaHandle::CallOutSetCallInFilter(lua_State* L)
+{
+	const std::string name = luaL_checkstring(L, 1);
+
+	SUnitEventFilter filter;
+
+	// no table (or one without sets) removes the filter
+	if (lua_istable(L, 2)) {
+		ParseCallInFilterSet(L, 2, "unitDefIDs", (unitDefHandler != nullptr)? unitDefHandler->NumUnitDefs(): 0, filter.unitDefIDs);
+		ParseCallInFilterSet(L, 2, "teamIDs", teamHandler.ActiveTeams() - 1, filter.teamIDs);
+	}
+
+	lua_pushboolean(L, eventHandler.SetUnitEventFilter(GetHandle(L), name, filter));
+	return 1;
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
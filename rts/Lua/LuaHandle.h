@@ -312,6 +312,10 @@ class CLuaHandle : public CEventClient
 
 		std::string killMsg;
 
+		// per-handle GC profiling, see CollectGarbage
+		std::string gcTimerName;
+		std::string gcCounterNames[3];
+
 		std::vector<bool> watchUnitDefs;        // callin masks for Unit*Collision, UnitMoveFailed
 		std::vector<bool> watchFeatureDefs;     // callin masks for UnitFeatureCollision
 		std::vector<bool> watchProjectileDefs;  // callin masks for Projectile*
@@ -332,6 +336,7 @@ class CLuaHandle : public CEventClient
 		static int CallOutGetRegistry(lua_State* L);
 		static int CallOutGetCallInList(lua_State* L);
 		static int CallOutUpdateCallIn(lua_State* L);
+		static int CallOutSetCallInFilter(lua_State* L);
 		static int CallOutIsEngineMinVersion(lua_State* L);
 
 	public: // static
@@ -347,8 +352,12 @@ class CLuaHandle : public CEventClient
 
 		static void HandleLuaMsg(int playerID, int script, int mode, const std::vector<std::uint8_t>& msg);
 
+		/// lets every handle collect garbage until <endTime>, for when the engine would otherwise wait
+		static void CollectGarbageIdle(spring_time endTime);
+
 	protected: // static
 		static bool devMode; // allows real file access
+		static spring_time gcIdleEndTime; // set during CollectGarbageIdle
 
 		// FIXME: because CLuaUnitScript needs to access RunCallIn
 		friend class CLuaUnitScript;
@@ -0,0 +1,402 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include "LuaProfiler.h"
+#include "LuaInclude.h"
+#include "System/StringHash.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/Log/ILog.h"
+
+#ifndef UNIT_TEST
+CONFIG(bool, LuaProfiler).defaultValue(false).description("Profile Lua callins from the start of every game, results are written to luaprofile-*.{txt,folded} when it ends. See /LuaProfiler.");
+CONFIG(int, LuaProfilerSamplePeriod).defaultValue(1000).minimumValue(50).description("Microseconds of Lua execution between two stack samples taken by the Lua profiler.");
+#endif
+
+// number of VM instructions between two checks of the sample period
+static constexpr int HOOK_INSTR_COUNT = 1000;
+static constexpr int MAX_STACK_DEPTH = 64;
+
+
+static void AppendFrameName(std::string& s, const lua_Debug& ar)
+{
+	const size_t pos = s.size();
+
+	if (ar.what[0] == 'C') {
+		s += "[C] ";
+		s += (ar.name != nullptr)? ar.name: "?";
+	} else {
+		s += (ar.name != nullptr)? ar.name: ((ar.what[0] == 'm')? "main": "?");
+		s += ' ';
+		s += ar.short_src;
+		s += ':';
+		s += std::to_string(ar.linedefined);
+	}
+
+	// separators of the collapsed-stack format, chunk-names can be arbitrary strings
+	std::replace(s.begin() + pos, s.end(), ';', ',');
+	std::replace(s.begin() + pos, s.end(), '\n', ' ');
+}
+
+template<typename T, typename Pred>
+static unsigned int FindKey(const spring::unordered_map<unsigned int, T>& map, unsigned int hash, Pred matches)
+{
+	// returns the key of the matching record, or the first free one
+	for (auto it = map.find(hash); it != map.end() && !matches(it->second); it = map.find(++hash));
+	return hash;
+}
+
+static void SortByValue(std::vector< std::pair<std::string, std::int64_t> >& vec)
+{
+	std::sort(vec.begin(), vec.end(), [](const std::pair<std::string, std::int64_t>& a, const std::pair<std::string, std::int64_t>& b) {
+		return (a.second > b.second);
+	});
+}
+
+
+
+CLuaProfiler& CLuaProfiler::GetInstance()
+{
+	static CLuaProfiler instance;
+	return instance;
+}
+
+std::vector<CLuaProfiler::CallInFrame>& CLuaProfiler::GetCallInFrames()
+{
+	// callins nest, e.g. when a call-out triggers an event
+	static thread_local std::vector<CallInFrame> frames;
+	return frames;
+}
+
+
+void CLuaProfiler::Enable(bool enable)
+{
+	if (enable)
+		samplePeriod = spring_time::fromMicroSecs(configHandler->GetInt("LuaProfilerSamplePeriod"));
+
+	// hooks remove themselves when disabled
+	enabled = enable;
+
+	LOG("[LuaProfiler] %s (sample-period %ius)", (enable? "enabled": "disabled"), int(samplePeriod.toMicroSecsi()));
+}
+
+void CLuaProfiler::Reset()
+{
+	std::lock_guard<spring::spinlock> lock(mutex);
+
+	callIns.clear();
+	functions.clear();
+	stacks.clear();
+	lines.clear();
+}
+
+
+void CLuaProfiler::BeginCallIn(lua_State* L, const std::string& handleName, bool synced, const char* callIn)
+{
+	std::vector<CallInFrame>& frames = GetCallInFrames();
+
+	const spring_time now = spring_gettime();
+
+	// an outer callin is suspended in a call-out, close its current sample
+	if (!frames.empty())
+		AddSample(frames.back(), frames.back().state, now);
+
+	frames.push_back({L, &handleName, callIn, hashString(callIn, -1u, HashString(handleName) * 2 + synced), synced, now, now});
+
+	// leave hooks set from Lua (debug.sethook) alone
+	if (lua_gethook(L) == nullptr)
+		lua_sethook(L, SampleHook, LUA_MASKCOUNT, HOOK_INSTR_COUNT);
+}
+
+void CLuaProfiler::EndCallIn()
+{
+	std::vector<CallInFrame>& frames = GetCallInFrames();
+
+	if (frames.empty())
+		return;
+
+	const spring_time now = spring_gettime();
+
+	CallInFrame& frame = frames.back();
+
+	// the remainder can not be placed any deeper, stack has unwound
+	AddSample(frame, nullptr, now);
+
+	{
+		const spring_time dt = now - frame.startTime;
+
+		std::lock_guard<spring::spinlock> lock(mutex);
+
+		CallInRecord& r = callIns[GetCallInKey(frame)];
+
+		r.numCalls += 1;
+		r.totalTime += dt;
+		r.maxTime = std::max(r.maxTime, dt);
+	}
+
+	frames.pop_back();
+
+	// time spent in the inner callin is not the outer's
+	if (!frames.empty())
+		frames.back().sampleTime = now;
+}
+
+
+void CLuaProfiler::SampleHook(lua_State* L, lua_Debug* ar)
+{
+	CLuaProfiler& p = GetInstance();
+
+	if (!p.IsEnabled()) {
+		lua_sethook(L, nullptr, 0, 0);
+		return;
+	}
+
+	std::vector<CallInFrame>& frames = GetCallInFrames();
+
+	// code not run as a callin, e.g. while loading
+	if (frames.empty())
+		return;
+
+	const spring_time now = spring_gettime();
+
+	if ((now - frames.back().sampleTime) < p.samplePeriod)
+		return;
+
+	// L can be a coroutine resumed by the callin's state
+	p.AddSample(frames.back(), L, now);
+}
+
+void CLuaProfiler::AddSample(CallInFrame& frame, lua_State* L, spring_time sampleTime)
+{
+	const std::int64_t weight = (sampleTime - frame.sampleTime).toMicroSecsi();
+
+	frame.sampleTime = sampleTime;
+
+	if (weight <= 0)
+		return;
+
+	lua_Debug ars[MAX_STACK_DEPTH];
+	unsigned int functionKeys[MAX_STACK_DEPTH];
+
+	int depth = 0;
+	int lineDepth = -1;
+
+	bool truncated = false;
+
+	if (L != nullptr) {
+		// innermost first
+		for (; depth < MAX_STACK_DEPTH && lua_getstack(L, depth, &ars[depth]) != 0; depth++) {
+			lua_getinfo(L, "Sln", &ars[depth]);
+
+			if (lineDepth < 0 && ars[depth].currentline > 0)
+				lineDepth = depth;
+		}
+
+		lua_Debug ar;
+		truncated = (depth == MAX_STACK_DEPTH && lua_getstack(L, depth, &ar) != 0);
+	}
+
+	std::lock_guard<spring::spinlock> lock(mutex);
+
+	const unsigned int callInKey = GetCallInKey(frame);
+
+	unsigned int stackHash = callInKey * 2 + truncated;
+
+	for (int i = 0; i < depth; i++) {
+		functionKeys[i] = GetFunctionKey(ars[depth - 1 - i]);
+		stackHash = stackHash * 31 + functionKeys[i];
+	}
+
+	const unsigned int stackKey = FindKey(stacks, stackHash, [&](const StackRecord& r) {
+		return (r.callInKey == callInKey && r.truncated == truncated && std::equal(r.functionKeys.begin(), r.functionKeys.end(), functionKeys, functionKeys + depth));
+	});
+
+	auto it = stacks.find(stackKey);
+
+	if (it == stacks.end())
+		it = stacks.emplace(stackKey, StackRecord{callInKey, truncated, {functionKeys, functionKeys + depth}, 0}).first;
+
+	it->second.weight += weight;
+
+	if (lineDepth < 0)
+		return;
+
+	lines[(std::uint64_t(functionKeys[depth - 1 - lineDepth]) << 32) | std::uint32_t(ars[lineDepth].currentline)] += weight;
+}
+
+
+unsigned int CLuaProfiler::GetCallInKey(const CallInFrame& frame)
+{
+	const unsigned int key = FindKey(callIns, frame.callInHash, [&](const CallInRecord& r) {
+		return (r.synced == frame.synced && r.callInName == frame.callInName && r.handleName == *frame.handleName);
+	});
+
+	if (callIns.find(key) != callIns.end())
+		return key;
+
+	CallInRecord& r = callIns[key];
+
+	r.handleName = *frame.handleName;
+	r.callInName = frame.callInName;
+	r.synced = frame.synced;
+	return key;
+}
+
+unsigned int CLuaProfiler::GetFunctionKey(const lua_Debug& ar)
+{
+	// source and linedefined identify a Lua function, the name (of the first call) is only displayed
+	const char* cName = (ar.what[0] == 'C' && ar.name != nullptr)? ar.name: "";
+
+	const unsigned int hash = (HashString(ar.source, std::string::npos) * 31 + ar.linedefined) * 31 + HashString(cName, std::string::npos);
+	const unsigned int key = FindKey(functions, hash, [&](const FunctionRecord& r) {
+		return (r.lineDefined == ar.linedefined && r.source == ar.source && r.cName == cName);
+	});
+
+	if (functions.find(key) != functions.end())
+		return key;
+
+	FunctionRecord& r = functions[key];
+
+	r.source = ar.source;
+	r.cName = cName;
+	r.shortSrc = ar.short_src;
+	r.lineDefined = ar.linedefined;
+
+	AppendFrameName(r.name, ar);
+	return key;
+}
+
+
+std::vector< std::pair<std::string, std::int64_t> > CLuaProfiler::GetSortedStacks() const
+{
+	std::vector< std::pair<std::string, std::int64_t> > vec;
+	vec.reserve(stacks.size());
+
+	for (const auto& p: stacks) {
+		const StackRecord& s = p.second;
+		const CallInRecord& r = callIns.find(s.callInKey)->second;
+
+		std::string stack = r.handleName + ((r.synced)? "::Synced;": "::Unsynced;") + r.callInName;
+
+		if (s.truncated)
+			stack += ";...";
+
+		for (const unsigned int functionKey: s.functionKeys) {
+			stack += ';';
+			stack += functions.find(functionKey)->second.name;
+		}
+
+		vec.emplace_back(std::move(stack), s.weight);
+	}
+
+	SortByValue(vec);
+	return vec;
+}
+
+std::vector< std::pair<std::string, std::int64_t> > CLuaProfiler::GetSortedLines() const
+{
+	std::vector< std::pair<std::string, std::int64_t> > vec;
+	vec.reserve(lines.size());
+
+	for (const auto& p: lines) {
+		const FunctionRecord& f = functions.find(p.first >> 32)->second;
+
+		vec.emplace_back(f.shortSrc + ":" + std::to_string(std::uint32_t(p.first)), p.second);
+	}
+
+	SortByValue(vec);
+	return vec;
+}
+
+
+void CLuaProfiler::PrintStats(unsigned int maxEntries) const
+{
+	std::vector< std::pair<unsigned int, CallInRecord> > sortedCallIns;
+	std::vector< std::pair<std::string, std::int64_t> > sortedLines;
+
+	{
+		std::lock_guard<spring::spinlock> lock(mutex);
+
+		// callins still running have been sampled but not yet counted
+		std::copy_if(callIns.begin(), callIns.end(), std::back_inserter(sortedCallIns), [](const decltype(callIns)::value_type& p) { return (p.second.numCalls > 0); });
+		sortedLines = GetSortedLines();
+	}
+
+	std::sort(sortedCallIns.begin(), sortedCallIns.end(), [](const std::pair<unsigned int, CallInRecord>& a, const std::pair<unsigned int, CallInRecord>& b) {
+		return (a.second.totalTime > b.second.totalTime);
+	});
+
+	LOG("[LuaProfiler] %u callins, %u source lines", unsigned(sortedCallIns.size()), unsigned(sortedLines.size()));
+	LOG("%35s|%10s|%12s|%10s|%10s", "Handle::CallIn", "Calls", "Total [ms]", "Mean [us]", "Max [us]");
+
+	for (size_t i = 0, n = std::min(sortedCallIns.size(), size_t(maxEntries)); i < n; i++) {
+		const CallInRecord& r = sortedCallIns[i].second;
+		const std::string name = r.handleName + ((r.synced)? "::Synced::": "::Unsynced::") + r.callInName;
+
+		LOG("%35s %10" PRIu64 " %12.2f %10.1f %10" PRId64, name.c_str(), r.numCalls, r.totalTime.toMilliSecsf(), r.totalTime.toMicroSecsi() * 1.0f / r.numCalls, r.maxTime.toMicroSecsi());
+	}
+
+	LOG("%35s|%12s", "Source Line", "Total [ms]");
+
+	for (size_t i = 0, n = std::min(sortedLines.size(), size_t(maxEntries)); i < n; i++) {
+		LOG("%35s %12.2f", sortedLines[i].first.c_str(), sortedLines[i].second * 0.001f);
+	}
+}
+
+bool CLuaProfiler::Dump(const std::string& name) const
+{
+	std::vector< std::pair<unsigned int, CallInRecord> > sortedCallIns;
+	std::vector< std::pair<std::string, std::int64_t> > sortedLines;
+	std::vector< std::pair<std::string, std::int64_t> > sortedStacks;
+
+	{
+		std::lock_guard<spring::spinlock> lock(mutex);
+
+		// callins still running have been sampled but not yet counted
+		std::copy_if(callIns.begin(), callIns.end(), std::back_inserter(sortedCallIns), [](const decltype(callIns)::value_type& p) { return (p.second.numCalls > 0); });
+		sortedLines = GetSortedLines();
+		sortedStacks = GetSortedStacks();
+	}
+
+	std::sort(sortedCallIns.begin(), sortedCallIns.end(), [](const std::pair<unsigned int, CallInRecord>& a, const std::pair<unsigned int, CallInRecord>& b) {
+		return (a.second.totalTime > b.second.totalTime);
+	});
+
+	const std::string txtFileName = dataDirsAccess.LocateFile(name + ".txt", FileQueryFlags::WRITE);
+	const std::string stkFileName = dataDirsAccess.LocateFile(name + ".folded", FileQueryFlags::WRITE);
+
+	std::ofstream txtFile(txtFileName.c_str());
+	std::ofstream stkFile(stkFileName.c_str());
+
+	if (!txtFile.is_open() || !stkFile.is_open()) {
+		LOG_L(L_ERROR, "[LuaProfiler::%s] could not open \"%s\" for writing", __func__, (txtFile.is_open()? stkFileName: txtFileName).c_str());
+		return false;
+	}
+
+	txtFile << "# handle\tcallin\tcalls\ttotal[ms]\tmean[us]\tmax[us]\n";
+
+	for (const auto& p: sortedCallIns) {
+		const CallInRecord& r = p.second;
+
+		txtFile << r.handleName << ((r.synced)? "::Synced": "::Unsynced") << '\t' << r.callInName << '\t' << r.numCalls << '\t';
+		txtFile << r.totalTime.toMilliSecsf() << '\t' << (r.totalTime.toMicroSecsi() * 1.0f / r.numCalls) << '\t' << r.maxTime.toMicroSecsi() << '\n';
+	}
+
+	txtFile << "\n# source:line\ttotal[ms]\n";
+
+	for (const auto& p: sortedLines) {
+		txtFile << p.first << '\t' << (p.second * 0.001f) << '\n';
+	}
+
+	// weights in microseconds
+	for (const auto& p: sortedStacks) {
+		stkFile << p.first << ' ' << p.second << '\n';
+	}
+
+	LOG("[LuaProfiler] wrote \"%s\" and \"%s\"", txtFileName.c_str(), stkFileName.c_str());
+	return true;
+}
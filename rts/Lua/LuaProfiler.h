@@ -0,0 +1,123 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef LUA_PROFILER_H
+#define LUA_PROFILER_H
+
+#include <atomic>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "System/Misc/SpringTime.h"
+#include "System/UnorderedMap.hpp"
+#include "System/Threading/SpringThreading.h"
+
+struct lua_State;
+struct lua_Debug;
+
+/**
+ * @brief Per-callin Lua profiler
+ *
+ * Times every callin run through CLuaHandle::RunCallInTraceback and, via a
+ * count-hook on the callin's state, samples its Lua stack whenever another
+ * sample-period of Lua execution has passed. Each sample is weighted by the
+ * time since the previous one, whatever a callin's samples do not cover is
+ * attributed to the callin itself, so per-callin totals are exact.
+ *
+ * Results are aggregated per callin, per source line, and per collapsed
+ * stack ("handle;callin;outermost;...;innermost weight"), the input format
+ * of flamegraph.pl and compatible tools. While disabled a callin costs one
+ * atomic load.
+ */
+class CLuaProfiler {
+public:
+	static CLuaProfiler& GetInstance();
+
+	bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	void Enable(bool enable);
+	void Reset();
+
+	/// must be paired with EndCallIn on the same thread; <handleName> must outlive the call
+	void BeginCallIn(lua_State* L, const std::string& handleName, bool synced, const char* callIn);
+	void EndCallIn();
+
+	void PrintStats(unsigned int maxEntries) const;
+	/// writes <name>.txt (per-callin and per-line tables) and <name>.folded (collapsed stacks)
+	bool Dump(const std::string& name) const;
+
+private:
+	struct CallInRecord {
+		std::string handleName;
+		std::string callInName;
+
+		bool synced = false;
+
+		std::uint64_t numCalls = 0;
+
+		spring_time totalTime;
+		spring_time maxTime;
+	};
+
+	/// a function on a sampled stack, interned so that samples of known stacks do not allocate
+	struct FunctionRecord {
+		std::string source;   // lua_Debug::source, identifies the chunk
+		std::string cName;    // C functions all share one source
+		std::string shortSrc; // for per-line results
+		std::string name;     // collapsed-stack frame, named after the first call seen
+
+		int lineDefined;
+	};
+
+	struct StackRecord {
+		unsigned int callInKey;
+
+		bool truncated;
+
+		std::vector<unsigned int> functionKeys; // outermost first
+		std::int64_t weight; // microseconds
+	};
+
+	struct CallInFrame {
+		lua_State* state;
+
+		const std::string* handleName;
+		const char* callInName;
+
+		unsigned int callInHash;
+
+		bool synced;
+
+		spring_time startTime;
+		spring_time sampleTime;
+	};
+
+	static std::vector<CallInFrame>& GetCallInFrames();
+	static void SampleHook(lua_State* L, lua_Debug* ar);
+
+	/// attributes the time since the frame's previous sample to <L>'s stack, or to the callin if null
+	void AddSample(CallInFrame& frame, lua_State* L, spring_time sampleTime);
+
+	// map keys are hashes, a collision moves on to the next free key; mutex must be held
+	unsigned int GetCallInKey(const CallInFrame& frame);
+	unsigned int GetFunctionKey(const lua_Debug& ar);
+
+	std::vector< std::pair<std::string, std::int64_t> > GetSortedStacks() const;
+	std::vector< std::pair<std::string, std::int64_t> > GetSortedLines() const;
+
+private:
+	spring::unordered_map<unsigned int, CallInRecord> callIns;
+	spring::unordered_map<unsigned int, FunctionRecord> functions;
+	spring::unordered_map<unsigned int, StackRecord> stacks;
+	spring::unordered_map<std::uint64_t, std::int64_t> lines; // (function, line) -> microseconds
+
+	mutable spring::spinlock mutex;
+
+	spring_time samplePeriod;
+
+	std::atomic<bool> enabled = {false};
+};
+
+#define luaProfiler (CLuaProfiler::GetInstance())
+
+#endif /* LUA_PROFILER_H */
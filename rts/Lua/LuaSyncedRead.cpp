@@ -190,6 +190,7 @@ bool LuaSyncedRead::PushEntries(lua_State* L)
 	REGISTER_LUA_CFUNC(GetUnitAllyTeam);
 	REGISTER_LUA_CFUNC(GetUnitNeutral);
 	REGISTER_LUA_CFUNC(GetUnitHealth);
+	REGISTER_LUA_CFUNC(GetUnitArrayHealths);
 	REGISTER_LUA_CFUNC(GetUnitIsDead);
 	REGISTER_LUA_CFUNC(GetUnitIsStunned);
 	REGISTER_LUA_CFUNC(GetUnitResources);
@@ -209,6 +210,7 @@ bool LuaSyncedRead::PushEntries(lua_State* L)
 	REGISTER_LUA_CFUNC(GetUnitMass);
 	REGISTER_LUA_CFUNC(GetUnitPosition);
 	REGISTER_LUA_CFUNC(GetUnitBasePosition);
+	REGISTER_LUA_CFUNC(GetUnitArrayPositions);
 	REGISTER_LUA_CFUNC(GetUnitVectors);
 	REGISTER_LUA_CFUNC(GetUnitRotation);
 	REGISTER_LUA_CFUNC(GetUnitDirection);
@@ -705,6 +707,34 @@ static inline const CUnit* ParseTypedUnit(lua_State* L, const char* caller, int
 }
 
 
+static inline int ParseUnitArray(lua_State* L, const char* caller, int index)
+{
+	if (!lua_istable(L, index))
+		luaL_error(L, "[%s] unitIDs (arg #%d) not a table\n", caller, index);
+
+	return (lua_objlen(L, index));
+}
+
+// pushes unitIDs[elem] of the array at <index>; checked here so errors name the element
+static inline void PushUnitArrayElement(lua_State* L, const char* caller, int index, int elem)
+{
+	lua_rawgeti(L, index, elem);
+
+	if (!lua_isnumber(L, -1))
+		luaL_error(L, "[%s] bad unitID at index %d of arg #%d\n", caller, elem, index);
+}
+
+// output tables are optional; reusing one across calls saves allocations
+static inline void ParseOutputTable(lua_State* L, int index, int size)
+{
+	if (lua_istable(L, index))
+		return;
+
+	lua_createtable(L, size, 0);
+	lua_replace(L, index);
+}
+
+
 static const CFeature* ParseFeature(lua_State* L, const char* caller, int index)
 {
 	if (!lua_isnumber(L, index)) {
@@ -2202,11 +2232,12 @@ int LuaSyncedRead::GetUnitsInRectangle(lua_State* L)
 
 	const int allegiance = ParseAllegiance(L, __func__, 5);
 
-#define RECTANGLE_TEST ; // no test, GetUnitsExact is sufficient
+#define RECTANGLE_TEST ; // no test, the rectangle query is sufficient
 
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, mins, maxs);
-	const auto& units = (*qfQuery.units);
+	QuadFieldBatchQuery qfBatch;
+	qfBatch.AddRectangle(mins, maxs);
+	quadField.GetUnitsExact(qfBatch);
+	const auto& units = qfBatch.units;
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -2253,9 +2284,10 @@ int LuaSyncedRead::GetUnitsInBox(lua_State* L)
 		continue;                     \
 	}
 
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, mins, maxs);
-	const auto& units = (*qfQuery.units);
+	QuadFieldBatchQuery qfBatch;
+	qfBatch.AddRectangle(mins, maxs);
+	quadField.GetUnitsExact(qfBatch);
+	const auto& units = qfBatch.units;
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -2303,9 +2335,10 @@ int LuaSyncedRead::GetUnitsInCylinder(lua_State* L)
 		continue;                               \
 	}                                           \
 
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, mins, maxs);
-	const auto& units = (*qfQuery.units);
+	QuadFieldBatchQuery qfBatch;
+	qfBatch.AddRectangle(mins, maxs);
+	quadField.GetUnitsExact(qfBatch);
+	const auto& units = qfBatch.units;
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -2357,9 +2390,10 @@ int LuaSyncedRead::GetUnitsInSphere(lua_State* L)
 		continue;                                 \
 	}                                           \
 
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, mins, maxs);
-	const auto& units = (*qfQuery.units);
+	QuadFieldBatchQuery qfBatch;
+	qfBatch.AddRectangle(mins, maxs);
+	quadField.GetUnitsExact(qfBatch);
+	const auto& units = qfBatch.units;
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -3008,6 +3042,42 @@ int LuaSyncedRead::GetUnitHealth(lua_State* L)
 	return 5;
 }
 
+int LuaSyncedRead::GetUnitArrayHealths(lua_State* L)
+{
+	const int numUnits = ParseUnitArray(L, __func__, 1);
+
+	lua_settop(L, 3);
+	ParseOutputTable(L, 2, numUnits);
+	ParseOutputTable(L, 3, numUnits);
+
+	int numValues = 0;
+
+	// healths[i] and maxHealths[i] belong to unitIDs[i], nil where
+	// GetUnitHealth would not return them
+	for (int i = 1; i <= numUnits; i++) {
+		PushUnitArrayElement(L, __func__, 1, i);
+		const CUnit* unit = ParseInLosUnit(L, __func__, -1);
+		lua_pop(L, 1);
+
+		if (unit == nullptr || (unit->unitDef->hideDamage && IsEnemyUnit(L, unit))) {
+			lua_pushnil(L); lua_rawseti(L, 2, i);
+			lua_pushnil(L); lua_rawseti(L, 3, i);
+			continue;
+		}
+
+		const UnitDef* ud = unit->unitDef;
+		const float scale = (IsEnemyUnit(L, unit) && ud->decoyDef != nullptr)? (ud->decoyDef->health / ud->health): 1.0f;
+
+		lua_pushnumber(L, scale * unit->health   ); lua_rawseti(L, 2, i);
+		lua_pushnumber(L, scale * unit->maxHealth); lua_rawseti(L, 3, i);
+
+		numValues++;
+	}
+
+	lua_pushnumber(L, numValues);
+	return 3;
+}
+
 
 int LuaSyncedRead::GetUnitIsDead(lua_State* L)
 {
@@ -3109,6 +3179,49 @@ int LuaSyncedRead::GetUnitBasePosition(lua_State* L)
 	return (GetUnitPosition(L));
 }
 
+int LuaSyncedRead::GetUnitArrayPositions(lua_State* L)
+{
+	const int numUnits = ParseUnitArray(L, __func__, 1);
+	const bool returnMidPos = luaL_optboolean(L, 3, false);
+
+	lua_settop(L, 2);
+	ParseOutputTable(L, 2, numUnits * 3);
+
+	const int readAllyTeam = CLuaHandle::GetHandleReadAllyTeam(L);
+	const bool fullRead = CLuaHandle::GetHandleFullRead(L);
+
+	int numValues = 0;
+
+	// positions[i*3-2 .. i*3] belong to unitIDs[i], nil where
+	// GetUnitPosition would not return them
+	for (int i = 1, j = 1; i <= numUnits; i++, j += 3) {
+		PushUnitArrayElement(L, __func__, 1, i);
+		const CUnit* unit = ParseUnit(L, __func__, -1);
+		lua_pop(L, 1);
+
+		if (unit == nullptr) {
+			lua_pushnil(L); lua_rawseti(L, 2, j + 0);
+			lua_pushnil(L); lua_rawseti(L, 2, j + 1);
+			lua_pushnil(L); lua_rawseti(L, 2, j + 2);
+			continue;
+		}
+
+		float3 pos = returnMidPos? float3(unit->midPos): float3(unit->pos);
+
+		if (!IsAllyUnit(L, unit))
+			pos += unit->GetLuaErrorVector(readAllyTeam, fullRead);
+
+		lua_pushnumber(L, pos.x); lua_rawseti(L, 2, j + 0);
+		lua_pushnumber(L, pos.y); lua_rawseti(L, 2, j + 1);
+		lua_pushnumber(L, pos.z); lua_rawseti(L, 2, j + 2);
+
+		numValues++;
+	}
+
+	lua_pushnumber(L, numValues);
+	return 2;
+}
+
 int LuaSyncedRead::GetUnitVectors(lua_State* L)
 {
 	const CUnit* unit = ParseInLosUnit(L, __func__, 1);
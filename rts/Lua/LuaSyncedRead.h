@@ -100,6 +100,7 @@ class LuaSyncedRead {
 		static int GetUnitAllyTeam(lua_State* L);
 		static int GetUnitNeutral(lua_State* L);
 		static int GetUnitHealth(lua_State* L);
+		static int GetUnitArrayHealths(lua_State* L);
 		static int GetUnitIsDead(lua_State* L);
 		static int GetUnitIsStunned(lua_State* L);
 		static int GetUnitResources(lua_State* L);
@@ -118,6 +119,7 @@ class LuaSyncedRead {
 		static int GetUnitMass(lua_State* L);
 		static int GetUnitPosition(lua_State* L);
 		static int GetUnitBasePosition(lua_State* L);
+		static int GetUnitArrayPositions(lua_State* L);
 		static int GetUnitVectors(lua_State* L);
 		static int GetUnitRotation(lua_State* L);
 		static int GetUnitDirection(lua_State* L);
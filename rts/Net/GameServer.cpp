@@ -2663,6 +2663,10 @@ void CGameServer::UpdateLoop()
 			std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
 			ServerReadNet();
 			Update();
+
+			// send everything the links flushed during this tick at once
+			if (UDPNet != nullptr)
+				UDPNet->Flush();
 		}
 
 		if (hostif != nullptr)
@@ -2681,6 +2685,15 @@ void CGameServer::UpdateLoop()
 				p.clientLink->Flush();
 		}
 
+		if (UDPNet != nullptr)
+			UDPNet->Flush();
+
+		// traffic (and compression) totals per link
+		for (const GameParticipant& p: players) {
+			if (logInfoMessages && p.clientLink != nullptr)
+				LOG("[GameServer::%s] link of player %d (%s): %s", __func__, p.id, p.name.c_str(), p.clientLink->Statistics().c_str());
+		}
+
 		// now let clients close their connections
 		if (!reloadingServer && !myGameSetup->onlyLocal)
 			spring_sleep(spring_msecs(1500));
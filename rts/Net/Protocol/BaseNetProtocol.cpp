@@ -543,6 +543,13 @@ PacketType CBaseNetProtocol::SendPing(uint8_t playerNum, uint8_t pingTag, float
 	return PacketType(packet);
 }
 
+PacketType CBaseNetProtocol::SendCompression(uint8_t mode)
+{
+	PackPacket* packet = new PackPacket(sizeof(uint8_t) + sizeof(mode), NETMSG_COMPRESSION);
+	*packet << mode;
+	return PacketType(packet);
+}
+
 
 PacketType CBaseNetProtocol::SendClientData(uint8_t playerNum, const std::vector<uint8_t>& data)
 {
@@ -666,6 +673,7 @@ CBaseNetProtocol::CBaseNetProtocol()
 	proto->AddType(NETMSG_AI_STATE_CHANGED, 4);
 	proto->AddType(NETMSG_GAME_FRAME_PROGRESS, 5);
 	proto->AddType(NETMSG_PING, 1 + (1 + 1 + 4));
+	proto->AddType(NETMSG_COMPRESSION, 2);
 
 #ifdef SYNCDEBUG
 	proto->AddType(NETMSG_SD_CHKREQUEST, 5);
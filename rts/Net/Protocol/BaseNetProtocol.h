@@ -82,6 +82,7 @@ public:
 	PacketType SendLuaMsg(uint8_t playerNum, uint16_t script, uint8_t mode, const std::vector<uint8_t>& rawData);
 	PacketType SendCurrentFrameProgress(int32_t frameNum);
 	PacketType SendPing(uint8_t playerNum, uint8_t pingTag, float localTime);
+	PacketType SendCompression(uint8_t mode);
 
 	PacketType SendPlayerStat(uint8_t playerNum, const PlayerStatistics& currentStats);
 	PacketType SendTeamStat(uint8_t teamNum, const TeamStatistics& currentStats);
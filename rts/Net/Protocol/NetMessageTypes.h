@@ -93,6 +93,9 @@ enum NETMSG {
 
 	NETMSG_PING = 78, // uint8_t playerNum, uint8_t pingTag, float localTime
 
+	NETMSG_COMPRESSION      = 79, // uint8_t mode (0: offer, 1: start)
+	                              // link-level, consumed by UDPConnection; after a start marker all data in that direction is a zlib stream
+
 	NETMSG_LAST //max types of netmessages, internal only
 };
 
@@ -0,0 +1,337 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/Net/UDPListener.h"
+#include "System/Net/UDPConnection.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "SpectatorRelay.h"
+
+#include "Game/GameVersion.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "System/GlobalConfig.h"
+#include "System/SpringFormat.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/Net/UnpackPacket.h"
+#include "System/Log/ILog.h"
+#include "System/Platform/errorhandler.h"
+#include "System/Platform/Misc.h"
+#include "System/Platform/Threading.h"
+
+#ifndef UNIT_TEST
+CONFIG(int, SpectatorRelayCacheSize).defaultValue(256).minimumValue(1).description("Maximum size in MB of the game stream a spectator relay buffers for late joiners; once exceeded no new spectators are accepted.");
+#endif
+
+
+CSpectatorRelay::CSpectatorRelay(
+	const std::string& hostIP,
+	int hostPort,
+	int relayPort,
+	const std::string& name,
+	const std::string& passwd,
+	unsigned int maxClients
+)
+	: cacheSize(0)
+	, maxCacheSize(configHandler->GetInt("SpectatorRelayCacheSize") * size_t(1024 * 1024))
+	, myName(name)
+	, myVersion(SpringVersion::GetSync())
+	, myPlayerNum(-1)
+	, loopSleepTime(configHandler->GetInt("ServerSleepTime"))
+	, maxClients(maxClients)
+	, numClients(0)
+	, quitRelay(false)
+	, finished(false)
+	, cacheOverflow(false)
+{
+	listener.reset(new netcode::UDPListener(relayPort));
+
+	// same handshake as a client, see CNetProtocol::InitClient
+	upstream.reset(new netcode::UDPConnection(configHandler->GetInt("SourcePort"), hostIP, hostPort));
+	upstream->Unmute();
+	upstream->SendData(CBaseNetProtocol::Get().SendAttemptConnect(myName, passwd, myVersion, Platform::GetPlatformStr(), globalConfig.networkLossFactor));
+	upstream->Flush(true);
+
+	LOG("[SpectatorRelay] relaying [%s]:%i as \"%s\" to spectators on port %i", hostIP.c_str(), hostPort, myName.c_str(), relayPort);
+
+	thread = std::move(spring::thread(std::bind(&CSpectatorRelay::UpdateLoop, this)));
+}
+
+CSpectatorRelay::~CSpectatorRelay()
+{
+	quitRelay = true;
+	thread.join();
+}
+
+
+void CSpectatorRelay::UpdateLoop()
+{
+	try {
+		Threading::SetThreadName("relay");
+
+		while (!quitRelay) {
+			spring_msecs(loopSleepTime).sleep(true);
+			Update();
+		}
+
+		// flush quit messages, ours or the host's
+		upstream->SendData(CBaseNetProtocol::Get().SendQuit("Relay shutdown"));
+		upstream->Flush(true);
+
+		for (RelayClient& c: clients) {
+			c.link->Flush(true);
+		}
+
+		listener->Flush();
+		spring_sleep(spring_msecs(500));
+	} CATCH_SPRING_ERRORS
+
+	finished = true;
+}
+
+void CSpectatorRelay::Update()
+{
+	upstream->Update();
+	listener->Update();
+
+	ReadUpstream();
+	ReadClients();
+	AcceptClients();
+
+	// send everything the links flushed during this tick at once
+	listener->Flush();
+}
+
+
+void CSpectatorRelay::ReadUpstream()
+{
+	for (std::shared_ptr<const netcode::RawPacket> packet; (packet = upstream->GetData()) != nullptr; ) {
+		switch (packet->data[0]) {
+			case NETMSG_SETPLAYERNUM: {
+				// no need to load anything, tell the host we are ready right away
+				myPlayerNum = packet->data[1];
+				upstream->SendData(CBaseNetProtocol::Get().SendPlayerName(myPlayerNum, myName));
+
+				CachePacket(packet);
+				Broadcast(packet);
+			} break;
+
+			case NETMSG_QUIT: {
+				Broadcast(packet);
+
+				try {
+					netcode::UnpackPacket msg(packet, 3);
+					std::string reason;
+					msg >> reason;
+					LOG("[SpectatorRelay] host closed the connection: %s", reason.c_str());
+				} catch (const netcode::UnpackPacketException& ex) {
+					LOG("[SpectatorRelay] host closed the connection");
+				}
+
+				quitRelay = true;
+			} break;
+
+			// replies to our own messages, none are expected
+			case NETMSG_PING: {
+			} break;
+
+			// live-only, as on the host
+			case NETMSG_GAME_FRAME_PROGRESS: {
+				Broadcast(packet);
+			} break;
+
+			default: {
+				CachePacket(packet);
+				Broadcast(packet);
+			} break;
+		}
+	}
+
+	if (upstream->CheckTimeout(0, upstream->GetDataReceived() == 0)) {
+		LOG_L(L_WARNING, "[SpectatorRelay] lost connection to host");
+		Broadcast(CBaseNetProtocol::Get().SendQuit("Relay lost connection to host"));
+		quitRelay = true;
+	}
+}
+
+void CSpectatorRelay::ReadClients()
+{
+	for (size_t i = 0; i < clients.size(); ) {
+		RelayClient& c = clients[i];
+
+		bool quit = false;
+
+		for (std::shared_ptr<const netcode::RawPacket> packet; (packet = c.link->GetData()) != nullptr; ) {
+			switch (packet->data[0]) {
+				case NETMSG_PING: {
+					// the host replies with the request itself
+					c.link->SendData(packet);
+				} break;
+
+				// the host has to see one response per frame from the
+				// relay's player, clients[0] is as good as any
+				case NETMSG_KEYFRAME:
+				case NETMSG_SYNCRESPONSE:
+				case NETMSG_CPU_USAGE: {
+					if (i == 0)
+						upstream->SendData(packet);
+				} break;
+
+				case NETMSG_QUIT: {
+					quit = true;
+				} break;
+
+				default: {
+					// chat, player-name, path-checksum, ...: spectators can not
+					// act on behalf of the relay
+				} break;
+			}
+		}
+
+		if (quit || c.link->CheckTimeout()) {
+			LOG("[SpectatorRelay] %s left (%s)", c.name.c_str(), (quit? "quit": "timeout"));
+
+			c.link->Close(false);
+			clients.erase(clients.begin() + i);
+			continue;
+		}
+
+		i++;
+	}
+
+	numClients = clients.size();
+}
+
+void CSpectatorRelay::AcceptClients()
+{
+	// see CGameServer::ServerReadNet
+	while (listener->HasIncomingConnections()) {
+		std::shared_ptr<netcode::UDPConnection> prev = listener->PreviewConnection().lock();
+		std::shared_ptr<const netcode::RawPacket> packet = prev->GetData();
+
+		if (packet == nullptr) {
+			listener->RejectConnection();
+			continue;
+		}
+
+		try {
+			if (packet->length < 3)
+				throw netcode::UnpackPacketException("Packet too short");
+
+			if (packet->data[0] != NETMSG_ATTEMPTCONNECT)
+				throw netcode::UnpackPacketException("Invalid message ID");
+
+			netcode::UnpackPacket msg(packet, 3);
+			std::string name;
+			std::string passwd;
+			std::string version;
+			std::string platform;
+			uint8_t reconnect;
+			uint8_t netloss;
+			uint16_t netversion;
+			msg >> netversion;
+			msg >> name;
+			msg >> passwd;
+			msg >> version;
+			msg >> platform;
+			msg >> reconnect;
+			msg >> netloss;
+
+			if (netversion != NETWORK_VERSION)
+				throw netcode::UnpackPacketException(spring::format("Wrong network version: received %d, required %d", (int)netversion, (int)NETWORK_VERSION));
+
+			const std::string errMsg = BindClient(listener->AcceptConnection(), name, version, reconnect, netloss);
+
+			if (!errMsg.empty())
+				LOG_L(L_WARNING, "[SpectatorRelay] connection attempt from %s rejected: %s", name.c_str(), errMsg.c_str());
+		} catch (const netcode::UnpackPacketException& ex) {
+			LOG_L(L_WARNING, "[SpectatorRelay] connection attempt from %s rejected: %s", prev->GetFullAddress().c_str(), ex.what());
+			listener->RejectConnection();
+		}
+	}
+
+	numClients = clients.size();
+}
+
+std::string CSpectatorRelay::BindClient(
+	std::shared_ptr<netcode::UDPConnection> link,
+	const std::string& name,
+	const std::string& version,
+	bool reconnect,
+	int netloss
+) {
+	const auto pred = [&name](const RelayClient& c) { return (c.name == name); };
+	const auto iter = std::find_if(clients.begin(), clients.end(), pred);
+
+	std::string errMsg;
+
+	if (version != myVersion) {
+		errMsg = "client version '" + version + "' mismatch, relay runs '" + myVersion + "'";
+	} else if (reconnect) {
+		if (iter == clients.end())
+			errMsg = "User is not ingame";
+	} else {
+		if (iter != clients.end())
+			errMsg = "User name already in use";
+		else if (clients.size() >= maxClients)
+			errMsg = "Relay is full";
+		else if (cacheOverflow)
+			errMsg = "Relay no longer accepts spectators";
+	}
+
+	// never respond to reconnection attempts, as on the host
+	if (!reconnect)
+		link->Unmute();
+
+	if (!errMsg.empty()) {
+		// flushed when the link goes out of scope
+		link->SendData(CBaseNetProtocol::Get().SendQuit(spring::format("Connection rejected: %s", errMsg.c_str())));
+		return errMsg;
+	}
+
+	if (reconnect) {
+		iter->link->ReconnectTo(*link);
+		listener->UpdateConnections();
+
+		LOG("[SpectatorRelay] %s reconnected", name.c_str());
+		return "";
+	}
+
+	// catch up from the start, the host would send a late joiner the same
+	for (const std::shared_ptr<const netcode::RawPacket>& p: packetCache) {
+		link->SendData(p);
+	}
+
+	link->SetLossFactor(netloss);
+	link->Flush(false);
+
+	clients.push_back({link, name});
+
+	LOG("[SpectatorRelay] %s joined (%u spectators, %u buffered messages)", name.c_str(), unsigned(clients.size()), unsigned(packetCache.size()));
+	return "";
+}
+
+
+void CSpectatorRelay::CachePacket(std::shared_ptr<const netcode::RawPacket> packet)
+{
+	if (cacheOverflow)
+		return;
+
+	if ((cacheSize += packet->length) > maxCacheSize) {
+		LOG_L(L_WARNING, "[SpectatorRelay] buffered stream exceeds %u MB, no longer accepting new spectators", unsigned(maxCacheSize >> 20));
+
+		// a partial stream is of no use to late joiners
+		packetCache.clear();
+		cacheOverflow = true;
+		return;
+	}
+
+	packetCache.push_back(packet);
+}
+
+void CSpectatorRelay::Broadcast(std::shared_ptr<const netcode::RawPacket> packet)
+{
+	for (RelayClient& c: clients) {
+		c.link->SendData(packet);
+	}
+}
@@ -0,0 +1,101 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _SPECTATOR_RELAY_H
+#define _SPECTATOR_RELAY_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "System/Threading/SpringThreading.h"
+
+namespace netcode
+{
+	class RawPacket;
+	class UDPConnection;
+	class UDPListener;
+}
+
+/**
+ * @brief Re-broadcasts a hosted game to spectators
+ *
+ * Joins the host as a single spectator and keeps everything the host sends
+ * it. Spectators connecting to the relay are served that buffered stream
+ * first, the way late joiners of the host get its packet cache, and the live
+ * stream afterwards; the host serves one link no matter how many watch.
+ *
+ * Relayed spectators all see themselves as the relay's player and whatever
+ * they send stays at the relay, except that the longest-connected one
+ * answers keyframes and sync checks upstream in the relay's name.
+ *
+ * The buffered stream is bounded by SpectatorRelayCacheSize; once that is
+ * exceeded it is dropped and only spectators already connected are served.
+ */
+class CSpectatorRelay
+{
+public:
+	CSpectatorRelay(
+		const std::string& hostIP,
+		int hostPort,
+		int relayPort,
+		const std::string& name,
+		const std::string& passwd,
+		unsigned int maxClients
+	);
+	~CSpectatorRelay();
+
+	bool HasFinished() const { return finished; }
+	unsigned int GetNumClients() const { return numClients; }
+
+private:
+	struct RelayClient {
+		std::shared_ptr<netcode::UDPConnection> link;
+		std::string name;
+	};
+
+	void UpdateLoop();
+	void Update();
+
+	void ReadUpstream();
+	void ReadClients();
+	void AcceptClients();
+
+	void CachePacket(std::shared_ptr<const netcode::RawPacket> packet);
+
+	std::string BindClient(std::shared_ptr<netcode::UDPConnection> link, const std::string& name, const std::string& version, bool reconnect, int netloss);
+	void Broadcast(std::shared_ptr<const netcode::RawPacket> packet);
+
+private:
+	std::shared_ptr<netcode::UDPConnection> upstream;
+	std::unique_ptr<netcode::UDPListener> listener;
+
+	/// oldest first, clients[0] speaks for the relay
+	std::vector<RelayClient> clients;
+
+	/// everything from the host that late joiners need, in arrival order
+	std::deque< std::shared_ptr<const netcode::RawPacket> > packetCache;
+
+	size_t cacheSize;
+	size_t maxCacheSize;
+
+	std::string myName;
+	std::string myVersion;
+
+	int myPlayerNum;
+	int loopSleepTime;
+
+	unsigned int maxClients;
+
+	std::atomic<unsigned int> numClients;
+	std::atomic<bool> quitRelay;
+	std::atomic<bool> finished;
+
+	/// set once packetCache outgrew maxCacheSize, late joiners can no longer catch up
+	bool cacheOverflow;
+
+	spring::thread thread;
+};
+
+#endif // _SPECTATOR_RELAY_H
@@ -89,6 +89,7 @@ CR_REG_METADATA(CGlobalRendering, (
 	CR_MEMBER(timeOffset),
 	CR_MEMBER(lastFrameTime),
 	CR_MEMBER(lastFrameStart),
+	CR_IGNORED(lastSwapTime),
 	CR_MEMBER(weightedSpeedFactor),
 	CR_MEMBER(drawFrame),
 	CR_MEMBER(FPS),
@@ -159,6 +160,7 @@ CGlobalRendering::CGlobalRendering()
 	: timeOffset(0.0f)
 	, lastFrameTime(0.0f)
 	, lastFrameStart(spring_notime)
+	, lastSwapTime(spring_notime)
 	, weightedSpeedFactor(0.0f)
 	, drawFrame(1)
 	, FPS(1.0f)
@@ -592,7 +594,7 @@ void CGlobalRendering::SwapBuffers(bool allowSwapBuffers, bool clearErrors)
 
 	GL::SwapRenderBuffers();
 	SDL_GL_SwapWindow(sdlWindows[0]);
-	eventHandler.DbgTimingInfo(TIMING_SWAP, preSwapTime, spring_now());
+	eventHandler.DbgTimingInfo(TIMING_SWAP, preSwapTime, lastSwapTime = spring_now());
 
 	// NB: this does not just count frames drawn by game
 	drawFrame += 1;
@@ -131,6 +131,9 @@ public:
 	/// the starting time in tick for last draw frame
 	spring_time lastFrameStart;
 
+	/// when SwapBuffers last returned, i.e. roughly the last vblank with vsync enabled
+	spring_time lastSwapTime;
+
 	/// 0.001f * gu->simFPS, used for rendering
 	float weightedSpeedFactor;
 
@@ -1,8 +1,10 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <cstdlib>
 #include <string>
 
 #include "VerticalSync.h"
+#include "GlobalRendering.h"
 #include "GL/myGL.h"
 #include "System/SpringMath.h"
 #include "System/Config/ConfigHandler.h"
@@ -87,3 +89,21 @@ void CVerticalSync::SetInterval(int i)
 	SDL_GL_SetSwapInterval(0);
 	LOG("[VSync::%s] interval=%d (disabled)", __func__, interval);
 }
+
+float CVerticalSync::GetSwapPeriod() const
+{
+	#if defined HEADLESS
+	return 0.0f;
+	#else
+	if (interval == 0)
+		return 0.0f;
+
+	SDL_DisplayMode dmode;
+
+	if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(globalRendering->GetWindow(0)), &dmode) != 0 || dmode.refresh_rate <= 0)
+		return 0.0f;
+
+	// adaptive intervals only wait when ahead of the display, same period
+	return ((std::abs(interval) * 1000.0f) / dmode.refresh_rate);
+	#endif
+}
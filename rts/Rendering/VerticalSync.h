@@ -13,6 +13,8 @@ public:
 	void SetInterval(int i);
 	void ConfigNotify(const std::string& key, const std::string& value);
 	int  GetInterval() const { return interval; }
+	/// expected time between buffer swaps in milliseconds, 0 if not synchronized
+	float GetSwapPeriod() const;
 
 	static CVerticalSync* GetInstance();
 
@@ -75,7 +75,6 @@ size_t ILosType::cacheRefs  = 1;
 
 constexpr float CLosHandler::defBaseRadarErrorSize;
 constexpr float CLosHandler::defBaseRadarErrorMult;
-constexpr SLosInstance::RLE SLosInstance::EMPTY_RLE;
 
 
 void ILosType::Init(const int mipLevel_, LosType type_)
@@ -268,29 +267,6 @@ inline void ILosType::RemoveUnit(CUnit* unit, bool delayed)
 }
 
 
-inline void ILosType::LosAdd(SLosInstance* li)
-{
-	assert(li);
-	assert(teamHandler.IsValidAllyTeam(li->allyteam));
-
-	if (algoType == LOS_ALGO_RAYCAST) {
-		losMaps[li->allyteam].AddRaycast(li, 1);
-	} else {
-		losMaps[li->allyteam].AddCircle(li, 1);
-	}
-}
-
-
-inline void ILosType::LosRemove(SLosInstance* li)
-{
-	if (algoType == LOS_ALGO_RAYCAST) {
-		losMaps[li->allyteam].AddRaycast(li, -1);
-	} else {
-		losMaps[li->allyteam].AddCircle(li, -1);
-	}
-}
-
-
 inline void ILosType::RefInstance(SLosInstance* li)
 {
 	if ((++li->refCount) != 1)
@@ -546,10 +522,7 @@ void ILosType::Update()
 	}
 
 	// remove sight
-	//FIXME multithread?
-	for (SLosInstance* li: losRemove) {
-		LosRemove(li);
-	}
+	CLosMap::AddInstances(losMaps, losRemove, -1, algoType == LOS_ALGO_RAYCAST, addInstancesBuffers);
 
 	// raycast terrain
 	if (algoType == LOS_ALGO_RAYCAST)  {
@@ -562,10 +535,7 @@ void ILosType::Update()
 	}
 
 	// add sight
-	for (SLosInstance* li: losAdd) {
-		assert(li->refCount > 0);
-		LosAdd(li);
-	}
+	CLosMap::AddInstances(losMaps, losAdd, 1, algoType == LOS_ALGO_RAYCAST, addInstancesBuffers);
 
 	// delete / move to cache unused instances
 	if (algoType == LOS_ALGO_RAYCAST) {
@@ -4,19 +4,43 @@
 #include <array>
 
 #include "LosMap.h"
-#include "LosHandler.h"
-#include "Map/ReadMap.h"
+#include "Sim/Misc/GlobalConstants.h"
+#include "System/Rectangle.h"
 #include "System/SpringMath.h"
 #include "System/float3.h"
 #include "System/Log/ILog.h"
 #include "System/StringUtil.h"
 #include "System/Threading/ThreadPool.h"
+#include "System/Platform/CpuID.h"
+#include "System/MainDefines.h"
+#ifndef UNIT_TEST
+	#include "Map/ReadMap.h"
+#else
+	#include "Map/MapDimensions.h"
+	extern MapDimensions mapDims;
+#endif
 #ifdef USE_UNSYNCED_HEIGHTMAP
 	#include "Game/GlobalUnsynced.h" // for myAllyTeam
 #endif
 
+#if (__is_x86_arch__ == 1 && !defined(DEDICATED_NOSSE))
+	#define LOSMAP_SIMD_KERNELS 1
+	#include <xmmintrin.h>
+	#include <immintrin.h>
+
+	#if defined(__GNUC__)
+		#define LOSMAP_TARGET_AVX2 __attribute__((target("avx2")))
+	#else
+		#define LOSMAP_TARGET_AVX2
+	#endif
+#else
+	#define LOSMAP_SIMD_KERNELS 0
+#endif
+
 constexpr float LOS_BONUS_HEIGHT = 5.0f;
 
+constexpr SLosInstance::RLE SLosInstance::EMPTY_RLE;
+
 
 
 static std::array<std::vector<float>, ThreadPool::MAX_THREADS> RADIUS_ISQRT_TABLES;
@@ -121,12 +145,8 @@ public:
 	// only generates table if not in cache
 	void GenerateForLosSize(size_t losSize);
 
-	const int2 GetLosTableRaySquare(size_t losSize, size_t rayIndex, size_t squareIdx) {
-		return losTables[losSize][rayIndex][squareIdx];
-	}
-
-	size_t GetLosTableRaySize(size_t losSize, size_t rayIndex) {
-		return losTables[losSize][rayIndex].size();
+	const LosLine& GetLosTableRay(size_t losSize, size_t rayIndex) const {
+		return losTables[losSize][rayIndex];
 	}
 
 	size_t GetLosTableSize(size_t losSize) {
@@ -404,16 +424,16 @@ void CLosTableHelper::Debug(const LosTable& losRays, const std::vector<int2>& po
 //////////////////////////////////////////////////////////////////////
 /// CLosMap implementation
 
-void CLosMap::AddCircle(SLosInstance* instance, int amount)
+void CLosMap::AddCircle(SLosInstance* instance, int amount, int2 rows)
 {
 #ifdef USE_UNSYNCED_HEIGHTMAP
 	//only AddRaycast supports UnsyncedHeightMap updates
 #endif
 
 	MidpointCircleAlgoPerLine(instance->radius, [&](int width, int y) {
-		const unsigned y_ = instance->basePos.y + y;
+		const int y_ = instance->basePos.y + y;
 
-		if (y_ < size.y) {
+		if (y_ >= rows.x && y_ < rows.y) {
 			const unsigned sx = Clamp(instance->basePos.x - width,     0, size.x);
 			const unsigned ex = Clamp(instance->basePos.x + width + 1, 0, size.x);
 
@@ -425,33 +445,39 @@ void CLosMap::AddCircle(SLosInstance* instance, int amount)
 }
 
 
-void CLosMap::AddRaycast(SLosInstance* instance, int amount)
+void CLosMap::AddRaycast(SLosInstance* instance, int amount, int2 rows, std::vector<int>* losEnterSquares)
 {
 	const auto& losSquares = instance->squares;
 
 	if (losSquares.empty() || losSquares[0].length == SLosInstance::EMPTY_RLE.length)
 		return;
 
+	// RLE runs never cross a row and are sorted by row, so the
+	// runs inside <rows> form one contiguous [first, last) range
+	const auto RowCmp = [&](const SLosInstance::RLE& rle, int row) { return ((rle.start / size.x) < row); };
+	const auto first = std::lower_bound(losSquares.begin(), losSquares.end(), rows.x, RowCmp);
+	const auto last  = std::lower_bound(first,              losSquares.end(), rows.y, RowCmp);
+
 #ifdef USE_UNSYNCED_HEIGHTMAP
 	// inform ReadMap when squares enter LoS
 	const bool visibleInstanceSquares = (instance->allyteam >= 0 && (instance->allyteam == gu->myAllyTeam || gu->spectatingFullView));
 	const bool updateUnsyncedHeightMap = sendReadmapEvents && visibleInstanceSquares;
 
 	if ((amount > 0) && updateUnsyncedHeightMap) {
-		for (const SLosInstance::RLE rle: losSquares) {
-			for (int idx = rle.start, len = rle.length; len > 0; --len, ++idx) {
+		for (auto it = first; it != last; ++it) {
+			for (int idx = it->start, len = it->length; len > 0; --len, ++idx) {
 				losmap[idx] += amount;
 
 				// skip if this los-square did not *enter* LOS
 				if (losmap[idx] != amount)
 					continue;
 
-				const int2 lm = IdxToCoord(idx, size.x);
-				const int2 p1 = (lm             ) * LOS2HEIGHT;
-				const int2 p2 = (lm + int2(1, 1)) * LOS2HEIGHT;
-				const int2 p3 = {std::min(p2.x, mapDims.mapxm1), std::min(p2.y, mapDims.mapym1)};
-
-				readMap->UpdateLOS(SRectangle(p1.x, p1.y,  p3.x, p3.y));
+				// ReadMap is not thread-safe, caller has to forward these
+				if (losEnterSquares != nullptr) {
+					losEnterSquares->push_back(idx);
+				} else {
+					SendLosEnterEvent(idx);
+				}
 			}
 		}
 
@@ -459,14 +485,91 @@ void CLosMap::AddRaycast(SLosInstance* instance, int amount)
 	}
 #endif
 
-	for (const SLosInstance::RLE rle: losSquares) {
-		for (int idx = rle.start, len = rle.length; len > 0; --len, ++idx) {
+	for (auto it = first; it != last; ++it) {
+		for (int idx = it->start, len = it->length; len > 0; --len, ++idx) {
 			losmap[idx] += amount;
 		}
 	}
 }
 
 
+void CLosMap::SendLosEnterEvent(int losSquareIdx) const
+{
+#ifdef USE_UNSYNCED_HEIGHTMAP
+	const int2 lm = IdxToCoord(losSquareIdx, size.x);
+	const int2 p1 = (lm             ) * LOS2HEIGHT;
+	const int2 p2 = (lm + int2(1, 1)) * LOS2HEIGHT;
+	const int2 p3 = {std::min(p2.x, mapDims.mapxm1), std::min(p2.y, mapDims.mapym1)};
+
+	readMap->UpdateLOS(SRectangle(p1.x, p1.y,  p3.x, p3.y));
+#endif
+}
+
+
+void CLosMap::AddInstances(std::vector<CLosMap>& losMaps, const std::vector<SLosInstance*>& instances, int amount, bool raycast, AddInstancesBuffers& buffers)
+{
+	std::vector< std::vector<SLosInstance*> >& allyInstances = buffers.allyInstances;
+	std::vector< std::vector<int> >& losEnterSquares = buffers.losEnterSquares;
+
+	if (instances.empty() || losMaps.empty())
+		return;
+
+	// bucket by allyteam, preserving the relative order within each
+	allyInstances.resize(losMaps.size());
+
+	for (auto& v: allyInstances) {
+		v.clear();
+	}
+	for (SLosInstance* li: instances) {
+		assert(li->allyteam >= 0 && li->allyteam < losMaps.size());
+		allyInstances[li->allyteam].push_back(li);
+	}
+
+	const int numRows = losMaps[0].size.y;
+	const int numStripes = std::min(numRows, ThreadPool::GetNumThreads() * 2);
+	const int stripeSize = (numRows + numStripes - 1) / numStripes;
+	const int numItems = losMaps.size() * numStripes;
+
+	losEnterSquares.resize(std::max(int(losEnterSquares.size()), numItems));
+
+	for_mt(0, numItems, [&](const int i) {
+		const int allyTeam = i / numStripes;
+		const int stripe   = i % numStripes;
+
+		const auto& allyInsts = allyInstances[allyTeam];
+
+		if (allyInsts.empty())
+			return;
+
+		const int2 rows = {stripe * stripeSize, std::min((stripe + 1) * stripeSize, numRows)};
+
+		CLosMap& losMap = losMaps[allyTeam];
+		std::vector<int>& enterSquares = losEnterSquares[i];
+
+		for (SLosInstance* li: allyInsts) {
+			// instance does not reach into this stripe
+			if ((li->basePos.y + li->radius) < rows.x || (li->basePos.y - li->radius) >= rows.y)
+				continue;
+
+			if (raycast) {
+				losMap.AddRaycast(li, amount, rows, &enterSquares);
+			} else {
+				losMap.AddCircle(li, amount, rows);
+			}
+		}
+	});
+
+	// forward squares that entered LOS in fixed (allyteam, stripe) order
+	for (int i = 0; i < numItems; ++i) {
+		for (const int idx: losEnterSquares[i]) {
+			losMaps[i / numStripes].SendLosEnterEvent(idx);
+		}
+
+		losEnterSquares[i].clear();
+	}
+}
+
+
 void CLosMap::PrepareRaycast(SLosInstance* instance) const
 {
 	if (!instance->squares.empty())
@@ -523,10 +626,10 @@ inline void CastLos(
 	float* prvAngle,
 	float* maxAngle,
 	const int2& off,
-	std::vector<char>& losRaySquares,
-	std::vector<float>& raycastAngles,
-	int losRadius,
-	int threadNum
+	char* losRaySquares,
+	const float* raycastAngles,
+	const float* isqrtTable,
+	int losRadius
 ) {
 	const size_t oidx = ToAngleMapIdx(off, losRadius);
 
@@ -537,7 +640,7 @@ inline void CastLos(
 	}
 
 	if (raycastAngles[oidx] < *prvAngle) {
-		const float invR = isqrtTableLookup(off.x * off.x + off.y * off.y, threadNum);
+		const float invR = isqrtTable[off.x * off.x + off.y * off.y];
 		const float angle = *prvAngle - LOS_BONUS_HEIGHT * invR;
 
 		if (raycastAngles[oidx] < (*maxAngle = angle)) {
@@ -550,6 +653,241 @@ inline void CastLos(
 }
 
 
+//////////////////////////////////////////////////////////////////////
+/// raycast kernels
+//
+// Every ray of the table is cast into all four quadrants; the four
+// mirrored rays are independent, which the SIMD kernels exploit by
+// tracing them in separate lanes (and two rays at once with AVX2).
+// All kernels evaluate CastLos' comparisons and float ops in the same
+// order, so their results are bit-identical (LOS is synced).
+
+struct RaycastParams {
+	CLosTableHelper* helper;
+	int radius;
+	char* losRaySquares;
+	const float* raycastAngles;
+	const float* isqrtTable;
+};
+
+
+static void RaycastKernelScalar(const RaycastParams& p)
+{
+	const int radius = p.radius;
+	const size_t numRays = p.helper->GetLosTableSize(radius);
+
+	for (size_t i = 0; i < numRays; ++i) {
+		float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
+		float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
+
+		for (const int2 square: p.helper->GetLosTableRay(radius, i)) {
+			CastLos(&prvAngles[0], &maxAngles[0],       square              , p.losRaySquares, p.raycastAngles, p.isqrtTable, radius);
+			CastLos(&prvAngles[1], &maxAngles[1],      -square              , p.losRaySquares, p.raycastAngles, p.isqrtTable, radius);
+			CastLos(&prvAngles[2], &maxAngles[2], int2( square.y, -square.x), p.losRaySquares, p.raycastAngles, p.isqrtTable, radius);
+			CastLos(&prvAngles[3], &maxAngles[3], int2(-square.y,  square.x), p.losRaySquares, p.raycastAngles, p.isqrtTable, radius);
+		}
+	}
+}
+
+
+#if (LOSMAP_SIMD_KERNELS == 1)
+// angle-map offsets of <square> rotated into each quadrant, relative to the center
+static inline void QuadrantOffsets(const int2 square, const int stride, int offsets[4])
+{
+	offsets[0] =  square.y * stride + square.x;
+	offsets[1] = -square.y * stride - square.x;
+	offsets[2] = -square.x * stride + square.y;
+	offsets[3] =  square.x * stride - square.y;
+}
+
+// one CastLos step for four lanes, returns the mask of lanes that became hidden
+static inline int CastLosSSE(__m128& maxAngles, __m128& prvAngles, const __m128 angles, const float bonus)
+{
+	const __m128 hilltops = _mm_sub_ps(prvAngles, _mm_set1_ps(bonus));
+
+	// behind an already cached hilltop
+	const __m128 belowMax = _mm_cmplt_ps(angles, maxAngles);
+	// descending from the previous square, cache it as new hilltop
+	const __m128 belowPrv = _mm_andnot_ps(belowMax, _mm_cmplt_ps(angles, prvAngles));
+
+	maxAngles = _mm_or_ps(_mm_and_ps(belowPrv, hilltops), _mm_andnot_ps(belowPrv, maxAngles));
+
+	const __m128 hidden = _mm_or_ps(belowMax, _mm_and_ps(belowPrv, _mm_cmplt_ps(angles, maxAngles)));
+
+	prvAngles = _mm_or_ps(_mm_and_ps(hidden, prvAngles), _mm_andnot_ps(hidden, angles));
+	return (_mm_movemask_ps(hidden));
+}
+
+static inline void CastLosRaySSE(
+	const RaycastParams& p,
+	const CLosTableHelper::LosLine& ray,
+	size_t n,
+	__m128 maxAngles,
+	__m128 prvAngles
+) {
+	const int stride = 2 * p.radius + 1;
+	const int center = p.radius * stride + p.radius;
+
+	char* losRaySquares = p.losRaySquares + center;
+	const float* raycastAngles = p.raycastAngles + center;
+
+	int offsets[4];
+
+	for (; n < ray.size(); ++n) {
+		const int2 square = ray[n];
+
+		QuadrantOffsets(square, stride, offsets);
+
+		const __m128 angles = _mm_setr_ps(
+			raycastAngles[offsets[0]],
+			raycastAngles[offsets[1]],
+			raycastAngles[offsets[2]],
+			raycastAngles[offsets[3]]
+		);
+		const float bonus = LOS_BONUS_HEIGHT * p.isqrtTable[square.x * square.x + square.y * square.y];
+
+		if (const int hidden = CastLosSSE(maxAngles, prvAngles, angles, bonus)) {
+			for (int k = 0; k < 4; ++k) {
+				if ((hidden >> k) & 1)
+					losRaySquares[offsets[k]] = false;
+			}
+		}
+	}
+}
+
+static void RaycastKernelSSE(const RaycastParams& p)
+{
+	const size_t numRays = p.helper->GetLosTableSize(p.radius);
+
+	for (size_t i = 0; i < numRays; ++i) {
+		CastLosRaySSE(p, p.helper->GetLosTableRay(p.radius, i), 0, _mm_set1_ps(-1e7f), _mm_set1_ps(-1e7f));
+	}
+}
+
+
+// two rays (eight lanes) per step; the longer ray of a pair is finished by the SSE kernel
+LOSMAP_TARGET_AVX2 static void RaycastKernelAVX2(const RaycastParams& p)
+{
+	const int stride = 2 * p.radius + 1;
+	const int center = p.radius * stride + p.radius;
+
+	char* losRaySquares = p.losRaySquares + center;
+	const float* raycastAngles = p.raycastAngles + center;
+
+	const size_t numRays = p.helper->GetLosTableSize(p.radius);
+
+	size_t i = 0;
+
+	for (; (i + 1) < numRays; i += 2) {
+		const CLosTableHelper::LosLine& ray0 = p.helper->GetLosTableRay(p.radius, i    );
+		const CLosTableHelper::LosLine& ray1 = p.helper->GetLosTableRay(p.radius, i + 1);
+
+		const size_t numSquares = std::min(ray0.size(), ray1.size());
+
+		__m256 maxAngles = _mm256_set1_ps(-1e7f);
+		__m256 prvAngles = _mm256_set1_ps(-1e7f);
+
+		int offsets[8];
+
+		for (size_t n = 0; n < numSquares; ++n) {
+			const int2 square0 = ray0[n];
+			const int2 square1 = ray1[n];
+
+			QuadrantOffsets(square0, stride, &offsets[0]);
+			QuadrantOffsets(square1, stride, &offsets[4]);
+
+			// scalar loads beat vgatherdps for eight scattered floats on most cores
+			const __m256 angles = _mm256_setr_ps(
+				raycastAngles[offsets[0]], raycastAngles[offsets[1]], raycastAngles[offsets[2]], raycastAngles[offsets[3]],
+				raycastAngles[offsets[4]], raycastAngles[offsets[5]], raycastAngles[offsets[6]], raycastAngles[offsets[7]]
+			);
+
+			const float bonus0 = LOS_BONUS_HEIGHT * p.isqrtTable[square0.x * square0.x + square0.y * square0.y];
+			const float bonus1 = LOS_BONUS_HEIGHT * p.isqrtTable[square1.x * square1.x + square1.y * square1.y];
+
+			const __m256 hilltops = _mm256_sub_ps(prvAngles, _mm256_setr_ps(bonus0, bonus0, bonus0, bonus0, bonus1, bonus1, bonus1, bonus1));
+
+			const __m256 belowMax = _mm256_cmp_ps(angles, maxAngles, _CMP_LT_OQ);
+			const __m256 belowPrv = _mm256_andnot_ps(belowMax, _mm256_cmp_ps(angles, prvAngles, _CMP_LT_OQ));
+
+			maxAngles = _mm256_blendv_ps(maxAngles, hilltops, belowPrv);
+
+			const __m256 hidden = _mm256_or_ps(belowMax, _mm256_and_ps(belowPrv, _mm256_cmp_ps(angles, maxAngles, _CMP_LT_OQ)));
+
+			prvAngles = _mm256_blendv_ps(angles, prvAngles, hidden);
+
+			if (const int mask = _mm256_movemask_ps(hidden)) {
+				for (int k = 0; k < 8; ++k) {
+					if ((mask >> k) & 1)
+						losRaySquares[offsets[k]] = false;
+				}
+			}
+		}
+
+		CastLosRaySSE(p, ray0, numSquares, _mm256_castps256_ps128(maxAngles), _mm256_castps256_ps128(prvAngles));
+		CastLosRaySSE(p, ray1, numSquares, _mm256_extractf128_ps(maxAngles, 1), _mm256_extractf128_ps(prvAngles, 1));
+	}
+
+	for (; i < numRays; ++i) {
+		CastLosRaySSE(p, p.helper->GetLosTableRay(p.radius, i), 0, _mm_set1_ps(-1e7f), _mm_set1_ps(-1e7f));
+	}
+}
+#endif
+
+
+static bool HasRaycastKernelImpl(int kernel)
+{
+	switch (kernel) {
+		case CLosMap::RAYCAST_KERNEL_SCALAR: return true;
+	#if (LOSMAP_SIMD_KERNELS == 1)
+		case CLosMap::RAYCAST_KERNEL_SSE   : return true;
+		case CLosMap::RAYCAST_KERNEL_AVX2  : return springproc::HasAVX2();
+	#endif
+		default: {
+		} break;
+	}
+
+	return false;
+}
+
+static int SelectRaycastKernel()
+{
+	for (int k = CLosMap::RAYCAST_KERNEL_COUNT - 1; k > CLosMap::RAYCAST_KERNEL_SCALAR; --k) {
+		if (HasRaycastKernelImpl(k))
+			return k;
+	}
+
+	return CLosMap::RAYCAST_KERNEL_SCALAR;
+}
+
+static int raycastKernel = SelectRaycastKernel();
+
+
+bool CLosMap::HasRaycastKernel(int kernel) { return (HasRaycastKernelImpl(kernel)); }
+int CLosMap::GetRaycastKernel() { return raycastKernel; }
+
+bool CLosMap::SetRaycastKernel(int kernel)
+{
+	if (!HasRaycastKernelImpl(kernel))
+		return false;
+
+	raycastKernel = kernel;
+	return true;
+}
+
+
+static void CastLosRays(const RaycastParams& p)
+{
+	switch (raycastKernel) {
+	#if (LOSMAP_SIMD_KERNELS == 1)
+		case CLosMap::RAYCAST_KERNEL_AVX2: { RaycastKernelAVX2(p); } break;
+		case CLosMap::RAYCAST_KERNEL_SSE : { RaycastKernelSSE(p); } break;
+	#endif
+		default: { RaycastKernelScalar(p); } break;
+	}
+}
+
+
 void CLosMap::AddSquaresToInstance(SLosInstance* li, const std::vector<char>& losRaySquares) const
 {
 	const int2 pos   = li->basePos;
@@ -653,23 +991,7 @@ void CLosMap::UnsafeLosAdd(SLosInstance* li) const
 	// cast the rays
 	losRaySquares[ToAngleMapIdx(int2(0, 0), radius)] = true;
 
-	const size_t numRays = helper.GetLosTableSize(radius);
-
-	for (size_t i = 0; i < numRays; ++i) {
-		float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-		float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-
-		const size_t numSquares = helper.GetLosTableRaySize(radius, i);
-
-		for (size_t n = 0; n < numSquares; n++) {
-			const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-			CastLos(&prvAngles[0], &maxAngles[0],       square              , losRaySquares, raycastAngles, radius, threadNum);
-			CastLos(&prvAngles[1], &maxAngles[1],      -square              , losRaySquares, raycastAngles, radius, threadNum);
-			CastLos(&prvAngles[2], &maxAngles[2], int2( square.y, -square.x), losRaySquares, raycastAngles, radius, threadNum);
-			CastLos(&prvAngles[3], &maxAngles[3], int2(-square.y,  square.x), losRaySquares, raycastAngles, radius, threadNum);
-		}
-	}
+	CastLosRays({&helper, radius, &losRaySquares[0], &raycastAngles[0], &RADIUS_ISQRT_TABLES[threadNum][0]});
 
 	// translate visible square indices to map square idx + RLE
 	AddSquaresToInstance(li, losRaySquares);
@@ -739,75 +1061,12 @@ void CLosMap::SafeLosAdd(SLosInstance* li) const
 
 
 	// Cast the Rays
-	const size_t numRays = helper.GetLosTableSize(radius);
-
-	if (safeRect.Inside(pos)) {
+	// squares outside the map keep their initial angle (-1e8) which is always below
+	// maxAngle, so rays pass over them without changing state; no clipping needed
+	if (safeRect.Inside(pos))
 		losRaySquares[ToAngleMapIdx(int2(0, 0), radius)] = true;
 
-		for (size_t i = 0; i < numRays; ++i) {
-			float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-			float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-
-			const size_t numSquares = helper.GetLosTableRaySize(radius, i);
-
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-				if (!safeRect.Inside(pos + square))
-					break;
-
-				CastLos(&prvAngles[0], &maxAngles[0],  square,                   losRaySquares, raycastAngles, radius, threadNum);
-			}
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-				if (!safeRect.Inside(pos - square))
-					break;
-
-				CastLos(&prvAngles[1], &maxAngles[1], -square,                   losRaySquares, raycastAngles, radius, threadNum);
-			}
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-				if (!safeRect.Inside(pos + int2(square.y, -square.x)))
-					break;
-
-				CastLos(&prvAngles[2], &maxAngles[2], int2(square.y, -square.x), losRaySquares, raycastAngles, radius, threadNum);
-			}
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-				if (!safeRect.Inside(pos + int2(-square.y, square.x)))
-					break;
-
-				CastLos(&prvAngles[3], &maxAngles[3], int2(-square.y, square.x), losRaySquares, raycastAngles, radius, threadNum);
-			}
-		}
-	} else {
-		// emit position outside the map
-		for (size_t i = 0; i < numRays; ++i) {
-			float maxAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-			float prvAngles[4] = {-1e7, -1e7, -1e7, -1e7};
-
-			const size_t numSquares = helper.GetLosTableRaySize(radius, i);
-
-			for (size_t n = 0; n < numSquares; n++) {
-				const int2 square = helper.GetLosTableRaySquare(radius, i, n);
-
-				if (safeRect.Inside(pos + square))
-					CastLos(&prvAngles[0], &maxAngles[0],  square,                   losRaySquares, raycastAngles, radius, threadNum);
-
-				if (safeRect.Inside(pos - square))
-					CastLos(&prvAngles[1], &maxAngles[1], -square,                   losRaySquares, raycastAngles, radius, threadNum);
-
-				if (safeRect.Inside(pos + int2(square.y, -square.x)))
-					CastLos(&prvAngles[2], &maxAngles[2], int2(square.y, -square.x), losRaySquares, raycastAngles, radius, threadNum);
-
-				if (safeRect.Inside(pos + int2(-square.y, square.x)))
-					CastLos(&prvAngles[3], &maxAngles[3], int2(-square.y, square.x), losRaySquares, raycastAngles, radius, threadNum);
-			}
-		}
-	}
+	CastLosRays({&helper, radius, &losRaySquares[0], &raycastAngles[0], &RADIUS_ISQRT_TABLES[threadNum][0]});
 
 	// translate visible square indices to map square idx + RLE
 	AddSquaresToInstance(li, losRaySquares);
@@ -10,7 +10,71 @@
 #include "System/SpringMath.h"
 
 
-struct SLosInstance;
+/**
+ * LoS Instance
+ *
+ * The main goal of this object is to store the squares on the LOS map that
+ * have been incremented (CLosHandler::LosAdd) when the unit last moved.
+ * (CLosHandler::MoveUnit)
+ *
+ * These squares must be remembered because 1) ray-casting against the terrain
+ * is not particularly fast and more importantly 2) the terrain may have changed
+ * between the LosAdd and the moment we want to undo the LosAdd.
+ *
+ * LosInstances may be shared between multiple units. Reference counting is
+ * used to track how many units currently use one instance.
+ *
+ * An instance will be shared iff the other unit is in the same square
+ * (basePos, baseSquare) on the LOS map, has the same radius, is in the
+ * same ally-team and has the same height.
+ */
+struct SLosInstance
+{
+	SLosInstance(int id)
+		: id(id)
+		, allyteam(-1)
+		, radius(-1)
+		, basePos()
+		, baseHeight(-1)
+		, refCount(0)
+		, hashNum(-1)
+		, status(NONE)
+		, isCached(false)
+		, isQueuedForUpdate(false)
+		, isQueuedForTerraform(false)
+	{}
+	void Init(int radius, int allyteam, int2 basePos, float baseHeight, int hashNum);
+
+public:
+	// hash properties
+	int id;
+	int allyteam;
+	int radius;
+	int2 basePos;
+	float baseHeight;
+
+	// working data
+	int refCount;
+	struct RLE { int start; unsigned length; };
+	static constexpr RLE EMPTY_RLE = RLE{0,0};
+	std::vector<RLE> squares;
+
+	// helpers
+	int hashNum;
+	enum TLosStatus {
+		NONE       =  0,
+		NEW        =  1,
+		REACTIVATE =  2,
+		RECALC     =  4,
+		REMOVE     =  8,
+	};
+	int status;
+
+	bool isCached;
+	bool isQueuedForUpdate;
+	bool isQueuedForTerraform;
+};
+
 
 
 /// map containing counts of how many units have Line Of Sight (LOS) to each square
@@ -35,14 +99,43 @@ public:
 
 public:
 	/// circular area, for airLosMap, circular radar maps, jammer maps, ...
-	void AddCircle(SLosInstance* instance, int amount);
+	void AddCircle(SLosInstance* instance, int amount) { AddCircle(instance, amount, {0, size.y}); }
+	void AddCircle(SLosInstance* instance, int amount, int2 rows);
 
 	/// arbitrary area, for losMap, non-circular radar maps, ...
-	void AddRaycast(SLosInstance* instance, int amount);
+	void AddRaycast(SLosInstance* instance, int amount) { AddRaycast(instance, amount, {0, size.y}, nullptr); }
+	void AddRaycast(SLosInstance* instance, int amount, int2 rows, std::vector<int>* losEnterSquares);
+
+	/// scratch space for AddInstances, one per set of losMaps since LOS types update concurrently
+	struct AddInstancesBuffers {
+		std::vector< std::vector<SLosInstance*> > allyInstances;
+		std::vector< std::vector<int> > losEnterSquares;
+	};
+
+	/**
+	 * Adds <amount> for every instance to losMaps[instance->allyteam].
+	 * Work is split into (allyteam, row-stripe) pairs so that each square has
+	 * exactly one writer and receives its increments in the same order as a
+	 * serial loop over <instances> would apply them.
+	 */
+	static void AddInstances(std::vector<CLosMap>& losMaps, const std::vector<SLosInstance*>& instances, int amount, bool raycast, AddInstancesBuffers& buffers);
 
 	/// arbitrary area, for losMap, non-circular radar maps, ...
 	void PrepareRaycast(SLosInstance* instance) const;
 
+public:
+	enum RaycastKernel {
+		RAYCAST_KERNEL_SCALAR = 0,
+		RAYCAST_KERNEL_SSE    = 1,
+		RAYCAST_KERNEL_AVX2   = 2,
+		RAYCAST_KERNEL_COUNT  = 3,
+	};
+
+	/// the best supported kernel is selected at startup; all produce identical squares
+	static bool HasRaycastKernel(int kernel);
+	static bool SetRaycastKernel(int kernel);
+	static int GetRaycastKernel();
+
 public:
 	int At(int2 p) const {
 		p.x = Clamp(p.x, 0, size.x - 1);
@@ -59,6 +152,7 @@ private:
 	void SafeLosAdd(SLosInstance* instance) const;
 
 	void AddSquaresToInstance(SLosInstance* li, const std::vector<char>& losRaySquares) const;
+	void SendLosEnterEvent(int losSquareIdx) const;
 
 protected:
 	int2 size;
@@ -95,6 +95,8 @@ void CModInfo::ResetState()
 		pathFinderSystem = NOPFS_TYPE;
 		pfRawDistMult    = 1.25f;
 		pfUpdateRate     = 0.007f;
+		pfUpdateBudget   = 0.0f;
+		pfAsyncRequests  = false;
 
 		allowTake = true;
 	}
@@ -134,6 +136,8 @@ void CModInfo::Init(const std::string& modFileName)
 		pathFinderSystem = Clamp(system.GetInt("pathFinderSystem", HAPFS_TYPE), int(NOPFS_TYPE), int(QTPFS_TYPE));
 		pfRawDistMult = system.GetFloat("pathFinderRawDistMult", pfRawDistMult);
 		pfUpdateRate = system.GetFloat("pathFinderUpdateRate", pfUpdateRate);
+		pfUpdateBudget = std::max(0.0f, system.GetFloat("pathFinderUpdateBudget", pfUpdateBudget));
+		pfAsyncRequests = system.GetBool("pathFinderAsyncRequests", pfAsyncRequests);
 
 		allowTake = system.GetBool("allowTake", allowTake);
 	}
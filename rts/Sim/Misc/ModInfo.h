@@ -161,6 +161,10 @@ public:
 
 	float pfRawDistMult;
 	float pfUpdateRate;
+	/// per-frame PathEstimator block-update budget in milliseconds (0 := use pfUpdateRate)
+	float pfUpdateBudget;
+	/// whether the default pathfinder defers unit path-requests to its (multithreaded) Update
+	bool pfAsyncRequests;
 
 	bool allowTake;
 };
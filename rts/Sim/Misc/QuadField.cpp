@@ -17,6 +17,8 @@
 	#include "Sim/Weapons/PlasmaRepulser.h"
 #endif
 
+#include "System/Threading/ThreadPool.h"
+
 CR_BIND(CQuadField, )
 CR_REG_METADATA(CQuadField, (
 	CR_MEMBER(baseQuads),
@@ -30,24 +32,56 @@ CR_REG_METADATA(CQuadField, (
 	CR_IGNORED(tempFeatures),
 	CR_IGNORED(tempProjectiles),
 	CR_IGNORED(tempSolids),
-	CR_IGNORED(tempQuads)
+	CR_IGNORED(tempQuads),
+
+	CR_POSTLOAD(PostLoad)
 ))
 
 CR_BIND(CQuadField::Quad, )
 CR_REG_METADATA_SUB(CQuadField, Quad, (
 	CR_MEMBER(units),
+	CR_IGNORED(unitSpans),
 	CR_IGNORED(teamUnits),
+	CR_IGNORED(teamUnitSpans),
 	CR_MEMBER(features),
 	CR_MEMBER(projectiles),
-	CR_MEMBER(repulsers),
-
-	CR_POSTLOAD(PostLoad)
+	CR_IGNORED(projectileSpans),
+	CR_MEMBER(repulsers)
 ))
 
 
 CQuadField quadField;
 
 
+// per-thread replacement for tempNum in span queries, indexed by object id
+struct SpanQueryStamps {
+public:
+	void Next() {
+		if ((++stamp) != 0)
+			return;
+
+		std::fill(stamps.begin(), stamps.end(), 0);
+		stamp = 1;
+	}
+
+	bool Mark(int id) {
+		if (size_t(id) >= stamps.size())
+			stamps.resize(id + 1, 0);
+		if (stamps[id] == stamp)
+			return false;
+
+		stamps[id] = stamp;
+		return true;
+	}
+
+private:
+	std::vector<unsigned int> stamps;
+	unsigned int stamp = 0;
+};
+
+static std::array<SpanQueryStamps, ThreadPool::MAX_THREADS> spanQueryStamps;
+
+
 #ifndef UNIT_TEST
 /*
 void CQuadField::Resize(int quad_size)
@@ -95,17 +129,147 @@ void CQuadField::Resize(int quad_size)
 #endif
 
 
-void CQuadField::Quad::PostLoad()
+void CQuadField::PostLoad()
 {
 #ifndef UNIT_TEST
-	Resize(teamHandler.ActiveAllyTeams());
+	// teamUnits, the spans and CUnit::quadIndices are not saved
+	for (int qi = 0, nq = baseQuads.size(); qi < nq; ++qi) {
+		Quad& quad = baseQuads[qi];
 
-	for (CUnit* unit: units) {
-		spring::VectorInsertUnique(teamUnits[unit->allyteam], unit, false);
+		quad.Resize(teamHandler.ActiveAllyTeams());
+		quad.unitSpans.clear();
+		quad.projectileSpans.clear();
+
+		for (auto& v: quad.teamUnits) {
+			v.clear();
+		}
+		for (auto& v: quad.teamUnitSpans) {
+			v.clear();
+		}
+
+		for (int i = 0, n = quad.units.size(); i < n; ++i) {
+			CUnit* unit = quad.units[i];
+
+			auto& teamUnits = quad.teamUnits[unit->allyteam];
+			auto& teamUnitSpans = quad.teamUnitSpans[unit->allyteam];
+
+			unit->quadIndices.resize(unit->quads.size());
+			unit->quadIndices[std::find(unit->quads.begin(), unit->quads.end(), qi) - unit->quads.begin()] = {i, int(teamUnits.size())};
+
+			quad.unitSpans.push_back({unit->pos, unit->radius, unit->id});
+			teamUnits.push_back(unit);
+			teamUnitSpans.push_back({unit->pos, unit->radius, unit->id});
+		}
+
+		for (CProjectile* p: quad.projectiles) {
+			p->quadIndex = quad.projectileSpans.size();
+			quad.projectileSpans.push_back({p->pos, p->radius, p->id});
+		}
 	}
 #endif
 }
 
+
+#ifndef UNIT_TEST
+// units and projectiles are stored unordered, erasing swaps in the last
+// element; the span arrays mirror every change of their pointer arrays
+// and CUnit::quadIndices tracks where a unit is in each of its quads
+static inline int2& GetQuadIndex(CUnit* unit, int quadIdx)
+{
+	const auto iter = std::find(unit->quads.begin(), unit->quads.end(), quadIdx);
+
+	assert(iter != unit->quads.end());
+	return unit->quadIndices[iter - unit->quads.begin()];
+}
+
+int2 CQuadField::Quad::AddUnit(CUnit* unit)
+{
+	auto& allyTeamUnits = teamUnits[unit->allyteam];
+	auto& allyTeamUnitSpans = teamUnitSpans[unit->allyteam];
+
+	const int2 unitIdx = {int(units.size()), int(allyTeamUnits.size())};
+
+	units.push_back(unit);
+	unitSpans.push_back({unit->pos, unit->radius, unit->id});
+	allyTeamUnits.push_back(unit);
+	allyTeamUnitSpans.push_back({unit->pos, unit->radius, unit->id});
+	return unitIdx;
+}
+
+void CQuadField::Quad::RemoveUnit(int quadIdx, CUnit* unit, int2 unitIdx)
+{
+	auto& allyTeamUnits = teamUnits[unit->allyteam];
+	auto& allyTeamUnitSpans = teamUnitSpans[unit->allyteam];
+
+	assert(units[unitIdx.x] == unit);
+	assert(allyTeamUnits[unitIdx.y] == unit);
+
+	if (unitIdx.x != int(units.size() - 1)) {
+		units[unitIdx.x] = units.back();
+		unitSpans[unitIdx.x] = unitSpans.back();
+
+		GetQuadIndex(units[unitIdx.x], quadIdx).x = unitIdx.x;
+	}
+	if (unitIdx.y != int(allyTeamUnits.size() - 1)) {
+		allyTeamUnits[unitIdx.y] = allyTeamUnits.back();
+		allyTeamUnitSpans[unitIdx.y] = allyTeamUnitSpans.back();
+
+		GetQuadIndex(allyTeamUnits[unitIdx.y], quadIdx).y = unitIdx.y;
+	}
+
+	units.pop_back();
+	unitSpans.pop_back();
+	allyTeamUnits.pop_back();
+	allyTeamUnitSpans.pop_back();
+}
+
+void CQuadField::Quad::UpdateUnit(const CUnit* unit, int2 unitIdx)
+{
+	assert(units[unitIdx.x] == unit);
+	assert(teamUnits[unit->allyteam][unitIdx.y] == unit);
+
+	unitSpans[unitIdx.x] = {unit->pos, unit->radius, unit->id};
+	teamUnitSpans[unit->allyteam][unitIdx.y] = {unit->pos, unit->radius, unit->id};
+}
+
+
+void CQuadField::Quad::AddProjectile(CProjectile* p)
+{
+	spring::VectorInsertUnique(projectiles, p, false);
+	p->quadIndex = projectileSpans.size();
+	projectileSpans.push_back({p->pos, p->radius, p->id});
+}
+
+void CQuadField::Quad::RemoveProjectile(CProjectile* p)
+{
+	size_t idx = p->quadIndex;
+
+	// hitscan projectiles live in multiple quads, quadIndex is only valid for one
+	if (idx >= projectiles.size() || projectiles[idx] != p) {
+		const auto iter = std::find(projectiles.begin(), projectiles.end(), p);
+
+		if (iter == projectiles.end())
+			return;
+
+		idx = iter - projectiles.begin();
+	}
+
+	projectiles[idx] = projectiles.back();
+	projectiles[idx]->quadIndex = idx;
+	projectiles.pop_back();
+	projectileSpans[idx] = projectileSpans.back();
+	projectileSpans.pop_back();
+}
+
+void CQuadField::Quad::UpdateProjectile(const CProjectile* p)
+{
+	assert(size_t(p->quadIndex) < projectiles.size());
+	assert(projectiles[p->quadIndex] == p);
+
+	projectileSpans[p->quadIndex] = {p->pos, p->radius, p->id};
+}
+#endif
+
 void CQuadField::Init(int2 mapDims, int quadSize)
 {
 	quadSizeX = quadSize;
@@ -162,12 +326,15 @@ int CQuadField::WorldPosToQuadFieldIdx(const float3 p) const
 }
 
 
-#ifndef UNIT_TEST
 void CQuadField::GetQuads(QuadFieldQuery& qfq, float3 pos, float radius)
+{
+	GetQuads(*(qfq.quads = tempQuads.ReserveVector()), pos, radius);
+}
+
+void CQuadField::GetQuads(std::vector<int>& quads, float3 pos, float radius) const
 {
 	pos.AssertNaNs();
 	pos.ClampInBounds();
-	qfq.quads = tempQuads.ReserveVector();
 
 	const int2 min = WorldPosToQuadField(pos - radius);
 	const int2 max = WorldPosToQuadField(pos + radius);
@@ -184,20 +351,22 @@ void CQuadField::GetQuads(QuadFieldQuery& qfq, float3 pos, float radius)
 			assert(z < numQuadsZ);
 			const float3 quadPos = float3(x * quadSizeX + quadSizeX * 0.5f, 0, z * quadSizeZ + quadSizeZ * 0.5f);
 			if (pos.SqDistance2D(quadPos) < maxSqLength) {
-				qfq.quads->push_back(z * numQuadsX + x);
+				quads.push_back(z * numQuadsX + x);
 			}
 		}
 	}
-
-	return;
 }
 
 
 void CQuadField::GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, const float3& maxs)
+{
+	GetQuadsRectangle(*(qfq.quads = tempQuads.ReserveVector()), mins, maxs);
+}
+
+void CQuadField::GetQuadsRectangle(std::vector<int>& quads, const float3& mins, const float3& maxs) const
 {
 	mins.AssertNaNs();
 	maxs.AssertNaNs();
-	qfq.quads = tempQuads.ReserveVector();
 
 	const int2 min = WorldPosToQuadField(mins);
 	const int2 max = WorldPosToQuadField(maxs);
@@ -209,23 +378,23 @@ void CQuadField::GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, cons
 		for (int x = min.x; x <= max.x; ++x) {
 			assert(x < numQuadsX);
 			assert(z < numQuadsZ);
-			qfq.quads->push_back(z * numQuadsX + x);
+			quads.push_back(z * numQuadsX + x);
 		}
 	}
-
-	return;
 }
-#endif // UNIT_TEST
 
 
-/// note: this function got an UnitTest, check the tests/ folder!
 void CQuadField::GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const float3& dir, float length)
+{
+	GetQuadsOnRay(*(qfq.quads = tempQuads.ReserveVector()), start, dir, length);
+}
+
+/// note: this function got an UnitTest, check the tests/ folder!
+void CQuadField::GetQuadsOnRay(std::vector<int>& queryQuads, const float3& start, const float3& dir, float length) const
 {
 	dir.AssertNaNs();
 	start.AssertNaNs();
 
-	auto& queryQuads = *(qfq.quads = tempQuads.ReserveVector());
-
 	const float3 to = start + (dir * length);
 
 	const bool noXdir = (math::floor(start.x * invQuadSize.x) == math::floor(to.x * invQuadSize.x));
@@ -306,6 +475,247 @@ void CQuadField::GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const f
 
 
 
+void CQuadField::GetUnitsExactSpans(
+	std::vector<CUnit*>& units,
+	std::vector<int>& quads,
+	const float3& pos,
+	const float radius,
+	const bool spherical
+) const {
+	SpanQueryStamps& stamps = spanQueryStamps[ThreadPool::GetThreadNum()];
+
+	quads.clear();
+	GetQuads(quads, pos, radius);
+	stamps.Next();
+
+	for (const int qi: quads) {
+		const Quad& quad = baseQuads[qi];
+
+		for (size_t i = 0, n = quad.unitSpans.size(); i < n; ++i) {
+			const ObjectSpan& span = quad.unitSpans[i];
+
+			const float totRadSq     = Square(radius + span.radius);
+			const float posUnitDstSq = spherical?
+				pos.SqDistance(span.pos):
+				pos.SqDistance2D(span.pos);
+
+			if (posUnitDstSq >= totRadSq)
+				continue;
+			// spans are identical in every quad, so only hits can be duplicates
+			if (!stamps.Mark(span.id))
+				continue;
+
+			units.push_back(quad.units[i]);
+		}
+	}
+}
+
+void CQuadField::GetUnitsExactSpans(
+	std::vector<CUnit*>& units,
+	std::vector<int>& quads,
+	const float3& mins,
+	const float3& maxs
+) const {
+	SpanQueryStamps& stamps = spanQueryStamps[ThreadPool::GetThreadNum()];
+
+	quads.clear();
+	GetQuadsRectangle(quads, mins, maxs);
+	stamps.Next();
+
+	for (const int qi: quads) {
+		const Quad& quad = baseQuads[qi];
+
+		for (size_t i = 0, n = quad.unitSpans.size(); i < n; ++i) {
+			const ObjectSpan& span = quad.unitSpans[i];
+
+			if (span.pos.x < mins.x || span.pos.x > maxs.x)
+				continue;
+			if (span.pos.z < mins.z || span.pos.z > maxs.z)
+				continue;
+			if (!stamps.Mark(span.id))
+				continue;
+
+			units.push_back(quad.units[i]);
+		}
+	}
+}
+
+void CQuadField::GetUnitsExactSpans(QuadFieldQuery& qfq, const float3& pos, float radius, bool spherical)
+{
+	qfq.quads = tempQuads.ReserveVector();
+	qfq.units = tempUnits.ReserveVector();
+
+	GetUnitsExactSpans(*qfq.units, *qfq.quads, pos, radius, spherical);
+}
+
+void CQuadField::GetUnitsExactSpans(QuadFieldQuery& qfq, const float3& mins, const float3& maxs)
+{
+	qfq.quads = tempQuads.ReserveVector();
+	qfq.units = tempUnits.ReserveVector();
+
+	GetUnitsExactSpans(*qfq.units, *qfq.quads, mins, maxs);
+}
+
+void CQuadField::GetProjectilesExactSpans(
+	std::vector<CProjectile*>& projectiles,
+	std::vector<int>& quads,
+	const float3& pos,
+	const float radius
+) const {
+	SpanQueryStamps& stamps = spanQueryStamps[ThreadPool::GetThreadNum()];
+
+	quads.clear();
+	GetQuads(quads, pos, radius);
+	stamps.Next();
+
+	for (const int qi: quads) {
+		const Quad& quad = baseQuads[qi];
+
+		for (size_t i = 0, n = quad.projectileSpans.size(); i < n; ++i) {
+			const ObjectSpan& span = quad.projectileSpans[i];
+
+			if (pos.SqDistance(span.pos) >= Square(radius + span.radius))
+				continue;
+			if (!stamps.Mark(span.id))
+				continue;
+
+			projectiles.push_back(quad.projectiles[i]);
+		}
+	}
+}
+
+void CQuadField::GetUnitsExact(QuadFieldBatchQuery& batch) const
+{
+	struct BatchScratch {
+		std::vector<int> quads;
+		std::vector<size_t> quadOffsets;
+		std::vector<size_t> order;
+		std::vector<CUnit*> units;
+		std::vector<size_t> ranges;
+	};
+
+	static std::array<BatchScratch, ThreadPool::MAX_THREADS> batchScratch;
+
+	const auto& queries = batch.queries;
+	const size_t numQueries = queries.size();
+
+	BatchScratch& scratch = batchScratch[ThreadPool::GetThreadNum()];
+	SpanQueryStamps& stamps = spanQueryStamps[ThreadPool::GetThreadNum()];
+
+	scratch.quads.clear();
+	scratch.quadOffsets.clear();
+	scratch.order.clear();
+	scratch.units.clear();
+	scratch.ranges.clear();
+	scratch.ranges.resize(numQueries * 2, 0);
+
+	batch.units.clear();
+	batch.offsets.clear();
+	batch.offsets.reserve(numQueries + 1);
+
+	// enumerate the quads touched by every query up front
+	for (const QuadFieldBatchQuery::Query& q: queries) {
+		scratch.quadOffsets.push_back(scratch.quads.size());
+
+		switch (q.type) {
+			case QuadFieldBatchQuery::QUERY_SPHERE:
+			case QuadFieldBatchQuery::QUERY_CYLINDER: {
+				GetQuads(scratch.quads, q.p0, q.radius);
+			} break;
+			case QuadFieldBatchQuery::QUERY_RECTANGLE: {
+				GetQuadsRectangle(scratch.quads, q.p0, q.p1);
+			} break;
+			case QuadFieldBatchQuery::QUERY_RAY: {
+				if (q.radius <= 0.0f) {
+					GetQuadsOnRay(scratch.quads, q.p0, q.p1, q.length);
+				} else {
+					// thick rays also touch quads next to the ones they cross
+					const float3 p1 = q.p0 + q.p1 * q.length;
+					const float3 mins = {std::min(q.p0.x, p1.x) - q.radius, 0.0f, std::min(q.p0.z, p1.z) - q.radius};
+					const float3 maxs = {std::max(q.p0.x, p1.x) + q.radius, 0.0f, std::max(q.p0.z, p1.z) + q.radius};
+
+					GetQuadsRectangle(scratch.quads, mins, maxs);
+				}
+			} break;
+			default: {
+				assert(false);
+			} break;
+		}
+
+		scratch.order.push_back(scratch.order.size());
+	}
+
+	scratch.quadOffsets.push_back(scratch.quads.size());
+
+	// visit queries starting in the same quad back-to-back
+	const auto FirstQuad = [&](size_t i) {
+		return ((scratch.quadOffsets[i] == scratch.quadOffsets[i + 1])? -1: scratch.quads[scratch.quadOffsets[i]]);
+	};
+	std::stable_sort(scratch.order.begin(), scratch.order.end(), [&](size_t a, size_t b) { return (FirstQuad(a) < FirstQuad(b)); });
+
+	for (const size_t qi: scratch.order) {
+		const QuadFieldBatchQuery::Query& q = queries[qi];
+
+		const float3& pos = q.p0;
+		const float radius = q.radius;
+
+		scratch.ranges[qi * 2 + 0] = scratch.units.size();
+		stamps.Next();
+
+		for (size_t k = scratch.quadOffsets[qi]; k < scratch.quadOffsets[qi + 1]; ++k) {
+			const Quad& quad = baseQuads[scratch.quads[k]];
+
+			for (size_t i = 0, n = quad.unitSpans.size(); i < n; ++i) {
+				const ObjectSpan& span = quad.unitSpans[i];
+
+				switch (q.type) {
+					case QuadFieldBatchQuery::QUERY_SPHERE: {
+						if (pos.SqDistance(span.pos) >= Square(radius + span.radius))
+							continue;
+					} break;
+					case QuadFieldBatchQuery::QUERY_CYLINDER: {
+						if (pos.SqDistance2D(span.pos) >= Square(radius + span.radius))
+							continue;
+					} break;
+					case QuadFieldBatchQuery::QUERY_RECTANGLE: {
+						if (span.pos.x < q.p0.x || span.pos.x > q.p1.x)
+							continue;
+						if (span.pos.z < q.p0.z || span.pos.z > q.p1.z)
+							continue;
+					} break;
+					case QuadFieldBatchQuery::QUERY_RAY: {
+						const float t = Clamp((span.pos - pos).dot(q.p1), 0.0f, q.length);
+
+						if ((pos + q.p1 * t).SqDistance(span.pos) >= Square(radius + span.radius))
+							continue;
+					} break;
+					default: {
+					} break;
+				}
+
+				if (!stamps.Mark(span.id))
+					continue;
+
+				scratch.units.push_back(quad.units[i]);
+			}
+		}
+
+		scratch.ranges[qi * 2 + 1] = scratch.units.size();
+	}
+
+	// gather results in query order
+	batch.units.reserve(scratch.units.size());
+
+	for (size_t qi = 0; qi < numQueries; ++qi) {
+		batch.offsets.push_back(batch.units.size());
+		batch.units.insert(batch.units.end(), scratch.units.begin() + scratch.ranges[qi * 2 + 0], scratch.units.begin() + scratch.ranges[qi * 2 + 1]);
+	}
+
+	batch.offsets.push_back(batch.units.size());
+}
+
+
+
 #ifndef UNIT_TEST
 bool CQuadField::InsertUnitIf(CUnit* unit, const float3& wpos)
 {
@@ -319,11 +729,13 @@ bool CQuadField::InsertUnitIf(CUnit* unit, const float3& wpos)
 		return false;
 
 	// unit might also be overlapping the cell, so test for uniqueness
-	if (!spring::VectorInsertUnique(unit->quads, wposQuadIdx, true))
+	const auto iter = std::lower_bound(unit->quads.begin(), unit->quads.end(), wposQuadIdx);
+
+	if (iter != unit->quads.end() && *iter == wposQuadIdx)
 		return false;
 
-	spring::VectorInsertUnique(baseQuads[wposQuadIdx].units, unit, false);
-	spring::VectorInsertUnique(baseQuads[wposQuadIdx].teamUnits[unit->allyteam], unit, false);
+	unit->quadIndices.insert(unit->quadIndices.begin() + (iter - unit->quads.begin()), baseQuads[wposQuadIdx].AddUnit(unit));
+	unit->quads.insert(iter, wposQuadIdx);
 	return true;
 }
 
@@ -349,11 +761,18 @@ bool CQuadField::RemoveUnitIf(CUnit* unit, const float3& wpos)
 		return false;
 	}
 
-	if (!spring::VectorErase(unit->quads, wposQuadIdx))
+	const auto iter = std::find(unit->quads.begin(), unit->quads.end(), wposQuadIdx);
+
+	if (iter == unit->quads.end())
 		return false;
 
-	spring::VectorErase(baseQuads[wposQuadIdx].units, unit);
-	spring::VectorErase(baseQuads[wposQuadIdx].teamUnits[unit->allyteam], unit);
+	const size_t k = iter - unit->quads.begin();
+
+	baseQuads[wposQuadIdx].RemoveUnit(wposQuadIdx, unit, unit->quadIndices[k]);
+
+	// keep unit->quads sorted, InsertUnitIf relies on it
+	unit->quads.erase(iter);
+	unit->quadIndices.erase(unit->quadIndices.begin() + k);
 	return true;
 }
 #endif
@@ -366,33 +785,42 @@ void CQuadField::MovedUnit(CUnit* unit)
 	QuadFieldQuery qfQuery;
 	GetQuads(qfQuery, unit->pos, unit->radius);
 
-	// compare if the quads have changed, if not stop here
+	// compare if the quads have changed, if not only refresh the spans
 	if (qfQuery.quads->size() == unit->quads.size()) {
-		if (std::equal(qfQuery.quads->begin(), qfQuery.quads->end(), unit->quads.begin()))
+		if (std::equal(qfQuery.quads->begin(), qfQuery.quads->end(), unit->quads.begin())) {
+			MovedUnitSpans(unit);
 			return;
+		}
 	}
 
-	for (const int qi: unit->quads) {
-		spring::VectorErase(baseQuads[qi].units, unit);
-		spring::VectorErase(baseQuads[qi].teamUnits[unit->allyteam], unit);
+	for (size_t k = 0; k < unit->quads.size(); ++k) {
+		baseQuads[unit->quads[k]].RemoveUnit(unit->quads[k], unit, unit->quadIndices[k]);
 	}
 
+	unit->quadIndices.clear();
+
 	for (const int qi: *qfQuery.quads) {
-		spring::VectorInsertUnique(baseQuads[qi].units, unit, false);
-		spring::VectorInsertUnique(baseQuads[qi].teamUnits[unit->allyteam], unit, false);
+		unit->quadIndices.push_back(baseQuads[qi].AddUnit(unit));
 	}
 
 	unit->quads = std::move(*qfQuery.quads);
 }
 
+void CQuadField::MovedUnitSpans(const CUnit* unit)
+{
+	for (size_t k = 0; k < unit->quads.size(); ++k) {
+		baseQuads[unit->quads[k]].UpdateUnit(unit, unit->quadIndices[k]);
+	}
+}
+
 void CQuadField::RemoveUnit(CUnit* unit)
 {
-	for (const int qi: unit->quads) {
-		spring::VectorErase(baseQuads[qi].units, unit);
-		spring::VectorErase(baseQuads[qi].teamUnits[unit->allyteam], unit);
+	for (size_t k = 0; k < unit->quads.size(); ++k) {
+		baseQuads[unit->quads[k]].RemoveUnit(unit->quads[k], unit, unit->quadIndices[k]);
 	}
 
 	unit->quads.clear();
+	unit->quadIndices.clear();
 
 	#ifdef DEBUG_QUADFIELD
 	for (const Quad& q: baseQuads) {
@@ -490,6 +918,8 @@ void CQuadField::MovedProjectile(CProjectile* p)
 	if (newQuad != p->quads.back()) {
 		RemoveProjectile(p);
 		AddProjectile(p);
+	} else {
+		baseQuads[newQuad].UpdateProjectile(p);
 	}
 }
 
@@ -502,13 +932,13 @@ void CQuadField::AddProjectile(CProjectile* p)
 		GetQuadsOnRay(qfQuery, p->pos, p->dir, p->speed.w);
 
 		for (const int qi: *qfQuery.quads) {
-			spring::VectorInsertUnique(baseQuads[qi].projectiles, p, false);
+			baseQuads[qi].AddProjectile(p);
 		}
 
 		p->quads = std::move(*qfQuery.quads);
 	} else {
 		int newQuad = WorldPosToQuadFieldIdx(p->pos);
-		spring::VectorInsertUnique(baseQuads[newQuad].projectiles, p, false);
+		baseQuads[newQuad].AddProjectile(p);
 		p->quads.clear();
 		p->quads.push_back(newQuad);
 	}
@@ -519,7 +949,7 @@ void CQuadField::RemoveProjectile(CProjectile* p)
 	assert(p->synced);
 
 	for (const int qi: p->quads) {
-		spring::VectorErase(baseQuads[qi].projectiles, p);
+		baseQuads[qi].RemoveProjectile(p);
 	}
 
 	p->quads.clear();
@@ -770,6 +1200,56 @@ void CQuadField::GetSolidsExact(
 }
 
 
+void CQuadField::GetSolidsExactMT(
+	std::vector<CSolidObject*>& solids,
+	std::vector<int>& quads,
+	const float3& pos,
+	const float radius,
+	const unsigned int physicalStateBits,
+	const unsigned int collisionStateBits
+) const {
+	const size_t solidsBase = solids.size();
+
+	quads.clear();
+	GetQuads(quads, pos, radius);
+
+	// objects can overlap multiple quads; since tempNum is off-limits
+	// here duplicates are filtered by searching the (short) result list
+	// which also preserves the order in which GetSolidsExact finds them
+	const auto IsNewSolid = [&](const CSolidObject* o) {
+		return (std::find(solids.begin() + solidsBase, solids.end(), o) == solids.end());
+	};
+
+	for (const int qi: quads) {
+		for (CUnit* u: baseQuads[qi].units) {
+			if (!u->HasPhysicalStateBit(physicalStateBits))
+				continue;
+			if (!u->HasCollidableStateBit(collisionStateBits))
+				continue;
+			if ((pos - u->pos).SqLength() >= Square(radius + u->radius))
+				continue;
+			if (!IsNewSolid(u))
+				continue;
+
+			solids.push_back(u);
+		}
+
+		for (CFeature* f: baseQuads[qi].features) {
+			if (!f->HasPhysicalStateBit(physicalStateBits))
+				continue;
+			if (!f->HasCollidableStateBit(collisionStateBits))
+				continue;
+			if ((pos - f->pos).SqLength() >= Square(radius + f->radius))
+				continue;
+			if (!IsNewSolid(f))
+				continue;
+
+			solids.push_back(f);
+		}
+	}
+}
+
+
 bool CQuadField::NoSolidsExact(
 	const float3& pos,
 	const float radius,
@@ -885,4 +1365,64 @@ void CQuadField::GetUnitsAndFeaturesColVol(
 		}
 	}
 }
+
+void CQuadField::GetUnitsAndFeaturesColVolMT(
+	const float3& pos,
+	const float radius,
+	std::vector<CUnit*>& units,
+	std::vector<CFeature*>& features,
+	std::vector<CPlasmaRepulser*>* repulsers,
+	std::vector<int>& quads
+) const {
+	const size_t unitsBase = units.size();
+	const size_t featuresBase = features.size();
+	const size_t repulsersBase = (repulsers != nullptr)? repulsers->size(): 0;
+
+	quads.clear();
+	GetQuads(quads, pos, radius);
+
+	// see GetSolidsExactMT; the distance tests are done first since
+	// they reject most objects and are cheaper than the list search
+	for (const int qi: quads) {
+		const Quad& quad = baseQuads[qi];
+
+		for (CUnit* u: quad.units) {
+			const auto* colvol = &u->collisionVolume;
+			const float totRad = radius + colvol->GetBoundingRadius();
+
+			if (pos.SqDistance(colvol->GetWorldSpacePos(u)) >= (totRad * totRad))
+				continue;
+			if (std::find(units.begin() + unitsBase, units.end(), u) != units.end())
+				continue;
+
+			units.push_back(u);
+		}
+
+		for (CFeature* f: quad.features) {
+			const auto* colvol = &f->collisionVolume;
+			const float totRad = radius + colvol->GetBoundingRadius();
+
+			if (pos.SqDistance(colvol->GetWorldSpacePos(f)) >= (totRad * totRad))
+				continue;
+			if (std::find(features.begin() + featuresBase, features.end(), f) != features.end())
+				continue;
+
+			features.push_back(f);
+		}
+
+		if (repulsers != nullptr) {
+			for (CPlasmaRepulser* r: quad.repulsers) {
+				const auto* colvol = &r->collisionVolume;
+				const float totRad = radius + colvol->GetBoundingRadius();
+
+				if (pos.SqDistance(r->weaponMuzzlePos) >= (totRad * totRad))
+					continue;
+				if (std::find(repulsers->begin() + repulsersBase, repulsers->end(), r) != repulsers->end())
+					continue;
+
+				repulsers->push_back(r);
+			}
+		}
+	}
+}
 #endif // UNIT_TEST
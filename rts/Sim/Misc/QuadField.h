@@ -18,6 +18,7 @@ class CProjectile;
 class CSolidObject;
 class CPlasmaRepulser;
 struct QuadFieldQuery;
+struct QuadFieldBatchQuery;
 
 template<typename T>
 class QueryVectorCache {
@@ -93,8 +94,12 @@ public:
 	void Kill();
 
 	void GetQuads(QuadFieldQuery& qfq, float3 pos, float radius);
+	// thread-safe variant, appends to a caller-provided vector
+	void GetQuads(std::vector<int>& quads, float3 pos, float radius) const;
 	void GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
+	void GetQuadsRectangle(std::vector<int>& quads, const float3& mins, const float3& maxs) const;
 	void GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const float3& dir, float length);
+	void GetQuadsOnRay(std::vector<int>& quads, const float3& start, const float3& dir, float length) const;
 
 	void GetUnitsAndFeaturesColVol(
 		const float3& pos,
@@ -103,6 +108,18 @@ public:
 		std::vector<CFeature*>& features,
 		std::vector<CPlasmaRepulser*>* repulsers = nullptr
 	);
+	/**
+	 * Thread-safe variant of GetUnitsAndFeaturesColVol, with the same
+	 * guarantees as GetSolidsExactMT (@c quads is scratch space)
+	 */
+	void GetUnitsAndFeaturesColVolMT(
+		const float3& pos,
+		const float radius,
+		std::vector<CUnit*>& units,
+		std::vector<CFeature*>& features,
+		std::vector<CPlasmaRepulser*>* repulsers,
+		std::vector<int>& quads
+	) const;
 
 	/**
 	 * Returns all units within @c radius of @c pos,
@@ -143,6 +160,61 @@ public:
 		const unsigned int collisionStateBits = 0xFFFFFFFF
 	);
 
+	/**
+	 * Thread-safe variant of GetSolidsExact: does not modify the
+	 * tempNum's of any objects or use the shared query caches, but
+	 * appends the same objects in the same order to @c solids
+	 * (@c quads is caller-provided scratch space)
+	 */
+	void GetSolidsExactMT(
+		std::vector<CSolidObject*>& solids,
+		std::vector<int>& quads,
+		const float3& pos,
+		const float radius,
+		const unsigned int physicalStateBits = 0xFFFFFFFF,
+		const unsigned int collisionStateBits = 0xFFFFFFFF
+	) const;
+
+	/**
+	 * Span-based variants of GetUnitsExact and GetProjectilesExact: these only
+	 * scan the quads' ObjectSpans (see below) and never dereference an object,
+	 * which also makes them thread-safe (@c quads is caller-provided scratch).
+	 *
+	 * Unit spans follow every CUnit::Move and radius change, so outside of
+	 * the parallel phases these return the same units in the same order as
+	 * GetUnitsExact; projectile spans are refreshed by MovedProjectile.
+	 */
+	void GetUnitsExactSpans(
+		std::vector<CUnit*>& units,
+		std::vector<int>& quads,
+		const float3& pos,
+		const float radius,
+		const bool spherical = true
+	) const;
+	void GetUnitsExactSpans(
+		std::vector<CUnit*>& units,
+		std::vector<int>& quads,
+		const float3& mins,
+		const float3& maxs
+	) const;
+	/// as above, using the shared query caches (not thread-safe)
+	void GetUnitsExactSpans(QuadFieldQuery& qfq, const float3& pos, float radius, bool spherical = true);
+	void GetUnitsExactSpans(QuadFieldQuery& qfq, const float3& mins, const float3& maxs);
+	void GetProjectilesExactSpans(
+		std::vector<CProjectile*>& projectiles,
+		std::vector<int>& quads,
+		const float3& pos,
+		const float radius
+	) const;
+
+	/**
+	 * Runs all queries in @c batch against the quads' unit spans, with the
+	 * same semantics and thread-safety as GetUnitsExactSpans; queries are
+	 * processed sorted by their first quad (for cache locality) but their
+	 * results are stored in query order
+	 */
+	void GetUnitsExact(QuadFieldBatchQuery& batch) const;
+
 	bool NoSolidsExact(
 		const float3& pos,
 		const float radius,
@@ -155,6 +227,8 @@ public:
 	bool RemoveUnitIf(CUnit* unit, const float3& wpos);
 
 	void MovedUnit(CUnit* unit);
+	/// refreshes the unit's spans in the quads it is already part of
+	void MovedUnitSpans(const CUnit* unit);
 	void RemoveUnit(CUnit* unit);
 
 	void AddFeature(CFeature* feature);
@@ -173,6 +247,19 @@ public:
 	void ReleaseVector(std::vector<CSolidObject*>* v) { tempSolids.ReleaseVector(v); }
 	void ReleaseVector(std::vector<int>* v          ) { tempQuads.ReleaseVector(v); }
 
+	/**
+	 * Packed copy of the position, radius and id of an object in a quad.
+	 * Every quad keeps one per unit (in units and teamUnits) and projectile,
+	 * at the same index as the object pointer, so range queries can run
+	 * over contiguous memory. Units know their indices (CUnit::quadIndices)
+	 * so their spans are rewritten in place whenever they move.
+	 */
+	struct ObjectSpan {
+		float3 pos;
+		float radius;
+		int id;
+	};
+
 	struct Quad {
 	public:
 		CR_DECLARE_STRUCT(Quad)
@@ -184,32 +271,53 @@ public:
 		Quad& operator = (const Quad& q) = delete;
 		Quad& operator = (Quad&& q) {
 			units = std::move(q.units);
+			unitSpans = std::move(q.unitSpans);
 			teamUnits = std::move(q.teamUnits);
+			teamUnitSpans = std::move(q.teamUnitSpans);
 			features = std::move(q.features);
 			projectiles = std::move(q.projectiles);
+			projectileSpans = std::move(q.projectileSpans);
 			repulsers = std::move(q.repulsers);
 			return *this;
 		}
 
-		void PostLoad();
-		void Resize(int numAllyTeams) { teamUnits.resize(numAllyTeams); }
+		void Resize(int numAllyTeams) {
+			teamUnits.resize(numAllyTeams);
+			teamUnitSpans.resize(numAllyTeams);
+		}
 		void Clear() {
 			units.clear();
+			unitSpans.clear();
 			// reuse inner vectors when reloading
 			// teamUnits.clear();
 			for (auto& v: teamUnits) {
 				v.clear();
 			}
+			for (auto& v: teamUnitSpans) {
+				v.clear();
+			}
 			features.clear();
 			projectiles.clear();
+			projectileSpans.clear();
 			repulsers.clear();
 		}
 
+		int2 AddUnit(CUnit* unit);
+		void RemoveUnit(int quadIdx, CUnit* unit, int2 unitIdx);
+		void UpdateUnit(const CUnit* unit, int2 unitIdx);
+
+		void AddProjectile(CProjectile* p);
+		void RemoveProjectile(CProjectile* p);
+		void UpdateProjectile(const CProjectile* p);
+
 	public:
 		std::vector<CUnit*> units;
+		std::vector<ObjectSpan> unitSpans;
 		std::vector< std::vector<CUnit*> > teamUnits;
+		std::vector< std::vector<ObjectSpan> > teamUnitSpans;
 		std::vector<CFeature*> features;
 		std::vector<CProjectile*> projectiles;
+		std::vector<ObjectSpan> projectileSpans;
 		std::vector<CPlasmaRepulser*> repulsers;
 	};
 
@@ -232,6 +340,8 @@ public:
 	constexpr static unsigned int BASE_QUAD_SIZE = 128;
 
 private:
+	void PostLoad();
+
 	int2 WorldPosToQuadField(const float3 p) const;
 	int WorldPosToQuadFieldIdx(const float3 p) const;
 
@@ -274,4 +384,60 @@ struct QuadFieldQuery {
 };
 
 
+/**
+ * N unit range queries executed at once by CQuadField::GetUnitsExact; the
+ * units found by query i are units[offsets[i]] to units[offsets[i + 1] - 1]
+ */
+struct QuadFieldBatchQuery {
+public:
+	enum QueryType {
+		QUERY_SPHERE    = 0,
+		QUERY_CYLINDER  = 1,
+		QUERY_RECTANGLE = 2,
+		QUERY_RAY       = 3,
+	};
+
+	struct Query {
+		QueryType type;
+
+		float3 p0; // sphere or cylinder center, rectangle mins, ray start
+		float3 p1; // rectangle maxs, ray direction (normalized)
+
+		float radius; // sphere or cylinder radius, ray thickness
+		float length; // ray length
+	};
+
+	void Clear() {
+		queries.clear();
+		units.clear();
+		offsets.clear();
+	}
+
+	size_t AddSphere(const float3& pos, float radius, bool spherical = true) {
+		queries.push_back({spherical? QUERY_SPHERE: QUERY_CYLINDER, pos, ZeroVector, radius, 0.0f});
+		return (queries.size() - 1);
+	}
+	size_t AddRectangle(const float3& mins, const float3& maxs) {
+		queries.push_back({QUERY_RECTANGLE, mins, maxs, 0.0f, 0.0f});
+		return (queries.size() - 1);
+	}
+	size_t AddRay(const float3& start, const float3& dir, float length, float radius = 0.0f) {
+		queries.push_back({QUERY_RAY, start, dir, radius, length});
+		return (queries.size() - 1);
+	}
+
+	size_t GetNumQueries() const { return queries.size(); }
+	size_t GetNumResults(size_t i) const { return (offsets[i + 1] - offsets[i]); }
+
+	CUnit* const* GetResultsBegin(size_t i) const { return (units.data() + offsets[i    ]); }
+	CUnit* const* GetResultsEnd(size_t i) const { return (units.data() + offsets[i + 1]); }
+
+public:
+	std::vector<Query> queries;
+
+	std::vector<CUnit*> units;
+	std::vector<size_t> offsets;
+};
+
+
 #endif /* QUAD_FIELD_H */
@@ -34,6 +34,7 @@
 #include "System/type2.h"
 #include "System/Sound/ISoundChannels.h"
 #include "System/Sync/HsiehHash.h"
+#include "System/Threading/ThreadPool.h"
 
 #if 1
 #include "Rendering/IPathDrawer.h"
@@ -78,6 +79,11 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_GMT)
 #define MEMBER_LITERAL_HASH(memberName) HsiehHash(memberName, sizeof(memberName) - 1, 0)
 
 
+// per-thread scratch space for obstacle-avoidance queries made during UpdatePreMT
+static std::array<std::vector<CSolidObject*>, ThreadPool::MAX_THREADS> avoideeVectors;
+static std::array<std::vector<int>, ThreadPool::MAX_THREADS> avoideeQuadVectors;
+
+
 
 CR_BIND_DERIVED(CGroundMoveType, AMoveType, (nullptr))
 CR_REG_METADATA(CGroundMoveType, (
@@ -89,6 +95,7 @@ CR_REG_METADATA(CGroundMoveType, (
 	CR_MEMBER(waypointDir),
 	CR_MEMBER(flatFrontDir),
 	CR_MEMBER(lastAvoidanceDir),
+	CR_IGNORED(preAvoidanceVec),
 	CR_MEMBER(mainHeadingPos),
 	CR_MEMBER(skidRotVector),
 
@@ -119,6 +126,9 @@ CR_REG_METADATA(CGroundMoveType, (
 
 	CR_MEMBER(pathID),
 	CR_MEMBER(nextObstacleAvoidanceFrame),
+	CR_IGNORED(preAvoidanceVecFrame),
+	CR_IGNORED(preAvoidanceInputs),
+	CR_IGNORED(avoideeDebugPositions),
 
 	CR_MEMBER(numIdlingUpdates),
 	CR_MEMBER(numIdlingSlowUpdates),
@@ -421,7 +431,7 @@ void CGroundMoveType::PostLoad()
 	if (pathID == 0)
 		return;
 
-	pathID = pathManager->RequestPath(owner, owner->moveDef, owner->pos, goalPos, goalRadius + extraRadius, true);
+	pathID = pathManager->RequestPathAsync(owner, owner->moveDef, owner->pos, goalPos, goalRadius + extraRadius, true);
 }
 
 bool CGroundMoveType::OwnerMoved(const short oldHeading, const float3& posDif, const float3& cmpEps) {
@@ -473,6 +483,27 @@ bool CGroundMoveType::OwnerMoved(const short oldHeading, const float3& posDif, c
 	return true;
 }
 
+void CGroundMoveType::UpdatePreMT()
+{
+	// mirror the early-outs of Update and GetObstacleAvoidanceDir; if these
+	// change during the serial phase the avoidance vector is simply computed
+	// there instead
+	if (owner->GetTransporter() != nullptr)
+		return;
+	if (WantToStop())
+		return;
+	if (gs->frameNum < nextObstacleAvoidanceFrame)
+		return;
+
+	// neighbours are seen as they were at the start of the frame (the
+	// same on every client), but the owner's own inputs can still change
+	// before its serial Update runs; GetObstacleAvoidanceDir compares them
+	// against this snapshot and recomputes if they did
+	preAvoidanceVec = CalcObstacleAvoidanceVec(DEBUG_DRAWING_ENABLED? &avoideeDebugPositions: nullptr);
+	preAvoidanceVecFrame = gs->frameNum;
+	preAvoidanceInputs = GetObstacleAvoidanceInputs();
+}
+
 bool CGroundMoveType::Update()
 {
 	ASSERT_SYNCED(owner->pos);
@@ -1271,27 +1302,89 @@ float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
 	if (gs->frameNum < nextObstacleAvoidanceFrame)
 		return lastAvoidanceDir;
 
-	float3 avoidanceVec = ZeroVector;
 	float3 avoidanceDir = desiredDir;
 
 	lastAvoidanceDir = desiredDir;
 	nextObstacleAvoidanceFrame = gs->frameNum + 1;
 
-	CUnit* avoider = owner;
-
-	// const UnitDef* avoiderUD = avoider->unitDef;
-	const MoveDef* avoiderMD = avoider->moveDef;
-
 	// degenerate case: if facing anti-parallel to desired direction,
 	// do not actively avoid obstacles since that can interfere with
 	// normal waypoint steering (if the final avoidanceDir demands a
 	// turn in the opposite direction of desiredDir)
-	if (avoider->frontdir.dot(desiredDir) < 0.0f)
+	if (owner->frontdir.dot(desiredDir) < 0.0f)
 		return lastAvoidanceDir;
 
-	static constexpr float AVOIDER_DIR_WEIGHT = 1.0f;
 	static constexpr float DESIRED_DIR_WEIGHT = 0.5f;
 	static constexpr float LAST_DIR_MIX_ALPHA = 0.7f;
+
+	// normally precomputed by UpdatePreMT from start-of-frame state; units
+	// that started wanting to move during this frame's serial phase (e.g.
+	// through a path becoming available) or whose speed, goal, position or
+	// orientation changed since then (e.g. by being pushed) do it here
+	const bool preAvoidanceValid = (preAvoidanceVecFrame == gs->frameNum && preAvoidanceInputs == GetObstacleAvoidanceInputs());
+	const float3 avoidanceVec = preAvoidanceValid? preAvoidanceVec: CalcObstacleAvoidanceVec(DEBUG_DRAWING_ENABLED? &avoideeDebugPositions: nullptr);
+
+	// use a weighted combination of the desired- and the avoidance-directions
+	// also linearly smooth it using the vector calculated the previous frame
+	avoidanceDir = (mix(desiredDir, avoidanceVec, DESIRED_DIR_WEIGHT)).SafeNormalize();
+	avoidanceDir = (mix(avoidanceDir, lastAvoidanceDir, LAST_DIR_MIX_ALPHA)).SafeNormalize();
+
+	if (DEBUG_DRAWING_ENABLED) {
+		if (selectedUnitsHandler.selectedUnits.find(owner->id) != selectedUnitsHandler.selectedUnits.end()) {
+			const float3 p0 = owner->pos + (    UpVector * 20.0f);
+			const float3 p1 =         p0 + (avoidanceVec * 40.0f);
+			const float3 p2 =         p0 + (avoidanceDir * 40.0f);
+
+			for (const float3& avoideePos: avoideeDebugPositions) {
+				geometricObjects->AddLine(p0, avoideePos + (UpVector * 20.0f), 3, 1, 4);
+			}
+
+			const int avFigGroupID = geometricObjects->AddLine(p0, p1, 8.0f, 1, 4);
+			const int adFigGroupID = geometricObjects->AddLine(p0, p2, 8.0f, 1, 4);
+
+			geometricObjects->SetColor(avFigGroupID, 1, 0.3f, 0.3f, 0.6f);
+			geometricObjects->SetColor(adFigGroupID, 1, 0.3f, 0.3f, 0.6f);
+		}
+	}
+
+	return (lastAvoidanceDir = avoidanceDir);
+}
+
+/*
+ * Everything of the owner's own state that CalcObstacleAvoidanceVec reads.
+ */
+std::array<float, 20> CGroundMoveType::GetObstacleAvoidanceInputs() const {
+	return {{
+		owner->pos.x, owner->pos.y, owner->pos.z,
+		owner->speed.x, owner->speed.y, owner->speed.z,
+		owner->frontdir.x, owner->frontdir.y, owner->frontdir.z,
+		owner->rightdir.x, owner->rightdir.y, owner->rightdir.z,
+		goalPos.x, goalPos.y, goalPos.z,
+		currentSpeed,
+		owner->radius,
+		owner->mass,
+		float(owner->allyteam),
+		float(owner->moveDef->pathType),
+	}};
+}
+
+/*
+ * Sums the steering responses to all obstacles near the owner.
+ * Called from worker threads (UpdatePreMT), so this must not
+ * modify any state including that of the owner itself; the
+ * positions of contributing avoidees are only collected into
+ * <avoideePositions> (the owner's own debug list) if non-null.
+ */
+float3 CGroundMoveType::CalcObstacleAvoidanceVec(std::vector<float3>* avoideePositions) const {
+	float3 avoidanceVec = ZeroVector;
+	float3 avoidanceDir;
+
+	const CUnit* avoider = owner;
+
+	// const UnitDef* avoiderUD = avoider->unitDef;
+	const MoveDef* avoiderMD = avoider->moveDef;
+
+	static constexpr float AVOIDER_DIR_WEIGHT = 1.0f;
 	static const     float MAX_AVOIDEE_COSINE = math::cosf(120.0f * math::DEG_TO_RAD);
 
 	// now we do the obstacle avoidance proper
@@ -1300,10 +1393,16 @@ float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
 	const float avoidanceRadius = std::max(currentSpeed, 1.0f) * (avoider->radius * 2.0f);
 	const float avoiderRadius = avoiderMD->CalcFootPrintMinExteriorRadius();
 
-	QuadFieldQuery qfQuery;
-	quadField.GetSolidsExact(qfQuery, avoider->pos, avoidanceRadius, 0xFFFFFFFF, CSolidObject::CSTATE_BIT_SOLIDOBJECTS);
+	auto& avoidees = avoideeVectors[ThreadPool::GetThreadNum()];
+	auto& avoideeQuads = avoideeQuadVectors[ThreadPool::GetThreadNum()];
+
+	if (avoideePositions != nullptr)
+		avoideePositions->clear();
+
+	avoidees.clear();
+	quadField.GetSolidsExactMT(avoidees, avoideeQuads, avoider->pos, avoidanceRadius, 0xFFFFFFFF, CSolidObject::CSTATE_BIT_SOLIDOBJECTS);
 
-	for (const CSolidObject* avoidee: *qfQuery.solids) {
+	for (const CSolidObject* avoidee: avoidees) {
 		const MoveDef* avoideeMD = avoidee->moveDef;
 		const UnitDef* avoideeUD = dynamic_cast<const UnitDef*>(avoidee->GetDef());
 
@@ -1361,10 +1460,8 @@ float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
 		// if object and unit in relative motion are closing in on one another
 		// (or not yet fully apart), then the object is on the path of the unit
 		// and they are not collided
-		if (DEBUG_DRAWING_ENABLED) {
-			if (selectedUnitsHandler.selectedUnits.find(owner->id) != selectedUnitsHandler.selectedUnits.end())
-				geometricObjects->AddLine(avoider->pos + (UpVector * 20.0f), avoidee->pos + (UpVector * 20.0f), 3, 1, 4);
-		}
+		if (avoideePositions != nullptr)
+			avoideePositions->push_back(avoidee->pos);
 
 		float avoiderTurnSign = -Sign(avoidee->pos.dot(avoider->rightdir) - avoider->pos.dot(avoider->rightdir));
 		float avoideeTurnSign = -Sign(avoider->pos.dot(avoidee->rightdir) - avoidee->pos.dot(avoidee->rightdir));
@@ -1391,27 +1488,7 @@ float3 CGroundMoveType::GetObstacleAvoidanceDir(const float3& desiredDir) {
 		avoidanceVec += (avoidanceDir * avoidanceResponse * avoidanceFallOff * avoideeMassScale);
 	}
 
-
-	// use a weighted combination of the desired- and the avoidance-directions
-	// also linearly smooth it using the vector calculated the previous frame
-	avoidanceDir = (mix(desiredDir, avoidanceVec, DESIRED_DIR_WEIGHT)).SafeNormalize();
-	avoidanceDir = (mix(avoidanceDir, lastAvoidanceDir, LAST_DIR_MIX_ALPHA)).SafeNormalize();
-
-	if (DEBUG_DRAWING_ENABLED) {
-		if (selectedUnitsHandler.selectedUnits.find(owner->id) != selectedUnitsHandler.selectedUnits.end()) {
-			const float3 p0 = owner->pos + (    UpVector * 20.0f);
-			const float3 p1 =         p0 + (avoidanceVec * 40.0f);
-			const float3 p2 =         p0 + (avoidanceDir * 40.0f);
-
-			const int avFigGroupID = geometricObjects->AddLine(p0, p1, 8.0f, 1, 4);
-			const int adFigGroupID = geometricObjects->AddLine(p0, p2, 8.0f, 1, 4);
-
-			geometricObjects->SetColor(avFigGroupID, 1, 0.3f, 0.3f, 0.6f);
-			geometricObjects->SetColor(adFigGroupID, 1, 0.3f, 0.3f, 0.6f);
-		}
-	}
-
-	return (lastAvoidanceDir = avoidanceDir);
+	return avoidanceVec;
 }
 
 
@@ -1469,7 +1546,7 @@ unsigned int CGroundMoveType::GetNewPath()
 	if ((owner->pos - goalPos).SqLength2D() <= Square(goalRadius + extraRadius))
 		return newPathID;
 
-	if ((newPathID = pathManager->RequestPath(owner, owner->moveDef, owner->pos, goalPos, goalRadius + extraRadius, true)) != 0) {
+	if ((newPathID = pathManager->RequestPathAsync(owner, owner->moveDef, owner->pos, goalPos, goalRadius + extraRadius, true)) != 0) {
 		atGoal = false;
 		atEndOfPath = false;
 
@@ -4,6 +4,7 @@
 #define GROUNDMOVETYPE_H
 
 #include <array>
+#include <vector>
 
 #include "MoveType.h"
 #include "Sim/Path/IPathController.hpp"
@@ -29,6 +30,7 @@ public:
 
 	void PostLoad();
 
+	void UpdatePreMT() override;
 	bool Update() override;
 	void SlowUpdate() override;
 
@@ -94,6 +96,8 @@ public:
 
 private:
 	float3 GetObstacleAvoidanceDir(const float3& desiredDir);
+	float3 CalcObstacleAvoidanceVec(std::vector<float3>* avoideePositions) const;
+	std::array<float, 20> GetObstacleAvoidanceInputs() const;
 	float3 Here() const;
 
 	#define SQUARE(x) ((x) * (x))
@@ -170,6 +174,7 @@ private:
 	float3 waypointDir;
 	float3 flatFrontDir;
 	float3 lastAvoidanceDir;
+	float3 preAvoidanceVec;                 /// avoidance vector computed by UpdatePreMT for the current frame
 	float3 mainHeadingPos;
 	float3 skidRotVector;                   /// vector orthogonal to skidDir
 
@@ -202,6 +207,10 @@ private:
 
 	unsigned int pathID = 0;
 	unsigned int nextObstacleAvoidanceFrame = 0;
+	int preAvoidanceVecFrame = -1;          /// frame in which preAvoidanceVec was last computed
+
+	std::array<float, 20> preAvoidanceInputs;    /// owner state preAvoidanceVec was computed from
+	std::vector<float3> avoideeDebugPositions;   /// avoidees that contributed to the last avoidance vector (debug-drawing only)
 
 	unsigned int numIdlingUpdates = 0;      /// {in, de}creased every Update if idling is true/false and pathId != 0
 	unsigned int numIdlingSlowUpdates = 0;  /// {in, de}creased every SlowUpdate if idling is true/false and pathId != 0
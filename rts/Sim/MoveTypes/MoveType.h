@@ -49,6 +49,10 @@ public:
 	virtual void SetManeuverLeash(float leashLength) { maneuverLeash = leashLength; }
 	virtual void SetWaterline(float depth) { waterline = depth; }
 
+	// runs for all units in parallel before the serial Update-loop; may
+	// only read shared sim-state and write to this movetype's own scratch
+	// members (which Update consumes), never to other objects
+	virtual void UpdatePreMT() {}
 	virtual bool Update() = 0;
 	virtual void SlowUpdate();
 
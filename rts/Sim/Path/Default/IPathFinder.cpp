@@ -99,6 +99,8 @@ IPath::SearchResult IPathFinder::GetPath(
 	path.squares.clear();
 	path.pathCost = PATHCOST_INFINITY;
 
+	testedBlocks = 0;
+
 	// initial calculations
 	if (BLOCK_SIZE != 1) {
 		maxBlocksToBeSearched = std::min(MAX_SEARCHED_NODES_PE - 8U, maxNodes);
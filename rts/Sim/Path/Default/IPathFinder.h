@@ -36,6 +36,9 @@ public:
 	int2 BlockIdxToPos(const unsigned idx) const { return int2(idx % nbrOfBlocks.x, idx / nbrOfBlocks.x); }
 	int  BlockPosToIdx(const int2 pos) const { return (pos.y * nbrOfBlocks.x + pos.x); }
 
+	/// number of nodes expanded by the last GetPath call (0 for cache-hits)
+	unsigned int GetNumTestedBlocks() const { return testedBlocks; }
+
 
 	/**
 	 * Gives a path from given starting location to target defined in
@@ -73,23 +73,31 @@ const CPathCache::CacheItem& CPathCache::GetCachedPath(
 	float goalRadius,
 	int pathType
 ) {
+	const CacheItem& ci = GetCachedPathConst(strtBlock, goalBlock, goalRadius, pathType);
+
+	numCacheMisses += (&ci == &dummyCacheItem);
+	numCacheHits   += (&ci != &dummyCacheItem);
+	return ci;
+}
+
+const CPathCache::CacheItem& CPathCache::GetCachedPathConst(
+	const int2 strtBlock,
+	const int2 goalBlock,
+	float goalRadius,
+	int pathType
+) const {
 	const std::uint64_t hash = GetHash(strtBlock, goalBlock, goalRadius, pathType);
 	const auto iter = cachedPaths.find(hash);
 
-	if (iter == cachedPaths.end()) {
-		++numCacheMisses; return dummyCacheItem;
-	}
-	if ((iter->second).strtBlock != strtBlock) {
-		++numCacheMisses; return dummyCacheItem;
-	}
-	if ((iter->second).goalBlock != goalBlock) {
-		++numCacheMisses; return dummyCacheItem;
-	}
-	if ((iter->second).pathType != pathType) {
-		++numCacheMisses; return dummyCacheItem;
-	}
+	if (iter == cachedPaths.end())
+		return dummyCacheItem;
+	if ((iter->second).strtBlock != strtBlock)
+		return dummyCacheItem;
+	if ((iter->second).goalBlock != goalBlock)
+		return dummyCacheItem;
+	if ((iter->second).pathType != pathType)
+		return dummyCacheItem;
 
-	++numCacheHits;
 	return (iter->second);
 }
 
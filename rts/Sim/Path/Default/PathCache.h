@@ -40,6 +40,13 @@ public:
 		float goalRadius,
 		int pathType
 	);
+	/// same lookup without touching the hit-statistics; safe to call from multiple threads
+	const CacheItem& GetCachedPathConst(
+		const int2 strtBlock,
+		const int2 goalBlock,
+		float goalRadius,
+		int pathType
+	) const;
 
 private:
 	void RemoveFrontQueItem();
@@ -34,6 +34,15 @@ static constexpr unsigned int LOWRES_PE_BLOCKSIZE = 32;
 static constexpr unsigned int SQUARES_TO_UPDATE = 1000;
 static constexpr unsigned int MAX_SEARCHED_NODES_ON_REFINE = 2000;
 
+// PE update scheduling; node-rate converts modInfo.pfUpdateBudget (ms) to work
+static constexpr unsigned int PE_UPDATE_NODES_PER_MS  = 4096;
+static constexpr unsigned int PE_BUDGET_SAMPLE_BLOCKS = 4096;
+static constexpr unsigned int PE_PRIORITY_SCAN_BLOCKS = 1024;
+static constexpr          int PE_PRIORITY_BLOCK_RADIUS = 1;
+
+// maximum number of deferred requests (modInfo.pfAsyncRequests) served per Update
+static constexpr unsigned int MAX_ASYNC_PATH_REQUESTS = 64;
+
 static constexpr unsigned int PATH_HEATMAP_XSCALE =  1; // wrt. mapDims.hmapx
 static constexpr unsigned int PATH_HEATMAP_ZSCALE =  1; // wrt. mapDims.hmapy
 static constexpr unsigned int PATH_FLOWMAP_XSCALE = 32; // wrt. mapDims.mapx
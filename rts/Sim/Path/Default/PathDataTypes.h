@@ -219,6 +219,20 @@ struct PathNodeStateBuffer {
 		er[synced].y = sz;
 	}
 
+	/// alias the extra costs of <pnsb> (which must have the same resolution) as our overlay
+	void ShareNodeExtraCosts(const PathNodeStateBuffer& pnsb) {
+		for (const bool synced: {false, true}) {
+			if ((extraCostsOverlay[synced] = pnsb.extraCostsOverlay[synced]) != nullptr) {
+				er[synced] = pnsb.er[synced];
+				continue;
+			}
+
+			// null if vector is empty; indexing via er=br is equivalent to ps
+			extraCostsOverlay[synced] = pnsb.extraCosts[synced].data();
+			er[synced] = pnsb.br;
+		}
+	}
+
 public:
 	std::vector<float> fCost;
 	std::vector<float> gCost;
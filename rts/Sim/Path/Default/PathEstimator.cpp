@@ -12,6 +12,7 @@
 #include "PathMemPool.h"
 #include "Game/GlobalUnsynced.h"
 #include "Game/LoadScreen.h"
+#include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/Misc/ModInfo.h"
 #include "Sim/MoveTypes/MoveDefHandler.h"
@@ -85,6 +86,18 @@ void CPathEstimator::Init(IPathFinder* pf, unsigned int BLOCK_SIZE, const std::s
 		updatedBlocks.clear();
 		consumedBlocks.clear();
 		offsetBlocksSortedByCost.clear();
+
+		blockObsoleteFrames.clear();
+		blockObsoleteFrames.resize(blockStates.GetSize(), 0);
+		blockRequestStamps.clear();
+		blockRequestStamps.resize(blockStates.GetSize(), 0);
+
+		requestStamp = 1;
+		numRequestBlocks = 0;
+		numObsoleteBlocks = 0;
+
+		updateNodesSum = 0;
+		updateBlocksSum = 0;
 	}
 
 	CPathEstimator*  childPE = this;
@@ -136,8 +149,39 @@ void CPathEstimator::Init(IPathFinder* pf, unsigned int BLOCK_SIZE, const std::s
 }
 
 
+void CPathEstimator::InitClone(const CPathEstimator* pe, IPathFinder* pf)
+{
+	IPathFinder::Init(pe->BLOCK_SIZE);
+
+	{
+		parentPathFinder = pf;
+		nextPathEstimator = nullptr;
+		sourceEstimator = pe;
+
+		pathChecksum = pe->pathChecksum;
+		fileHashCode = pe->fileHashCode;
+	}
+	{
+		vertexCosts = pe->vertexCosts;
+		maxSpeedMods = pe->maxSpeedMods;
+		blockStates.peNodeOffsets = pe->blockStates.peNodeOffsets;
+
+		updatedBlocks.clear();
+		consumedBlocks.clear();
+	}
+
+	// shared, only ever read through GetCachedPathConst
+	pathCache[0] = pe->pathCache[0];
+	pathCache[1] = pe->pathCache[1];
+}
+
 void CPathEstimator::Kill()
 {
+	if (sourceEstimator != nullptr) {
+		IPathFinder::Kill();
+		return;
+	}
+
 	pcMemPool.free(pathCache[0]);
 	pcMemPool.free(pathCache[1]);
 }
@@ -360,18 +404,22 @@ int2 CPathEstimator::FindBlockPosOffset(const MoveDef& moveDef, unsigned int blo
 /**
  * Calculate costs of paths to all vertices connected from the given block
  */
-void CPathEstimator::CalcVertexPathCosts(const MoveDef& moveDef, int2 block, unsigned int threadNum)
+unsigned int CPathEstimator::CalcVertexPathCosts(const MoveDef& moveDef, int2 block, unsigned int threadNum)
 {
+	unsigned int numTestedNodes = 0;
+
 	// see GetBlockVertexOffset(); costs are bi-directional and only
 	// calculated for *half* the outgoing edges (while costs for the
 	// other four directions are stored at the adjacent vertices)
-	CalcVertexPathCost(moveDef, block, PATHDIR_LEFT,     threadNum);
-	CalcVertexPathCost(moveDef, block, PATHDIR_LEFT_UP,  threadNum);
-	CalcVertexPathCost(moveDef, block, PATHDIR_UP,       threadNum);
-	CalcVertexPathCost(moveDef, block, PATHDIR_RIGHT_UP, threadNum);
+	numTestedNodes += CalcVertexPathCost(moveDef, block, PATHDIR_LEFT,     threadNum);
+	numTestedNodes += CalcVertexPathCost(moveDef, block, PATHDIR_LEFT_UP,  threadNum);
+	numTestedNodes += CalcVertexPathCost(moveDef, block, PATHDIR_UP,       threadNum);
+	numTestedNodes += CalcVertexPathCost(moveDef, block, PATHDIR_RIGHT_UP, threadNum);
+
+	return numTestedNodes;
 }
 
-void CPathEstimator::CalcVertexPathCost(
+unsigned int CPathEstimator::CalcVertexPathCost(
 	const MoveDef& moveDef,
 	int2 parentBlockPos,
 	unsigned int pathDir,
@@ -389,7 +437,7 @@ void CPathEstimator::CalcVertexPathCost(
 	// outside map?
 	if ((unsigned)childBlockPos.x >= nbrOfBlocks.x || (unsigned)childBlockPos.y >= nbrOfBlocks.y) {
 		vertexCosts[vertexCostIdx] = PATHCOST_INFINITY;
-		return;
+		return 0;
 	}
 
 
@@ -414,7 +462,7 @@ void CPathEstimator::CalcVertexPathCost(
 
 	if (strtBlocked || goalBlocked) {
 		vertexCosts[vertexCostIdx] = PATHCOST_INFINITY;
-		return;
+		return 0;
 	}
 
 	// find path from parent to child block
@@ -438,6 +486,8 @@ void CPathEstimator::CalcVertexPathCost(
 	} else {
 		vertexCosts[vertexCostIdx] = PATHCOST_INFINITY;
 	}
+
+	return (pathFinders[threadNum]->GetNumTestedBlocks());
 }
 
 
@@ -467,13 +517,16 @@ void CPathEstimator::MapChanged(unsigned int x1, unsigned int z1, unsigned int x
 
 			updatedBlocks.emplace_back(x, z);
 			blockStates.nodeMask[idx] |= PATHOPT_OBSOLETE;
+			blockObsoleteFrames[idx] = gs->frameNum;
+			numObsoleteBlocks += 1;
 		}
 	}
 }
 
 
 /**
- * Update some obsolete blocks using the FIFO-principle
+ * Update some obsolete blocks, those near recent synced path
+ * requests first and the remainder using the FIFO-principle
  */
 void CPathEstimator::Update()
 {
@@ -493,29 +546,76 @@ void CPathEstimator::Update()
 		const int MIN_BLOCKS_TO_UPDATE = std::max<int>(BLOCKS_TO_UPDATE >> 1, 4U);
 		const int MAX_BLOCKS_TO_UPDATE = std::max<int>(BLOCKS_TO_UPDATE << 1, MIN_BLOCKS_TO_UPDATE);
 
-		blocksToUpdate = Clamp(progressiveUpdates, MIN_BLOCKS_TO_UPDATE, MAX_BLOCKS_TO_UPDATE);
+		if (modInfo.pfUpdateBudget > 0.0f) {
+			// fill the per-frame budget, but always advance by at least one block
+			blocksToUpdate = std::max(GetBudgetedBlockUpdates(), int(numMoveDefs));
+		} else {
+			blocksToUpdate = Clamp(progressiveUpdates, MIN_BLOCKS_TO_UPDATE, MAX_BLOCKS_TO_UPDATE);
+		}
+
 		blockUpdatePenalty = std::max(0, blockUpdatePenalty - blocksToUpdate);
 
 		if (blockUpdatePenalty > 0)
 			blocksToUpdate = std::max(0, blocksToUpdate - blockUpdatePenalty);
 
+		const bool chargeUpdates = (modInfo.pfUpdateBudget > 0.0f)? !updatedBlocks.empty(): (progressiveUpdates != 0);
+
 		// we have to update blocks for all movedefs (PATHOPT_OBSOLETE applies per block, not per movedef)
-		consumeBlocks = int(progressiveUpdates != 0) * int(ceil(float(blocksToUpdate) / numMoveDefs)) * numMoveDefs;
+		consumeBlocks = int(chargeUpdates) * int(ceil(float(blocksToUpdate) / numMoveDefs)) * numMoveDefs;
 		blockUpdatePenalty += consumeBlocks;
 	}
 
-	if (blocksToUpdate == 0)
-		return;
+	const unsigned int currRequestStamp = requestStamp;
+	const unsigned int currRequestBlocks = numRequestBlocks;
 
-	if (updatedBlocks.empty())
+	// requests made from here on count towards the next update
+	requestStamp += 1;
+	numRequestBlocks = 0;
+
+	if (blocksToUpdate == 0 || updatedBlocks.empty()) {
+		UpdateCounters(0, 0, 0);
 		return;
+	}
 
 	consumedBlocks.clear();
 	consumedBlocks.reserve(consumeBlocks);
 
-	// get blocks to update
+	unsigned int sumLatency = 0;
+	unsigned int maxLatency = 0;
+
+	const auto ConsumeQueuedBlock = [&](const int2 pos, const int idx) {
+		const unsigned int latency = gs->frameNum - blockObsoleteFrames[idx];
+
+		sumLatency += latency;
+		maxLatency = std::max(maxLatency, latency);
+
+		ConsumeBlock(pos, numMoveDefs);
+	};
+
+	// get blocks to update; first pass takes those close to the start- or goal-blocks
+	// of synced searches since the previous update, in FIFO-order among themselves
+	// note: the scan is bounded so a large backlog can not make this quadratic, and
+	// entries consumed here are skipped as stale once they reach the queue front
+	if (currRequestBlocks > 0) {
+		SCOPED_TIMER("Sim::Path::Estimator::PrioritizeBlocks");
+
+		const size_t numScanned = std::min(updatedBlocks.size(), size_t(PE_PRIORITY_SCAN_BLOCKS));
+
+		for (size_t n = 0; n < numScanned && consumedBlocks.size() < blocksToUpdate; n++) {
+			const int2 pos = updatedBlocks[n];
+			const int idx = BlockPosToIdx(pos);
+
+			if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) == 0)
+				continue;
+			if (blockRequestStamps[idx] != currRequestStamp)
+				continue;
+
+			ConsumeQueuedBlock(pos, idx);
+		}
+	}
+
 	while (!updatedBlocks.empty()) {
-		const int2& pos = updatedBlocks.front();
+		const int2 pos = updatedBlocks.front();
 		const int idx = BlockPosToIdx(pos);
 
 		if ((blockStates.nodeMask[idx] & PATHOPT_OBSOLETE) == 0) {
@@ -526,23 +626,8 @@ void CPathEstimator::Update()
 		if (consumedBlocks.size() >= blocksToUpdate)
 			break;
 
-		// issue repathing for all active movedefs
-		for (unsigned int i = 0; i < numMoveDefs; i++) {
-			const MoveDef* md = moveDefHandler.GetMoveDefByPathType(i);
-
-			consumedBlocks.emplace_back(pos, md);
-		}
-
-		// inform dependent estimator that costs were updated and it should do the same
-		// FIXME?
-		//   adjacent med-res PE blocks will cause a low-res block to be updated twice
-		//   (in addition to the overlap that already exists because MapChanged() adds
-		//   boundary blocks)
-		if (true && nextPathEstimator != nullptr)
-			nextPathEstimator->MapChanged(pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE, pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE);
-
-		updatedBlocks.pop_front(); // must happen _after_ last usage of the `pos` reference!
-		blockStates.nodeMask[idx] &= ~PATHOPT_OBSOLETE;
+		ConsumeQueuedBlock(pos, idx);
+		updatedBlocks.pop_front();
 	}
 
 	// FindOffset (threadsafe)
@@ -558,22 +643,142 @@ void CPathEstimator::Update()
 	}
 
 	// CalcVertexPathCosts (not threadsafe)
+	// all searches must go through parentPathFinder, its node-state buffer
+	// holds the (synced) extra costs that per-thread instances would lack
 	{
 		SCOPED_TIMER("Sim::Path::Estimator::CalcVertexPathCosts");
 		for (unsigned int n = 0; n < consumedBlocks.size(); ++n) {
-			CalcVertexPathCosts(*consumedBlocks[n].moveDef, consumedBlocks[n].blockPos);
+			updateNodesSum += CalcVertexPathCosts(*consumedBlocks[n].moveDef, consumedBlocks[n].blockPos);
 		}
+
+		// decay the totals so the per-block cost estimate follows the map
+		if ((updateBlocksSum += consumedBlocks.size()) >= PE_BUDGET_SAMPLE_BLOCKS) {
+			updateNodesSum >>= 1;
+			updateBlocksSum >>= 1;
+		}
+	}
+
+	UpdateCounters(consumedBlocks.size() / numMoveDefs, sumLatency, maxLatency);
+}
+
+
+void CPathEstimator::ConsumeBlock(const int2 pos, unsigned int numMoveDefs)
+{
+	const int idx = BlockPosToIdx(pos);
+
+	// issue repathing for all active movedefs
+	for (unsigned int i = 0; i < numMoveDefs; i++) {
+		const MoveDef* md = moveDefHandler.GetMoveDefByPathType(i);
+
+		consumedBlocks.emplace_back(pos, md);
+	}
+
+	// inform dependent estimator that costs were updated and it should do the same
+	// FIXME?
+	//   adjacent med-res PE blocks will cause a low-res block to be updated twice
+	//   (in addition to the overlap that already exists because MapChanged() adds
+	//   boundary blocks)
+	if (true && nextPathEstimator != nullptr)
+		nextPathEstimator->MapChanged(pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE, pos.x * BLOCK_SIZE, pos.y * BLOCK_SIZE);
+
+	blockStates.nodeMask[idx] &= ~PATHOPT_OBSOLETE;
+	numObsoleteBlocks -= 1;
+}
+
+
+void CPathEstimator::MarkPriorityBlocks(const int2 pos)
+{
+	const int xmin = std::max(pos.x - PE_PRIORITY_BLOCK_RADIUS, 0);
+	const int xmax = std::min(pos.x + PE_PRIORITY_BLOCK_RADIUS, int(nbrOfBlocks.x - 1));
+	const int zmin = std::max(pos.y - PE_PRIORITY_BLOCK_RADIUS, 0);
+	const int zmax = std::min(pos.y + PE_PRIORITY_BLOCK_RADIUS, int(nbrOfBlocks.y - 1));
+
+	for (int z = zmin; z <= zmax; z++) {
+		for (int x = xmin; x <= xmax; x++) {
+			blockRequestStamps[BlockPosToIdx(int2(x, z))] = requestStamp;
+		}
+	}
+
+	numRequestBlocks += 1;
+}
+
+
+int CPathEstimator::GetBudgetedBlockUpdates() const
+{
+	// the budget is given in milliseconds but must resolve to the same block
+	// count on every client, so it is converted via a fixed reference rate of
+	// node expansions and the (synced) average number of nodes one (block,
+	// movedef) update expanded so far; the initial estimate assumes each vertex
+	// search covers both of its blocks at the parent's resolution
+	const unsigned int parentBlocks = BLOCK_SIZE / parentPathFinder->GetBlockSize();
+
+	const std::uint64_t budgetNodes = modInfo.pfUpdateBudget * PE_UPDATE_NODES_PER_MS;
+	const std::uint64_t initialCost = (parentBlocks * parentBlocks * 2) * PATH_DIRECTION_VERTICES;
+	const std::uint64_t averageCost = (updateNodesSum + initialCost) / (updateBlocksSum + 1);
+
+	return (std::min(budgetNodes / std::max(averageCost, std::uint64_t(1)), std::uint64_t(blockStates.GetSize())));
+}
+
+
+void CPathEstimator::UpdateCounters(unsigned int numUpdatedBlocks, unsigned int sumLatency, unsigned int maxLatency) const
+{
+	// names must be literals, one set per estimator resolution
+	static const char* counterNames[2][4] = {
+		{
+			"Sim::Path::Estimator::MedRes::QueueDepth",
+			"Sim::Path::Estimator::MedRes::UpdatedBlocks",
+			"Sim::Path::Estimator::MedRes::AvgLatencyFrames",
+			"Sim::Path::Estimator::MedRes::MaxLatencyFrames",
+		},
+		{
+			"Sim::Path::Estimator::LowRes::QueueDepth",
+			"Sim::Path::Estimator::LowRes::UpdatedBlocks",
+			"Sim::Path::Estimator::LowRes::AvgLatencyFrames",
+			"Sim::Path::Estimator::LowRes::MaxLatencyFrames",
+		},
+	};
+
+	const char** names = counterNames[BLOCK_SIZE == LOWRES_PE_BLOCKSIZE];
+
+	profiler.SetCounter(names[0], numObsoleteBlocks);
+	profiler.SetCounter(names[1], numUpdatedBlocks);
+	profiler.SetCounter(names[2], sumLatency / std::max(numUpdatedBlocks, 1u));
+	profiler.SetCounter(names[3], maxLatency);
+}
+
+
+void CPathEstimator::SyncClone(CPathEstimator* clone) const
+{
+	assert(clone->sourceEstimator == this);
+
+	// CalcVertexPathCosts only writes the vertices owned by each consumed block
+	for (const SingleBlock& sb: consumedBlocks) {
+		const unsigned int pathType = sb.moveDef->pathType;
+		const unsigned int blockIdx = BlockPosToIdx(sb.blockPos);
+		const unsigned int vertexIdx = pathType * blockStates.GetSize() * PATH_DIRECTION_VERTICES + blockIdx * PATH_DIRECTION_VERTICES;
+
+		clone->blockStates.peNodeOffsets[pathType][blockIdx] = blockStates.peNodeOffsets[pathType][blockIdx];
+
+		std::copy(vertexCosts.begin() + vertexIdx, vertexCosts.begin() + vertexIdx + PATH_DIRECTION_VERTICES, clone->vertexCosts.begin() + vertexIdx);
 	}
 }
 
 
 const CPathCache::CacheItem& CPathEstimator::GetCache(const int2 strtBlock, const int2 goalBlock, float goalRadius, int pathType, const bool synced) const
 {
+	// clones may run concurrently, leave the hit-statistics alone
+	if (sourceEstimator != nullptr)
+		return pathCache[synced]->GetCachedPathConst(strtBlock, goalBlock, goalRadius, pathType);
+
 	return pathCache[synced]->GetCachedPath(strtBlock, goalBlock, goalRadius, pathType);
 }
 
 void CPathEstimator::AddCache(const IPath::Path* path, const IPath::SearchResult result, const int2 strtBlock, const int2 goalBlock, float goalRadius, int pathType, const bool synced)
 {
+	// the cache contents must not depend on how searches were spread over clones
+	if (sourceEstimator != nullptr)
+		return;
+
 	pathCache[synced]->AddPath(path, result, strtBlock, goalBlock, goalRadius, pathType);
 }
 
@@ -620,6 +825,13 @@ IPath::SearchResult CPathEstimator::DoSearch(const MoveDef& moveDef, const CPath
 {
 	bool foundGoal = false;
 
+	// let Update prefer obsolete blocks around the endpoints of synced unit
+	// searches; internal (direction-independent) vertex searches are ignored
+	if (peDef.synced && !peDef.dirIndependent && sourceEstimator == nullptr) {
+		MarkPriorityBlocks(mStartBlock);
+		MarkPriorityBlocks(int2(peDef.goalSquareX / BLOCK_SIZE, peDef.goalSquareZ / BLOCK_SIZE));
+	}
+
 	// get the goal square offset
 	const int2 goalSqrOffset = peDef.GoalSquareOffset(BLOCK_SIZE);
 	const float maxSpeedMod = maxSpeedMods[moveDef.pathType];
@@ -41,6 +41,12 @@ public:
 	 *   Ex. PE-name "pe" + Mapname "Desert" => "Desert.pe"
 	 */
 	void Init(IPathFinder*, unsigned int BSIZE, const std::string& peFileName, const std::string& mapFileName);
+	/**
+	 * Creates a search-only copy of <pe> with its own node-state, so several
+	 * searches can run concurrently; the copy reads (but never adds to) the
+	 * path-caches of <pe> and must be kept current via SyncClone.
+	 */
+	void InitClone(const CPathEstimator* pe, IPathFinder* pf);
 	void Kill();
 
 	bool RemoveCacheFile(const std::string& peFileName, const std::string& mapFileName);
@@ -59,6 +65,9 @@ public:
 	 */
 	void Update();
 
+	/// copies the block-data changed by the last Update into <clone>
+	void SyncClone(CPathEstimator* clone) const;
+
 	IPathFinder* GetParent() override { return parentPathFinder; }
 
 	/**
@@ -115,8 +124,14 @@ private:
 	void EstimatePathCosts(unsigned int, unsigned int);
 
 	int2 FindBlockPosOffset(const MoveDef&, unsigned int, unsigned int) const;
-	void CalcVertexPathCosts(const MoveDef&, int2, unsigned int threadNum = 0);
-	void CalcVertexPathCost(const MoveDef&, int2, unsigned int pathDir, unsigned int threadNum = 0);
+	/// both return the number of nodes expanded by the vertex searches
+	unsigned int CalcVertexPathCosts(const MoveDef&, int2, unsigned int threadNum = 0);
+	unsigned int CalcVertexPathCost(const MoveDef&, int2, unsigned int pathDir, unsigned int threadNum = 0);
+
+	void ConsumeBlock(const int2 pos, unsigned int numMoveDefs);
+	void MarkPriorityBlocks(const int2 pos);
+	int GetBudgetedBlockUpdates() const;
+	void UpdateCounters(unsigned int numUpdatedBlocks, unsigned int sumLatency, unsigned int maxLatency) const;
 
 	bool ReadFile(const std::string& peFileName, const std::string& mapFileName);
 	bool WriteFile(const std::string& peFileName, const std::string& mapFileName);
@@ -143,6 +158,7 @@ private:
 
 	IPathFinder* parentPathFinder; // parent (PF if BLOCK_SIZE is 16, PE[16] if 32)
 	CPathEstimator* nextPathEstimator; // next lower-resolution estimator
+	const CPathEstimator* sourceEstimator = nullptr; // non-null iff we are a clone
 	CPathCache* pathCache[2]; // [0] = !synced, [1] = synced
 
 	std::vector<IPathFinder*> pathFinders; // InitEstimator helpers
@@ -153,6 +169,19 @@ private:
 	/// blocks that may need an update due to map changes
 	std::deque<int2> updatedBlocks;
 
+	/// sim-frame at which each block was (last) marked obsolete
+	std::vector<int> blockObsoleteFrames;
+	/// Update-stamp of the last synced search starting or ending near each block
+	std::vector<unsigned int> blockRequestStamps;
+
+	unsigned int requestStamp = 1;
+	unsigned int numRequestBlocks = 0;
+	unsigned int numObsoleteBlocks = 0;
+
+	/// running totals used to convert modInfo.pfUpdateBudget into a block count
+	std::uint64_t updateNodesSum = 0;
+	std::uint64_t updateBlocksSum = 0;
+
 	struct SOffsetBlock {
 		float cost;
 		int2 offset;
@@ -12,8 +12,12 @@
 #include "Sim/Misc/ModInfo.h"
 #include "Sim/Objects/SolidObject.h"
 #include "Sim/MoveTypes/MoveDefHandler.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/Log/ILog.h"
 #include "System/TimeProfiler.h"
+#include "System/Threading/ThreadPool.h"
+
+#include <atomic>
 
 
 static CPathFinder    gMaxResPF;
@@ -46,6 +50,8 @@ CPathManager::~CPathManager()
 {
 	// Finalize is not called in case of forced exit
 	if (maxResPF != nullptr) {
+		KillAsyncSearchers();
+
 		lowResPE->Kill();
 		medResPE->Kill();
 		maxResPF->Kill();
@@ -131,6 +137,7 @@ void CPathManager::FinalizePath(MultiPath* path, const float3 startPos, const fl
 
 IPath::SearchResult CPathManager::ArrangePath(
 	MultiPath* newPath,
+	const PathSearchers& searchers,
 	const MoveDef* moveDef,
 	const float3& startPos,
 	const float3& goalPos,
@@ -158,7 +165,7 @@ IPath::SearchResult CPathManager::ArrangePath(
 	constexpr bool useConstraints[] = {false, false, false};
 	constexpr bool allowRawSearch[] = {false, false, false};
 
-	IPathFinder* pathFinders[] = {lowResPE, medResPE, maxResPF};
+	IPathFinder* pathFinders[] = {searchers.lowResPE, searchers.medResPE, searchers.maxResPF};
 	IPath::Path* pathObjects[] = {&newPath->lowResPath, &newPath->medResPath, &newPath->maxResPath};
 
 	IPath::SearchResult bestResult = IPath::Error;
@@ -380,15 +387,80 @@ unsigned int CPathManager::RequestPath(
 	if (caller != nullptr)
 		caller->UnBlock();
 
-	const IPath::SearchResult result = ArrangePath(&newPath, moveDef, startPos, goalPos, caller);
-
 	unsigned int pathID = 0;
 
+	if (SearchPath(&newPath, GetMainSearchers()) != IPath::Error)
+		pathID = Store(newPath);
+
+	if (caller != nullptr)
+		caller->Block();
+
+	return pathID;
+}
+
+/*
+Like RequestPath, but only stores the request; the search itself runs during
+the next Update (in parallel with other deferred requests) so every client
+gets the same result in the same frame.
+*/
+unsigned int CPathManager::RequestPathAsync(
+	CSolidObject* caller,
+	const MoveDef* moveDef,
+	float3 startPos,
+	float3 goalPos,
+	float goalRadius,
+	bool synced
+) {
+	if (!modInfo.pfAsyncRequests || !synced)
+		return (RequestPath(caller, moveDef, startPos, goalPos, goalRadius, synced));
+
+	if (!IsFinalized())
+		return 0;
+
+	startPos.ClampInBounds();
+	goalPos.ClampInBounds();
+
+	goalRadius = std::max<float>(goalRadius, PATH_NODE_SPACING * SQUARE_SIZE);
+	assert(moveDef == moveDefHandler.GetMoveDefByPathType(moveDef->pathType));
+
+	MultiPath newPath = MultiPath(moveDef, startPos, goalPos, goalRadius);
+	newPath.finalGoal = goalPos;
+	newPath.caller = caller;
+	newPath.peDef.synced = synced;
+	newPath.pending = true;
+
+	// have this frame's PE updates refresh the blocks the search will start from
+	for (CPathEstimator* pe: {medResPE, lowResPE}) {
+		const unsigned int blockPixelSize = pe->BLOCK_PIXEL_SIZE;
+
+		pe->MarkPriorityBlocks(int2(startPos.x / blockPixelSize, startPos.z / blockPixelSize));
+		pe->MarkPriorityBlocks(int2( goalPos.x / blockPixelSize,  goalPos.z / blockPixelSize));
+	}
+
+	const unsigned int pathID = Store(newPath);
+
+	asyncRequests.push_back(pathID);
+	return pathID;
+}
+
+
+// runs the full search for a request, with all PF/PE calls made by <searchers>
+IPath::SearchResult CPathManager::SearchPath(MultiPath* newPath, const PathSearchers& searchers) const
+{
+	const MoveDef* moveDef = newPath->moveDef;
+	CSolidObject* caller = newPath->caller;
+
+	const float3 startPos = newPath->start;
+	const float3 goalPos = newPath->finalGoal;
+	const bool synced = newPath->peDef.synced;
+
+	const IPath::SearchResult result = ArrangePath(newPath, searchers, moveDef, startPos, goalPos, caller);
+
 	if (result != IPath::Error) {
-		if (newPath.maxResPath.path.empty()) {
+		if (newPath->maxResPath.path.empty()) {
 			if (result != IPath::CantGetCloser) {
-				LowRes2MedRes(newPath, startPos, caller, synced);
-				MedRes2MaxRes(newPath, startPos, caller, synced);
+				LowRes2MedRes(*newPath, searchers, startPos, caller, synced);
+				MedRes2MaxRes(*newPath, searchers, startPos, caller, synced);
 			} else {
 				// add one dummy waypoint so that the calling MoveType
 				// does not consider this request a failure, which can
@@ -397,25 +469,21 @@ unsigned int CPathManager::RequestPath(
 				// otherwise, code relying on MoveType::progressState
 				// (eg. BuilderCAI::MoveInBuildRange) would misbehave
 				// (eg. reject build orders)
-				newPath.maxResPath.path.push_back(startPos);
-				newPath.maxResPath.squares.push_back(int2(startPos.x / SQUARE_SIZE, startPos.z / SQUARE_SIZE));
+				newPath->maxResPath.path.push_back(startPos);
+				newPath->maxResPath.squares.push_back(int2(startPos.x / SQUARE_SIZE, startPos.z / SQUARE_SIZE));
 			}
 		}
 
-		FinalizePath(&newPath, startPos, goalPos, result == IPath::CantGetCloser);
-		newPath.searchResult = result;
-		pathID = Store(newPath);
+		FinalizePath(newPath, startPos, goalPos, result == IPath::CantGetCloser);
 	}
 
-	if (caller != nullptr)
-		caller->Block();
-
-	return pathID;
+	newPath->searchResult = result;
+	return result;
 }
 
 
 // converts part of a med-res path into a max-res path
-void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, const CSolidObject* owner, bool synced) const
+void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const PathSearchers& searchers, const float3& startPos, const CSolidObject* owner, bool synced) const
 {
 	assert(IsFinalized());
 
@@ -448,7 +516,7 @@ void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, c
 	// Perform the search.
 	// If this is the final improvement of the path, then use the original goal.
 	const auto& pfd = (medResPath.path.empty() && lowResPath.path.empty()) ? multiPath.peDef : rangedGoalDef;
-	const IPath::SearchResult result = maxResPF->GetPath(*multiPath.moveDef, pfd, owner, startPos, maxResPath, MAX_SEARCHED_NODES_ON_REFINE);
+	const IPath::SearchResult result = searchers.maxResPF->GetPath(*multiPath.moveDef, pfd, owner, startPos, maxResPath, MAX_SEARCHED_NODES_ON_REFINE);
 
 	// If no refined path could be found, set goal as desired goal.
 	if (result == IPath::CantGetCloser || result == IPath::Error) {
@@ -457,7 +525,7 @@ void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, c
 }
 
 // converts part of a low-res path into a med-res path
-void CPathManager::LowRes2MedRes(MultiPath& multiPath, const float3& startPos, const CSolidObject* owner, bool synced) const
+void CPathManager::LowRes2MedRes(MultiPath& multiPath, const PathSearchers& searchers, const float3& startPos, const CSolidObject* owner, bool synced) const
 {
 	assert(IsFinalized());
 
@@ -487,7 +555,7 @@ void CPathManager::LowRes2MedRes(MultiPath& multiPath, const float3& startPos, c
 	// Perform the search.
 	// If there is no low-res path left, use original goal.
 	const auto& pfd = (lowResPath.path.empty()) ? multiPath.peDef : rangedGoalDef;
-	const IPath::SearchResult result = medResPE->GetPath(*multiPath.moveDef, pfd, owner, startPos, medResPath, MAX_SEARCHED_NODES_ON_REFINE);
+	const IPath::SearchResult result = searchers.medResPE->GetPath(*multiPath.moveDef, pfd, owner, startPos, medResPath, MAX_SEARCHED_NODES_ON_REFINE);
 
 	// If no refined path could be found, set goal as desired goal.
 	if (result == IPath::CantGetCloser || result == IPath::Error) {
@@ -525,6 +593,14 @@ float3 CPathManager::NextWayPoint(
 	if (multiPath == nullptr)
 		return noPathPoint;
 
+	if (multiPath->pending) {
+		// search has not run yet; head toward the goal in small steps
+		// (y=-1 marks these as temporary waypoints, see QTPFS) so the
+		// real path is picked up as soon as it becomes available
+		const float3 goalDir = (multiPath->finalGoal - callerPos).SafeNormalize() * SQUARE_SIZE;
+		return float3(callerPos.x + goalDir.x, -1.0f, callerPos.z + goalDir.z);
+	}
+
 	if (numRetries > MAX_PATH_REFINEMENT_DEPTH)
 		return (multiPath->finalGoal);
 
@@ -550,9 +626,9 @@ float3 CPathManager::NextWayPoint(
 			multiPath->caller->UnBlock();
 
 		if (extendMedResPath)
-			LowRes2MedRes(*multiPath, callerPos, owner, synced);
+			LowRes2MedRes(*multiPath, GetMainSearchers(), callerPos, owner, synced);
 
-		MedRes2MaxRes(*multiPath, callerPos, owner, synced);
+		MedRes2MaxRes(*multiPath, GetMainSearchers(), callerPos, owner, synced);
 
 		if (multiPath->caller != nullptr)
 			multiPath->caller->Block();
@@ -594,7 +670,6 @@ float3 CPathManager::NextWayPoint(
 	} while ((callerPos.SqDistance2D(waypoint) < Square(radius)) && (waypoint != maxResPath.pathGoal));
 
 	// y=0 indicates this is not a temporary waypoint
-	// (the default PFS does not queue path-requests)
 	return (waypoint * XZVector);
 }
 
@@ -625,6 +700,118 @@ void CPathManager::Update()
 
 	medResPE->Update();
 	lowResPE->Update();
+
+	for (const PathSearchers& searchers: asyncSearchers) {
+		medResPE->SyncClone(searchers.medResPE);
+		lowResPE->SyncClone(searchers.lowResPE);
+	}
+
+	UpdateAsyncRequests();
+}
+
+
+void CPathManager::InitAsyncSearchers()
+{
+	// one set per thread, but keep the node-state buffers within the same
+	// memory-bounds as those of the PE cache-generator threads
+	const size_t setMemFootPrint = maxResPF->GetMemFootPrint() + medResPE->GetMemFootPrint() + lowResPE->GetMemFootPrint();
+	const size_t maxMemFootPrint = configHandler->GetInt("MaxPathCostsMemoryFootPrint") * size_t(1024 * 1024);
+	const size_t numSearchers = Clamp(maxMemFootPrint / setMemFootPrint, size_t(1), size_t(ThreadPool::GetNumThreads()));
+
+	asyncSearchers.resize(numSearchers);
+
+	for (PathSearchers& searchers: asyncSearchers) {
+		searchers.maxResPF = pfMemPool.alloc<CPathFinder>(true);
+		searchers.medResPE = peMemPool.alloc<CPathEstimator>();
+		searchers.lowResPE = peMemPool.alloc<CPathEstimator>();
+
+		searchers.medResPE->InitClone(medResPE, searchers.maxResPF);
+		searchers.lowResPE->InitClone(lowResPE, searchers.medResPE);
+	}
+
+	LOG("[PathManager::%s] created %u sets of path-searchers for deferred requests", __func__, uint32_t(numSearchers));
+}
+
+void CPathManager::KillAsyncSearchers()
+{
+	for (PathSearchers& searchers: asyncSearchers) {
+		searchers.lowResPE->Kill();
+		searchers.medResPE->Kill();
+		searchers.maxResPF->Kill();
+
+		peMemPool.free(searchers.lowResPE);
+		peMemPool.free(searchers.medResPE);
+		pfMemPool.free(searchers.maxResPF);
+	}
+
+	asyncSearchers.clear();
+	asyncRequests.clear();
+}
+
+void CPathManager::UpdateAsyncRequests()
+{
+	if (asyncRequests.empty())
+		return;
+
+	SCOPED_TIMER("Sim::Path::AsyncRequests");
+
+	std::vector< std::pair<unsigned int, MultiPath*> > requests;
+	std::vector<unsigned int> failedIDs;
+
+	requests.reserve(std::min(asyncRequests.size(), size_t(MAX_ASYNC_PATH_REQUESTS)));
+
+	// requests deleted (or replaced) since they were made are skipped
+	while (!asyncRequests.empty() && requests.size() < MAX_ASYNC_PATH_REQUESTS) {
+		const unsigned int pathID = asyncRequests.front();
+		MultiPath* multiPath = GetMultiPath(pathID);
+
+		asyncRequests.pop_front();
+
+		if (multiPath == nullptr || !multiPath->pending)
+			continue;
+
+		requests.emplace_back(pathID, multiPath);
+	}
+
+	if (requests.empty())
+		return;
+
+	if (asyncSearchers.empty())
+		InitAsyncSearchers();
+
+	// the clones read the current (possibly Lua-replaced) cost-overlays
+	for (const PathSearchers& searchers: asyncSearchers) {
+		searchers.maxResPF->GetNodeStateBuffer().ShareNodeExtraCosts(maxResPF->GetNodeStateBuffer());
+		searchers.medResPE->GetNodeStateBuffer().ShareNodeExtraCosts(medResPE->GetNodeStateBuffer());
+		searchers.lowResPE->GetNodeStateBuffer().ShareNodeExtraCosts(lowResPE->GetNodeStateBuffer());
+	}
+
+	{
+		// clones never write to the shared path-caches, so each result only
+		// depends on its request and not on which set (or thread) produced
+		// it; callers do not need to be unblocked either (IsNonBlocking)
+		std::atomic<unsigned int> nextRequest = {0};
+
+		for_mt(0, asyncSearchers.size(), [&](const int k) {
+			for (unsigned int n = nextRequest++; n < requests.size(); n = nextRequest++) {
+				SearchPath(requests[n].second, asyncSearchers[k]);
+			}
+		});
+	}
+
+	for (const auto& request: requests) {
+		request.second->pending = false;
+
+		if (request.second->searchResult != IPath::Error)
+			continue;
+
+		failedIDs.push_back(request.first);
+	}
+
+	// failed requests invalidate their ID, as RequestPath would have
+	for (const unsigned int pathID: failedIDs) {
+		DeletePath(pathID);
+	}
 }
 
 // used to deposit heat on the heat-map as a unit moves along its path
@@ -4,6 +4,8 @@
 #define PATHMANAGER_H
 
 #include <cinttypes>
+#include <deque>
+#include <vector>
 
 #include "Sim/Path/IPathManager.h"
 #include "IPath.h"
@@ -21,13 +23,14 @@ struct MoveDef;
 class CPathManager: public IPathManager {
 public:
 	struct MultiPath {
-		MultiPath(): moveDef(nullptr), caller(nullptr) {}
+		MultiPath(): moveDef(nullptr), caller(nullptr), pending(false) {}
 		MultiPath(const MoveDef* moveDef, const float3& startPos, const float3& goalPos, float goalRadius)
 			: searchResult(IPath::Error)
 			, start(startPos)
 			, peDef(startPos, goalPos, goalRadius, 3.0f, 2000)
 			, moveDef(moveDef)
 			, caller(nullptr)
+			, pending(false)
 		{}
 
 		MultiPath(const MultiPath& mp) = delete;
@@ -47,6 +50,7 @@ public:
 			peDef   = mp.peDef;
 			moveDef = mp.moveDef;
 			caller  = mp.caller;
+			pending = mp.pending;
 
 			mp.moveDef = nullptr;
 			mp.caller  = nullptr;
@@ -70,6 +74,16 @@ public:
 
 		// additional information
 		CSolidObject* caller;
+
+		// true until a deferred (RequestPathAsync) search has run
+		bool pending;
+	};
+
+	// one set of (max, med, low)-res searchers; each thread needs its own
+	struct PathSearchers {
+		CPathFinder* maxResPF;
+		CPathEstimator* medResPE;
+		CPathEstimator* lowResPE;
 	};
 
 public:
@@ -115,6 +129,20 @@ public:
 		bool synced
 	) override;
 
+	unsigned int RequestPathAsync(
+		CSolidObject* caller,
+		const MoveDef* moveDef,
+		float3 startPos,
+		float3 goalPos,
+		float goalRadius,
+		bool synced
+	) override;
+
+	bool IsPathPending(unsigned int pathID) const override {
+		const MultiPath* multiPath = GetMultiPathConst(pathID);
+		return (multiPath != nullptr && multiPath->pending);
+	}
+
 	/**
 	 * Returns waypoints of the max-resolution path segments.
 	 * @param pathID
@@ -158,11 +186,17 @@ public:
 private:
 	IPath::SearchResult ArrangePath(
 		MultiPath* newPath,
+		const PathSearchers& searchers,
 		const MoveDef* moveDef,
 		const float3& startPos,
 		const float3& goalPos,
 		CSolidObject* caller
 	) const;
+	IPath::SearchResult SearchPath(MultiPath* newPath, const PathSearchers& searchers) const;
+
+	void InitAsyncSearchers();
+	void KillAsyncSearchers();
+	void UpdateAsyncRequests();
 
 	MultiPath* GetMultiPath(int pathID) { return (const_cast<MultiPath*>(GetMultiPathConst(pathID))); }
 
@@ -181,8 +215,10 @@ private:
 
 	static void FinalizePath(MultiPath* path, const float3 startPos, const float3 goalPos, const bool cantGetCloser);
 
-	void LowRes2MedRes(MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
-	void MedRes2MaxRes(MultiPath& path, const float3& startPos, const CSolidObject* owner, bool synced) const;
+	void LowRes2MedRes(MultiPath& path, const PathSearchers& searchers, const float3& startPos, const CSolidObject* owner, bool synced) const;
+	void MedRes2MaxRes(MultiPath& path, const PathSearchers& searchers, const float3& startPos, const CSolidObject* owner, bool synced) const;
+
+	PathSearchers GetMainSearchers() const { return {maxResPF, medResPE, lowResPE}; }
 
 	bool IsFinalized() const { return (maxResPF != nullptr); }
 
@@ -196,6 +232,11 @@ private:
 
 	spring::unordered_map<unsigned int, MultiPath> pathMap;
 
+	// ids of deferred requests in arrival order, served by Update
+	std::deque<unsigned int> asyncRequests;
+	// search-only clones of the main PF and PE's, created on first use
+	std::vector<PathSearchers> asyncSearchers;
+
 	unsigned int nextPathID;
 };
 
@@ -144,6 +144,30 @@ public:
 		return 0;
 	}
 
+	/**
+	 * Same as RequestPath, but the search may be deferred to the next Update
+	 * (and then run in parallel with other deferred requests, with identical
+	 * results on every client). Until it completes, NextWayPoint returns
+	 * temporary waypoints (y=-1) leading toward goalPos.
+	 * @return
+	 *     a path-id >= 1; a deferred search that fails invalidates the id
+	 */
+	virtual unsigned int RequestPathAsync(
+		CSolidObject* caller,
+		const MoveDef* moveDef,
+		float3 startPos,
+		float3 goalPos,
+		float goalRadius,
+		bool synced
+	) {
+		return (RequestPath(caller, moveDef, startPos, goalPos, goalRadius, synced));
+	}
+
+	/**
+	 * Returns true while the search for this path has not been run yet.
+	 */
+	virtual bool IsPathPending(unsigned int pathID) const { return false; }
+
 	/**
 	 * Whenever there are any changes in the terrain
 	 * (examples: explosions, new buildings, etc.)
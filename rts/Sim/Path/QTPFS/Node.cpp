@@ -640,43 +640,63 @@ unsigned int QTPFS::QTNode::GetMaxNumNeighbors() const {
 
 
 
-void QTPFS::QTNode::Serialize(std::fstream& fStream, NodeLayer& nodeLayer, unsigned int* streamSize, unsigned int depth, bool readMode) {
-	// overwritten when de-serializing
-	unsigned int numChildren = QTNODE_CHILD_COUNT * (1 - int(IsLeaf()));
-
-	(*streamSize) += (3 * sizeof(unsigned int));
-	(*streamSize) += (3 * sizeof(float));
-
-	if (readMode) {
-		fStream.read(reinterpret_cast<char*>(&nodeNumber), sizeof(unsigned int));
-		fStream.read(reinterpret_cast<char*>(&numChildren), sizeof(unsigned int));
-		fStream.read(reinterpret_cast<char*>(&childBaseIndex), sizeof(unsigned int));
-
-		fStream.read(reinterpret_cast<char*>(&speedModAvg), sizeof(float));
-		fStream.read(reinterpret_cast<char*>(&speedModSum), sizeof(float));
-		fStream.read(reinterpret_cast<char*>(&moveCostAvg), sizeof(float));
-
-		if (numChildren > 0) {
-			// re-create child nodes
-			assert(IsLeaf());
-			Split(nodeLayer, depth, true);
-		} else {
-			// node was a leaf in an earlier life, register it
-			nodeLayer.RegisterNode(this);
-		}
-	} else {
-		fStream.write(reinterpret_cast<const char*>(&nodeNumber), sizeof(unsigned int));
-		fStream.write(reinterpret_cast<const char*>(&numChildren), sizeof(unsigned int));
-		fStream.write(reinterpret_cast<const char*>(&childBaseIndex), sizeof(unsigned int));
+// appends this subtree to <records> in depth-first order
+void QTPFS::QTNode::WriteCache(const NodeLayer& nodeLayer, std::vector<NodeCacheRecord>& records) const {
+	records.push_back({nodeNumber, childBaseIndex, speedModSum, speedModAvg, moveCostAvg});
+
+	if (IsLeaf())
+		return;
+
+	for (unsigned int i = 0; i < QTNODE_CHILD_COUNT; i++) {
+		static_cast<const QTNode*>(nodeLayer.GetPoolNode(childBaseIndex + i))->WriteCache(nodeLayer, records);
+	}
+}
+
+// inverse of WriteCache; children are re-created at the pool indices
+// they had when written s.t. the layer's node pool is fully restored
+// (returns false if <records> does not describe a valid subtree)
+bool QTPFS::QTNode::ReadCache(NodeLayer& nodeLayer, const NodeCacheRecord* records, unsigned int numRecords, unsigned int& recordIndex) {
+	if (recordIndex >= numRecords)
+		return false;
+
+	const NodeCacheRecord& record = records[recordIndex++];
+
+	if (record.nodeNumber != nodeNumber)
+		return false;
 
-		fStream.write(reinterpret_cast<const char*>(&speedModAvg), sizeof(float));
-		fStream.write(reinterpret_cast<const char*>(&speedModSum), sizeof(float));
-		fStream.write(reinterpret_cast<const char*>(&moveCostAvg), sizeof(float));
+	speedModSum = record.speedModSum;
+	speedModAvg = record.speedModAvg;
+	moveCostAvg = record.moveCostAvg;
+
+	if (record.childBaseIndex == -1u) {
+		// node was a leaf in an earlier life, register it
+		nodeLayer.RegisterNode(this);
+		return true;
 	}
 
-	for (unsigned int i = 0; i < numChildren; i++) {
-		nodeLayer.GetPoolNode(childBaseIndex + i)->Serialize(fStream, nodeLayer, streamSize, depth + 1, readMode);
+	assert(IsLeaf());
+
+	if (!CanSplit(0, true))
+		return false;
+
+	if (!nodeLayer.InitPoolNode(record.childBaseIndex + 0, this, GetChildID(NODE_IDX_TL),  xmin(), zmin(),  xmid(), zmid())) return false;
+	if (!nodeLayer.InitPoolNode(record.childBaseIndex + 1, this, GetChildID(NODE_IDX_TR),  xmid(), zmin(),  xmax(), zmid())) return false;
+	if (!nodeLayer.InitPoolNode(record.childBaseIndex + 2, this, GetChildID(NODE_IDX_BR),  xmid(), zmid(),  xmax(), zmax())) return false;
+	if (!nodeLayer.InitPoolNode(record.childBaseIndex + 3, this, GetChildID(NODE_IDX_BL),  xmin(), zmid(),  xmid(), zmax())) return false;
+
+	childBaseIndex = record.childBaseIndex;
+
+	neighbors.clear();
+	netpoints.clear();
+
+	nodeLayer.SetNumLeafNodes(nodeLayer.GetNumLeafNodes() + (4 - 1));
+
+	for (unsigned int i = 0; i < QTNODE_CHILD_COUNT; i++) {
+		if (!static_cast<QTNode*>(nodeLayer.GetPoolNode(childBaseIndex + i))->ReadCache(nodeLayer, records, numRecords, recordIndex))
+			return false;
 	}
+
+	return true;
 }
 
 unsigned int QTPFS::QTNode::GetNeighbors(const std::vector<INode*>& nodes, std::vector<INode*>& ngbs) {
@@ -5,7 +5,6 @@
 
 #include <array>
 #include <vector>
-#include <fstream>
 #include <cinttypes>
 
 #include "PathEnums.hpp"
@@ -22,6 +21,17 @@
 
 namespace QTPFS {
 	struct NodeLayer;
+
+	// flattened node, as stored by the node-layer cache (see NodeLayer::WriteCache)
+	struct NodeCacheRecord {
+		std::uint32_t nodeNumber;
+		std::uint32_t childBaseIndex;
+
+		float speedModSum;
+		float speedModAvg;
+		float moveCostAvg;
+	};
+
 	struct INode {
 	public:
 		void SetNodeNumber(unsigned int n) { nodeNumber = n; }
@@ -37,7 +47,8 @@ namespace QTPFS {
 		bool operator >= (const INode* n) const { return (fCost >= n->fCost); }
 
 		#ifdef QTPFS_VIRTUAL_NODE_FUNCTIONS
-		virtual void Serialize(std::fstream&, NodeLayer&, unsigned int*, unsigned int, bool) = 0;
+		virtual void WriteCache(const NodeLayer&, std::vector<NodeCacheRecord>&) const = 0;
+		virtual bool ReadCache(NodeLayer&, const NodeCacheRecord*, unsigned int, unsigned int&) = 0;
 		virtual unsigned int GetNeighbors(const std::vector<INode*>&, std::vector<INode*>&) = 0;
 		virtual const std::vector<INode*>& GetNeighbors(const std::vector<INode*>& v) = 0;
 		virtual bool UpdateNeighborCache(const std::vector<INode*>& nodes) = 0;
@@ -135,7 +146,8 @@ namespace QTPFS {
 
 		void PreTesselate(NodeLayer& nl, const SRectangle& r, SRectangle& ur, unsigned int depth);
 		void Tesselate(NodeLayer& nl, const SRectangle& r, unsigned int depth);
-		void Serialize(std::fstream& fStream, NodeLayer& nodeLayer, unsigned int* streamSize, unsigned int depth, bool readMode);
+		void WriteCache(const NodeLayer& nodeLayer, std::vector<NodeCacheRecord>& records) const;
+		bool ReadCache(NodeLayer& nodeLayer, const NodeCacheRecord* records, unsigned int numRecords, unsigned int& recordIndex);
 
 		bool IsLeaf() const { return (childBaseIndex == -1u); }
 		bool CanSplit(unsigned int depth, bool forced) const;
@@ -1,6 +1,15 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <limits>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "NodeLayer.hpp"
 #include "PathManager.hpp"
@@ -11,11 +20,19 @@
 #include "Sim/MoveTypes/MoveDefHandler.h"
 #include "Sim/MoveTypes/MoveMath/MoveMath.h"
 #include "System/SpringMath.h"
+#include "System/Sync/HsiehHash.h"
 
 unsigned int QTPFS::NodeLayer::NUM_SPEEDMOD_BINS;
 float        QTPFS::NodeLayer::MIN_SPEEDMOD_VALUE;
 float        QTPFS::NodeLayer::MAX_SPEEDMOD_VALUE;
 
+static constexpr char CACHE_FILE_MAGIC[8] = {'Q', 'T', 'P', 'F', 'S', 'N', 'L', '\0'};
+
+// keeps all sections (and the records read in-place from a mapped file) 4-byte aligned
+static_assert((sizeof(QTPFS::NodeLayerCacheHeader) % 4) == 0, "");
+static_assert((sizeof(QTPFS::NodeCacheRecord) % 4) == 0, "");
+static_assert((sizeof(QTPFS::NodeIndexRun) % 4) == 0, "");
+
 
 
 void QTPFS::NodeLayer::InitStatic() {
@@ -371,3 +388,183 @@ void QTPFS::NodeLayer::ExecNodeNeighborCacheUpdates(const SRectangle& ur, unsign
 	}
 }
 
+
+
+bool QTPFS::NodeLayer::WriteCache(const std::string& fileName, std::uint32_t inputSum) const {
+	std::vector<NodeCacheRecord> records;
+	std::vector<NodeIndexRun> freeRuns;
+
+	records.reserve(POOL_TOTAL_SIZE - nodeIndcs.size() + 1);
+	rootNode.WriteCache(*this, records);
+
+	// the free-list is mostly one long descending run (never-used indices)
+	// followed by short ones for nodes released by merges, so store it RLE
+	for (const unsigned int idx: nodeIndcs) {
+		if (!freeRuns.empty() && (freeRuns.back().first - freeRuns.back().count) == idx) {
+			freeRuns.back().count += 1;
+			continue;
+		}
+
+		freeRuns.push_back({idx, 1});
+	}
+
+	NodeLayerCacheHeader header;
+
+	std::memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic));
+
+	header.version = QTPFS_CACHE_VERSION;
+	header.layerNumber = layerNumber;
+	header.xsize = xsize;
+	header.zsize = zsize;
+	header.inputSum = inputSum;
+	header.dataSum = 0;
+	header.numNodes = records.size();
+	header.numLeafNodes = numLeafNodes;
+	header.numFreeRuns = freeRuns.size();
+	header.maxRelSpeedMod = maxRelSpeedMod;
+	header.avgRelSpeedMod = avgRelSpeedMod;
+
+	header.dataSum = HsiehHash(records.data(), records.size() * sizeof(NodeCacheRecord), header.dataSum);
+	header.dataSum = HsiehHash(freeRuns.data(), freeRuns.size() * sizeof(NodeIndexRun), header.dataSum);
+	header.dataSum = HsiehHash(curSpeedMods.data(), curSpeedMods.size() * sizeof(SpeedModType), header.dataSum);
+	header.dataSum = HsiehHash(curSpeedBins.data(), curSpeedBins.size() * sizeof(SpeedBinType), header.dataSum);
+
+	// write to a temporary file first, concurrent readers can then
+	// never observe a partially written cache under the final name;
+	// pid and counter keep concurrent writers (threads or processes
+	// sharing the cache directory) off each other's temporaries
+	static std::atomic<unsigned int> numTmpFiles = {0};
+
+	#ifdef _WIN32
+	const int pid = _getpid();
+	#else
+	const int pid = getpid();
+	#endif
+
+	const std::string tmpFileName = fileName + "-tmp-" + std::to_string(pid) + "-" + std::to_string(numTmpFiles++);
+
+	{
+		std::ofstream fs(tmpFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+		fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		fs.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(NodeCacheRecord));
+		fs.write(reinterpret_cast<const char*>(freeRuns.data()), freeRuns.size() * sizeof(NodeIndexRun));
+		fs.write(reinterpret_cast<const char*>(curSpeedMods.data()), curSpeedMods.size() * sizeof(SpeedModType));
+		fs.write(reinterpret_cast<const char*>(curSpeedBins.data()), curSpeedBins.size() * sizeof(SpeedBinType));
+		fs.flush();
+
+		if (!fs.good()) {
+			fs.close();
+			std::remove(tmpFileName.c_str());
+			return false;
+		}
+	}
+
+	#ifdef _WIN32
+	// rename does not replace existing files here
+	std::remove(fileName.c_str());
+	#endif
+
+	if (std::rename(tmpFileName.c_str(), fileName.c_str()) == 0)
+		return true;
+
+	std::remove(tmpFileName.c_str());
+	return false;
+}
+
+bool QTPFS::NodeLayer::ReadCache(const unsigned char* data, size_t size, std::uint32_t inputSum) {
+	NodeLayerCacheHeader header;
+
+	if (data == nullptr || size < sizeof(header))
+		return false;
+
+	std::memcpy(&header, data, sizeof(header));
+
+	// stale (written by another version or for other inputs) or malformed
+	if (std::memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic)) != 0)
+		return false;
+	if (header.version != QTPFS_CACHE_VERSION || header.layerNumber != layerNumber)
+		return false;
+	if (header.xsize != xsize || header.zsize != zsize)
+		return false;
+	if (header.inputSum != inputSum)
+		return false;
+	if (header.numNodes == 0 || header.numNodes > (POOL_TOTAL_SIZE + 1))
+		return false;
+	if (header.numFreeRuns > POOL_TOTAL_SIZE)
+		return false;
+
+	const size_t numSquares = size_t(xsize) * zsize;
+	const size_t recordsSize = header.numNodes * sizeof(NodeCacheRecord);
+	const size_t runsSize = header.numFreeRuns * sizeof(NodeIndexRun);
+
+	if (size != (sizeof(header) + recordsSize + runsSize + numSquares * (sizeof(SpeedModType) + sizeof(SpeedBinType))))
+		return false;
+
+	const unsigned char* recordsData = data + sizeof(header);
+	const unsigned char* runsData = recordsData + recordsSize;
+	const unsigned char* modsData = runsData + runsSize;
+	const unsigned char* binsData = modsData + numSquares * sizeof(SpeedModType);
+
+	{
+		// truncated or corrupt
+		std::uint32_t dataSum = 0;
+
+		dataSum = HsiehHash(recordsData, recordsSize, dataSum);
+		dataSum = HsiehHash(runsData, runsSize, dataSum);
+		dataSum = HsiehHash(modsData, numSquares * sizeof(SpeedModType), dataSum);
+		dataSum = HsiehHash(binsData, numSquares * sizeof(SpeedBinType), dataSum);
+
+		if (dataSum != header.dataSum)
+			return false;
+	}
+
+	{
+		// node records and free-runs are used in-place
+		const NodeCacheRecord* records = reinterpret_cast<const NodeCacheRecord*>(recordsData);
+		const NodeIndexRun* freeRuns = reinterpret_cast<const NodeIndexRun*>(runsData);
+
+		unsigned int recordIndex = 0;
+
+		if (!rootNode.ReadCache(*this, records, header.numNodes, recordIndex))
+			return false;
+		if (recordIndex != header.numNodes || numLeafNodes != header.numLeafNodes)
+			return false;
+
+		size_t numFreeNodes = 0;
+
+		for (unsigned int i = 0; i < header.numFreeRuns; i++) {
+			const NodeIndexRun& run = freeRuns[i];
+
+			if (run.first >= POOL_TOTAL_SIZE || run.count == 0 || run.count > (run.first + 1))
+				return false;
+			if ((numFreeNodes += run.count) > POOL_TOTAL_SIZE)
+				return false;
+		}
+
+		// every pool node is either part of the tree (root is not pooled) or free
+		if ((numFreeNodes + header.numNodes - 1) != POOL_TOTAL_SIZE)
+			return false;
+
+		nodeIndcs.clear();
+		nodeIndcs.reserve(numFreeNodes);
+
+		for (unsigned int i = 0; i < header.numFreeRuns; i++) {
+			for (unsigned int j = 0; j < freeRuns[i].count; j++) {
+				nodeIndcs.push_back(freeRuns[i].first - j);
+			}
+		}
+	}
+
+	// squares are modified by terrain changes later, so these need a copy
+	curSpeedMods.assign(modsData, modsData + numSquares * sizeof(SpeedModType));
+	curSpeedBins.assign(binsData, binsData + numSquares * sizeof(SpeedBinType));
+
+	// same state as after the initial (global) Update
+	std::fill(oldSpeedMods.begin(), oldSpeedMods.end(),  0);
+	std::fill(oldSpeedBins.begin(), oldSpeedBins.end(), -1);
+
+	maxRelSpeedMod = header.maxRelSpeedMod;
+	avgRelSpeedMod = header.avgRelSpeedMod;
+	return true;
+}
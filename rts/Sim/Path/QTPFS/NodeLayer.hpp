@@ -7,6 +7,7 @@
 #include <vector>
 #include <deque>
 #include <cinttypes>
+#include <string>
 
 #include "System/Rectangle.h"
 #include "Node.hpp"
@@ -28,6 +29,36 @@ namespace QTPFS {
 	};
 	#endif
 
+	// layout of a node-layer cache file, followed by (in order)
+	// numNodes NodeCacheRecord's, numFreeRuns NodeIndexRun's and
+	// the xsize*zsize current speed-mod and speed-bin arrays
+	struct NodeLayerCacheHeader {
+		char magic[8];
+
+		std::uint32_t version;
+		std::uint32_t layerNumber;
+		std::uint32_t xsize;
+		std::uint32_t zsize;
+
+		// hash over every input of the tesselation (movedef,
+		// constants, terrain) and over the data that follows
+		std::uint32_t inputSum;
+		std::uint32_t dataSum;
+
+		std::uint32_t numNodes;
+		std::uint32_t numLeafNodes;
+		std::uint32_t numFreeRuns;
+
+		float maxRelSpeedMod;
+		float avgRelSpeedMod;
+	};
+
+	// run of decreasing pool-node indices {first, first - 1, ..., first - count + 1}
+	struct NodeIndexRun {
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+
 	struct NodeLayer {
 	public:
 		typedef unsigned char SpeedModType;
@@ -96,6 +127,33 @@ namespace QTPFS {
 
 		void FreePoolNode(unsigned int nodeIndex) { nodeIndcs.push_back(nodeIndex); }
 
+		// (re-)initializes a specific pool node without touching the free-list, for ReadCache
+		bool InitPoolNode(unsigned int idx, const INode* parent, unsigned int nn,  unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2) {
+			if (idx >= POOL_TOTAL_SIZE)
+				return false;
+
+			if (poolNodes[idx / POOL_CHUNK_SIZE].empty())
+				poolNodes[idx / POOL_CHUNK_SIZE].resize(POOL_CHUNK_SIZE);
+
+			poolNodes[idx / POOL_CHUNK_SIZE][idx % POOL_CHUNK_SIZE].Init(parent, nn, x1, z1, x2, z2);
+			return true;
+		}
+
+		/**
+		 * Writes the tesselated tree (rooted at rootNode), the node-pool
+		 * free-list and the speed-mod data needed to restore this layer
+		 * without re-running Update and tesselation to <fileName>; data
+		 * goes to a temporary file first which is renamed on completion
+		 */
+		bool WriteCache(const std::string& fileName, std::uint32_t inputSum) const;
+		/**
+		 * Restores the state written by WriteCache from a mapped cache file;
+		 * must be called right after Init and AllocRootNode. Fails if the file
+		 * was written for different inputs or is truncated or corrupt, after
+		 * which the layer must be Clear'ed and re-initialized
+		 */
+		bool ReadCache(const unsigned char* data, size_t size, std::uint32_t inputSum);
+
 
 		const std::vector<SpeedBinType>& GetOldSpeedBins() const { return oldSpeedBins; }
 		const std::vector<SpeedBinType>& GetCurSpeedBins() const { return curSpeedBins; }
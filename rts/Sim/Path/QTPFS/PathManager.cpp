@@ -1,5 +1,6 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
 #include <chrono>
 #include <cinttypes>
 #include <functional>
@@ -13,6 +14,8 @@
 #include "Game/GameSetup.h"
 #include "Game/LoadScreen.h"
 #include "Map/MapInfo.h"
+#include "Map/ReadMap.h"
+#include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/MoveTypes/MoveDefHandler.h"
@@ -22,10 +25,12 @@
 #include "System/FileSystem/ArchiveScanner.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/Log/ILog.h"
+#include "System/Platform/MappedFile.h"
 #include "System/Platform/Threading.h"
 #include "System/Rectangle.h"
 #include "System/TimeProfiler.h"
 #include "System/StringUtil.h"
+#include "System/Sync/HsiehHash.h"
 
 #ifdef GetTempPath
 #undef GetTempPath
@@ -99,6 +104,35 @@ namespace QTPFS {
 
 	static PMLoadScreen pmLoadScreen;
 
+	// hashes the terrain state the node-layers are derived from, which can differ
+	// from the pristine map (e.g. if Lua changed heights or placed features) and
+	// is therefore not covered by the map checksum that names the cache-dir
+	static std::uint32_t GetTerrainCheckSum() {
+		const size_t numHalfSquares = mapDims.hmapx * mapDims.hmapy;
+		const size_t numSquares = mapDims.mapx * mapDims.mapy;
+
+		std::uint32_t sum = readMap->CalcTypemapChecksum();
+
+		sum = HsiehHash(readMap->GetMIPHeightMapSynced(1), numHalfSquares * sizeof(float), sum);
+		sum = HsiehHash(readMap->GetSlopeMapSynced(), numHalfSquares * sizeof(float), sum);
+
+		for (size_t sqr = 0; sqr < numSquares; sqr++) {
+			const auto& cell = groundBlockingObjectMap.GetCellUnsafeConst(sqr);
+
+			if (cell.empty())
+				continue;
+
+			sum = HsiehHash(&sqr, sizeof(sqr), sum);
+
+			for (size_t i = 0, n = cell.size(); i < n; i++) {
+				const int objID = cell[i]->GetBlockingMapID();
+				sum = HsiehHash(&objID, sizeof(objID), sum);
+			}
+		}
+
+		return sum;
+	}
+
 	static size_t GetNumThreads() {
 		const size_t numThreads = std::max(0, configHandler->GetInt("PathingThreadCount"));
 		const size_t numCores = Threading::GetLogicalCpuCores();
@@ -209,16 +243,33 @@ void QTPFS::PathManager::Load() {
 		sha512::dump_digest(mapCheckSum, mapCheckSumHex);
 		sha512::dump_digest(modCheckSum, modCheckSumHex);
 
-		const std::string& cacheDirName = GetCacheDirName({mapCheckSumHex.data()}, {modCheckSumHex.data()});
+		cacheDirName = GetCacheDirName({mapCheckSumHex.data()}, {modCheckSumHex.data()});
+
+		if (!FileSystem::DirExists(cacheDirName))
+			FileSystem::CreateDirectory(cacheDirName);
 
 		{
-			layersInited = false;
-			haveCacheDir = FileSystem::DirExists(cacheDirName);
+			const std::uint32_t terrainCheckSum = GetTerrainCheckSum();
+			const auto& qtpfsConstants = mapInfo->pfs.qtpfs_constants;
+
+			cachedLayers.clear();
+			cachedLayers.resize(nodeLayers.size(), 0);
+			layerInputSums.clear();
+			layerInputSums.resize(nodeLayers.size(), 0);
+
+			for (unsigned int layerNum = 0; layerNum < nodeLayers.size(); layerNum++) {
+				const unsigned int moveDefSum = moveDefHandler.GetMoveDefByPathType(layerNum)->CalcCheckSum();
+
+				layerInputSums[layerNum] = HsiehHash(&moveDefSum, sizeof(moveDefSum), terrainCheckSum);
+				layerInputSums[layerNum] = HsiehHash(&qtpfsConstants, sizeof(qtpfsConstants), layerInputSums[layerNum]);
+			}
 
 			InitNodeLayersThreaded(MAP_RECTANGLE);
-			Serialize(cacheDirName);
 
-			layersInited = true;
+			const unsigned int numCachedLayers = std::count(cachedLayers.begin(), cachedLayers.end(), 1);
+			const unsigned int numLayers = nodeLayers.size();
+
+			pmLoadScreen.AddMessage("[" + std::string(__func__) + "] restored " + IntToString(numCachedLayers) + " of " + IntToString(numLayers) + " node-layers from cache");
 		}
 
 		// NOTE:
@@ -235,8 +286,8 @@ void QTPFS::PathManager::Load() {
 
 		for (unsigned int layerNum = 0; layerNum < nodeLayers.size(); layerNum++) {
 			#ifndef QTPFS_CONSERVATIVE_NEIGHBOR_CACHE_UPDATES
-			if (haveCacheDir) {
-				// if cache-dir exists, must set node relations after de-serializing its trees
+			if (cachedLayers[layerNum]) {
+				// must set node relations after restoring cached trees
 				nodeLayers[layerNum].ExecNodeNeighborCacheUpdates(MAP_RECTANGLE, numTerrainChanges);
 			}
 			#endif
@@ -291,11 +342,11 @@ void QTPFS::PathManager::InitNodeLayersThreaded(const SRectangle& rect) {
 	streflop::streflop_init<streflop::Simple>();
 
 	char loadMsg[512] = {'\0'};
-	const char* fmtString = "[PathManager::%s] using %u threads for %u node-layers (%s)";
+	const char* fmtString = "[PathManager::%s] using %u threads for %u node-layers";
 
 	#ifdef QTPFS_OPENMP_ENABLED
 	{
-		sprintf(loadMsg, fmtString, __func__, ThreadPool::GetNumThreads(), nodeLayers.size(), (haveCacheDir? "cached": "uncached"));
+		sprintf(loadMsg, fmtString, __func__, ThreadPool::GetNumThreads(), nodeLayers.size());
 		pmLoadScreen.AddMessage(loadMsg);
 
 		#ifndef NDEBUG
@@ -309,14 +360,8 @@ void QTPFS::PathManager::InitNodeLayersThreaded(const SRectangle& rect) {
 			pmLoadScreen.AddMessage(loadMsg);
 			#endif
 
-			// construct each tree from scratch IFF no cache-dir exists
-			// (if it does, we only need to initialize speed{Mods, Bins}
-			// since Serialize will fill in the branches)
-			// NOTE:
-			//     silently assumes trees either ALL exist or ALL do not
-			//     (if >= 1 are missing for some player in MP, we desync)
-			InitNodeLayer(layerNum, rect);
-			UpdateNodeLayer(layerNum, rect);
+			// construct each tree from scratch IFF it is not cached
+			LoadNodeLayer(layerNum, rect);
 
 			const QTNode* tree = nodeTrees[layerNum];
 			const NodeLayer& layer = nodeLayers[layerNum];
@@ -330,7 +375,7 @@ void QTPFS::PathManager::InitNodeLayersThreaded(const SRectangle& rect) {
 	}
 	#else
 	{
-		sprintf(loadMsg, fmtString, __func__, GetNumThreads(), nodeLayers.size(), (haveCacheDir? "cached": "uncached"));
+		sprintf(loadMsg, fmtString, __func__, GetNumThreads(), nodeLayers.size());
 		pmLoadScreen.AddMessage(loadMsg);
 
 		SpawnSpringThreads(&PathManager::InitNodeLayersThread, rect);
@@ -365,8 +410,7 @@ void QTPFS::PathManager::InitNodeLayersThread(
 		pmLoadScreen.AddMessage(loadMsg);
 		#endif
 
-		InitNodeLayer(layerNum, rect);
-		UpdateNodeLayer(layerNum, rect);
+		LoadNodeLayer(layerNum, rect);
 
 		const QTNode* tree = nodeTrees[layerNum];
 		const NodeLayer& layer = nodeLayers[layerNum];
@@ -386,6 +430,32 @@ void QTPFS::PathManager::InitNodeLayer(unsigned int layerNum, const SRectangle&
 	nl.RegisterNode(nodeTrees[layerNum] = nl.AllocRootNode(nullptr, 0,  r.x1, r.z1,  r.x2, r.z2));
 }
 
+void QTPFS::PathManager::LoadNodeLayer(unsigned int layerNum, const SRectangle& r) {
+	const std::string& cacheFileName = GetCacheFileName(layerNum);
+
+	InitNodeLayer(layerNum, r);
+
+	{
+		CMappedFile cacheFile;
+
+		if (cacheFile.Open(cacheFileName) && nodeLayers[layerNum].ReadCache(cacheFile.GetData(), cacheFile.GetSize(), layerInputSums[layerNum])) {
+			cachedLayers[layerNum] = 1;
+			return;
+		}
+
+		if (cacheFile.IsOpen()) {
+			// stale or corrupt, discard whatever was partially restored
+			nodeLayers[layerNum].Clear();
+			InitNodeLayer(layerNum, r);
+		}
+	}
+
+	UpdateNodeLayer(layerNum, r);
+
+	if (!nodeLayers[layerNum].WriteCache(cacheFileName, layerInputSums[layerNum]))
+		pmLoadScreen.AddMessage("[PathManager::" + std::string(__func__) + "] failed to write cache-file \"" + cacheFileName + "\"");
+}
+
 
 
 void QTPFS::PathManager::UpdateNodeLayersThreaded(const SRectangle& rect) {
@@ -454,10 +524,7 @@ void QTPFS::PathManager::UpdateNodeLayer(unsigned int layerNum, const SRectangle
 	ur.x2 = mr.x2;
 	ur.z2 = mr.z2;
 
-	const bool wantTesselation = (layersInited || !haveCacheDir);
-	const bool needTesselation = nodeLayers[layerNum].Update(mr, md);
-
-	if (needTesselation && wantTesselation) {
+	if (nodeLayers[layerNum].Update(mr, md)) {
 		nodeTrees[layerNum]->PreTesselate(nodeLayers[layerNum], mr, ur, 0);
 		pathCaches[layerNum].MarkDeadPaths(mr);
 
@@ -547,88 +614,9 @@ std::string QTPFS::PathManager::GetCacheDirName(const std::string& mapCheckSumHe
 	return dir;
 }
 
-void QTPFS::PathManager::Serialize(const std::string& cacheFileDir) {
-	std::vector<std::string> fileNames(nodeTrees.size(), "");
-	std::vector<std::fstream*> fileStreams(nodeTrees.size(), nullptr);
-	std::vector<unsigned int> fileSizes(nodeTrees.size(), 0);
-
-	if (!haveCacheDir) {
-		FileSystem::CreateDirectory(cacheFileDir);
-		assert(FileSystem::DirExists(cacheFileDir));
-	}
-
-	#ifndef NDEBUG
-	char loadMsg[512] = {'\0'};
-	const char* fmtString = "[PathManager::%s] serializing node-tree %u (%s)";
-	#endif
-
-	// TODO: compress the tree cache-files?
-	for (unsigned int i = 0; i < nodeTrees.size(); i++) {
-		const MoveDef* md = moveDefHandler.GetMoveDefByPathType(i);
-
-		fileNames[i] = cacheFileDir + "tree" + IntToString(i, "%02x") + "-" + md->name;
-		fileStreams[i] = new std::fstream();
-
-		if (haveCacheDir) {
-			#ifdef QTPFS_CACHE_XACCESS
-			{
-				// FIXME: lock fileNames[i] instead of doing this
-				// fstreams can not be easily locked however, see
-				// http://stackoverflow.com/questions/839856/
-				while (!FileSystem::FileExists(fileNames[i] + "-tmp")) {
-					spring::this_thread::sleep_for(std::chrono::milliseconds(100));
-				}
-				while (FileSystem::GetFileSize(fileNames[i] + "-tmp") != sizeof(unsigned int)) {
-					spring::this_thread::sleep_for(std::chrono::milliseconds(100));
-				}
-
-				fileStreams[i]->open((fileNames[i] + "-tmp").c_str(), std::ios::in | std::ios::binary);
-				fileStreams[i]->read(reinterpret_cast<char*>(&fileSizes[i]), sizeof(unsigned int));
-				fileStreams[i]->close();
-
-				while (!FileSystem::FileExists(fileNames[i])) {
-					spring::this_thread::sleep_for(std::chrono::milliseconds(100));
-				}
-				while (FileSystem::GetFileSize(fileNames[i]) != fileSizes[i]) {
-					spring::this_thread::sleep_for(std::chrono::milliseconds(100));
-				}
-			}
-
-			#else
-			assert(FileSystem::FileExists(fileNames[i]));
-			#endif
-
-			// read fileNames[i] into nodeTrees[i]
-			fileStreams[i]->open(fileNames[i].c_str(), std::ios::in | std::ios::binary);
-			assert(fileStreams[i]->good());
-			assert(nodeTrees[i]->IsLeaf());
-		} else {
-			// write nodeTrees[i] into fileNames[i]
-			fileStreams[i]->open(fileNames[i].c_str(), std::ios::out | std::ios::binary);
-		}
-
-		#ifndef NDEBUG
-		sprintf(loadMsg, fmtString, __func__, i, md->name.c_str());
-		pmLoadScreen.AddMessage(loadMsg);
-		#endif
-
-		nodeTrees[i]->Serialize(*fileStreams[i], nodeLayers[i], &fileSizes[i], 0, haveCacheDir);
-
-		fileStreams[i]->flush();
-		fileStreams[i]->close();
-
-		#ifdef QTPFS_CACHE_XACCESS
-		if (!haveCacheDir) {
-			// signal any other (concurrently loading) Spring processes; needed for validation-tests
-			fileStreams[i]->open((fileNames[i] + "-tmp").c_str(), std::ios::out | std::ios::binary);
-			fileStreams[i]->write(reinterpret_cast<const char*>(&fileSizes[i]), sizeof(unsigned int));
-			fileStreams[i]->flush();
-			fileStreams[i]->close();
-		}
-		#endif
-
-		delete fileStreams[i];
-	}
+std::string QTPFS::PathManager::GetCacheFileName(unsigned int layerNum) const {
+	const MoveDef* md = moveDefHandler.GetMoveDefByPathType(layerNum);
+	return (cacheDirName + "layer" + IntToString(layerNum, "%02x") + "-" + md->name);
 }
 
 
@@ -1009,6 +997,16 @@ bool QTPFS::PathManager::PathUpdated(unsigned int pathID) {
 	return true;
 }
 
+bool QTPFS::PathManager::IsPathPending(unsigned int pathID) const {
+	const auto pathTypeIt = pathTypes.find(pathID);
+
+	if (pathTypeIt == pathTypes.end())
+		return false;
+
+	// request is still queued iff the ID maps to a temporary path
+	return (pathCaches[pathTypeIt->second].GetTempPath(pathID)->GetID() != 0);
+}
+
 
 
 float3 QTPFS::PathManager::NextWayPoint(
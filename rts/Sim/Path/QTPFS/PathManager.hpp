@@ -38,6 +38,7 @@ namespace QTPFS {
 		std::int64_t Finalize() override;
 
 		bool PathUpdated(unsigned int pathID) override;
+		bool IsPathPending(unsigned int pathID) const override;
 
 		void TerrainChange(unsigned int x1, unsigned int z1,  unsigned int x2, unsigned int z2, unsigned int type) override;
 		void Update() override;
@@ -114,6 +115,7 @@ namespace QTPFS {
 			const SRectangle& rect
 		);
 		void InitNodeLayer(unsigned int layerNum, const SRectangle& r);
+		void LoadNodeLayer(unsigned int layerNum, const SRectangle& r);
 		void UpdateNodeLayer(unsigned int layerNum, const SRectangle& r);
 
 		#ifdef QTPFS_STAGGERED_LAYER_UPDATES
@@ -146,7 +148,7 @@ namespace QTPFS {
 
 
 		std::string GetCacheDirName(const std::string& mapCheckSumHexStr, const std::string& modCheckSumHexStr) const;
-		void Serialize(const std::string& cacheFileDir);
+		std::string GetCacheFileName(unsigned int layerNum) const;
 
 		static std::vector<NodeLayer> nodeLayers;
 		static std::vector<QTNode*> nodeTrees;
@@ -172,8 +174,12 @@ namespace QTPFS {
 
 		std::uint32_t pfsCheckSum;
 
-		bool layersInited;
-		bool haveCacheDir;
+		std::string cacheDirName;
+
+		// per-layer hash of the tesselation inputs, and whether
+		// the layer was restored from its cache-file (or built)
+		std::vector<std::uint32_t> layerInputSums;
+		std::vector<std::uint8_t> cachedLayers;
 
 		#ifdef QTPFS_ENABLE_THREADED_UPDATE
 		spring::thread updateThread;
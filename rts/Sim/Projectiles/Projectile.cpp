@@ -50,7 +50,8 @@ CR_REG_METADATA(CProjectile,
 	CR_MEMBER(collisionFlags),
 	CR_IGNORED(renderIndex),
 
-	CR_MEMBER(quads)
+	CR_MEMBER(quads),
+	CR_IGNORED(quadIndex)
 ))
 
 
@@ -131,6 +131,8 @@ protected:
 
 public:
 	std::vector<int> quads;
+	// position in its quad's projectile list (non-hitscan only); maintained by CQuadField
+	int quadIndex = -1;
 };
 
 #endif /* PROJECTILE_H */
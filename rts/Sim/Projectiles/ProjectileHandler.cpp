@@ -30,6 +30,7 @@
 #include "System/Log/ILog.h"
 #include "System/SpringMath.h"
 #include "System/TimeProfiler.h"
+#include "System/Threading/ThreadPool.h"
 
 
 // reserve 5% of maxNanoParticles for important stuff such as capture and reclaim other teams' units
@@ -595,10 +596,44 @@ void CProjectileHandler::CheckShieldCollisions(
 
 void CProjectileHandler::CheckUnitFeatureCollisions(ProjectileContainer& pc)
 {
+	struct CollisionCandidates {
+		std::vector<CUnit*> units;
+		std::vector<CFeature*> features;
+		std::vector<CPlasmaRepulser*> repulsers;
+
+		bool gathered = false;
+	};
+
+	static std::vector<CollisionCandidates> candidates;
+	static std::array<std::vector<int>, ThreadPool::MAX_THREADS> candidateQuads;
+
 	static std::vector<CUnit*> tempUnits;
 	static std::vector<CFeature*> tempFeatures;
 	static std::vector<CPlasmaRepulser*> tempRepulsers;
 
+	const size_t numProjectiles = pc.size();
+
+	if (candidates.size() < numProjectiles)
+		candidates.resize(numProjectiles);
+
+	// gather candidates for all projectiles up front; the
+	// quadfield queries are read-only so can be done in MT
+	for_mt(0, numProjectiles, [&](const int i) {
+		const CProjectile* p = pc[i];
+		CollisionCandidates& cc = candidates[i];
+
+		cc.units.clear();
+		cc.features.clear();
+		cc.repulsers.clear();
+
+		if ((cc.gathered = (p->checkCol && !p->deleteMe)))
+			quadField.GetUnitsAndFeaturesColVolMT(p->pos, p->speed.w + p->radius, cc.units, cc.features, &cc.repulsers, candidateQuads[ThreadPool::GetThreadNum()]);
+	});
+
+	// resolve in container order, collisions change simulation state
+	// NOTE:
+	//   pc can grow while iterating (e.g. cluster submunitions) and any
+	//   projectile without gathered candidates queries the quadfield now
 	for (size_t i = 0; i < pc.size(); ++i) {
 		CProjectile* p = pc[i];
 
@@ -609,6 +644,13 @@ void CProjectileHandler::CheckUnitFeatureCollisions(ProjectileContainer& pc)
 		const float3 ppos1 = p->pos + p->speed;
 		// const float3 ppos1 = p->pos + p->dir * (p->speed.w + p->radius);
 
+		if (i < numProjectiles && candidates[i].gathered) {
+			CheckShieldCollisions(p, candidates[i].repulsers, ppos0, ppos1);
+			CheckUnitCollisions(p, candidates[i].units, ppos0, ppos1);
+			CheckFeatureCollisions(p, candidates[i].features, ppos0, ppos1);
+			continue;
+		}
+
 		quadField.GetUnitsAndFeaturesColVol(p->pos, p->speed.w + p->radius, tempUnits, tempFeatures, &tempRepulsers);
 
 		CheckShieldCollisions(p, tempRepulsers, ppos0, ppos1); tempRepulsers.clear();
@@ -1497,10 +1497,11 @@ int CBuilderCAI::FindReclaimTarget(const float3& pos, float radius, unsigned cha
 	int rid = -1;
 
 	if (recUnits || recEnemy || recEnemyOnly) {
-		QuadFieldQuery qfQuery;
-		quadField.GetUnitsExact(qfQuery, pos, radius, false);
+		QuadFieldBatchQuery qfBatch;
+		qfBatch.AddSphere(pos, radius, false);
+		quadField.GetUnitsExact(qfBatch);
 
-		for (const CUnit* u: *qfQuery.units) {
+		for (const CUnit* u: qfBatch.units) {
 			if (u == owner)
 				continue;
 			if (!u->unitDef->reclaimable)
@@ -1658,8 +1659,9 @@ bool CBuilderCAI::FindCaptureTargetAndCapture(
 	unsigned char options,
 	bool healthyOnly
 ) {
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius, false);
+	QuadFieldBatchQuery qfBatch;
+	qfBatch.AddSphere(pos, radius, false);
+	quadField.GetUnitsExact(qfBatch);
 
 	const CUnit* best = nullptr;
 	float bestDist = 1.0e30f;
@@ -1667,7 +1669,7 @@ bool CBuilderCAI::FindCaptureTargetAndCapture(
 
 	const bool ctrlOpt = (options & CONTROL_KEY);
 
-	for (const CUnit* unit: *qfQuery.units) {
+	for (const CUnit* unit: qfBatch.units) {
 		const bool isAlliedUnit = teamHandler.Ally(owner->allyteam, unit->allyteam);
 		const bool isVisibleUnit = (unit->losStatus[owner->allyteam] & (LOS_INRADAR | LOS_INLOS));
 		const bool isCapturableUnit = !unit->beingBuilt && unit->unitDef->capturable;
@@ -1713,8 +1715,9 @@ bool CBuilderCAI::FindRepairTargetAndRepair(
 	bool attackEnemy,
 	bool builtOnly
 ) {
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, pos, radius, false);
+	QuadFieldBatchQuery qfBatch;
+	qfBatch.AddSphere(pos, radius, false);
+	quadField.GetUnitsExact(qfBatch);
 	const CUnit* bestUnit = nullptr;
 
 	const float maxSpeed = owner->moveType->GetMaxSpeed();
@@ -1725,7 +1728,7 @@ bool CBuilderCAI::FindRepairTargetAndRepair(
 	bool trySelfRepair = false;
 	bool stationary = false;
 
-	for (const CUnit* unit: *qfQuery.units) {
+	for (const CUnit* unit: qfBatch.units) {
 		if (teamHandler.Ally(owner->allyteam, unit->allyteam)) {
 			if (!haveEnemy && (unit->health < unit->maxHealth)) {
 				// don't help allies build unless set on roam
@@ -1614,10 +1614,11 @@ CUnit* CMobileCAI::FindUnitToTransport(float3 center, float radius)
 	CUnit* bestUnit = nullptr;
 	float bestDist = std::numeric_limits<float>::max();
 
-	QuadFieldQuery qfQuery;
-	quadField.GetUnitsExact(qfQuery, center, radius);
+	QuadFieldBatchQuery qfBatch;
+	qfBatch.AddSphere(center, radius);
+	quadField.GetUnitsExact(qfBatch);
 
-	for (CUnit* unit: *qfQuery.units) {
+	for (CUnit* unit: qfBatch.units) {
 		const float dist = unit->pos.SqDistance2D(owner->pos);
 
 		if (unit->loadingTransportId != -1 && unit->loadingTransportId != owner->id) {
@@ -20,7 +20,11 @@ CR_REG_METADATA(CCobEngine, (
 	CR_IGNORED(curThread),
 
 	CR_MEMBER(currentTime),
-	CR_MEMBER(threadCounter)
+	CR_MEMBER(threadCounter),
+
+	CR_IGNORED(numExecutedInstrs),
+	CR_IGNORED(numTickedInstrs),
+	CR_IGNORED(tickTime)
 ))
 
 CR_BIND(CCobEngine::SleepingThread, )
@@ -126,6 +130,11 @@ void CCobEngine::WakeSleepingThreads()
 
 void CCobEngine::Tick(int deltaTime)
 {
+	#ifdef PROFILE
+	const spring_time startTime = spring_gettime();
+	const std::uint64_t startInstrs = numExecutedInstrs;
+	#endif
+
 	currentTime += deltaTime;
 
 	TickRunningThreads();
@@ -133,6 +142,29 @@ void CCobEngine::Tick(int deltaTime)
 
 	WakeSleepingThreads();
 	AddQueuedThreads();
+
+	#ifdef PROFILE
+	numTickedInstrs += (numExecutedInstrs - startInstrs);
+	tickTime += (spring_gettime() - startTime);
+	#endif
+}
+
+
+void CCobEngine::LogStatistics()
+{
+	if (numExecutedInstrs == 0)
+		return;
+
+	// ticked threads are mostly animation scripts, the rate includes scheduling overhead
+	const float tickSecs = tickTime.toMilliSecsf() * 0.001f;
+	const float tickRate = (tickSecs > 0.0f)? (numTickedInstrs / tickSecs): 0.0f;
+
+	LOG("[COBEngine::%s] %llu instructions executed, %llu by scheduled threads in %.2fs (%.2fM/s)", __func__, (unsigned long long) numExecutedInstrs, (unsigned long long) numTickedInstrs, tickSecs, tickRate * 1e-6f);
+
+	numExecutedInstrs = 0;
+	numTickedInstrs = 0;
+
+	tickTime = spring_notime;
 }
 
 
@@ -8,9 +8,11 @@
  * It also manages reading and caching of the actual .cob files.
  */
 
+#include <cstdint>
 #include <vector>
 
 #include "CobThread.h"
+#include "System/Misc/SpringTime.h"
 #include "System/creg/creg_cond.h"
 #include "System/creg/STL_Queue.h"
 #include "System/creg/STL_Map.h"
@@ -63,6 +65,8 @@ public:
 		while (!sleepingThreadIDs.empty()) {
 			sleepingThreadIDs.pop();
 		}
+
+		LogStatistics();
 	}
 
 	void Tick(int deltaTime);
@@ -93,6 +97,8 @@ public:
 	int GenThreadID() { return (threadCounter++); }
 	int GetCurrentTime() const { return currentTime; }
 
+	void AddExecutedInstrs(unsigned int n) { numExecutedInstrs += n; }
+
 	void QueueAddThread(CCobThread&& thread) { tickAddedThreads.emplace_back(std::move(thread)); }
 	void AddQueuedThreads() {
 		// move new threads spawned by START into threadInstances;
@@ -110,6 +116,7 @@ public:
 
 private:
 	void TickThread(CCobThread* thread);
+	void LogStatistics();
 
 	void WakeSleepingThreads();
 	void TickRunningThreads() {
@@ -145,6 +152,14 @@ private:
 
 	int currentTime = 0;
 	int threadCounter = 0;
+
+	// instructions executed by all threads, and by those ticked from Tick
+	// (rather than directly by callins) along with the time that took; only
+	// counted in PROFILE builds, the hot loop does not pay for it otherwise
+	std::uint64_t numExecutedInstrs = 0;
+	std::uint64_t numTickedInstrs = 0;
+
+	spring_time tickTime;
 };
 
 
@@ -15,6 +15,165 @@
 #include <cstring>
 
 
+// Command documentation from http://visualta.tauniverse.com/Downloads/cob-commands.txt
+// And some information from basm0.8 source (basm ops.txt)
+
+// Model interaction
+constexpr int MOVE       = 0x10001000;
+constexpr int TURN       = 0x10002000;
+constexpr int SPIN       = 0x10003000;
+constexpr int STOP_SPIN  = 0x10004000;
+constexpr int SHOW       = 0x10005000;
+constexpr int HIDE       = 0x10006000;
+constexpr int CACHE      = 0x10007000;
+constexpr int DONT_CACHE = 0x10008000;
+constexpr int MOVE_NOW   = 0x1000B000;
+constexpr int TURN_NOW   = 0x1000C000;
+constexpr int SHADE      = 0x1000D000;
+constexpr int DONT_SHADE = 0x1000E000;
+constexpr int EMIT_SFX   = 0x1000F000;
+
+// Blocking operations
+constexpr int WAIT_TURN  = 0x10011000;
+constexpr int WAIT_MOVE  = 0x10012000;
+constexpr int SLEEP      = 0x10013000;
+
+// Stack manipulation
+constexpr int PUSH_CONSTANT    = 0x10021001;
+constexpr int PUSH_LOCAL_VAR   = 0x10021002;
+constexpr int PUSH_STATIC      = 0x10021004;
+constexpr int CREATE_LOCAL_VAR = 0x10022000;
+constexpr int POP_LOCAL_VAR    = 0x10023002;
+constexpr int POP_STATIC       = 0x10023004;
+constexpr int POP_STACK        = 0x10024000; ///< Not sure what this is supposed to do
+
+// Arithmetic operations
+constexpr int ADD         = 0x10031000;
+constexpr int SUB         = 0x10032000;
+constexpr int MUL         = 0x10033000;
+constexpr int DIV         = 0x10034000;
+constexpr int MOD		  = 0x10034001; ///< spring specific
+constexpr int BITWISE_AND = 0x10035000;
+constexpr int BITWISE_OR  = 0x10036000;
+constexpr int BITWISE_XOR = 0x10037000;
+constexpr int BITWISE_NOT = 0x10038000;
+
+// Native function calls
+constexpr int RAND           = 0x10041000;
+constexpr int GET_UNIT_VALUE = 0x10042000;
+constexpr int GET            = 0x10043000;
+
+// Comparison
+constexpr int SET_LESS             = 0x10051000;
+constexpr int SET_LESS_OR_EQUAL    = 0x10052000;
+constexpr int SET_GREATER          = 0x10053000;
+constexpr int SET_GREATER_OR_EQUAL = 0x10054000;
+constexpr int SET_EQUAL            = 0x10055000;
+constexpr int SET_NOT_EQUAL        = 0x10056000;
+constexpr int LOGICAL_AND          = 0x10057000;
+constexpr int LOGICAL_OR           = 0x10058000;
+constexpr int LOGICAL_XOR          = 0x10059000;
+constexpr int LOGICAL_NOT          = 0x1005A000;
+
+// Flow control
+constexpr int START           = 0x10061000;
+constexpr int CALL            = 0x10062000; ///< converted when executed
+constexpr int REAL_CALL       = 0x10062001; ///< spring custom
+constexpr int LUA_CALL        = 0x10062002; ///< spring custom
+constexpr int JUMP            = 0x10064000;
+constexpr int RETURN          = 0x10065000;
+constexpr int JUMP_NOT_EQUAL  = 0x10066000;
+constexpr int SIGNAL          = 0x10067000;
+constexpr int SET_SIGNAL_MASK = 0x10068000;
+
+// Piece destruction
+constexpr int EXPLODE    = 0x10071000;
+constexpr int PLAY_SOUND = 0x10072000;
+
+// Special functions
+constexpr int SET    = 0x10082000;
+constexpr int ATTACH = 0x10083000;
+constexpr int DROP   = 0x10084000;
+
+
+#if 0
+static const char* GetOpcodeName(int opcode)
+{
+	switch (opcode) {
+		case MOVE: return "move";
+		case TURN: return "turn";
+		case SPIN: return "spin";
+		case STOP_SPIN: return "stop-spin";
+		case SHOW: return "show";
+		case HIDE: return "hide";
+		case CACHE: return "cache";
+		case DONT_CACHE: return "dont-cache";
+		case TURN_NOW: return "turn-now";
+		case MOVE_NOW: return "move-now";
+		case SHADE: return "shade";
+		case DONT_SHADE: return "dont-shade";
+		case EMIT_SFX: return "sfx";
+
+		case WAIT_TURN: return "wait-for-turn";
+		case WAIT_MOVE: return "wait-for-move";
+		case SLEEP: return "sleep";
+
+		case PUSH_CONSTANT: return "pushc";
+		case PUSH_LOCAL_VAR: return "pushl";
+		case PUSH_STATIC: return "pushs";
+		case CREATE_LOCAL_VAR: return "clv";
+		case POP_LOCAL_VAR: return "popl";
+		case POP_STATIC: return "pops";
+		case POP_STACK: return "pop-stack";
+
+		case ADD: return "add";
+		case SUB: return "sub";
+		case MUL: return "mul";
+		case DIV: return "div";
+		case MOD: return "mod";
+		case BITWISE_AND: return "and";
+		case BITWISE_OR: return "or";
+		case BITWISE_XOR: return "xor";
+		case BITWISE_NOT: return "not";
+
+		case RAND: return "rand";
+		case GET_UNIT_VALUE: return "getuv";
+		case GET: return "get";
+
+		case SET_LESS: return "setl";
+		case SET_LESS_OR_EQUAL: return "setle";
+		case SET_GREATER: return "setg";
+		case SET_GREATER_OR_EQUAL: return "setge";
+		case SET_EQUAL: return "sete";
+		case SET_NOT_EQUAL: return "setne";
+		case LOGICAL_AND: return "land";
+		case LOGICAL_OR: return "lor";
+		case LOGICAL_XOR: return "lxor";
+		case LOGICAL_NOT: return "neg";
+
+		case START: return "start";
+		case CALL: return "call";
+		case REAL_CALL: return "call";
+		case LUA_CALL: return "lua_call";
+		case JUMP: return "jmp";
+		case RETURN: return "return";
+		case JUMP_NOT_EQUAL: return "jne";
+		case SIGNAL: return "signal";
+		case SET_SIGNAL_MASK: return "mask";
+
+		case EXPLODE: return "explode";
+		case PLAY_SOUND: return "play-sound";
+
+		case SET: return "set";
+		case ATTACH: return "attach";
+		case DROP: return "drop";
+	}
+
+	return "unknown";
+}
+#endif
+
+
 //The following structure is taken from http://visualta.tauniverse.com/Downloads/ta-cob-fmt.txt
 //Information on missing fields from Format_Cob.pas
 typedef struct tagCOBHeader
@@ -196,6 +355,189 @@ CCobFile::CCobFile(CFileHandler& in, const std::string& scriptName)
 
 		scriptIndex[pair.second] = fn;
 	}
+
+	flareScripts.resize(scriptNames.size(), false);
+
+	for (int i = 0; i < MAX_WEAPONS_PER_UNIT; ++i) {
+		const int fn = scriptIndex[COBFN_FirePrimary + COBFN_Weapon_Funcs * i];
+
+		if (fn < 0)
+			continue;
+
+		flareScripts[fn] = true;
+	}
+
+	DecodeCode();
+}
+
+
+void CCobFile::DecodeCode()
+{
+	// decode starting at every word, not only at instruction boundaries, so
+	// that execution behaves exactly like reading the raw code would even if
+	// a jump lands on an operand
+	instrs.clear();
+	instrs.resize(code.size() + 1);
+
+	for (size_t i = 0, n = code.size(); i < n; ++i) {
+		instrs[i] = DecodeInstr(i);
+	}
+}
+
+CCobInstr CCobFile::DecodeInstr(int pos) const
+{
+	const int numWords = code.size();
+	const int opcode = code[pos];
+
+	CCobInstr instr;
+	CCobInstr::Op op = CCobInstr::OP_UNKNOWN;
+
+	int numOperands = 0;
+
+	switch (opcode) {
+		case MOVE      : { op = CCobInstr::OP_MOVE     ; numOperands = 2; } break;
+		case TURN      : { op = CCobInstr::OP_TURN     ; numOperands = 2; } break;
+		case SPIN      : { op = CCobInstr::OP_SPIN     ; numOperands = 2; } break;
+		case STOP_SPIN : { op = CCobInstr::OP_STOP_SPIN; numOperands = 2; } break;
+		case SHOW      : { op = CCobInstr::OP_SHOW     ; numOperands = 1; } break;
+		case HIDE      : { op = CCobInstr::OP_HIDE     ; numOperands = 1; } break;
+		case CACHE     : { op = CCobInstr::OP_NOP      ; numOperands = 1; } break;
+		case DONT_CACHE: { op = CCobInstr::OP_NOP      ; numOperands = 1; } break;
+		case MOVE_NOW  : { op = CCobInstr::OP_MOVE_NOW ; numOperands = 2; } break;
+		case TURN_NOW  : { op = CCobInstr::OP_TURN_NOW ; numOperands = 2; } break;
+		case SHADE     : { op = CCobInstr::OP_NOP      ; numOperands = 1; } break;
+		case DONT_SHADE: { op = CCobInstr::OP_NOP      ; numOperands = 1; } break;
+		case EMIT_SFX  : { op = CCobInstr::OP_EMIT_SFX ; numOperands = 1; } break;
+
+		case WAIT_TURN: { op = CCobInstr::OP_WAIT_TURN; numOperands = 2; } break;
+		case WAIT_MOVE: { op = CCobInstr::OP_WAIT_MOVE; numOperands = 2; } break;
+		case SLEEP    : { op = CCobInstr::OP_SLEEP    ; numOperands = 0; } break;
+
+		case PUSH_CONSTANT   : { op = CCobInstr::OP_PUSH_CONSTANT   ; numOperands = 1; } break;
+		case PUSH_LOCAL_VAR  : { op = CCobInstr::OP_PUSH_LOCAL_VAR  ; numOperands = 1; } break;
+		case PUSH_STATIC     : { op = CCobInstr::OP_PUSH_STATIC     ; numOperands = 1; } break;
+		case CREATE_LOCAL_VAR: { op = CCobInstr::OP_CREATE_LOCAL_VAR; numOperands = 0; } break;
+		case POP_LOCAL_VAR   : { op = CCobInstr::OP_POP_LOCAL_VAR   ; numOperands = 1; } break;
+		case POP_STATIC      : { op = CCobInstr::OP_POP_STATIC      ; numOperands = 1; } break;
+		case POP_STACK       : { op = CCobInstr::OP_POP_STACK       ; numOperands = 0; } break;
+
+		case ADD        : { op = CCobInstr::OP_ADD        ; } break;
+		case SUB        : { op = CCobInstr::OP_SUB        ; } break;
+		case MUL        : { op = CCobInstr::OP_MUL        ; } break;
+		case DIV        : { op = CCobInstr::OP_DIV        ; } break;
+		case MOD        : { op = CCobInstr::OP_MOD        ; } break;
+		case BITWISE_AND: { op = CCobInstr::OP_BITWISE_AND; } break;
+		case BITWISE_OR : { op = CCobInstr::OP_BITWISE_OR ; } break;
+		case BITWISE_XOR: { op = CCobInstr::OP_BITWISE_XOR; } break;
+		case BITWISE_NOT: { op = CCobInstr::OP_BITWISE_NOT; } break;
+
+		case RAND          : { op = CCobInstr::OP_RAND          ; } break;
+		case GET_UNIT_VALUE: { op = CCobInstr::OP_GET_UNIT_VALUE; } break;
+		case GET           : { op = CCobInstr::OP_GET           ; } break;
+
+		case SET_LESS            : { op = CCobInstr::OP_SET_LESS            ; } break;
+		case SET_LESS_OR_EQUAL   : { op = CCobInstr::OP_SET_LESS_OR_EQUAL   ; } break;
+		case SET_GREATER         : { op = CCobInstr::OP_SET_GREATER         ; } break;
+		case SET_GREATER_OR_EQUAL: { op = CCobInstr::OP_SET_GREATER_OR_EQUAL; } break;
+		case SET_EQUAL           : { op = CCobInstr::OP_SET_EQUAL           ; } break;
+		case SET_NOT_EQUAL       : { op = CCobInstr::OP_SET_NOT_EQUAL       ; } break;
+		case LOGICAL_AND         : { op = CCobInstr::OP_LOGICAL_AND         ; } break;
+		case LOGICAL_OR          : { op = CCobInstr::OP_LOGICAL_OR          ; } break;
+		case LOGICAL_XOR         : { op = CCobInstr::OP_LOGICAL_XOR         ; } break;
+		case LOGICAL_NOT         : { op = CCobInstr::OP_LOGICAL_NOT         ; } break;
+
+		case START          : { op = CCobInstr::OP_START          ; numOperands = 2; } break;
+		case CALL           : { op = CCobInstr::OP_CALL           ; numOperands = 2; } break;
+		case REAL_CALL      : { op = CCobInstr::OP_CALL           ; numOperands = 2; } break;
+		case LUA_CALL       : { op = CCobInstr::OP_LUA_CALL       ; numOperands = 2; } break;
+		case JUMP           : { op = CCobInstr::OP_JUMP           ; numOperands = 1; } break;
+		case RETURN         : { op = CCobInstr::OP_RETURN         ; numOperands = 0; } break;
+		case JUMP_NOT_EQUAL : { op = CCobInstr::OP_JUMP_NOT_EQUAL ; numOperands = 1; } break;
+		case SIGNAL         : { op = CCobInstr::OP_SIGNAL         ; numOperands = 0; } break;
+		case SET_SIGNAL_MASK: { op = CCobInstr::OP_SET_SIGNAL_MASK; numOperands = 0; } break;
+
+		case EXPLODE   : { op = CCobInstr::OP_EXPLODE   ; numOperands = 1; } break;
+		case PLAY_SOUND: { op = CCobInstr::OP_PLAY_SOUND; numOperands = 1; } break;
+
+		case SET   : { op = CCobInstr::OP_SET   ; } break;
+		case ATTACH: { op = CCobInstr::OP_ATTACH; } break;
+		case DROP  : { op = CCobInstr::OP_DROP  ; } break;
+
+		default: {
+			// keep the raw opcode for the error message
+			instr.op = CCobInstr::OP_UNKNOWN;
+			instr.a = opcode;
+			return instr;
+		} break;
+	}
+
+	// operands would be read past the end of the code
+	if (pos + numOperands >= numWords)
+		return instr;
+
+	instr.op = op;
+	instr.len = 1 + numOperands;
+	instr.a = (numOperands > 0)? code[pos + 1]: 0;
+	instr.b = (numOperands > 1)? code[pos + 2]: 0;
+
+	const auto IsValidFunc = [&](int fn) { return (static_cast<size_t>(fn) < scriptNames.size()); };
+	const auto IsValidAddr = [&](int pc) { return (pc >= 0 && pc < numWords); };
+
+	switch (op) {
+		case CCobInstr::OP_CALL: {
+			if (!IsValidFunc(instr.a)) {
+				instr.op = CCobInstr::OP_UNKNOWN;
+				instr.len = 1;
+				instr.a = opcode;
+				break;
+			}
+
+			// what the raw CALL was rewritten into on first execution
+			if (opcode == CALL && scriptNames[instr.a].find("lua_") == 0) {
+				instr.op = CCobInstr::OP_LUA_CALL;
+				break;
+			}
+
+			// do not call zero-length functions
+			if (scriptLengths[instr.a] == 0) {
+				instr.op = CCobInstr::OP_NOP;
+				break;
+			}
+
+			instr.c = IsValidAddr(scriptOffsets[instr.a])? scriptOffsets[instr.a]: numWords;
+		} break;
+		case CCobInstr::OP_START: {
+			if (!IsValidFunc(instr.a)) {
+				instr.op = CCobInstr::OP_UNKNOWN;
+				instr.len = 1;
+				instr.a = opcode;
+				break;
+			}
+
+			if (scriptLengths[instr.a] == 0)
+				instr.op = CCobInstr::OP_NOP;
+		} break;
+
+		case CCobInstr::OP_JUMP:
+		case CCobInstr::OP_JUMP_NOT_EQUAL: {
+			// land on the end-of-code entry, which fails like reading there would
+			instr.a = IsValidAddr(instr.a)? instr.a: numWords;
+		} break;
+
+		case CCobInstr::OP_PUSH_STATIC: {
+			if (static_cast<unsigned int>(instr.a) >= static_cast<unsigned int>(numStaticVars))
+				instr.op = CCobInstr::OP_NOP;
+		} break;
+		case CCobInstr::OP_POP_STATIC: {
+			if (static_cast<unsigned int>(instr.a) >= static_cast<unsigned int>(numStaticVars))
+				instr.op = CCobInstr::OP_POP_STACK;
+		} break;
+
+		default: {
+		} break;
+	}
+
+	return instr;
 }
 
 
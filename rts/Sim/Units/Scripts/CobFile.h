@@ -4,6 +4,7 @@
 #define COB_FILE_H
 
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -13,6 +14,95 @@
 
 class CFileHandler;
 
+/**
+ * Pre-decoded form of the instruction starting at some word of CCobFile::code,
+ * operands resolved wherever they can be at load time (calls, jump targets,
+ * static variable indices).
+ */
+struct CCobInstr
+{
+	enum Op {
+		// pc past the end of the code, or an instruction running past it
+		OP_END_OF_CODE,
+		OP_UNKNOWN,
+		OP_NOP,
+
+		OP_MOVE,
+		OP_TURN,
+		OP_SPIN,
+		OP_STOP_SPIN,
+		OP_SHOW,
+		OP_HIDE,
+		OP_MOVE_NOW,
+		OP_TURN_NOW,
+		OP_EMIT_SFX,
+
+		OP_WAIT_TURN,
+		OP_WAIT_MOVE,
+		OP_SLEEP,
+
+		OP_PUSH_CONSTANT,
+		OP_PUSH_LOCAL_VAR,
+		OP_PUSH_STATIC,
+		OP_CREATE_LOCAL_VAR,
+		OP_POP_LOCAL_VAR,
+		OP_POP_STATIC,
+		OP_POP_STACK,
+
+		OP_ADD,
+		OP_SUB,
+		OP_MUL,
+		OP_DIV,
+		OP_MOD,
+		OP_BITWISE_AND,
+		OP_BITWISE_OR,
+		OP_BITWISE_XOR,
+		OP_BITWISE_NOT,
+
+		OP_RAND,
+		OP_GET_UNIT_VALUE,
+		OP_GET,
+
+		OP_SET_LESS,
+		OP_SET_LESS_OR_EQUAL,
+		OP_SET_GREATER,
+		OP_SET_GREATER_OR_EQUAL,
+		OP_SET_EQUAL,
+		OP_SET_NOT_EQUAL,
+		OP_LOGICAL_AND,
+		OP_LOGICAL_OR,
+		OP_LOGICAL_XOR,
+		OP_LOGICAL_NOT,
+
+		OP_START,
+		OP_CALL,
+		OP_LUA_CALL,
+		OP_JUMP,
+		OP_RETURN,
+		OP_JUMP_NOT_EQUAL,
+		OP_SIGNAL,
+		OP_SET_SIGNAL_MASK,
+
+		OP_EXPLODE,
+		OP_PLAY_SOUND,
+
+		OP_SET,
+		OP_ATTACH,
+		OP_DROP,
+
+		OP_COUNT
+	};
+
+	std::int16_t op = OP_END_OF_CODE;
+	/// words taken up by opcode and operands
+	std::int16_t len = 1;
+
+	int a = 0;
+	int b = 0;
+	int c = 0;
+};
+
+
 class CCobFile
 {
 public:
@@ -23,6 +113,7 @@ public:
 		numStaticVars = f.numStaticVars;
 
 		code = std::move(f.code);
+		instrs = std::move(f.instrs);
 		scriptNames = std::move(f.scriptNames);
 		scriptOffsets = std::move(f.scriptOffsets);
 
@@ -32,6 +123,7 @@ public:
 		sounds = std::move(f.sounds);
 		luaScripts = std::move(f.luaScripts);
 		scriptMap = std::move(f.scriptMap);
+		flareScripts = std::move(f.flareScripts);
 
 		name = std::move(f.name);
 		return *this;
@@ -39,10 +131,16 @@ public:
 
 	int GetFunctionId(const std::string& name);
 
+private:
+	void DecodeCode();
+	CCobInstr DecodeInstr(int pos) const;
+
 public:
 	int numStaticVars = 0;
 
 	std::vector<int> code;
+	/// one entry per word of code plus the end, so any jump target is decoded
+	std::vector<CCobInstr> instrs;
 	std::vector<std::string> scriptNames;
 	std::vector<int> scriptOffsets;
 	/// Assumes that the scripts are sorted by offset in the file
@@ -52,6 +150,8 @@ public:
 	std::vector<int> sounds;
 	std::vector<LuaHashString> luaScripts;
 	spring::unordered_map<std::string, int> scriptMap;
+	/// per script, whether SHOW emits a flare (weapon fire scripts)
+	std::vector<bool> flareScripts;
 
 	std::string name;
 };
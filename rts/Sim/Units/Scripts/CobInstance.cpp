@@ -85,6 +85,13 @@ void CCobInstance::PostLoad()
 
 		t->cobInst = this;
 		t->cobFile = cobFile;
+
+		if (t->CheckLoaded())
+			continue;
+
+		// script changed since the game was saved, or a corrupt savegame
+		LOG_L(L_ERROR, "[CobInstance::%s] thread %d of %s has code addresses out of range, killing it", __func__, threadID, cobFile->name.c_str());
+		t->SetState(CCobThread::Dead);
 	}
 
 	Init();
@@ -8,6 +8,8 @@
 #include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Misc/GlobalSynced.h"
 
+#include <stdexcept>
+
 CR_BIND(CCobThread, )
 
 CR_REG_METADATA(CCobThread, (
@@ -198,86 +200,6 @@ void CCobThread::InitStack(unsigned int n, CCobThread* t)
 
 
 
-// Command documentation from http://visualta.tauniverse.com/Downloads/cob-commands.txt
-// And some information from basm0.8 source (basm ops.txt)
-
-// Model interaction
-constexpr int MOVE       = 0x10001000;
-constexpr int TURN       = 0x10002000;
-constexpr int SPIN       = 0x10003000;
-constexpr int STOP_SPIN  = 0x10004000;
-constexpr int SHOW       = 0x10005000;
-constexpr int HIDE       = 0x10006000;
-constexpr int CACHE      = 0x10007000;
-constexpr int DONT_CACHE = 0x10008000;
-constexpr int MOVE_NOW   = 0x1000B000;
-constexpr int TURN_NOW   = 0x1000C000;
-constexpr int SHADE      = 0x1000D000;
-constexpr int DONT_SHADE = 0x1000E000;
-constexpr int EMIT_SFX   = 0x1000F000;
-
-// Blocking operations
-constexpr int WAIT_TURN  = 0x10011000;
-constexpr int WAIT_MOVE  = 0x10012000;
-constexpr int SLEEP      = 0x10013000;
-
-// Stack manipulation
-constexpr int PUSH_CONSTANT    = 0x10021001;
-constexpr int PUSH_LOCAL_VAR   = 0x10021002;
-constexpr int PUSH_STATIC      = 0x10021004;
-constexpr int CREATE_LOCAL_VAR = 0x10022000;
-constexpr int POP_LOCAL_VAR    = 0x10023002;
-constexpr int POP_STATIC       = 0x10023004;
-constexpr int POP_STACK        = 0x10024000; ///< Not sure what this is supposed to do
-
-// Arithmetic operations
-constexpr int ADD         = 0x10031000;
-constexpr int SUB         = 0x10032000;
-constexpr int MUL         = 0x10033000;
-constexpr int DIV         = 0x10034000;
-constexpr int MOD		  = 0x10034001; ///< spring specific
-constexpr int BITWISE_AND = 0x10035000;
-constexpr int BITWISE_OR  = 0x10036000;
-constexpr int BITWISE_XOR = 0x10037000;
-constexpr int BITWISE_NOT = 0x10038000;
-
-// Native function calls
-constexpr int RAND           = 0x10041000;
-constexpr int GET_UNIT_VALUE = 0x10042000;
-constexpr int GET            = 0x10043000;
-
-// Comparison
-constexpr int SET_LESS             = 0x10051000;
-constexpr int SET_LESS_OR_EQUAL    = 0x10052000;
-constexpr int SET_GREATER          = 0x10053000;
-constexpr int SET_GREATER_OR_EQUAL = 0x10054000;
-constexpr int SET_EQUAL            = 0x10055000;
-constexpr int SET_NOT_EQUAL        = 0x10056000;
-constexpr int LOGICAL_AND          = 0x10057000;
-constexpr int LOGICAL_OR           = 0x10058000;
-constexpr int LOGICAL_XOR          = 0x10059000;
-constexpr int LOGICAL_NOT          = 0x1005A000;
-
-// Flow control
-constexpr int START           = 0x10061000;
-constexpr int CALL            = 0x10062000; ///< converted when executed
-constexpr int REAL_CALL       = 0x10062001; ///< spring custom
-constexpr int LUA_CALL        = 0x10062002; ///< spring custom
-constexpr int JUMP            = 0x10064000;
-constexpr int RETURN          = 0x10065000;
-constexpr int JUMP_NOT_EQUAL  = 0x10066000;
-constexpr int SIGNAL          = 0x10067000;
-constexpr int SET_SIGNAL_MASK = 0x10068000;
-
-// Piece destruction
-constexpr int EXPLODE    = 0x10071000;
-constexpr int PLAY_SOUND = 0x10072000;
-
-// Special functions
-constexpr int SET    = 0x10082000;
-constexpr int ATTACH = 0x10083000;
-constexpr int DROP   = 0x10084000;
-
 // Indices for SET, GET, and GET_UNIT_VALUE for LUA return values
 #define LUA0 110 // (LUA0 returns the lua call status, 0 or 1)
 #define LUA1 111
@@ -290,89 +212,42 @@ constexpr int DROP   = 0x10084000;
 #define LUA8 118
 #define LUA9 119
 
-#if 0
-#define GET_LONG_PC() (cobFile->code[pc++])
-#else
-// mantis #5981
-#define GET_LONG_PC() (cobFile->code.at(pc++))
-#endif
 
+#if defined(__GNUC__)
+// GCC and clang support taking the address of a label; dispatching through
+// a table from the end of every handler gives each its own indirect branch
+// (and prediction history) instead of funneling all through one switch
+#define COB_COMPUTED_GOTO
+#endif
 
-#if 0
-static const char* GetOpcodeName(int opcode)
-{
-	switch (opcode) {
-		case MOVE: return "move";
-		case TURN: return "turn";
-		case SPIN: return "spin";
-		case STOP_SPIN: return "stop-spin";
-		case SHOW: return "show";
-		case HIDE: return "hide";
-		case CACHE: return "cache";
-		case DONT_CACHE: return "dont-cache";
-		case TURN_NOW: return "turn-now";
-		case MOVE_NOW: return "move-now";
-		case SHADE: return "shade";
-		case DONT_SHADE: return "dont-shade";
-		case EMIT_SFX: return "sfx";
-
-		case WAIT_TURN: return "wait-for-turn";
-		case WAIT_MOVE: return "wait-for-move";
-		case SLEEP: return "sleep";
-
-		case PUSH_CONSTANT: return "pushc";
-		case PUSH_LOCAL_VAR: return "pushl";
-		case PUSH_STATIC: return "pushs";
-		case CREATE_LOCAL_VAR: return "clv";
-		case POP_LOCAL_VAR: return "popl";
-		case POP_STATIC: return "pops";
-		case POP_STACK: return "pop-stack";
-
-		case ADD: return "add";
-		case SUB: return "sub";
-		case MUL: return "mul";
-		case DIV: return "div";
-		case MOD: return "mod";
-		case BITWISE_AND: return "and";
-		case BITWISE_OR: return "or";
-		case BITWISE_XOR: return "xor";
-		case BITWISE_NOT: return "not";
-
-		case RAND: return "rand";
-		case GET_UNIT_VALUE: return "getuv";
-		case GET: return "get";
-
-		case SET_LESS: return "setl";
-		case SET_LESS_OR_EQUAL: return "setle";
-		case SET_GREATER: return "setg";
-		case SET_GREATER_OR_EQUAL: return "setge";
-		case SET_EQUAL: return "sete";
-		case SET_NOT_EQUAL: return "setne";
-		case LOGICAL_AND: return "land";
-		case LOGICAL_OR: return "lor";
-		case LOGICAL_XOR: return "lxor";
-		case LOGICAL_NOT: return "neg";
-
-		case START: return "start";
-		case CALL: return "call";
-		case REAL_CALL: return "call";
-		case LUA_CALL: return "lua_call";
-		case JUMP: return "jmp";
-		case RETURN: return "return";
-		case JUMP_NOT_EQUAL: return "jne";
-		case SIGNAL: return "signal";
-		case SET_SIGNAL_MASK: return "mask";
-
-		case EXPLODE: return "explode";
-		case PLAY_SOUND: return "play-sound";
-
-		case SET: return "set";
-		case ATTACH: return "attach";
-		case DROP: return "drop";
-	}
+#ifdef PROFILE
+	#define COB_COUNT_INSTR() (counter.numInstrs += 1)
+#else
+	#define COB_COUNT_INSTR()
+#endif
 
-	return "unknown";
-}
+#ifdef COB_COMPUTED_GOTO
+	#define COB_OP(name) op_##name
+	#define COB_DISPATCH()                  \
+		do {                                \
+			instr = &instrs[ip];            \
+			pc = (ip += instr->len);        \
+			COB_COUNT_INSTR();              \
+			goto *dispatchTable[instr->op]; \
+		} while (false)
+	// anything calling out of the interpreter can end up killing or
+	// suspending this thread (e.g. through CCobInstance::Signal), the
+	// other handlers go straight to the next instruction
+	#define COB_NEXT()            \
+		do {                      \
+			if (state != Run)     \
+				goto tick_done;   \
+			COB_DISPATCH();       \
+		} while (false)
+#else
+	#define COB_OP(name) case CCobInstr::name
+	#define COB_DISPATCH() continue
+	#define COB_NEXT() continue
 #endif
 
 
@@ -386,39 +261,132 @@ bool CCobThread::Tick()
 
 	state = Run;
 
+	#ifdef PROFILE
+	// flushed on every way out, including the early returns
+	struct InstrCounter {
+		~InstrCounter() { cobEngine->AddExecutedInstrs(numInstrs); }
+		unsigned int numInstrs = 0;
+	} counter;
+	#endif
+
+	// decoded jumps and calls always stay within instrs, the entry point
+	// is the only pc that has to be checked (savegames go through CheckLoaded)
+	if (static_cast<size_t>(pc) >= cobFile->instrs.size())
+		throw std::out_of_range("[COBThread::Tick] pc out of range");
+
+	const CCobInstr* instrs = cobFile->instrs.data();
+	const CCobInstr* instr = nullptr;
+
+	// jumps and calls only ever change ip and the next dispatch stores it,
+	// so pc is always up to date for ShowError while never being read back
+	int ip = pc;
+
 	int r1, r2, r3, r4, r5, r6;
 
+#ifdef COB_COMPUTED_GOTO
+	// same order as CCobInstr::Op
+	static const void* dispatchTable[] = {
+		&&COB_OP(OP_END_OF_CODE),
+		&&COB_OP(OP_UNKNOWN),
+		&&COB_OP(OP_NOP),
+
+		&&COB_OP(OP_MOVE),
+		&&COB_OP(OP_TURN),
+		&&COB_OP(OP_SPIN),
+		&&COB_OP(OP_STOP_SPIN),
+		&&COB_OP(OP_SHOW),
+		&&COB_OP(OP_HIDE),
+		&&COB_OP(OP_MOVE_NOW),
+		&&COB_OP(OP_TURN_NOW),
+		&&COB_OP(OP_EMIT_SFX),
+
+		&&COB_OP(OP_WAIT_TURN),
+		&&COB_OP(OP_WAIT_MOVE),
+		&&COB_OP(OP_SLEEP),
+
+		&&COB_OP(OP_PUSH_CONSTANT),
+		&&COB_OP(OP_PUSH_LOCAL_VAR),
+		&&COB_OP(OP_PUSH_STATIC),
+		&&COB_OP(OP_CREATE_LOCAL_VAR),
+		&&COB_OP(OP_POP_LOCAL_VAR),
+		&&COB_OP(OP_POP_STATIC),
+		&&COB_OP(OP_POP_STACK),
+
+		&&COB_OP(OP_ADD),
+		&&COB_OP(OP_SUB),
+		&&COB_OP(OP_MUL),
+		&&COB_OP(OP_DIV),
+		&&COB_OP(OP_MOD),
+		&&COB_OP(OP_BITWISE_AND),
+		&&COB_OP(OP_BITWISE_OR),
+		&&COB_OP(OP_BITWISE_XOR),
+		&&COB_OP(OP_BITWISE_NOT),
+
+		&&COB_OP(OP_RAND),
+		&&COB_OP(OP_GET_UNIT_VALUE),
+		&&COB_OP(OP_GET),
+
+		&&COB_OP(OP_SET_LESS),
+		&&COB_OP(OP_SET_LESS_OR_EQUAL),
+		&&COB_OP(OP_SET_GREATER),
+		&&COB_OP(OP_SET_GREATER_OR_EQUAL),
+		&&COB_OP(OP_SET_EQUAL),
+		&&COB_OP(OP_SET_NOT_EQUAL),
+		&&COB_OP(OP_LOGICAL_AND),
+		&&COB_OP(OP_LOGICAL_OR),
+		&&COB_OP(OP_LOGICAL_XOR),
+		&&COB_OP(OP_LOGICAL_NOT),
+
+		&&COB_OP(OP_START),
+		&&COB_OP(OP_CALL),
+		&&COB_OP(OP_LUA_CALL),
+		&&COB_OP(OP_JUMP),
+		&&COB_OP(OP_RETURN),
+		&&COB_OP(OP_JUMP_NOT_EQUAL),
+		&&COB_OP(OP_SIGNAL),
+		&&COB_OP(OP_SET_SIGNAL_MASK),
+
+		&&COB_OP(OP_EXPLODE),
+		&&COB_OP(OP_PLAY_SOUND),
+
+		&&COB_OP(OP_SET),
+		&&COB_OP(OP_ATTACH),
+		&&COB_OP(OP_DROP),
+	};
+
+	static_assert((sizeof(dispatchTable) / sizeof(dispatchTable[0])) == CCobInstr::OP_COUNT, "");
+
+	COB_DISPATCH();
+#else
 	while (state == Run) {
-		const int opcode = GET_LONG_PC();
+		instr = &instrs[ip];
+		pc = (ip += instr->len);
+		COB_COUNT_INSTR();
 
-		switch (opcode) {
-			case PUSH_CONSTANT: {
-				r1 = GET_LONG_PC();
-				PushDataStack(r1);
-			} break;
-			case SLEEP: {
+		switch (instr->op) {
+#endif
+			COB_OP(OP_PUSH_CONSTANT): {
+				PushDataStack(instr->a);
+			} COB_DISPATCH();
+			COB_OP(OP_SLEEP): {
 				r1 = PopDataStack();
 				wakeTime = cobEngine->GetCurrentTime() + r1;
 				state = Sleep;
 
 				cobEngine->ScheduleThread(this);
 				return true;
-			} break;
-			case SPIN: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
+			} COB_NEXT();
+			COB_OP(OP_SPIN): {
 				r3 = PopDataStack();         // speed
 				r4 = PopDataStack();         // accel
-				cobInst->Spin(r1, r2, r3, r4);
-			} break;
-			case STOP_SPIN: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
+				cobInst->Spin(instr->a, instr->b, r3, r4);
+			} COB_NEXT();
+			COB_OP(OP_STOP_SPIN): {
 				r3 = PopDataStack();         // decel
 
-				cobInst->StopSpin(r1, r2, r3);
-			} break;
-			case RETURN: {
+				cobInst->StopSpin(instr->a, instr->b, r3);
+			} COB_NEXT();
+			COB_OP(OP_RETURN): {
 				retCode = PopDataStack();
 
 				if (LocalReturnAddr() == -1) {
@@ -430,254 +398,196 @@ bool CCobThread::Tick()
 				}
 
 				// return to caller
-				pc = LocalReturnAddr();
+				ip = LocalReturnAddr();
 				dataStackSize = std::min(dataStackSize, LocalStackFrame());
 				callStackSize -= 1;
-			} break;
-
-
-			case SHADE: {
-				r1 = GET_LONG_PC();
-			} break;
-			case DONT_SHADE: {
-				r1 = GET_LONG_PC();
-			} break;
-			case CACHE: {
-				r1 = GET_LONG_PC();
-			} break;
-			case DONT_CACHE: {
-				r1 = GET_LONG_PC();
-			} break;
-
-
-			case CALL: {
-				r1 = GET_LONG_PC();
-				pc--;
-
-				if (cobFile->scriptNames[r1].find("lua_") == 0) {
-					cobFile->code[pc - 1] = LUA_CALL;
-					LuaCall();
-					break;
-				}
+			} COB_DISPATCH();
 
-				cobFile->code[pc - 1] = REAL_CALL;
 
-				// fall-through
-			}
-			case REAL_CALL: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
+			// SHADE, CACHE, ..., and calls or starts of zero-length functions
+			COB_OP(OP_NOP): {
+			} COB_DISPATCH();
 
-				// do not call zero-length functions
-				if (cobFile->scriptLengths[r1] == 0)
-					break;
 
+			COB_OP(OP_CALL): {
 				CallInfo& ci = PushCallStackRef();
-				ci.functionId = r1;
-				ci.returnAddr = pc;
-				ci.stackTop = dataStackSize - r2;
-
-				paramCount = r2;
+				ci.functionId = instr->a;
+				ci.returnAddr = ip;
+				ci.stackTop = dataStackSize - instr->b;
 
-				// call cobFile->scriptNames[r1]
-				pc = cobFile->scriptOffsets[r1];
-			} break;
-			case LUA_CALL: {
-				LuaCall();
-			} break;
+				paramCount = instr->b;
 
+				// call cobFile->scriptNames[instr->a]
+				ip = instr->c;
+			} COB_DISPATCH();
+			COB_OP(OP_LUA_CALL): {
+				LuaCall(instr->a, instr->b);
+			} COB_NEXT();
 
-			case POP_STATIC: {
-				r1 = GET_LONG_PC();
-				r2 = PopDataStack();
 
-				if (static_cast<size_t>(r1) < cobInst->staticVars.size())
-					cobInst->staticVars[r1] = r2;
-			} break;
-			case POP_STACK: {
+			COB_OP(OP_POP_STATIC): {
+				// index was checked when decoding
+				cobInst->staticVars[instr->a] = PopDataStack();
+			} COB_DISPATCH();
+			COB_OP(OP_POP_STACK): {
 				PopDataStack();
-			} break;
+			} COB_DISPATCH();
 
 
-			case START: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
+			COB_OP(OP_START): {
+				StartChild(instr->a, instr->b);
+			} COB_DISPATCH();
 
-				if (cobFile->scriptLengths[r1] == 0)
-					break;
-
-
-				CCobThread t(cobInst);
-
-				t.SetID(cobEngine->GenThreadID());
-				t.InitStack(r2, this);
-				t.Start(r1, signalMask, {{0}}, true);
-
-				// calling AddThread directly might move <this>, defer it
-				cobEngine->QueueAddThread(std::move(t));
-			} break;
-
-			case CREATE_LOCAL_VAR: {
+			COB_OP(OP_CREATE_LOCAL_VAR): {
 				if (paramCount == 0) {
 					PushDataStack(0);
 				} else {
 					paramCount--;
 				}
-			} break;
-			case GET_UNIT_VALUE: {
+			} COB_DISPATCH();
+			COB_OP(OP_GET_UNIT_VALUE): {
 				r1 = PopDataStack();
 				if ((r1 >= LUA0) && (r1 <= LUA9)) {
 					PushDataStack(luaArgs[r1 - LUA0]);
-					break;
+					COB_NEXT();
 				}
 				r1 = cobInst->GetUnitVal(r1, 0, 0, 0, 0);
 				PushDataStack(r1);
-			} break;
+			} COB_NEXT();
 
 
-			case JUMP_NOT_EQUAL: {
-				r1 = GET_LONG_PC();
+			COB_OP(OP_JUMP_NOT_EQUAL): {
 				r2 = PopDataStack();
 
 				if (r2 == 0)
-					pc = r1;
+					ip = instr->a;
 
-			} break;
-			case JUMP: {
-				r1 = GET_LONG_PC();
+			} COB_DISPATCH();
+			COB_OP(OP_JUMP): {
 				// this seem to be an error in the docs..
 				//r2 = cobFile->scriptOffsets[LocalFunctionID()] + r1;
-				pc = r1;
-			} break;
+				ip = instr->a;
+			} COB_DISPATCH();
 
 
-			case POP_LOCAL_VAR: {
-				r1 = GET_LONG_PC();
+			COB_OP(OP_POP_LOCAL_VAR): {
 				r2 = PopDataStack();
-				dataStack[LocalStackFrame() + r1] = r2;
-			} break;
-			case PUSH_LOCAL_VAR: {
-				r1 = GET_LONG_PC();
-				r2 = dataStack[LocalStackFrame() + r1];
+				dataStack[LocalStackFrame() + instr->a] = r2;
+			} COB_DISPATCH();
+			COB_OP(OP_PUSH_LOCAL_VAR): {
+				r2 = dataStack[LocalStackFrame() + instr->a];
 				PushDataStack(r2);
-			} break;
+			} COB_DISPATCH();
 
 
-			case BITWISE_AND: {
+			COB_OP(OP_BITWISE_AND): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 				PushDataStack(r1 & r2);
-			} break;
-			case BITWISE_OR: {
+			} COB_DISPATCH();
+			COB_OP(OP_BITWISE_OR): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 				PushDataStack(r1 | r2);
-			} break;
-			case BITWISE_XOR: {
+			} COB_DISPATCH();
+			COB_OP(OP_BITWISE_XOR): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 				PushDataStack(r1 ^ r2);
-			} break;
-			case BITWISE_NOT: {
+			} COB_DISPATCH();
+			COB_OP(OP_BITWISE_NOT): {
 				r1 = PopDataStack();
 				PushDataStack(~r1);
-			} break;
+			} COB_DISPATCH();
 
-			case EXPLODE: {
-				r1 = GET_LONG_PC();
+			COB_OP(OP_EXPLODE): {
 				r2 = PopDataStack();
-				cobInst->Explode(r1, r2);
-			} break;
+				cobInst->Explode(instr->a, r2);
+			} COB_NEXT();
 
-			case PLAY_SOUND: {
-				r1 = GET_LONG_PC();
+			COB_OP(OP_PLAY_SOUND): {
 				r2 = PopDataStack();
-				cobInst->PlayUnitSound(r1, r2);
-			} break;
-
-			case PUSH_STATIC: {
-				r1 = GET_LONG_PC();
+				cobInst->PlayUnitSound(instr->a, r2);
+			} COB_NEXT();
 
-				if (static_cast<size_t>(r1) < cobInst->staticVars.size())
-					PushDataStack(cobInst->staticVars[r1]);
-			} break;
+			COB_OP(OP_PUSH_STATIC): {
+				// index was checked when decoding
+				PushDataStack(cobInst->staticVars[instr->a]);
+			} COB_DISPATCH();
 
-			case SET_NOT_EQUAL: {
+			COB_OP(OP_SET_NOT_EQUAL): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 
 				PushDataStack(int(r1 != r2));
-			} break;
-			case SET_EQUAL: {
+			} COB_DISPATCH();
+			COB_OP(OP_SET_EQUAL): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 
 				PushDataStack(int(r1 == r2));
-			} break;
+			} COB_DISPATCH();
 
-			case SET_LESS: {
+			COB_OP(OP_SET_LESS): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 
 				PushDataStack(int(r1 < r2));
-			} break;
-			case SET_LESS_OR_EQUAL: {
+			} COB_DISPATCH();
+			COB_OP(OP_SET_LESS_OR_EQUAL): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 
 				PushDataStack(int(r1 <= r2));
-			} break;
+			} COB_DISPATCH();
 
-			case SET_GREATER: {
+			COB_OP(OP_SET_GREATER): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 
 				PushDataStack(int(r1 > r2));
-			} break;
-			case SET_GREATER_OR_EQUAL: {
+			} COB_DISPATCH();
+			COB_OP(OP_SET_GREATER_OR_EQUAL): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 
 				PushDataStack(int(r1 >= r2));
-			} break;
+			} COB_DISPATCH();
 
-			case RAND: {
+			COB_OP(OP_RAND): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 				r3 = gsRNG.NextInt(r2 - r1 + 1) + r1;
 				PushDataStack(r3);
-			} break;
-			case EMIT_SFX: {
+			} COB_DISPATCH();
+			COB_OP(OP_EMIT_SFX): {
 				r1 = PopDataStack();
-				r2 = GET_LONG_PC();
-				cobInst->EmitSfx(r1, r2);
-			} break;
-			case MUL: {
+				cobInst->EmitSfx(r1, instr->a);
+			} COB_NEXT();
+			COB_OP(OP_MUL): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 				PushDataStack(r1 * r2);
-			} break;
+			} COB_DISPATCH();
 
 
-			case SIGNAL: {
+			COB_OP(OP_SIGNAL): {
 				r1 = PopDataStack();
 				cobInst->Signal(r1);
-			} break;
-			case SET_SIGNAL_MASK: {
+			} COB_NEXT();
+			COB_OP(OP_SET_SIGNAL_MASK): {
 				r1 = PopDataStack();
 				signalMask = r1;
-			} break;
+			} COB_DISPATCH();
 
 
-			case TURN: {
+			COB_OP(OP_TURN): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
-				r3 = GET_LONG_PC(); // piece
-				r4 = GET_LONG_PC(); // axis
 
-				cobInst->Turn(r3, r4, r1, r2);
-			} break;
-			case GET: {
+				cobInst->Turn(instr->a, instr->b, r1, r2);
+			} COB_NEXT();
+			COB_OP(OP_GET): {
 				r5 = PopDataStack();
 				r4 = PopDataStack();
 				r3 = PopDataStack();
@@ -685,24 +595,24 @@ bool CCobThread::Tick()
 				r1 = PopDataStack();
 				if ((r1 >= LUA0) && (r1 <= LUA9)) {
 					PushDataStack(luaArgs[r1 - LUA0]);
-					break;
+					COB_NEXT();
 				}
 				r6 = cobInst->GetUnitVal(r1, r2, r3, r4, r5);
 				PushDataStack(r6);
-			} break;
-			case ADD: {
+			} COB_NEXT();
+			COB_OP(OP_ADD): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 				PushDataStack(r1 + r2);
-			} break;
-			case SUB: {
+			} COB_DISPATCH();
+			COB_OP(OP_SUB): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 				r3 = r1 - r2;
 				PushDataStack(r3);
-			} break;
+			} COB_DISPATCH();
 
-			case DIV: {
+			COB_OP(OP_DIV): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 
@@ -713,8 +623,8 @@ bool CCobThread::Tick()
 					ShowError("division by zero");
 				}
 				PushDataStack(r3);
-			} break;
-			case MOD: {
+			} COB_DISPATCH();
+			COB_OP(OP_MOD): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 
@@ -724,145 +634,168 @@ bool CCobThread::Tick()
 					PushDataStack(0);
 					ShowError("modulo division by zero");
 				}
-			} break;
+			} COB_DISPATCH();
 
 
-			case MOVE: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
+			COB_OP(OP_MOVE): {
 				r4 = PopDataStack();
 				r3 = PopDataStack();
-				cobInst->Move(r1, r2, r3, r4);
-			} break;
-			case MOVE_NOW: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
+				cobInst->Move(instr->a, instr->b, r3, r4);
+			} COB_NEXT();
+			COB_OP(OP_MOVE_NOW): {
 				r3 = PopDataStack();
-				cobInst->MoveNow(r1, r2, r3);
-			} break;
-			case TURN_NOW: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
+				cobInst->MoveNow(instr->a, instr->b, r3);
+			} COB_NEXT();
+			COB_OP(OP_TURN_NOW): {
 				r3 = PopDataStack();
-				cobInst->TurnNow(r1, r2, r3);
-			} break;
+				cobInst->TurnNow(instr->a, instr->b, r3);
+			} COB_NEXT();
 
 
-			case WAIT_TURN: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
-
-				if (cobInst->NeedsWait(CCobInstance::ATurn, r1, r2)) {
+			COB_OP(OP_WAIT_TURN): {
+				if (cobInst->NeedsWait(CCobInstance::ATurn, instr->a, instr->b)) {
 					state = WaitTurn;
-					waitPiece = r1;
-					waitAxis = r2;
+					waitPiece = instr->a;
+					waitAxis = instr->b;
 					return true;
 				}
-			} break;
-			case WAIT_MOVE: {
-				r1 = GET_LONG_PC();
-				r2 = GET_LONG_PC();
-
-				if (cobInst->NeedsWait(CCobInstance::AMove, r1, r2)) {
+			} COB_NEXT();
+			COB_OP(OP_WAIT_MOVE): {
+				if (cobInst->NeedsWait(CCobInstance::AMove, instr->a, instr->b)) {
 					state = WaitMove;
-					waitPiece = r1;
-					waitAxis = r2;
+					waitPiece = instr->a;
+					waitAxis = instr->b;
 					return true;
 				}
-			} break;
+			} COB_NEXT();
 
 
-			case SET: {
+			COB_OP(OP_SET): {
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 
 				if ((r1 >= LUA0) && (r1 <= LUA9)) {
 					luaArgs[r1 - LUA0] = r2;
-					break;
+					COB_NEXT();
 				}
 
 				cobInst->SetUnitVal(r1, r2);
-			} break;
+			} COB_NEXT();
 
 
-			case ATTACH: {
+			COB_OP(OP_ATTACH): {
 				r3 = PopDataStack();
 				r2 = PopDataStack();
 				r1 = PopDataStack();
 				cobInst->AttachUnit(r2, r1);
-			} break;
-			case DROP: {
+			} COB_NEXT();
+			COB_OP(OP_DROP): {
 				r1 = PopDataStack();
 				cobInst->DropUnit(r1);
-			} break;
+			} COB_NEXT();
 
 			// like bitwise ops, but only on values 1 and 0
-			case LOGICAL_NOT: {
+			COB_OP(OP_LOGICAL_NOT): {
 				r1 = PopDataStack();
 				PushDataStack(int(r1 == 0));
-			} break;
-			case LOGICAL_AND: {
+			} COB_DISPATCH();
+			COB_OP(OP_LOGICAL_AND): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 				PushDataStack(int(r1 && r2));
-			} break;
-			case LOGICAL_OR: {
+			} COB_DISPATCH();
+			COB_OP(OP_LOGICAL_OR): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 				PushDataStack(int(r1 || r2));
-			} break;
-			case LOGICAL_XOR: {
+			} COB_DISPATCH();
+			COB_OP(OP_LOGICAL_XOR): {
 				r1 = PopDataStack();
 				r2 = PopDataStack();
 				PushDataStack(int((!!r1) ^ (!!r2)));
-			} break;
-
-
-			case HIDE: {
-				r1 = GET_LONG_PC();
-				cobInst->SetVisibility(r1, false);
-			} break;
+			} COB_DISPATCH();
 
-			case SHOW: {
-				r1 = GET_LONG_PC();
 
-				int i;
-				for (i = 0; i < MAX_WEAPONS_PER_UNIT; ++i)
-					if (LocalFunctionID() == cobFile->scriptIndex[COBFN_FirePrimary + COBFN_Weapon_Funcs * i])
-						break;
+			COB_OP(OP_HIDE): {
+				cobInst->SetVisibility(instr->a, false);
+			} COB_NEXT();
 
+			COB_OP(OP_SHOW): {
 				// if true, we are in a Fire-script and should show a special flare effect
-				if (i < MAX_WEAPONS_PER_UNIT) {
-					cobInst->ShowFlare(r1);
+				if (cobFile->flareScripts[LocalFunctionID()]) {
+					cobInst->ShowFlare(instr->a);
 				} else {
-					cobInst->SetVisibility(r1, true);
+					cobInst->SetVisibility(instr->a, true);
 				}
-			} break;
+			} COB_NEXT();
 
-			default: {
+			COB_OP(OP_UNKNOWN): {
 				const char* name = cobFile->name.c_str();
 				const char* func = cobFile->scriptNames[LocalFunctionID()].c_str();
 
-				LOG_L(L_ERROR, "[COBThread::%s] unknown opcode %x (in %s:%s at %x)", __func__, opcode, name, func, pc - 1);
-
-				#if 0
-				auto ei = execTrace.begin();
-				while (ei != execTrace.end()) {
-					LOG_L(L_ERROR, "\tprogctr: %3x  opcode: %s", __func__, *ei, GetOpcodeName(cobFile->code[*ei]));
-					++ei;
-				}
-				#endif
+				LOG_L(L_ERROR, "[COBThread::%s] unknown opcode %x (in %s:%s at %x)", __func__, instr->a, name, func, pc - 1);
 
 				state = Dead;
 				return false;
-			} break;
+			} COB_NEXT();
+
+			COB_OP(OP_END_OF_CODE): {
+				// what reading the raw code past its end used to do, mantis #5981
+				throw std::out_of_range("[COBThread::Tick] code read out of range");
+			} COB_NEXT();
+#ifndef COB_COMPUTED_GOTO
 		}
 	}
+#else
+tick_done:
+#endif
 
 	// can arrive here as dead, through CCobInstance::Signal()
 	return (state != Dead);
 }
 
+#undef COB_NEXT
+#undef COB_DISPATCH
+#undef COB_OP
+#undef COB_COMPUTED_GOTO
+
+void CCobThread::StartChild(int functionId, int numArgs)
+{
+	// kept out of Tick, the thread object would bloat its stack frame
+	CCobThread t(cobInst);
+
+	t.SetID(cobEngine->GenThreadID());
+	t.InitStack(numArgs, this);
+	t.Start(functionId, signalMask, {{0}}, true);
+
+	// calling AddThread directly might move <this>, defer it
+	cobEngine->QueueAddThread(std::move(t));
+}
+
+bool CCobThread::CheckLoaded() const
+{
+	const size_t numInstrs = cobFile->instrs.size();
+
+	if (static_cast<size_t>(pc) >= numInstrs)
+		return false;
+	if (callStackSize < 0 || static_cast<size_t>(callStackSize) > callStack.size())
+		return false;
+	if (dataStackSize < 0 || static_cast<size_t>(dataStackSize) > dataStack.size())
+		return false;
+
+	// OP_RETURN jumps to these without further checks; frame 0 is read even when empty
+	for (int i = 0, n = std::max(callStackSize, 1); i < n; i++) {
+		const CallInfo& ci = callStack[i];
+
+		if (ci.returnAddr != -1 && static_cast<size_t>(ci.returnAddr) >= numInstrs)
+			return false;
+		if (static_cast<size_t>(ci.functionId) >= cobFile->scriptNames.size())
+			return false;
+	}
+
+	return true;
+}
+
 void CCobThread::ShowError(const char* msg)
 {
 	if ((errorCounter = std::max(errorCounter - 1, 0)) == 0)
@@ -880,25 +813,22 @@ void CCobThread::ShowError(const char* msg)
 }
 
 
-void CCobThread::LuaCall()
+void CCobThread::LuaCall(int scriptId, int numArgs)
 {
-	const int r1 = GET_LONG_PC(); // script id
-	const int r2 = GET_LONG_PC(); // arg count
-
 	// setup the parameter array
 	const int size = dataStackSize;
-	const int argCount = std::min(r2, MAX_LUA_COB_ARGS);
-	const int start = std::max(0, size - r2);
+	const int argCount = std::min(numArgs, MAX_LUA_COB_ARGS);
+	const int start = std::max(0, size - numArgs);
 	const int end = std::min(size, start + argCount);
 
 	for (int a = 0, i = start; i < end; i++) {
 		luaArgs[a++] = dataStack[i];
 	}
 
-	if (r2 >= size) {
+	if (numArgs >= size) {
 		dataStackSize = 0;
 	} else {
-		dataStackSize = size - r2;
+		dataStackSize = size - numArgs;
 	}
 
 	if (!luaRules) {
@@ -907,13 +837,13 @@ void CCobThread::LuaCall()
 	}
 
 	// check script index validity
-	if (static_cast<size_t>(r1) >= cobFile->luaScripts.size()) {
+	if (static_cast<size_t>(scriptId) >= cobFile->luaScripts.size()) {
 		luaArgs[0] = 0; // failure
 		return;
 	}
 
 	int argsCount = argCount;
-	luaRules->Cob2Lua(cobFile->luaScripts[r1], cobInst->GetUnit(), argsCount, luaArgs);
+	luaRules->Cob2Lua(cobFile->luaScripts[scriptId], cobInst->GetUnit(), argsCount, luaArgs);
 	retCode = luaArgs[0];
 }
 
@@ -56,6 +56,12 @@ public:
 		cbType = cb;
 		cbParam = cbp;
 	}
+	/**
+	 * Checks that pc and the saved return addresses of a thread
+	 * restored from a savegame lie within cobFile's code.
+	 */
+	bool CheckLoaded() const;
+
 	void MakeGarbage() {
 		cobInst = nullptr;
 		cobFile = nullptr;
@@ -105,7 +111,8 @@ protected:
 		int stackTop = -1;
 	};
 
-	void LuaCall();
+	void LuaCall(int scriptId, int numArgs);
+	void StartChild(int functionId, int numArgs);
 
 	bool PushCallStack(CallInfo v) { return (callStackSize < callStack.size() && PushCallStackRaw(v)); }
 	bool PushDataStack(     int v) { return (dataStackSize < dataStack.size() && PushDataStackRaw(v)); }
@@ -65,6 +65,7 @@
 #include "System/creg/STL_List.h"
 #include "System/Sound/ISoundChannels.h"
 #include "System/Sync/SyncedPrimitive.h"
+#include "System/Threading/ThreadPool.h"
 
 #undef near
 
@@ -521,6 +522,12 @@ void CUnit::ForcedMove(const float3& newPos)
 	quadField.MovedUnit(this);
 }
 
+void CUnit::Move(const float3& v, bool relative)
+{
+	CSolidObject::Move(v, relative);
+	quadField.MovedUnitSpans(this);
+}
+
 
 
 float3 CUnit::GetErrorVector(int argAllyTeam) const
@@ -1040,6 +1047,32 @@ void CUnit::SlowUpdate()
 }
 
 
+// per-thread batch holding one target query per weapon of a unit
+static std::array<QuadFieldBatchQuery, ThreadPool::MAX_THREADS> weaponTargetBatches;
+
+void CUnit::PrepareSlowUpdateWeapons()
+{
+	if (!CanUpdateWeapons())
+		return;
+
+	QuadFieldBatchQuery& batch = weaponTargetBatches[ThreadPool::GetThreadNum()];
+
+	batch.Clear();
+
+	for (CWeapon* w: weapons) {
+		w->PrepareAutoTarget(batch);
+	}
+
+	if (batch.GetNumQueries() == 0)
+		return;
+
+	quadField.GetUnitsExact(batch);
+
+	for (CWeapon* w: weapons) {
+		w->GatherAutoTargets(batch);
+	}
+}
+
 void CUnit::SlowUpdateWeapons()
 {
 	if (!CanUpdateWeapons())
@@ -2806,6 +2839,7 @@ CR_REG_METADATA(CUnit, (
 	CR_MEMBER(losStatus),
 	CR_MEMBER(posErrorMask),
 	CR_MEMBER(quads),
+	CR_IGNORED(quadIndices),
 
 
 	CR_MEMBER(loadingTransportId),
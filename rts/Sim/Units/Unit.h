@@ -89,6 +89,8 @@ public:
 	void Deactivate();
 
 	void ForcedMove(const float3& newPos);
+	// hides CSolidObject::Move to keep the QuadField's unit spans current
+	void Move(const float3& v, bool relative);
 
 	void DeleteScript();
 	void EnableScriptMoveType();
@@ -177,6 +179,7 @@ public:
 
 	void UpdateWeapons();
 
+	void PrepareSlowUpdateWeapons();
 	void SlowUpdateWeapons();
 	void SlowUpdateKamikaze(bool scanForTargets);
 	void SlowUpdateCloak(bool stunCheck);
@@ -316,6 +319,8 @@ public:
 
 	// quads the unit is part of
 	std::vector<int> quads;
+	// per entry of quads: {index in Quad::units, index in Quad::teamUnits[allyteam]}
+	std::vector<int2> quadIndices;
 
 	std::vector<TransportedUnit> transportedUnits;
 	// incoming projectiles for which flares can cause retargeting
@@ -19,6 +19,7 @@
 #include "System/Log/ILog.h"
 #include "System/SpringMath.h"
 #include "System/TimeProfiler.h"
+#include "System/Threading/ThreadPool.h"
 #include "System/creg/STL_Deque.h"
 #include "System/creg/STL_Set.h"
 
@@ -301,6 +302,19 @@ void CUnitHandler::UpdateUnitMoveTypes()
 {
 	SCOPED_TIMER("Sim::Unit::MoveType");
 
+	{
+		SCOPED_TIMER("Sim::Unit::MoveType::PreMT");
+
+		// parallel phase; movetypes only read shared state and write their
+		// own scratch members here, so the result does not depend on which
+		// thread processes which unit and stays in sync across clients
+		for_mt(0, activeUnits.size(), [&](const int i) {
+			activeUnits[i]->moveType->UpdatePreMT();
+		});
+	}
+
+	// serial phase; all changes to unit positions, the quadfield and the
+	// blocking-map are applied here in activeUnits order
 	for (activeUpdateUnit = 0; activeUpdateUnit < activeUnits.size(); ++activeUpdateUnit) {
 		CUnit* unit = activeUnits[activeUpdateUnit];
 		AMoveType* moveType = unit->moveType;
@@ -340,6 +354,20 @@ void CUnitHandler::SlowUpdateUnits()
 	if ((gs->frameNum % UNIT_SLOWUPDATE_RATE) == 0)
 		activeSlowUpdateUnit = 0;
 
+	{
+		SCOPED_TIMER("Sim::Unit::SlowUpdate::WeaponsMT");
+
+		const size_t slowUpdateBeg = activeSlowUpdateUnit;
+		const size_t slowUpdateEnd = std::min(activeUnits.size(), slowUpdateBeg + (activeUnits.size() / UNIT_SLOWUPDATE_RATE) + 1);
+
+		// read-only weapon target scanning for all units in this frame's
+		// batch; the candidates are turned into targets in batch order by
+		// SlowUpdateWeapons (which runs all RNG, script and Lua calls)
+		for_mt(slowUpdateBeg, slowUpdateEnd, [&](const int i) {
+			activeUnits[i]->PrepareSlowUpdateWeapons();
+		});
+	}
+
 	// stagger the SlowUpdate's
 	for (size_t n = (activeUnits.size() / UNIT_SLOWUPDATE_RATE) + 1; (activeSlowUpdateUnit < activeUnits.size() && n != 0); ++activeSlowUpdateUnit) {
 		CUnit* unit = activeUnits[activeSlowUpdateUnit];
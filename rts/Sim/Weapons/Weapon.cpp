@@ -102,7 +102,11 @@ CR_REG_METADATA(CWeapon, (
 	CR_MEMBER(currentTarget),
 	CR_MEMBER(currentTargetPos),
 
-	CR_MEMBER(incomingProjectileIDs)
+	CR_MEMBER(incomingProjectileIDs),
+
+	CR_IGNORED(autoTargetCandidates),
+	CR_IGNORED(autoTargetCandidatesFrame),
+	CR_IGNORED(autoTargetQuery)
 ))
 
 
@@ -612,6 +616,36 @@ bool CWeapon::AllowWeaponAutoTarget() const
 	return (gs->frameNum > (lastTargetRetry + 65));
 }
 
+void CWeapon::PrepareAutoTarget(QuadFieldBatchQuery& batch)
+{
+	autoTargetQuery = -1;
+
+	// read-only subset of the AllowWeaponAutoTarget conditions; if AutoTarget
+	// still runs for a weapon skipped here (e.g. because Lua overrides these)
+	// it gathers candidates itself
+	if (weaponDef->noAutoTarget || noAutoTarget)
+		return;
+	if (owner->fireState < FIRESTATE_FIREATWILL)
+		return;
+	if (slavedTo != nullptr)
+		return;
+	if (weaponDef->interceptor)
+		return;
+	if (HaveTarget() && !avoidTarget && gs->frameNum <= (lastTargetRetry + 65))
+		return;
+
+	autoTargetQuery = CGameHelper::AddWeaponTargetQuery(this, batch);
+}
+
+void CWeapon::GatherAutoTargets(const QuadFieldBatchQuery& batch)
+{
+	if (autoTargetQuery < 0)
+		return;
+
+	CGameHelper::GatherWeaponTargets(this, batch, autoTargetQuery, autoTargetCandidates);
+	autoTargetCandidatesFrame = gs->frameNum;
+}
+
 bool CWeapon::AutoTarget()
 {
 	if (!AllowWeaponAutoTarget())
@@ -627,11 +661,17 @@ bool CWeapon::AutoTarget()
 
 	auto& targetPairs = helper->targetPairs;
 
+	// candidates gathered by PrepareAutoTarget are only valid for the frame it ran in
+	if (autoTargetCandidatesFrame != gs->frameNum)
+		CGameHelper::GatherWeaponTargets(this, autoTargetCandidates);
+
+	autoTargetCandidatesFrame = -1;
+
 	// NOTE:
 	//   GenerateWeaponTargets sorts by INCREASING order of priority, so lower equals better
 	//   <targetPairs> is normally sorted such that all bad TargetCategory units live at the
 	//   end, but Lua can mess with the ordering arbitrarily
-	for (size_t i = 0, n = CGameHelper::GenerateWeaponTargets(this, avoidUnit, targetPairs); i < n; i++, assert(n == targetPairs.size())) {
+	for (size_t i = 0, n = CGameHelper::GenerateWeaponTargets(this, avoidUnit, autoTargetCandidates, targetPairs); i < n; i++, assert(n == targetPairs.size())) {
 		CUnit* unit = targetPairs[i].second;
 
 		// save the "best" bad target in case we have no other
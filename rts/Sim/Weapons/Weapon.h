@@ -15,6 +15,7 @@
 class CUnit;
 class CWeaponProjectile;
 struct WeaponDef;
+struct QuadFieldBatchQuery;
 
 
 class CWeapon : public CObject
@@ -82,6 +83,8 @@ public:
 	virtual void UpdateProjectileSpeed(const float val) { projectileSpeed = val; }
 	virtual void UpdateRange(const float val) { range = val; }
 
+	void PrepareAutoTarget(QuadFieldBatchQuery& batch);
+	void GatherAutoTargets(const QuadFieldBatchQuery& batch);
 	bool AutoTarget();
 	void AimReady(const int value);
 	void Fire(const bool scriptCall);
@@ -204,6 +207,13 @@ protected:
 	// projectiles that are on the way to our interception zone
 	// (eg. nuke toward a repulsor, or missile toward a shield)
 	std::vector<int> incomingProjectileIDs;
+
+	// filled by GatherAutoTargets (on a worker thread) and consumed
+	// by AutoTarget if the latter runs in the same simulation frame
+	std::vector<SWeaponTargetCandidate> autoTargetCandidates;
+	int autoTargetCandidatesFrame = -1;
+	// index of the query added to the batch by PrepareAutoTarget, or -1
+	int autoTargetQuery = -1;
 };
 
 #endif /* WEAPON_H */
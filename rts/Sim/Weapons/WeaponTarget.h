@@ -48,4 +48,15 @@ public:
 	float3 groundPos;             // if targettype=ground: the ground position
 };
 
+
+// potential auto-target produced by CGameHelper::GatherWeaponTargets; the
+// priority only includes those factors which do not depend on RNG, script
+// or Lua state (the rest is applied by GenerateWeaponTargets)
+struct SWeaponTargetCandidate {
+	CUnit* unit;
+
+	float priority;
+	unsigned short losStatus;
+};
+
 #endif // WEAPONTARGET_H
@@ -2,6 +2,8 @@
 
 #include "CRC.h"
 
+#include <mutex>
+
 extern "C" {
 #include "lib/7z/7zCrc.h"
 }
@@ -15,15 +17,17 @@ CRC::CRC(): crc(CRC_INIT_VAL)
 
 uint32_t CRC::InitTable()
 {
-	static bool crcTableInitialized = false;
+	// archives are opened from multiple threads
+	static std::once_flag crcTableFlag;
 
-	if (crcTableInitialized)
-		return 1;
+	uint32_t ret = 1;
 
-	CrcGenerateTable();
+	std::call_once(crcTableFlag, [&]() {
+		CrcGenerateTable();
+		ret = 0;
+	});
 
-	crcTableInitialized = true;
-	return 0;
+	return ret;
 }
 
 uint32_t CRC::CalcDigest(const void* data, size_t size)
@@ -3,6 +3,8 @@
 
 #include "System/EventClient.h"
 #include "System/EventHandler.h"
+#include "Sim/Units/Unit.h"
+#include "Sim/Units/UnitDef.h"
 
 /******************************************************************************/
 /******************************************************************************/
@@ -38,6 +40,42 @@ bool CEventClient::WantsEvent(const std::string& eventName)
 }
 
 
+void CEventClient::SetUnitEventFilter(int eventIdx, const SUnitEventFilter& filter)
+{
+	assert(eventIdx >= 0 && eventIdx < NUM_EVENTS);
+
+	if (unitEventFilters.empty()) {
+		if (filter.Empty())
+			return;
+
+		unitEventFilters.resize(NUM_EVENTS);
+	}
+
+	unitEventFilters[eventIdx] = filter;
+
+	// keep the unfiltered fast-path once the last filter is gone
+	const auto pred = [](const SUnitEventFilter& f) { return f.Empty(); };
+
+	if (std::all_of(unitEventFilters.begin(), unitEventFilters.end(), pred))
+		unitEventFilters.clear();
+}
+
+bool CEventClient::PassUnitEventFilter(int eventIdx, const CUnit* unit) const
+{
+	const SUnitEventFilter& filter = unitEventFilters[eventIdx];
+
+	const unsigned int unitDefID = unit->unitDef->id;
+	const unsigned int teamID = unit->team;
+
+	if (!filter.unitDefIDs.empty() && (unitDefID >= filter.unitDefIDs.size() || !filter.unitDefIDs[unitDefID]))
+		return false;
+	if (!filter.teamIDs.empty() && (teamID >= filter.teamIDs.size() || !filter.teamIDs[teamID]))
+		return false;
+
+	return true;
+}
+
+
 /******************************************************************************/
 /******************************************************************************/
 //
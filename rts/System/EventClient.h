@@ -48,6 +48,19 @@ enum DbgTimingInfoType {
 };
 
 
+/**
+ * Restricts a unit call-in to units of the given defs and teams,
+ * an empty set does not restrict. Checked by the eventHandler
+ * before the client is called.
+ */
+struct SUnitEventFilter {
+	bool Empty() const { return (unitDefIDs.empty() && teamIDs.empty()); }
+
+	std::vector<bool> unitDefIDs;
+	std::vector<bool> teamIDs;
+};
+
+
 class CEventClient
 {
 	public:
@@ -57,6 +70,15 @@ class CEventClient
 			MinSpecialTeam = AllAccessTeam
 		};
 
+		enum EventIndex {
+			#define SETUP_EVENT(name, props) EVENT_ ## name,
+			#define SETUP_UNMANAGED_EVENT(name, props) EVENT_ ## name,
+				#include "Events.def"
+			#undef SETUP_UNMANAGED_EVENT
+			#undef SETUP_EVENT
+			NUM_EVENTS
+		};
+
 	public:
 		inline const std::string& GetName()   const { return name;   }
 		inline int                GetOrder()  const { return order;  }
@@ -74,6 +96,15 @@ class CEventClient
 		inline bool CanReadAllyTeam(int allyTeam) {
 			return (GetFullRead() || (GetReadAllyTeam() == allyTeam));
 		}
+		inline bool WantsUnitEvent(int eventIdx, const CUnit* unit) const {
+			return (unitEventFilters.empty() || PassUnitEventFilter(eventIdx, unit));
+		}
+
+		/// an empty filter removes the call-in's filter
+		void SetUnitEventFilter(int eventIdx, const SUnitEventFilter& filter);
+
+	private:
+		bool PassUnitEventFilter(int eventIdx, const CUnit* unit) const;
 
 	protected:
 		CEventClient(const std::string& name, int order, bool synced);
@@ -85,6 +116,9 @@ class CEventClient
 		const bool        synced_;
 		      bool        autoLinkEvents;
 
+		/// indexed by EventIndex, empty while no call-in is filtered
+		std::vector<SUnitEventFilter> unitEventFilters;
+
 	protected:
 		friend class CEventHandler;
 		typedef std::pair<std::string, bool> LinkPair;
@@ -15,10 +15,10 @@ CEventHandler eventHandler;
 /******************************************************************************/
 /******************************************************************************/
 
-void CEventHandler::SetupEvent(const std::string& eName, EventClientList* list, int props)
+void CEventHandler::SetupEvent(const std::string& eName, EventClientList* list, int props, int index)
 {
 	assert(std::find_if(eventMap.cbegin(), eventMap.cend(), [&](const EventPair& p) { return (p.first == eName); }) == eventMap.cend());
-	eventMap.push_back({eName, EventInfo(eName, list, props)});
+	eventMap.push_back({eName, EventInfo(eName, list, props, index)});
 }
 
 /******************************************************************************/
@@ -43,8 +43,8 @@ void CEventHandler::ResetState()
 
 void CEventHandler::SetupEvents()
 {
-	#define SETUP_EVENT(name, props) SetupEvent(#name, &list ## name, props);
-	#define SETUP_UNMANAGED_EVENT(name, props) SetupEvent(#name, NULL, props);
+	#define SETUP_EVENT(name, props) SetupEvent(#name, &list ## name, props, CEventClient::EVENT_ ## name);
+	#define SETUP_UNMANAGED_EVENT(name, props) SetupEvent(#name, NULL, props, CEventClient::EVENT_ ## name);
 		#include "Events.def"
 	#undef SETUP_UNMANAGED_EVENT
 	#undef SETUP_EVENT
@@ -138,6 +138,14 @@ bool CEventHandler::IsController(const std::string& eName) const
 }
 
 
+bool CEventHandler::IsFilterable(const std::string& eName) const
+{
+	const auto comp = [](const EventPair& a, const EventPair& b) { return (a.first < b.first); };
+	const auto iter = std::lower_bound(eventMap.begin(), eventMap.end(), EventPair{eName, {}}, comp);
+	return (iter != eventMap.end() && iter->second.HasPropBit(FILTER_BIT) && iter->first == eName);
+}
+
+
 /******************************************************************************/
 
 bool CEventHandler::InsertEvent(CEventClient* ec, const std::string& ciName)
@@ -169,6 +177,19 @@ bool CEventHandler::RemoveEvent(CEventClient* ec, const std::string& ciName)
 }
 
 
+bool CEventHandler::SetUnitEventFilter(CEventClient* ec, const std::string& ciName, const SUnitEventFilter& filter)
+{
+	const auto comp = [](const EventPair& a, const EventPair& b) { return (a.first < b.first); };
+	const auto iter = std::lower_bound(eventMap.begin(), eventMap.end(), EventPair{ciName, {}}, comp);
+
+	if ((iter == eventMap.end()) || !iter->second.HasPropBit(FILTER_BIT) || (iter->first != ciName))
+		return false;
+
+	ec->SetUnitEventFilter(iter->second.GetIndex(), filter);
+	return true;
+}
+
+
 /******************************************************************************/
 
 void CEventHandler::ListInsert(EventClientList& ecList, CEventClient* ec)
@@ -546,7 +567,7 @@ void CEventHandler::UnitHarvestStorageFull(const CUnit* unit)
 	const int count = listUnitHarvestStorageFull.size();
 	for (int i = 0; i < count; i++) {
 		CEventClient* ec = listUnitHarvestStorageFull[i];
-		if (ec->CanReadAllyTeam(unitAllyTeam)) {
+		if (ec->CanReadAllyTeam(unitAllyTeam) && ec->WantsUnitEvent(CEventClient::EVENT_UnitHarvestStorageFull, unit)) {
 			ec->UnitHarvestStorageFull(unit);
 		}
 	}
@@ -39,6 +39,9 @@ class CEventHandler
 		bool IsManaged(const std::string& ciName) const;
 		bool IsUnsynced(const std::string& ciName) const;
 		bool IsController(const std::string& ciName) const;
+		bool IsFilterable(const std::string& ciName) const;
+
+		bool SetUnitEventFilter(CEventClient* ec, const std::string& ciName, const SUnitEventFilter& filter);
 
 
 	public:
@@ -302,25 +305,28 @@ class CEventHandler
 		enum EventPropertyBits {
 			MANAGED_BIT  = (1 << 0), // managed by eventHandler
 			UNSYNCED_BIT = (1 << 1), // delivers unsynced information
-			CONTROL_BIT  = (1 << 2)  // controls synced information
+			CONTROL_BIT  = (1 << 2), // controls synced information
+			FILTER_BIT   = (1 << 3)  // can be filtered per unitDef and team
 		};
 
 		class EventInfo {
 			public:
-				EventInfo() : list(NULL), propBits(0) {}
-				EventInfo(const std::string& _name, EventClientList* _list, int _bits)
-				: name(_name), list(_list), propBits(_bits) {}
+				EventInfo() : list(NULL), propBits(0), index(-1) {}
+				EventInfo(const std::string& _name, EventClientList* _list, int _bits, int _index)
+				: name(_name), list(_list), propBits(_bits), index(_index) {}
 				~EventInfo() {}
 
 				inline const std::string& GetName() const { return name; }
 				inline EventClientList* GetList() const { return list; }
 				inline int GetPropBits() const { return propBits; }
 				inline bool HasPropBit(int bit) const { return propBits & bit; }
+				inline int GetIndex() const { return index; }
 
 			private:
 				std::string name;
 				EventClientList* list;
 				int propBits;
+				int index;
 		};
 
 		typedef std::pair<std::string, EventInfo> EventPair;
@@ -328,7 +334,7 @@ class CEventHandler
 
 	private:
 		void SetupEvent(const std::string& ciName,
-		                EventClientList* list, int props);
+		                EventClientList* list, int props, int index);
 		void ListInsert(EventClientList& ciList, CEventClient* ec);
 		void ListRemove(EventClientList& ciList, CEventClient* ec);
 
@@ -366,12 +372,13 @@ extern CEventHandler eventHandler;
 		i += (i < list##name.size() && ec == list##name[i]);       \
 	}
 
-#define ITERATE_ALLYTEAM_EVENTCLIENTLIST(name, allyTeam, ...)      \
+#define ITERATE_UNIT_LOS_EVENTCLIENTLIST(name, unit, allyTeam)    \
 	for (size_t i = 0; i < list##name.size(); ) {                  \
 		CEventClient* ec = list##name[i];                          \
                                                                    \
-		if (ec->CanReadAllyTeam(allyTeam))                         \
-			ec->name(__VA_ARGS__);                                 \
+		if (ec->CanReadAllyTeam(allyTeam) &&                       \
+		    ec->WantsUnitEvent(CEventClient::EVENT_##name, unit))  \
+			ec->name(unit, allyTeam);                              \
                                                                    \
 		/* the call-in may remove itself from the list */          \
 		i += (i < list##name.size() && ec == list##name[i]);       \
@@ -382,7 +389,8 @@ extern CEventHandler eventHandler;
 	for (size_t i = 0; i < list##name.size(); ) {                  \
 		CEventClient* ec = list##name[i];                          \
                                                                    \
-		if (ec->CanReadAllyTeam(unitAllyTeam))                     \
+		if (ec->CanReadAllyTeam(unitAllyTeam) &&                   \
+		    ec->WantsUnitEvent(CEventClient::EVENT_##name, unit))  \
 			ec->name(unit, __VA_ARGS__);                           \
                                                                    \
 		/* the call-in may remove itself from the list */          \
@@ -407,7 +415,8 @@ inline void CEventHandler::UnitDestroyed(const CUnit* unit, const CUnit* attacke
 		for (size_t i = 0; i < list##name.size(); ) {              \
 			CEventClient* ec = list##name[i];                      \
                                                                    \
-			if (ec->CanReadAllyTeam(unitAllyTeam))                 \
+			if (ec->CanReadAllyTeam(unitAllyTeam) &&               \
+			    ec->WantsUnitEvent(CEventClient::EVENT_##name, unit)) \
 				ec->name(unit);                                    \
                                                                    \
 			i += (i < list##name.size() && ec == list##name[i]);   \
@@ -437,7 +446,7 @@ UNIT_CALLIN_INT_PARAMS(Given)
 #define UNIT_CALLIN_LOS_PARAM(name)                                        \
 	inline void CEventHandler:: Unit ## name (const CUnit* unit, int at)   \
 	{                                                                      \
-		ITERATE_ALLYTEAM_EVENTCLIENTLIST(Unit ## name, at, unit, at)       \
+		ITERATE_UNIT_LOS_EVENTCLIENTLIST(Unit ## name, unit, at)           \
 	}
 
 UNIT_CALLIN_LOS_PARAM(EnteredRadar)
@@ -557,6 +566,10 @@ inline void CEventHandler::UnitLoaded(const CUnit* unit,
 	for (size_t i = 0; i < count; i++) {
 		CEventClient* ec = listUnitLoaded[i];
 		const int ecAllyTeam = ec->GetReadAllyTeam();
+
+		if (!ec->WantsUnitEvent(CEventClient::EVENT_UnitLoaded, unit))
+			continue;
+
 		if (ec->GetFullRead() ||
 		    (ecAllyTeam == unit->allyteam) ||
 		    (ecAllyTeam == transport->allyteam)) {
@@ -574,6 +587,10 @@ inline void CEventHandler::UnitUnloaded(const CUnit* unit,
 	for (size_t i = 0; i < count; i++) {
 		CEventClient* ec = listUnitUnloaded[i];
 		const int ecAllyTeam = ec->GetReadAllyTeam();
+
+		if (!ec->WantsUnitEvent(CEventClient::EVENT_UnitUnloaded, unit))
+			continue;
+
 		if (ec->GetFullRead() ||
 		    (ecAllyTeam == unit->allyteam) ||
 		    (ecAllyTeam == transport->allyteam)) {
@@ -747,7 +764,7 @@ inline void CEventHandler::RenderProjectileDestroyed(const CProjectile* proj)
 
 
 #undef ITERATE_EVENTCLIENTLIST
-#undef ITERATE_ALLYTEAM_EVENTCLIENTLIST
+#undef ITERATE_UNIT_LOS_EVENTCLIENTLIST
 #undef ITERATE_UNIT_ALLYTEAM_EVENTCLIENTLIST
 #undef UNIT_CALLIN_NO_PARAM
 #undef UNIT_CALLIN_INT_PARAMS
@@ -6,22 +6,27 @@
 #include "System/Log/ILog.h"
 
 #include <cassert>
+#include <cinttypes>
 
-spring::mutex CBufferedArchive::archiveLock;
 
+CBufferedArchive::CBufferedArchive(const std::string& name, bool cached)
+	: IArchive(name)
+	, maxCacheSize(std::uint64_t(globalConfig.vfsCacheArchiveSize) * 1024 * 1024)
+	, noCache(!cached)
+{
+}
 
 CBufferedArchive::~CBufferedArchive()
 {
 	// filter archives for which only {map,mod}info.lua was accessed
-	if (cacheSize <= 1 || fileCount <= 1)
+	if (cachedBytes <= 1 || cachedFiles <= 1)
 		return;
 
-	LOG_L(L_INFO, "[%s][name=%s] %u bytes cached in %u files", __func__, archiveFile.c_str(), cacheSize, fileCount);
+	LOG_L(L_INFO, "[%s][name=%s] %" PRIu64 " bytes cached in %u files (%" PRIu64 " bytes held)", __func__, archiveFile.c_str(), cachedBytes.load(), cachedFiles.load(), cacheSize.load());
 }
 
 bool CBufferedArchive::GetFile(unsigned int fid, std::vector<std::uint8_t>& buffer)
 {
-	std::lock_guard<spring::mutex> lck(archiveLock);
 	assert(IsFileId(fid));
 
 	int ret = 0;
@@ -41,29 +46,103 @@ bool CBufferedArchive::GetFile(unsigned int fid, std::vector<std::uint8_t>& buff
 		return (ret == 1);
 	}
 
-	// NumFiles is virtual, can't do this in ctor
-	if (fileCache.empty())
-		fileCache.resize(NumFiles());
-
-	FileBuffer& fb = fileCache.at(fid);
+	bool exists = false;
 
-	if (!fb.populated) {
-		fb.exists = ((ret = GetFileImpl(fid, fb.data)) == 1);
-		fb.populated = true;
+	if (!GetCachedFile(fid, buffer, exists)) {
+		// not holding any lock, other readers of this fid may extract it as well
+		exists = ((ret = GetFileImpl(fid, buffer)) == 1);
 
-		cacheSize += fb.data.size();
-		fileCount += fb.exists;
+		AddCachedFile(fid, buffer, exists);
 	}
 
-	if (!fb.exists) {
-		LOG_L(L_WARNING, "[BufferedArchive::%s(fid=%u)][!fb.exists] name=%s ret=%d size=" _STPF_, __func__, fid, archiveFile.c_str(), ret, fb.data.size());
+	if (!exists) {
+		LOG_L(L_WARNING, "[BufferedArchive::%s(fid=%u)][!exists] name=%s ret=%d size=" _STPF_, __func__, fid, archiveFile.c_str(), ret, buffer.size());
 		return false;
 	}
 
-	if (buffer.size() != fb.data.size())
-		buffer.resize(fb.data.size());
+	return true;
+}
+
+
+bool CBufferedArchive::GetCachedFile(unsigned int fid, std::vector<std::uint8_t>& buffer, bool& exists)
+{
+	CacheShard& shard = cacheShards[fid % NUM_CACHE_SHARDS];
+
+	std::lock_guard<spring::mutex> lck(shard.mutex);
+
+	const auto iter = shard.files.find(fid);
+
+	if (iter == shard.files.end())
+		return false;
+
+	const FileBuffer& fb = iter->second;
 
 	// TODO: zero-copy access
-	std::copy(fb.data.begin(), fb.data.end(), buffer.begin());
+	buffer.assign(fb.data.begin(), fb.data.end());
+
+	exists = fb.exists;
+	return true;
+}
+
+void CBufferedArchive::AddCachedFile(unsigned int fid, const std::vector<std::uint8_t>& buffer, bool exists)
+{
+	if (buffer.size() > maxCacheSize)
+		return;
+
+	{
+		CacheShard& shard = cacheShards[fid % NUM_CACHE_SHARDS];
+
+		std::lock_guard<spring::mutex> lck(shard.mutex);
+
+		// a concurrent reader got here first
+		if (shard.files.find(fid) != shard.files.end())
+			return;
+
+		FileBuffer& fb = shard.files[fid];
+
+		fb.exists = exists;
+		fb.data.assign(buffer.begin(), buffer.end());
+
+		shard.order.emplace_back(numInserts++, fid);
+
+		cacheSize += buffer.size();
+		cachedBytes += buffer.size();
+		cachedFiles += exists;
+	}
+
+	// evict with no shard locked, EvictCachedFile takes one lock at a time
+	while (cacheSize > maxCacheSize && EvictCachedFile());
+}
+
+bool CBufferedArchive::EvictCachedFile()
+{
+	CacheShard* oldestShard = nullptr;
+	std::uint64_t oldestInsert = std::uint64_t(-1);
+
+	for (CacheShard& shard: cacheShards) {
+		std::lock_guard<spring::mutex> lck(shard.mutex);
+
+		if (shard.order.empty() || shard.order.front().first >= oldestInsert)
+			continue;
+
+		oldestShard = &shard;
+		oldestInsert = shard.order.front().first;
+	}
+
+	if (oldestShard == nullptr)
+		return false;
+
+	std::lock_guard<spring::mutex> lck(oldestShard->mutex);
+
+	// evicted by a concurrent insert meanwhile, the caller checks the size again
+	if (oldestShard->order.empty() || oldestShard->order.front().first != oldestInsert)
+		return true;
+
+	const auto iter = oldestShard->files.find(oldestShard->order.front().second);
+
+	cacheSize -= iter->second.data.size();
+
+	oldestShard->files.erase(iter);
+	oldestShard->order.pop_front();
 	return true;
 }
@@ -3,19 +3,31 @@
 #ifndef _BUFFERED_ARCHIVE_H
 #define _BUFFERED_ARCHIVE_H
 
+#include <array>
+#include <atomic>
+#include <deque>
+
 #include "IArchive.h"
+#include "System/UnorderedMap.hpp"
 #include "System/Threading/SpringThreading.h"
 
 /**
- * Provides a helper implementation for archive types that can only uncompress
- * one file to memory at a time.
+ * Provides a helper implementation for archive types that uncompress whole
+ * files to memory, and keeps a size-bounded cache of these.
+ *
+ * GetFile may be called from any number of threads at once; the cache is
+ * split into shards by file-id so readers rarely wait on each other, and
+ * GetFileImpl runs outside of any lock, derived classes keep one set of
+ * decompressor state per concurrent reader.
+ *
+ * The bound holds across shards, the oldest file of the whole archive is
+ * evicted first; concurrent inserts can overshoot it by the files being
+ * inserted until their eviction passes are done.
  */
 class CBufferedArchive : public IArchive
 {
 public:
-	CBufferedArchive(const std::string& name, bool cached = true): IArchive(name) {
-		noCache = !cached;
-	}
+	CBufferedArchive(const std::string& name, bool cached = true);
 
 	virtual ~CBufferedArchive();
 
@@ -24,6 +36,7 @@ public:
 	bool GetFile(unsigned int fid, std::vector<std::uint8_t>& buffer) override;
 
 protected:
+	/// must be safe to call concurrently, also for the same fid
 	virtual int GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffer) = 0;
 
 	struct FileBuffer {
@@ -34,23 +47,39 @@ protected:
 		FileBuffer& operator = (const FileBuffer& fb) = delete;
 		FileBuffer& operator = (FileBuffer&& fb) = default;
 
-		bool populated = false; // files may be empty (0 bytes)
 		bool exists = false;
 
 		std::vector<std::uint8_t> data;
 	};
 
-	// indexed by file-id
-	std::vector<FileBuffer> fileCache;
-	// neither 7zip (.sd7) nor minizip (.sdz) are thread-safe
-	// zlib (used to extract pool archive .gz entries) should
-	// not need this, but currently each buffered GetFileImpl
-	// call is protected
-	static spring::mutex archiveLock;
+private:
+	static constexpr unsigned int NUM_CACHE_SHARDS = 16;
+
+	struct CacheShard {
+		spring::mutex mutex;
+
+		spring::unordered_map<unsigned int, FileBuffer> files;
+		// (insertion number, fid) in insertion order
+		std::deque< std::pair<std::uint64_t, unsigned int> > order;
+	};
+
+	bool GetCachedFile(unsigned int fid, std::vector<std::uint8_t>& buffer, bool& exists);
+	void AddCachedFile(unsigned int fid, const std::vector<std::uint8_t>& buffer, bool exists);
+	/// drops the oldest file of all shards, false if the cache is empty
+	bool EvictCachedFile();
 
 private:
-	uint32_t cacheSize = 0;
-	uint32_t fileCount = 0;
+	std::array<CacheShard, NUM_CACHE_SHARDS> cacheShards;
+
+	// bytes currently held by all shards
+	std::atomic<std::uint64_t> cacheSize = {0};
+	std::uint64_t maxCacheSize = 0;
+
+	std::atomic<std::uint64_t> numInserts = {0};
+
+	// totals over the archive's lifetime
+	std::atomic<std::uint64_t> cachedBytes = {0};
+	std::atomic<std::uint32_t> cachedFiles = {0};
 
 	bool noCache = false;
 };
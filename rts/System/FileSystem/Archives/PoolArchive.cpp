@@ -158,7 +158,10 @@ int CPoolArchive::GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffe
 	const int bytesRead = (buffer.empty()) ? 0 : gzread(in, reinterpret_cast<char*>(buffer.data()), buffer.size());
 	gzclose(in);
 
-	s->readTime = (spring_now() - startTime).toNanoSecsi();
+	{
+		std::lock_guard<spring::spinlock> lck(fileDataLock);
+		s->readTime = (spring_now() - startTime).toNanoSecsi();
+	}
 
 
 	if (bytesRead != buffer.size()) {
@@ -167,6 +170,10 @@ int CPoolArchive::GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffe
 		return 0;
 	}
 
-	sha512::calc_digest(buffer.data(), buffer.size(), f->shasum.data());
+	std::array<uint8_t, sha512::SHA_LEN> shasum;
+	sha512::calc_digest(buffer.data(), buffer.size(), shasum.data());
+
+	std::lock_guard<spring::spinlock> lck(fileDataLock);
+	f->shasum = shasum;
 	return 1;
 }
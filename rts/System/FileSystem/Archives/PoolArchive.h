@@ -94,9 +94,10 @@ public:
 		const FileData& fd = files[fid];
 
 		// pool-entry hashes are not calculated until GetFileImpl, must check JIT
-		if (memcmp(fd.shasum.data(), dummyFileHash.data(), sizeof(fd.shasum)) == 0)
+		if (!HasFileHash(fid))
 			GetFileImpl(fid, fb);
 
+		std::lock_guard<spring::spinlock> lck(fileDataLock);
 		memcpy(hash, fd.shasum.data(), sha512::SHA_LEN);
 		return (memcmp(fd.shasum.data(), dummyFileHash.data(), sizeof(fd.shasum)) != 0);
 	}
@@ -104,6 +105,11 @@ public:
 protected:
 	int GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffer) override;
 
+	bool HasFileHash(unsigned int fid) const {
+		std::lock_guard<spring::spinlock> lck(fileDataLock);
+		return (memcmp(files[fid].shasum.data(), dummyFileHash.data(), sizeof(files[fid].shasum)) != 0);
+	}
+
 	std::pair<uint64_t, uint64_t> GetSums() const {
 		std::pair<uint64_t, uint64_t> p;
 
@@ -139,6 +145,9 @@ private:
 
 	std::vector<FileData> files;
 	std::vector<FileStat> stats;
+
+	// guards the shasum and readTime fields GetFileImpl fills in, it can run concurrently
+	mutable spring::spinlock fileDataLock;
 };
 
 #endif // _POOL_ARCHIVE_H
@@ -67,7 +67,6 @@ static Bool Utf16_To_Utf8(char* dest, size_t* destLen, const UInt16* src, size_t
 
 int CSevenZipArchive::GetFileName(const CSzArEx* db, int i)
 {
-	// caller has archiveLock
 	const size_t len = SzArEx_GetFileNameUtf16(db, i, nullptr);
 
 	if (len >= sizeof(tempBuffer))
@@ -131,8 +130,6 @@ static inline const char* GetSystemErrorStr(WRes wres)
 
 CSevenZipArchive::CSevenZipArchive(const std::string& name): CBufferedArchive(name, false)
 {
-	std::lock_guard<spring::mutex> lck(archiveLock);
-
 	allocImp.Alloc = SzAlloc;
 	allocImp.Free = SzFree;
 	allocTempImp.Alloc = SzAllocTemp;
@@ -140,21 +137,18 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name): CBufferedArchive(na
 
 	SzArEx_Init(&db);
 
-	const WRes wres = InFile_Open(&archiveStream.file, name.c_str());
-	if (wres) {
-		LOG_L(L_ERROR, "[%s] error opening \"%s\": %s (%i)", __func__, name.c_str(), GetSystemErrorStr(wres), (int) wres);
+	Reader* reader = OpenReader();
+
+	if (reader == nullptr)
 		return;
-	}
 
-	FileInStream_CreateVTable(&archiveStream);
-	LookToRead_CreateVTable(&lookStream, False);
+	CRC::InitTable();
 
-	lookStream.realStream = &archiveStream.s;
-	LookToRead_Init(&lookStream);
+	const SRes res = SzArEx_Open(&db, &reader->lookStream.s, &allocImp, &allocTempImp);
 
-	CRC::InitTable();
+	// the stream that read the index serves as the first reader
+	readers.push_back(reader);
 
-	const SRes res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
 	if (!(isOpen = (res == SZ_OK))) {
 		LOG_L(L_ERROR, "[%s] error opening \"%s\": %s", __func__, name.c_str(), GetErrorStr(res));
 		return;
@@ -207,7 +201,7 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name): CBufferedArchive(na
 
 		const UInt32 folderIndex = db.FileIndexToFolderIndexMap[i];
 
-		if (folderIndex == ((UInt32)-1)) {
+		if (folderIndex == NO_FOLDER) {
 			// file has no folder assigned
 			fd.unpackedSize = f->Size;
 			fd.packedSize   = f->Size;
@@ -224,31 +218,138 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name): CBufferedArchive(na
 
 CSevenZipArchive::~CSevenZipArchive()
 {
-	std::lock_guard<spring::mutex> lck(archiveLock);
-
-	if (outBuffer != nullptr)
-		IAlloc_Free(&allocImp, outBuffer);
+	for (Reader* reader: readers) {
+		CloseReader(reader);
+	}
 
-	if (isOpen)
-		File_Close(&archiveStream.file);
+	readers.clear();
 
 	SzArEx_Free(&db, &allocImp);
 }
 
 
+CSevenZipArchive::Reader* CSevenZipArchive::OpenReader()
+{
+	// CLookToRead points into CFileInStream, neither may move
+	Reader* reader = new Reader();
+
+	const WRes wres = InFile_Open(&reader->archiveStream.file, archiveFile.c_str());
+
+	if (wres) {
+		LOG_L(L_ERROR, "[%s] error opening \"%s\": %s (%i)", __func__, archiveFile.c_str(), GetSystemErrorStr(wres), (int) wres);
+		delete reader;
+		return nullptr;
+	}
+
+	FileInStream_CreateVTable(&reader->archiveStream);
+	LookToRead_CreateVTable(&reader->lookStream, False);
+
+	reader->lookStream.realStream = &reader->archiveStream.s;
+	LookToRead_Init(&reader->lookStream);
+	return reader;
+}
+
+void CSevenZipArchive::CloseReader(Reader* reader)
+{
+	if (reader->outBuffer != nullptr)
+		IAlloc_Free(&allocImp, reader->outBuffer);
+
+	File_Close(&reader->archiveStream.file);
+	delete reader;
+}
+
+
+CSevenZipArchive::Reader* CSevenZipArchive::AcquireReader(UInt32 folderIndex)
+{
+	std::unique_lock<spring::mutex> lck(readerMutex);
+
+	for (;;) {
+		Reader* freeReader = nullptr;
+		Reader* blockReader = nullptr;
+
+		for (Reader* reader: readers) {
+			if (reader->folderIndex == folderIndex) {
+				blockReader = reader;
+				break;
+			}
+
+			if (!reader->inUse && freeReader == nullptr)
+				freeReader = reader;
+		}
+
+		if (blockReader != nullptr) {
+			// extracting the block a second time would double its memory
+			if (!blockReader->inUse) {
+				blockReader->inUse = true;
+				return blockReader;
+			}
+		} else {
+			if (freeReader == nullptr && readers.size() < MAX_READERS && (freeReader = OpenReader()) != nullptr)
+				readers.push_back(freeReader);
+
+			if (freeReader != nullptr) {
+				freeReader->folderIndex = folderIndex;
+				freeReader->inUse = true;
+				return freeReader;
+			}
+
+			if (readers.empty())
+				return nullptr;
+		}
+
+		readerCond.wait(lck);
+	}
+}
+
+void CSevenZipArchive::ReleaseReader(Reader* reader, bool extracted)
+{
+	{
+		std::lock_guard<spring::mutex> lck(readerMutex);
+
+		// SzArEx_Extract sets blockIndex before decoding, a failed
+		// extraction must not leave a half-decoded block to be reused
+		if (!extracted) {
+			reader->blockIndex = NO_FOLDER;
+			reader->folderIndex = NO_FOLDER;
+		}
+
+		reader->inUse = false;
+	}
+
+	readerCond.notify_all();
+}
+
+
 int CSevenZipArchive::GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffer)
 {
-	// assert(archiveLock.locked());
 	assert(IsFileId(fid));
 
+	const UInt32 folderIndex = db.FileIndexToFolderIndexMap[fileEntries[fid].fp];
+
+	// empty files are in no solid block, extracting them would make a reader drop its own
+	if (folderIndex == NO_FOLDER) {
+		buffer.clear();
+		return 1;
+	}
+
+	Reader* reader = AcquireReader(folderIndex);
+
+	if (reader == nullptr)
+		return 0;
+
 	size_t offset = 0;
 	size_t outSizeProcessed = 0;
 
-	if (SzArEx_Extract(&db, &lookStream.s, fileEntries[fid].fp, &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp) != SZ_OK)
+	// db is only read from, everything Extract modifies belongs to the reader
+	if (SzArEx_Extract(&db, &reader->lookStream.s, fileEntries[fid].fp, &reader->blockIndex, &reader->outBuffer, &reader->outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp) != SZ_OK) {
+		ReleaseReader(reader, false);
 		return 0;
+	}
 
 	buffer.resize(outSizeProcessed);
-	memcpy(buffer.data(), reinterpret_cast<char*>(outBuffer) + offset, outSizeProcessed);
+	memcpy(buffer.data(), reinterpret_cast<char*>(reader->outBuffer) + offset, outSizeProcessed);
+
+	ReleaseReader(reader, true);
 	return 1;
 }
 
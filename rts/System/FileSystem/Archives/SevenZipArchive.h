@@ -53,6 +53,40 @@ public:
 	#endif
 
 private:
+	static constexpr UInt32 NO_FOLDER = 0xFFFFFFFF;
+
+	/**
+	 * Decompressor state of one reader; each keeps the solid block
+	 * it extracted last, the archive index (db) is shared.
+	 */
+	struct Reader {
+		CFileInStream archiveStream;
+		CLookToRead lookStream;
+
+		// block held in outBuffer, maintained by SzArEx_Extract
+		UInt32 blockIndex = NO_FOLDER;
+		// block this reader was handed out for, valid also while it is being extracted
+		UInt32 folderIndex = NO_FOLDER;
+
+		size_t outBufferSize = 0;
+
+		Byte* outBuffer = nullptr;
+
+		bool inUse = false;
+	};
+
+	Reader* OpenReader();
+	void CloseReader(Reader* reader);
+
+	/**
+	 * Returns the reader holding (or extracting) the given solid block,
+	 * waiting for it if in use, so no block is ever extracted by two
+	 * readers at once; otherwise any free one, opening new readers up
+	 * to MAX_READERS.
+	 */
+	Reader* AcquireReader(UInt32 folderIndex);
+	void ReleaseReader(Reader* reader, bool extracted);
+
 	int GetFileName(const CSzArEx* db, int i);
 
 private:
@@ -71,6 +105,11 @@ private:
 	 * @see FileEntry#unpackedSize
 	 */
 	static constexpr size_t COST_LIMIT_DISK_READ = 32 * 1024;
+	/**
+	 * Maximum number of readers, each may hold an entire extracted solid
+	 * block in memory.
+	 */
+	static constexpr size_t MAX_READERS = 4;
 
 	// actual data is in BufferedArchive
 	struct FileEntry {
@@ -104,16 +143,15 @@ private:
 
 	std::vector<FileEntry> fileEntries;
 
-	UInt32 blockIndex = 0xFFFFFFFF;
-	size_t outBufferSize = 0;
+	// one per concurrent reader, reused after
+	std::vector<Reader*> readers;
+	spring::mutex readerMutex;
+	spring::condition_variable_any readerCond;
 
-	Byte* outBuffer = nullptr;
 	// used for file names
 	UInt16 tempBuffer[2048];
 
-	CFileInStream archiveStream;
 	CSzArEx db;
-	CLookToRead lookStream;
 	ISzAlloc allocImp;
 	ISzAlloc allocTempImp;
 
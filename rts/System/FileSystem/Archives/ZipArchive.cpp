@@ -19,8 +19,6 @@ IArchive* CZipArchiveFactory::DoCreateArchive(const std::string& filePath) const
 
 CZipArchive::CZipArchive(const std::string& archiveName): CBufferedArchive(archiveName)
 {
-	std::lock_guard<spring::mutex> lck(archiveLock);
-
 	if ((zip = unzOpen(archiveName.c_str())) == nullptr) {
 		LOG_L(L_ERROR, "[%s] error opening \"%s\"", __func__, archiveName.c_str());
 		return;
@@ -59,16 +57,42 @@ CZipArchive::CZipArchive(const std::string& archiveName): CBufferedArchive(archi
 		lcNameIndex.emplace(StringToLower(fd.origName), fileEntries.size());
 		fileEntries.emplace_back(std::move(fd));
 	}
+
+	freeHandles.push_back(zip);
 }
 
 CZipArchive::~CZipArchive()
 {
-	std::lock_guard<spring::mutex> lck(archiveLock);
+	// includes zip
+	for (unzFile handle: freeHandles) {
+		unzClose(handle);
+	}
+
+	freeHandles.clear();
+	zip = nullptr;
+}
+
 
-	if (zip != nullptr) {
-		unzClose(zip);
-		zip = nullptr;
+unzFile CZipArchive::AcquireHandle()
+{
+	{
+		std::lock_guard<spring::mutex> lck(handleMutex);
+
+		if (!freeHandles.empty()) {
+			const unzFile handle = freeHandles.back();
+			freeHandles.pop_back();
+			return handle;
+		}
 	}
+
+	// positions from unzGetFilePos are valid for every handle of the same file
+	return (unzOpen(archiveFile.c_str()));
+}
+
+void CZipArchive::ReleaseHandle(unzFile handle)
+{
+	std::lock_guard<spring::mutex> lck(handleMutex);
+	freeHandles.push_back(handle);
 }
 
 
@@ -82,35 +106,42 @@ void CZipArchive::FileInfo(unsigned int fid, std::string& name, int& size) const
 
 
 // To simplify things, files are always read completely into memory from
-// the zip-file, since zlib does not provide any way of reading more
-// than one file at a time
+// the zip-file, since a minizip handle can only read one file at a time
 int CZipArchive::GetFileImpl(unsigned int fid, std::vector<std::uint8_t>& buffer)
 {
 	// Prevent opening files on missing/invalid archives
 	if (zip == nullptr)
 		return -4;
 
-	// assert(archiveLock.locked());
 	assert(IsFileId(fid));
 
-	unzGoToFilePos(zip, &fileEntries[fid].fp);
+	const unzFile handle = AcquireHandle();
+
+	if (handle == nullptr)
+		return -4;
+
+	unzGoToFilePos(handle, &fileEntries[fid].fp);
 
 	unz_file_info fi;
-	unzGetCurrentFileInfo(zip, &fi, nullptr, 0, nullptr, 0, nullptr, 0);
+	unzGetCurrentFileInfo(handle, &fi, nullptr, 0, nullptr, 0, nullptr, 0);
 
-	if (unzOpenCurrentFile(zip) != UNZ_OK)
+	if (unzOpenCurrentFile(handle) != UNZ_OK) {
+		ReleaseHandle(handle);
 		return -3;
+	}
 
 	buffer.clear();
 	buffer.resize(fi.uncompressed_size);
 
 	int ret = 1;
 
-	if (!buffer.empty() && unzReadCurrentFile(zip, buffer.data(), buffer.size()) != buffer.size())
+	if (!buffer.empty() && unzReadCurrentFile(handle, buffer.data(), buffer.size()) != buffer.size())
 		ret -= 2;
-	if (unzCloseCurrentFile(zip) == UNZ_CRCERROR)
+	if (unzCloseCurrentFile(handle) == UNZ_CRCERROR)
 		ret -= 1;
 
+	ReleaseHandle(handle);
+
 	if (ret != 1)
 		buffer.clear();
 
@@ -47,9 +47,18 @@ public:
 	}
 	#endif
 
+protected:
+	unzFile AcquireHandle();
+	void ReleaseHandle(unzFile handle);
+
 protected:
 	unzFile zip;
 
+	// minizip keeps the current file's state in its handle,
+	// one is opened per concurrent reader and reused after
+	std::vector<unzFile> freeHandles;
+	spring::mutex handleMutex;
+
 	// actual data is in BufferedArchive
 	struct FileEntry {
 		unz_file_pos fp;
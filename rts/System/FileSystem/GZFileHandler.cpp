@@ -47,6 +47,14 @@ bool CGZFileHandler::ReadToBuffer(const std::string& path)
 	while (true) {
 		int unzippedBytes = gzread(file, unzipBuffer, BUFFER_SIZE);
 		if (unzippedBytes < 0) {
+			int errnum = Z_OK;
+			gzerror(file, &errnum);
+
+			// truncated input (eg. a demo still being recorded or left by a
+			// crash); keep whatever could be inflated instead of failing
+			if (errnum == Z_BUF_ERROR && !fileBuffer.empty())
+				break;
+
 			fileBuffer.clear();
 			fileSize = -1;
 			gzclose(file);
@@ -86,7 +94,12 @@ bool CGZFileHandler::UncompressBuffer()
 		zstream.avail_out = BUFFER_SIZE;
 		zstream.next_out = unzipBuffer;
 		const int ret = inflate(&zstream, Z_NO_FLUSH);
-		if (ret != Z_OK) {
+		if (ret != Z_OK && ret != Z_STREAM_END) {
+			// as above, keep the inflated part of a truncated stream
+			if (ret == Z_BUF_ERROR && !fileBuffer.empty())
+				break;
+
+			inflateEnd(&zstream);
 			fileBuffer.clear();
 			fileSize = -1;
 			return false;
@@ -95,8 +108,13 @@ bool CGZFileHandler::UncompressBuffer()
 		const size_t unzippedBytes = BUFFER_SIZE - zstream.avail_out;
 		fileBuffer.insert(fileBuffer.end(), unzipBuffer, unzipBuffer + unzippedBytes);
 
-		if (ret == Z_STREAM_END)
+		if (ret != Z_STREAM_END)
+			continue;
+		// gzip files may consist of several concatenated members
+		if (zstream.avail_in == 0)
 			break;
+
+		inflateReset(&zstream);
 	}
 
 	inflateEnd(&zstream);
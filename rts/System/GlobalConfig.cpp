@@ -24,9 +24,11 @@ CONFIG(int, ReconnectTimeout)
 	.defaultValue(15)
 	.minimumValue(0);
 
+// datagrams are received into fixed-size buffers (UDPBatch::MAX_DATAGRAM_SIZE)
 CONFIG(int, MaximumTransmissionUnit)
 	.defaultValue(1400)
-	.minimumValue(400);
+	.minimumValue(400)
+	.maximumValue(4095);
 
 CONFIG(int, LinkOutgoingBandwidth)
 	.defaultValue(64 * 1024)
@@ -50,6 +52,9 @@ CONFIG(int, LinkIncomingMaxWaitingPackets)
 	.defaultValue(512)
 	.minimumValue(0);
 
+CONFIG(bool, UDPBatchedIO).defaultValue(true);
+CONFIG(bool, NetworkCompression).defaultValue(false);
+
 CONFIG(int, TeamHighlight)
 	.defaultValue(CTeamHighlight::HIGHLIGHT_PLAYERS)
 	.minimumValue(CTeamHighlight::HIGHLIGHT_FIRST)
@@ -59,6 +64,7 @@ CONFIG(bool, UseNetMessageSmoothingBuffer).defaultValue(true);
 
 CONFIG(bool, LuaWritableConfigFile).defaultValue(true);
 CONFIG(bool, VFSCacheArchiveFiles).defaultValue(true);
+CONFIG(int, VFSCacheArchiveSize).defaultValue(256).minimumValue(0);
 
 
 void GlobalConfig::Init()
@@ -76,6 +82,8 @@ void GlobalConfig::Init()
 	linkIncomingPeakBandwidth = configHandler->GetInt("LinkIncomingPeakBandwidth");
 	linkIncomingMaxPacketRate = configHandler->GetInt("LinkIncomingMaxPacketRate");
 	linkIncomingMaxWaitingPackets = configHandler->GetInt("LinkIncomingMaxWaitingPackets");
+	udpBatchedIO = configHandler->GetBool("UDPBatchedIO");
+	networkCompression = configHandler->GetBool("NetworkCompression");
 
 	if (linkIncomingSustainedBandwidth > 0 && linkIncomingPeakBandwidth < linkIncomingSustainedBandwidth)
 		linkIncomingPeakBandwidth = linkIncomingSustainedBandwidth;
@@ -87,6 +95,7 @@ void GlobalConfig::Init()
 	useNetMessageSmoothingBuffer = configHandler->GetBool("UseNetMessageSmoothingBuffer");
 	luaWritableConfigFile = configHandler->GetBool("LuaWritableConfigFile");
 	vfsCacheArchiveFiles = configHandler->GetBool("VFSCacheArchiveFiles");
+	vfsCacheArchiveSize = configHandler->GetInt("VFSCacheArchiveSize");
 
 	teamHighlight = configHandler->GetInt("TeamHighlight");
 }
@@ -82,6 +82,22 @@ public:
 	 */
 	int linkIncomingMaxWaitingPackets = 512;
 
+	/**
+	 * @brief udpBatchedIO
+	 *
+	 * Whether UDP sockets should send and receive multiple datagrams per
+	 * system call where supported (sendmmsg/recvmmsg on Linux)
+	 */
+	bool udpBatchedIO = true;
+
+	/**
+	 * @brief networkCompression
+	 *
+	 * Whether UDP connections should offer to compress their outgoing data,
+	 * each direction of a link is compressed if both ends agree
+	 */
+	bool networkCompression = false;
+
 
 	/**
 	 * @brief useNetMessageSmoothingBuffer
@@ -106,6 +122,13 @@ public:
 	 */
 	bool vfsCacheArchiveFiles = true;
 
+	/**
+	 * @brief vfsCacheArchiveSize
+	 *
+	 * Upper bound in MB on the files each (BufferedArchive) keeps cached
+	 */
+	int vfsCacheArchiveSize = 256;
+
 
 	/**
 	 * @brief teamHighlight
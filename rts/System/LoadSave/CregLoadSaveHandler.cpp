@@ -1,7 +1,8 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
+#include <memory>
 #include <sstream>
-#include <zlib.h>
 
 #include "ExternalAI/SkirmishAIHandler.h"
 #include "ExternalAI/EngineOutHandler.h"
@@ -37,7 +38,7 @@
 #include "System/Platform/errorhandler.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileQueryFlags.h"
-#include "System/FileSystem/GZFileHandler.h"
+#include "System/FileSystem/FileHandler.h"
 #include "System/Threading/ThreadPool.h"
 #include "System/creg/SerializeLuaState.h"
 #include "System/creg/Serializer.h"
@@ -156,7 +157,7 @@ static void ReadString(std::istream& s, std::string& str)
 }
 
 
-static void SaveLuaState(CSplitLuaHandle* handle, creg::COutputStreamSerializer& os, std::stringstream& oss)
+static void SaveLuaState(CSplitLuaHandle* handle, creg::COutputStreamSerializer& os, std::ostream& oss)
 {
 	CLuaStateCollector lsc;
 	lsc.valid = (handle != nullptr) && handle->syncedLuaHandle.IsValid();
@@ -169,7 +170,7 @@ static void SaveLuaState(CSplitLuaHandle* handle, creg::COutputStreamSerializer&
 }
 
 
-static void LoadLuaState(CSplitLuaHandle* handle, creg::CInputStreamSerializer& is, std::stringstream& iss)
+static void LoadLuaState(CSplitLuaHandle* handle, creg::CInputStreamSerializer& is, std::istream& iss)
 {
 	void* plsc;
 	creg::Class* plsccls = nullptr;
@@ -190,14 +191,10 @@ static void LoadLuaState(CSplitLuaHandle* handle, creg::CInputStreamSerializer&
 }
 
 
-void CCregLoadSaveHandler::SaveGame(const std::string& path)
+bool CCregLoadSaveHandler::SaveState(std::ostream& oss)
 {
 #ifdef USING_CREG
-	LOG("[LSH::%s] saving game to \"%s\"", __func__, path.c_str());
-
 	try {
-		std::stringstream oss;
-
 		// write our own header. SavePackage() will add its own
 		WriteString(oss, SpringVersion::GetSync());
 		WriteString(oss, gameSetup->setupText);
@@ -236,27 +233,7 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 			PrintSize("AIs", ((int)oss.tellp()) - aiStart);
 		}
 
-		{
-			gzFile file = gzopen(dataDirsAccess.LocateFile(path, FileQueryFlags::WRITE).c_str(), "wb5");
-
-			if (file == nullptr) {
-				LOG_L(L_ERROR, "[LSH::%s] could not open save-file", __func__);
-				return;
-			}
-
-			std::string data = std::move(oss.str());
-			std::function<void(gzFile, std::string&&)> func = [](gzFile file, std::string&& data) {
-				gzwrite(file, data.c_str(), data.size());
-				gzflush(file, Z_FINISH);
-				gzclose(file);
-			};
-
-			// gzFile is just a plain typedef (struct gzFile_s {}* gzFile), can be copied
-			// need to keep a reference to the future around or its destructor will block
-			ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(data))));
-		}
-
-		//FIXME add lua state
+		return true;
 	} catch (const content_error& ex) {
 		LOG_L(L_ERROR, "[LSH::%s] content error \"%s\"", __func__, ex.what());
 	} catch (const std::exception& ex) {
@@ -271,17 +248,55 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 #else //USING_CREG
 	LOG_L(L_ERROR, "[LSH::%s] creg is disabled", __func__);
 #endif //USING_CREG
+	return false;
+}
+
+void CCregLoadSaveHandler::SaveGame(const std::string& path)
+{
+	LOG("[LSH::%s] saving game to \"%s\"", __func__, path.c_str());
+
+	// filled blocks are compressed in parallel while serializing
+	std::unique_ptr<CSaveStreamBuf> saveBuf(new CSaveStreamBuf(5));
+
+	{
+		std::ostream oss(saveBuf.get());
+
+		if (!SaveState(oss))
+			return;
+	}
+
+	FILE* file = fopen(dataDirsAccess.LocateFile(path, FileQueryFlags::WRITE).c_str(), "wb");
+
+	if (file == nullptr) {
+		LOG_L(L_ERROR, "[LSH::%s] could not open save-file", __func__);
+		return;
+	}
+
+	std::function<void(FILE*, std::unique_ptr<CSaveStreamBuf>&&)> func = [](FILE* file, std::unique_ptr<CSaveStreamBuf>&& saveBuf) {
+		if (!saveBuf->WriteFile(file))
+			LOG_L(L_ERROR, "[LSH::SaveGame] could not write save-file");
+
+		fclose(file);
+	};
+
+	// the remaining blocks are finished off-thread, keeping state memory alive until then
+	// need to keep a reference to the future around or its destructor will block
+	ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(saveBuf))));
 }
 
 /// this just loads the mapname and some other early stuff
 void CCregLoadSaveHandler::LoadGameStartInfo(const std::string& path)
 {
-	CGZFileHandler saveFile(dataDirsAccess.LocateFile(FindSaveFile(path)), SPRING_VFS_RAW_FIRST);
-	std::stringbuf *sbuf = iss.rdbuf();
-	char buf[4096];
-	int len;
-	while ((len = saveFile.Read(buf, sizeof(buf))) > 0)
-		sbuf->sputn(buf, len);
+	CFileHandler saveFile(dataDirsAccess.LocateFile(FindSaveFile(path)), SPRING_VFS_RAW_FIRST);
+
+	{
+		std::vector<std::uint8_t> fileData(std::max(saveFile.FileSize(), 0));
+
+		if (fileData.empty() || saveFile.Read(fileData.data(), fileData.size()) != int(fileData.size()) || !stateBuf.ReadFile(fileData))
+			throw content_error("Could not read save-file \"" + path + "\"");
+	}
+
+	iss.clear();
 
 	//Check for compatible save versions
 	std::string saveVersion;
@@ -352,7 +367,7 @@ void CCregLoadSaveHandler::LoadGame()
 	}
 
 	// cleanup
-	iss.str("");
+	stateBuf.Clear();
 
 	gs->paused = false;
 	if (gameServer != nullptr) {
@@ -6,6 +6,7 @@
 #include <string>
 #include <sstream>
 #include "LoadSaveHandler.h"
+#include "SaveStream.h"
 
 class CCregLoadSaveHandler : public ILoadSaveHandler
 {
@@ -17,8 +18,12 @@ public:
 	void LoadGameStartInfo(const std::string& path);
 	void LoadGame();
 
+	/// serializes the current game-state into <oss>, in savefile format
+	bool SaveState(std::ostream& oss);
+
 protected:
-	std::stringstream iss;
+	CSaveStreamBuf stateBuf;
+	std::iostream iss{&stateBuf};
 };
 
 #endif // CREG_LOAD_SAVE_HANDLER_H
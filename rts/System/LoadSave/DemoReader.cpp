@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "DemoReader.h"
+#include "DemoStream.h"
 
 #include "Game/GameVersion.h"
 #include "Sim/Misc/GlobalConstants.h"
@@ -49,16 +50,34 @@ static bool CheckDemoHeader(const DemoFileHeader& fileHeader)
 }
 
 
-CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDemo(new CGZFileHandler(filename, SPRING_VFS_PWD_ALL))
+CDemoReader::CDemoReader(const std::string& filename, float curTime)
 {
 	if (FileSystem::GetExtension(filename) != "sdfz")
 		throw content_error("Unknown demo extension: " + FileSystem::GetExtension(filename));
 
+	{
+		// demos with a seek-index (and outside of archives) are streamed,
+		// anything else is inflated into memory in its entirety
+		const std::string rawPath = CFileHandler::GetFileAbsolutePath(filename, SPRING_VFS_PWD SPRING_VFS_RAW);
+
+		if (!rawPath.empty()) {
+			indexedDemo = new CDemoInputStream();
+
+			if (!indexedDemo->Open(rawPath)) {
+				delete indexedDemo;
+				indexedDemo = nullptr;
+			}
+		}
+
+		if (indexedDemo == nullptr)
+			playbackDemo = new CGZFileHandler(filename, SPRING_VFS_PWD_ALL);
+	}
+
 	// file not found -> exception
-	if (!playbackDemo->FileExists())
+	if (indexedDemo == nullptr && !playbackDemo->FileExists())
 		throw user_error("Demofile not found: " + filename);
 
-	playbackDemo->Read((char*)&fileHeader, sizeof(fileHeader));
+	ReadDemo((char*)&fileHeader, sizeof(fileHeader));
 	fileHeader.swab();
 
 	if (!CheckDemoHeader(fileHeader)) {
@@ -66,7 +85,7 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDe
 			const char* fmt = "[%s] demo-file \"%s\" (%d bytes, magic \"%s\") corrupt or created by a different Spring version, expected \"%s\"";
 
 			memset(buf, 0, sizeof(buf));
-			snprintf(buf, sizeof(buf) - 1, fmt, __func__, filename.c_str(), playbackDemo->FileSize(), fileHeader.magic, fileHeader.versionString);
+			snprintf(buf, sizeof(buf) - 1, fmt, __func__, filename.c_str(), GetDemoSize(), fileHeader.magic, fileHeader.versionString);
 
 #ifndef TOOLS
 			if (!configHandler->GetBool("DisableDemoVersionCheck"))
@@ -77,18 +96,17 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDe
 
 	if (fileHeader.scriptSize != 0) {
 		setupScript.resize(fileHeader.scriptSize, 0);
-		playbackDemo->Read(const_cast<char*>(setupScript.data()), setupScript.size());
+		ReadDemo(const_cast<char*>(setupScript.data()), setupScript.size());
 	}
 
-	playbackDemo->Read((char*)&chunkHeader, sizeof(chunkHeader));
+	ReadDemo((char*)&chunkHeader, sizeof(chunkHeader));
 	chunkHeader.swab();
 
 	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
 	nextDemoReadTime = curTime - 0.01f;
 
-	const long curPos = playbackDemo->GetPos();
-	playbackDemo->Seek(0, std::ios::end);
-	playbackDemoSize = playbackDemo->GetPos();
+	const long curPos = GetDemoPos();
+	playbackDemoSize = GetDemoSize();
 
 	if (fileHeader.demoStreamSize != 0) {
 		bytesRemaining = fileHeader.demoStreamSize;
@@ -99,13 +117,66 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDe
 		// (if this had still used CFileHandler that would have been easier ;-))
 		bytesRemaining = playbackDemoSize - curPos;
 	}
-	playbackDemo->Seek(curPos);
 }
 
 
 CDemoReader::~CDemoReader()
 {
 	delete playbackDemo;
+	delete indexedDemo;
+}
+
+
+int CDemoReader::ReadDemo(void* buf, int length)
+{
+	if (indexedDemo != nullptr)
+		return (indexedDemo->Read(buf, length));
+
+	return (playbackDemo->Read(buf, length));
+}
+
+void CDemoReader::SeekDemo(int pos)
+{
+	if (indexedDemo != nullptr) {
+		indexedDemo->Seek(pos);
+		return;
+	}
+
+	playbackDemo->Seek(pos);
+}
+
+int CDemoReader::GetDemoPos()
+{
+	if (indexedDemo != nullptr)
+		return (indexedDemo->GetPos());
+
+	return (playbackDemo->GetPos());
+}
+
+int CDemoReader::GetDemoSize() const
+{
+	// only finished demos are indexed, so their size is known
+	if (indexedDemo != nullptr)
+		return (GetStreamEnd() + fileHeader.winningAllyTeamsSize + fileHeader.playerStatSize + fileHeader.teamStatSize);
+
+	return (playbackDemo->FileSize());
+}
+
+bool CDemoReader::DemoEof() const
+{
+	if (indexedDemo != nullptr)
+		return (indexedDemo->Eof());
+
+	return (playbackDemo->Eof());
+}
+
+
+const std::vector<DemoIndexEntry>* CDemoReader::GetIndex() const
+{
+	if (indexedDemo == nullptr)
+		return nullptr;
+
+	return &(indexedDemo->GetIndex());
 }
 
 
@@ -119,7 +190,7 @@ netcode::RawPacket* CDemoReader::GetData(const float readTime)
 	// check needed
 	if (readTime >= nextDemoReadTime) {
 		netcode::RawPacket* buf = new netcode::RawPacket(chunkHeader.length);
-		if (playbackDemo->Read((char*)(buf->data), chunkHeader.length) < chunkHeader.length) {
+		if (ReadDemo((char*)(buf->data), chunkHeader.length) < chunkHeader.length) {
 			delete buf;
 			bytesRemaining = 0;
 			return nullptr;
@@ -128,7 +199,7 @@ netcode::RawPacket* CDemoReader::GetData(const float readTime)
 
 		if (!ReachedEnd()) {
 			// read next chunk header
-			if (playbackDemo->Read((char*)&chunkHeader, sizeof(chunkHeader)) < sizeof(chunkHeader)) {
+			if (ReadDemo((char*)&chunkHeader, sizeof(chunkHeader)) < sizeof(chunkHeader)) {
 				delete buf;
 				bytesRemaining = 0;
 				return nullptr;
@@ -149,7 +220,7 @@ netcode::RawPacket* CDemoReader::GetData(const float readTime)
 
 bool CDemoReader::ReachedEnd()
 {
-	return (bytesRemaining <= 0 || playbackDemo->Eof() || (playbackDemo->GetPos() > playbackDemoSize));
+	return (bytesRemaining <= 0 || DemoEof() || (GetDemoPos() > playbackDemoSize));
 }
 
 
@@ -159,8 +230,8 @@ void CDemoReader::LoadStats()
 	if (fileHeader.demoStreamSize == 0)
 		return;
 
-	const int curPos = playbackDemo->GetPos();
-	playbackDemo->Seek(fileHeader.headerSize + fileHeader.scriptSize + fileHeader.demoStreamSize);
+	const int curPos = GetDemoPos();
+	SeekDemo(GetStreamEnd());
 
 	winningAllyTeams.clear();
 	playerStats.clear();
@@ -168,13 +239,13 @@ void CDemoReader::LoadStats()
 
 	for (int allyTeamNum = 0; allyTeamNum < fileHeader.winningAllyTeamsSize; ++allyTeamNum) {
 		unsigned char winnerAllyTeam;
-		playbackDemo->Read((char*) &winnerAllyTeam, sizeof(unsigned char));
+		ReadDemo((char*) &winnerAllyTeam, sizeof(unsigned char));
 		winningAllyTeams.push_back(winnerAllyTeam);
 	}
 
 	for (int playerNum = 0; playerNum < fileHeader.numPlayers; ++playerNum) {
 		PlayerStatistics buf;
-		playbackDemo->Read(reinterpret_cast<char*>(&buf), sizeof(PlayerStatistics));
+		ReadDemo(reinterpret_cast<char*>(&buf), sizeof(PlayerStatistics));
 		buf.swab();
 		playerStats.push_back(buf);
 	}
@@ -186,17 +257,17 @@ void CDemoReader::LoadStats()
 
 		assert(fileHeader.numTeams <= numStatsPerTeam.size());
 		numStatsPerTeam.fill(0);
-		playbackDemo->Read(reinterpret_cast<char*>(numStatsPerTeam.data()), fileHeader.numTeams);
+		ReadDemo(reinterpret_cast<char*>(numStatsPerTeam.data()), fileHeader.numTeams);
 
 		for (int teamNum = 0; teamNum < fileHeader.numTeams; ++teamNum) {
 			for (int i = 0; i < numStatsPerTeam[teamNum]; ++i) {
 				TeamStatistics buf;
-				playbackDemo->Read(reinterpret_cast<char*>(&buf), sizeof(TeamStatistics));
+				ReadDemo(reinterpret_cast<char*>(&buf), sizeof(TeamStatistics));
 				buf.swab();
 				teamStats[teamNum].push_back(buf);
 			}
 		}
 	}
 
-	playbackDemo->Seek(curPos);
+	SeekDemo(curPos);
 }
@@ -13,6 +13,7 @@
 
 namespace netcode { class RawPacket; }
 class CFileHandler;
+class CDemoInputStream;
 
 /**
  * @brief Utility class for reading demofiles
@@ -39,6 +40,9 @@ public:
 	*/
 	bool ReachedEnd();
 
+	/// the seek-index, or null if the demo has none
+	const std::vector<DemoIndexEntry>* GetIndex() const;
+
 	float GetModGameTime() const { return chunkHeader.modGameTime; }
 	float GetDemoTimeOffset() const { return demoTimeOffset; }
 	float GetNextDemoReadTime() const { return nextDemoReadTime; }
@@ -56,7 +60,18 @@ public:
 	void LoadStats();
 
 private:
-	CFileHandler* playbackDemo;
+	int ReadDemo(void* buf, int length);
+	void SeekDemo(int pos);
+	int GetDemoPos();
+	int GetDemoSize() const;
+	bool DemoEof() const;
+
+	int GetStreamEnd() const { return (fileHeader.headerSize + fileHeader.scriptSize + fileHeader.demoStreamSize); }
+
+private:
+	// exactly one of these is non-null
+	CFileHandler* playbackDemo = nullptr;
+	CDemoInputStream* indexedDemo = nullptr;
 
 	float demoTimeOffset;
 	float nextDemoReadTime;
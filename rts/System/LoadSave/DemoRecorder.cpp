@@ -2,20 +2,26 @@
 
 #include <cassert>
 #include <cerrno>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <memory>
 
 #include "DemoRecorder.h"
+#include "DemoStream.h"
 #include "Game/GameVersion.h"
+#include "Net/Protocol/NetMessageTypes.h"
 #include "Sim/Misc/TeamStatistics.h"
 #include "System/TimeUtil.h"
+#include "System/Config/ConfigHandler.h"
 #include "System/StringUtil.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileHandler.h"
 #include "System/Log/ILog.h"
-#include "System/Threading/ThreadPool.h"
+#include "System/Platform/Threading.h"
+#include "System/Threading/SpringThreading.h"
 
 #ifdef CreateDirectory
 #undef CreateDirectory
@@ -26,26 +32,149 @@
 #endif
 
 
-// server and client memory-streams
-static std::string demoStreams[2];
-static spring::mutex demoMutex;
+// uncompressed bytes (or seconds of game-time) per block handed to the writer
+static constexpr size_t DEMO_BLOCK_SIZE = 256 * 1024;
+static constexpr float DEMO_BLOCK_TIME = 10.0f;
+// blocks that may be waiting for compression before SaveToDemo stalls
+static constexpr size_t DEMO_MAX_QUEUED_BLOCKS = 16;
+
+CONFIG(int, DemoIndexInterval).defaultValue(30).minimumValue(0).description("Game-time in seconds between the seek-points written to demos, 0 disables the seek-index.");
+
+
+/**
+ * Compresses and writes blocks of the demo stream via CDemoOutputStream on
+ * its own thread. The stream is sync-flushed after every block, so after a
+ * crash all blocks written so far can still be inflated.
+ */
+class CDemoStreamWriter {
+public:
+	CDemoStreamWriter(const std::string& fileName) {
+		if (!stream.Open(fileName))
+			return;
+
+		block.reserve(DEMO_BLOCK_SIZE);
+		thread = spring::thread(&CDemoStreamWriter::Run, this);
+	}
+
+	~CDemoStreamWriter() { Finish(); }
+
+	/// waits until all queued blocks are written; false if any write failed
+	bool Finish() {
+		if (!thread.joinable())
+			return false;
+
+		Flush();
+		Submit({JOB_TYPE_FINISH, 0, {}});
+		thread.join();
+
+		return (!stream.HasWriteError());
+	}
+
+	bool IsOpen() const { return (stream.IsOpen()); }
+
+	void Write(const char* data, size_t size) {
+		block.append(data, size);
+
+		if (block.size() < DEMO_BLOCK_SIZE)
+			return;
+
+		Flush();
+	}
+
+	void Flush() {
+		if (block.empty())
+			return;
+
+		Submit({JOB_TYPE_DATA, 0, std::move(block)});
+
+		block.clear();
+		block.reserve(DEMO_BLOCK_SIZE);
+	}
+
+	void WriteHeader(const DemoFileHeader& header) {
+		// header must follow all data appended so far
+		Flush();
+		Submit({JOB_TYPE_HEADER, 0, std::string(reinterpret_cast<const char*>(&header), sizeof(header))});
+	}
+
+	void AddIndexEntry(unsigned int frameNum) {
+		Flush();
+		Submit({JOB_TYPE_INDEX, frameNum, {}});
+	}
+
+private:
+	enum {
+		JOB_TYPE_DATA   = 0,
+		JOB_TYPE_HEADER = 1,
+		JOB_TYPE_INDEX  = 2,
+		JOB_TYPE_FINISH = 3,
+	};
+
+	struct Job {
+		int type;
+		unsigned int frameNum;
+		std::string data;
+	};
+
+	void Submit(Job&& job) {
+		std::unique_lock<spring::mutex> lock(mutex);
+
+		// bounds memory if the disk can not keep up
+		jobCond.wait(lock, [&]() { return (jobs.size() < DEMO_MAX_QUEUED_BLOCKS); });
+		jobs.push_back(std::move(job));
+		jobCond.notify_all();
+	}
+
+	void Run() {
+		Threading::SetThreadName("demo-writer");
+
+		Job job;
+
+		while (true) {
+			{
+				std::unique_lock<spring::mutex> lock(mutex);
+
+				jobCond.wait(lock, [&]() { return (!jobs.empty()); });
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				jobCond.notify_all();
+			}
+
+			switch (job.type) {
+				case JOB_TYPE_DATA  : { stream.Write(job.data.data(), job.data.size(), true); } break;
+				case JOB_TYPE_HEADER: { stream.WriteHeader(*reinterpret_cast<const DemoFileHeader*>(job.data.data())); } break;
+				case JOB_TYPE_INDEX : { stream.AddIndexEntry(job.frameNum); } break;
+				case JOB_TYPE_FINISH: { stream.Close(); return; } break;
+				default: { assert(false); } break;
+			}
+		}
+	}
+
+private:
+	CDemoOutputStream stream;
+
+	// producer-side, only touched by the recording thread
+	std::string block;
+
+	std::deque<Job> jobs;
+
+	spring::mutex mutex;
+	spring::condition_variable jobCond;
+	spring::thread thread;
+};
+
 
 
 CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modName, bool serverDemo): isServerDemo(serverDemo)
 {
-	std::lock_guard<spring::mutex> lock(demoMutex);
-
-	SetStream();
 	SetName(mapName, modName);
 	SetFileHeader();
-	WriteFileHeader(false);
-
-	file = gzopen(demoName.c_str(), "wb9");
+	OpenStream();
 }
 
 CDemoRecorder::~CDemoRecorder()
 {
-	if (file == nullptr)
+	if (writer == nullptr)
 		return;
 
 	WriteWinnerList();
@@ -56,10 +185,35 @@ CDemoRecorder::~CDemoRecorder()
 }
 
 
-void CDemoRecorder::SetStream()
+void CDemoRecorder::OpenStream()
+{
+	writer = new CDemoStreamWriter(demoName);
+
+	if (!writer->IsOpen()) {
+		LOG_L(L_ERROR, "[DemoRecorder::%s] could not open %s-demo \"%s\" (%s)", __func__, (isServerDemo? "server": "client"), demoName.c_str(), strerror(errno));
+
+		delete writer;
+		writer = nullptr;
+		return;
+	}
+
+	streamSize = 0;
+	lastBlockTime = 0.0f;
+	lastIndexTime = 0.0f;
+	indexInterval = configHandler->GetInt("DemoIndexInterval");
+	numFrames = 0;
+
+	// reserves the header's place in the file, rewritten with final values on close
+	WriteFileHeader(false);
+}
+
+void CDemoRecorder::AppendToStream(const void* data, size_t size)
 {
-	demoStreams[isServerDemo].clear();
-	demoStreams[isServerDemo].reserve(8 * 1024 * 1024);
+	if (writer == nullptr)
+		return;
+
+	writer->Write(reinterpret_cast<const char*>(data), size);
+	streamSize += size;
 }
 
 void CDemoRecorder::SetFileHeader()
@@ -78,29 +232,14 @@ void CDemoRecorder::SetFileHeader()
 
 void CDemoRecorder::WriteDemoFile()
 {
-	// zlib FAQ claims the lib is thread-safe, "however any library routines that zlib uses and
-	// any application-provided memory allocation routines must also be thread-safe. zlib's gz*
-	// functions use stdio library routines, and most of zlib's functions use the library memory
-	// allocation routines by default" (so code below should be OK)
-	// gz* should usually be finished before ctor runs again when reloading, but take no chances
-	std::string& data = demoStreams[isServerDemo];
-	std::function<void(gzFile, std::string&)> func = [](gzFile file, std::string& data) {
-		std::lock_guard<spring::mutex> lock(demoMutex);
-
-		gzwrite(file, data.c_str(), data.size());
-		gzflush(file, Z_FINISH);
-		gzclose(file);
-	};
+	LOG("[DemoRecorder::%s] finalizing %s-demo \"%s\" (" _STPF_ " bytes)", __func__, (isServerDemo? "server": "client"), demoName.c_str(), streamSize);
 
-	LOG("[DemoRecorder::%s] writing %s-demo \"%s\" (" _STPF_ " bytes)", __func__, (isServerDemo? "server": "client"), demoName.c_str(), data.size());
+	// at most one block plus the queue remain to be compressed at this point
+	if (!writer->Finish())
+		LOG_L(L_ERROR, "[DemoRecorder::%s] could not write %s-demo \"%s\", it is likely incomplete", __func__, (isServerDemo? "server": "client"), demoName.c_str());
 
-	#ifndef WIN32
-	// NOTE: can not use ThreadPool for this directly here, workers are already gone
-	// FIXME: does not currently (august 2017) compile on Windows mingw buildbots
-	ThreadPool::AddExtJob(spring::thread(std::move(func), file, std::ref(data)));
-	#else
-	ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::ref(data))));
-	#endif
+	delete writer;
+	writer = nullptr;
 }
 
 void CDemoRecorder::WriteSetupText(const std::string& text)
@@ -111,7 +250,7 @@ void CDemoRecorder::WriteSetupText(const std::string& text)
 	}
 
 	fileHeader.scriptSize = length;
-	demoStreams[isServerDemo].append(text.c_str(), length);
+	AppendToStream(text.c_str(), length);
 }
 
 void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime)
@@ -121,9 +260,27 @@ void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length,
 	chunkHeader.modGameTime = modGameTime;
 	chunkHeader.length = length;
 	chunkHeader.swab();
-	demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&chunkHeader), sizeof(chunkHeader));
-	demoStreams[isServerDemo].append(reinterpret_cast<const char*>(buf), length);
+
+	if (length > 0 && (buf[0] == NETMSG_NEWFRAME || buf[0] == NETMSG_KEYFRAME)) {
+		// seek-points are only placed in front of frames
+		if (writer != nullptr && indexInterval > 0 && (modGameTime - lastIndexTime) >= indexInterval) {
+			writer->AddIndexEntry(numFrames);
+			lastIndexTime = modGameTime;
+		}
+
+		numFrames += 1;
+	}
+
+	AppendToStream(&chunkHeader, sizeof(chunkHeader));
+	AppendToStream(buf, length);
 	fileHeader.demoStreamSize += (length + sizeof(chunkHeader));
+
+	// bound the amount of game-time lost if we crash during a quiet phase
+	if (writer == nullptr || (modGameTime - lastBlockTime) < DEMO_BLOCK_TIME)
+		return;
+
+	writer->Flush();
+	lastBlockTime = modGameTime;
 }
 
 void CDemoRecorder::SetName(const std::string& mapName, const std::string& modName)
@@ -216,8 +373,8 @@ void CDemoRecorder::SetWinningAllyTeams(const std::vector<unsigned char>& winnin
 }
 
 /** @brief Write DemoFileHeader
-Write the DemoFileHeader at the start of the file and restores the original
-position in the file afterwards. */
+Queue a rewrite of the DemoFileHeader at the start of the file; the header is
+kept in its own fixed-size gzip member so this does not disturb the stream. */
 unsigned int CDemoRecorder::WriteFileHeader(bool updateStreamLength)
 {
 	DemoFileHeader tmpHeader;
@@ -229,28 +386,29 @@ unsigned int CDemoRecorder::WriteFileHeader(bool updateStreamLength)
 	// to little endian
 	tmpHeader.swab();
 
-	if (demoStreams[isServerDemo].empty()) {
-		demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&tmpHeader), sizeof(tmpHeader));
-	} else {
-		assert(demoStreams[isServerDemo].size() >= sizeof(tmpHeader));
-		memcpy(&demoStreams[isServerDemo][0], reinterpret_cast<const char*>(&tmpHeader), sizeof(tmpHeader)); // no non-const .data() until C++17
-	}
+	if (writer == nullptr)
+		return 0;
+
+	// first call only reserves space, later ones overwrite
+	if (streamSize == 0)
+		streamSize += sizeof(tmpHeader);
 
-	return (demoStreams[isServerDemo].size());
+	writer->WriteHeader(tmpHeader);
+	return streamSize;
 }
 
 /** @brief Write the CPlayer::Statistics at the current position in the file. */
 void CDemoRecorder::WritePlayerStats()
 {
-	const size_t pos = demoStreams[isServerDemo].size();
+	const size_t pos = streamSize;
 
 	for (PlayerStatistics& stats: playerStats) {
 		stats.swab();
-		demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&stats), sizeof(PlayerStatistics));
+		AppendToStream(&stats, sizeof(PlayerStatistics));
 	}
 
 	fileHeader.numPlayers = playerStats.size();
-	fileHeader.playerStatSize = int(demoStreams[isServerDemo].size() - pos);
+	fileHeader.playerStatSize = int(streamSize - pos);
 
 	playerStats.clear();
 }
@@ -263,38 +421,38 @@ void CDemoRecorder::WriteWinnerList()
 	if (fileHeader.numTeams == 0)
 		return;
 
-	const size_t pos = demoStreams[isServerDemo].size();
+	const size_t pos = streamSize;
 
 	// Write the array of winningAllyTeams.
 	for (size_t i = 0; i < winningAllyTeams.size(); i++) { // NOLINT{modernize-loop-convert}
-		demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&winningAllyTeams[i]), sizeof(unsigned char));
+		AppendToStream(&winningAllyTeams[i], sizeof(unsigned char));
 	}
 
 	winningAllyTeams.clear();
 
-	fileHeader.winningAllyTeamsSize = int(demoStreams[isServerDemo].size() - pos);
+	fileHeader.winningAllyTeamsSize = int(streamSize - pos);
 }
 
 /** @brief Write the TeamStatistics at the current position in the file. */
 void CDemoRecorder::WriteTeamStats()
 {
-	const size_t pos = demoStreams[isServerDemo].size();
+	const size_t pos = streamSize;
 
 	// Write array of dwords indicating number of TeamStatistics per team.
 	for (std::vector<TeamStatistics>& history: teamStats) {
 		unsigned int c = swabDWord(history.size());
-		demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&c), sizeof(unsigned int));
+		AppendToStream(&c, sizeof(unsigned int));
 	}
 
 	// Write big array of TeamStatistics.
 	for (std::vector<TeamStatistics>& history: teamStats) {
 		for (TeamStatistics& stats: history) {
 			stats.swab();
-			demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&stats), sizeof(TeamStatistics));
+			AppendToStream(&stats, sizeof(TeamStatistics));
 		}
 	}
 
-	fileHeader.teamStatSize = int(demoStreams[isServerDemo].size() - pos);
+	fileHeader.teamStatSize = int(streamSize - pos);
 
 	teamStats.clear();
 }
@@ -5,12 +5,12 @@
 
 #include <vector>
 #include <sstream>
-#include <zlib.h>
 
 #include "Demo.h"
 #include "Game/Players/PlayerStatistics.h"
 #include "Sim/Misc/TeamStatistics.h"
 
+class CDemoStreamWriter;
 
 /**
  * @brief Used to record demos
@@ -32,7 +32,12 @@ public:
 		memcpy(&fileHeader, &r.fileHeader, sizeof(fileHeader));
 		memset(&r.fileHeader, 0, sizeof(fileHeader));
 
-		std::swap(file, r.file);
+		std::swap(writer, r.writer);
+		std::swap(streamSize, r.streamSize);
+		std::swap(lastBlockTime, r.lastBlockTime);
+		std::swap(lastIndexTime, r.lastIndexTime);
+		std::swap(indexInterval, r.indexInterval);
+		std::swap(numFrames, r.numFrames);
 
 		std::swap(demoName, r.demoName);
 		std::swap(playerStats, r.playerStats);
@@ -44,12 +49,11 @@ public:
 	}
 
 
-	bool IsValid() const { return (file != nullptr); }
+	bool IsValid() const { return (writer != nullptr); }
 
 	void WriteSetupText(const std::string& text);
 	void SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime);
 
-	void SetStream();
 	void SetName(const std::string& mapName, const std::string& modName);
 	const std::string& GetName() const { return demoName; }
 
@@ -63,6 +67,9 @@ public:
 	void SetWinningAllyTeams(const std::vector<unsigned char>& winningAllyTeams);
 
 private:
+	void OpenStream();
+	void AppendToStream(const void* data, size_t size);
+
 	unsigned int WriteFileHeader(bool updateStreamLength);
 	void SetFileHeader();
 	void WritePlayerStats();
@@ -71,7 +78,19 @@ private:
 	void WriteDemoFile();
 
 private:
-	gzFile file = nullptr;
+	// compresses and writes the stream incrementally on its own thread
+	CDemoStreamWriter* writer = nullptr;
+
+	// number of (uncompressed) bytes passed to writer so far
+	size_t streamSize = 0;
+	// game-time at which the last block was handed off
+	float lastBlockTime = 0.0f;
+	// game-time at which the last seek-point was placed
+	float lastIndexTime = 0.0f;
+	// DemoIndexInterval, in seconds
+	int indexInterval = 0;
+	// NETMSG_{NEW,KEY}FRAME packets recorded so far
+	unsigned int numFrames = 0;
 
 	std::vector<PlayerStatistics> playerStats;
 	std::vector< std::vector<TeamStatistics> > teamStats;
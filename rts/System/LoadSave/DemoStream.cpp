@@ -0,0 +1,371 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "DemoStream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+
+// empty final deflate block plus zero CRC32 and ISIZE
+static constexpr std::uint8_t EMPTY_MEMBER_TAIL[] = {0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0};
+static constexpr size_t INDEX_TAIL_SIZE = sizeof(DemoIndexFooter) + sizeof(EMPTY_MEMBER_TAIL);
+// gzip member header with FEXTRA (10 bytes), XLEN and the subfield header
+static constexpr size_t INDEX_HEAD_SIZE = 10 + 2 + 4;
+
+static constexpr size_t IN_BUFFER_SIZE = 64 * 1024;
+
+
+
+bool CDemoOutputStream::Open(const std::string& fileName, int level)
+{
+	assert(file == nullptr);
+
+	if ((file = fopen(fileName.c_str(), "wb")) == nullptr)
+		return false;
+
+	streamPos = 0;
+	headerSize = 0;
+	memberSize = 0;
+	writeError = false;
+
+	index.clear();
+	index.reserve(256);
+
+	deflateInit2(&zstream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+	return true;
+}
+
+void CDemoOutputStream::Close()
+{
+	if (file == nullptr)
+		return;
+
+	Deflate(nullptr, 0, Z_FINISH);
+
+	if (!index.empty())
+		WriteIndexMember();
+
+	deflateEnd(&zstream);
+
+	writeError |= (fclose(file) != 0);
+
+	file = nullptr;
+}
+
+
+void CDemoOutputStream::WriteHeader(const DemoFileHeader& header)
+{
+	std::vector<std::uint8_t> member(deflateBound(nullptr, sizeof(header)) + 32);
+
+	z_stream hstream;
+	memset(&hstream, 0, sizeof(hstream));
+
+	// level 0; member size only depends on the (constant) header size
+	deflateInit2(&hstream, Z_NO_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+	hstream.next_in   = reinterpret_cast<Bytef*>(const_cast<DemoFileHeader*>(&header));
+	hstream.avail_in  = sizeof(header);
+	hstream.next_out  = member.data();
+	hstream.avail_out = member.size();
+
+	deflate(&hstream, Z_FINISH);
+	member.resize(member.size() - hstream.avail_out);
+	deflateEnd(&hstream);
+
+	assert(headerSize == 0 || headerSize == member.size());
+
+	if (headerSize == 0) {
+		assert(streamPos == 0);
+
+		headerSize = member.size();
+		streamPos = sizeof(header);
+
+		WriteFile(member.data(), member.size());
+	} else {
+		writeError |= (fseek(file, 0, SEEK_SET) != 0);
+		WriteFile(member.data(), member.size());
+		writeError |= (fseek(file, 0, SEEK_END) != 0);
+	}
+
+	writeError |= (fflush(file) != 0);
+}
+
+void CDemoOutputStream::Write(const void* data, size_t size, bool flush)
+{
+	Deflate(data, size, flush? Z_SYNC_FLUSH: Z_NO_FLUSH);
+
+	streamPos += size;
+	memberSize += size;
+
+	// hand everything to the OS so it survives a crash of this process
+	if (flush)
+		writeError |= (fflush(file) != 0);
+}
+
+void CDemoOutputStream::AddIndexEntry(unsigned int frameNum)
+{
+	if (index.size() >= DEMOFILE_MAX_INDEX_ENTRIES)
+		return;
+	// nothing written since the last entry
+	if (!index.empty() && index.back().streamPos == streamPos)
+		return;
+
+	if (memberSize > 0) {
+		Deflate(nullptr, 0, Z_FINISH);
+		deflateReset(&zstream);
+	}
+
+	const long filePos = ftell(file);
+
+	// entries are 32-bit
+	if (filePos < 0 || size_t(filePos) > std::numeric_limits<std::uint32_t>::max())
+		return;
+	if (streamPos > std::numeric_limits<std::uint32_t>::max())
+		return;
+
+	index.push_back({frameNum, std::uint32_t(streamPos), std::uint32_t(filePos)});
+	memberSize = 0;
+}
+
+
+void CDemoOutputStream::WriteFile(const void* data, size_t size)
+{
+	writeError |= (fwrite(data, 1, size, file) != size);
+}
+
+void CDemoOutputStream::Deflate(const void* data, size_t size, int flush)
+{
+	std::uint8_t outBuffer[64 * 1024];
+
+	zstream.next_in  = reinterpret_cast<Bytef*>(const_cast<void*>(data));
+	zstream.avail_in = size;
+
+	do {
+		zstream.next_out  = outBuffer;
+		zstream.avail_out = sizeof(outBuffer);
+
+		deflate(&zstream, flush);
+		WriteFile(outBuffer, sizeof(outBuffer) - zstream.avail_out);
+	} while (zstream.avail_out == 0);
+}
+
+void CDemoOutputStream::WriteIndexMember()
+{
+	const size_t payloadSize = index.size() * sizeof(DemoIndexEntry) + sizeof(DemoIndexFooter);
+	const size_t extraSize = payloadSize + 4;
+
+	std::vector<std::uint8_t> member;
+	member.reserve(INDEX_HEAD_SIZE + payloadSize + sizeof(EMPTY_MEMBER_TAIL));
+
+	// magic, CM=deflate, FLG=FEXTRA, MTIME, XFL, OS=unknown
+	for (const std::uint8_t b: {0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff})
+		member.push_back(b);
+
+	member.push_back(extraSize & 0xff);
+	member.push_back(extraSize >> 8);
+	member.push_back(DEMOFILE_INDEX_SUBFIELD[0]);
+	member.push_back(DEMOFILE_INDEX_SUBFIELD[1]);
+	member.push_back(payloadSize & 0xff);
+	member.push_back(payloadSize >> 8);
+
+	for (DemoIndexEntry entry: index) {
+		entry.swab();
+		member.insert(member.end(), reinterpret_cast<const std::uint8_t*>(&entry), reinterpret_cast<const std::uint8_t*>(&entry + 1));
+	}
+
+	DemoIndexFooter footer;
+	footer.numEntries = index.size();
+	memcpy(footer.magic, DEMOFILE_INDEX_MAGIC, sizeof(footer.magic));
+	footer.swab();
+
+	member.insert(member.end(), reinterpret_cast<const std::uint8_t*>(&footer), reinterpret_cast<const std::uint8_t*>(&footer + 1));
+	member.insert(member.end(), std::begin(EMPTY_MEMBER_TAIL), std::end(EMPTY_MEMBER_TAIL));
+
+	WriteFile(member.data(), member.size());
+}
+
+
+
+bool CDemoInputStream::Open(const std::string& fileName)
+{
+	assert(file == nullptr);
+
+	if ((file = fopen(fileName.c_str(), "rb")) == nullptr)
+		return false;
+
+	if (!ReadIndex()) {
+		Close();
+		return false;
+	}
+
+	inBuffer.resize(IN_BUFFER_SIZE);
+	inflateInit2(&zstream, 15 + 16);
+
+	// the header-member is an implicit entry
+	return (SeekEntry({0, 0, 0}));
+}
+
+void CDemoInputStream::Close()
+{
+	if (file == nullptr)
+		return;
+
+	inflateEnd(&zstream);
+	fclose(file);
+
+	file = nullptr;
+	eof = true;
+
+	index.clear();
+}
+
+
+bool CDemoInputStream::ReadIndex()
+{
+	std::uint8_t tail[INDEX_TAIL_SIZE];
+	DemoIndexFooter footer;
+
+	if (fseek(file, 0, SEEK_END) != 0)
+		return false;
+
+	const long fileSize = ftell(file);
+
+	if (fileSize < long(INDEX_HEAD_SIZE + INDEX_TAIL_SIZE))
+		return false;
+
+	fseek(file, fileSize - INDEX_TAIL_SIZE, SEEK_SET);
+
+	if (fread(tail, 1, sizeof(tail), file) != sizeof(tail))
+		return false;
+	if (memcmp(tail + sizeof(footer), EMPTY_MEMBER_TAIL, sizeof(EMPTY_MEMBER_TAIL)) != 0)
+		return false;
+
+	memcpy(&footer, tail, sizeof(footer));
+	footer.swab();
+
+	if (memcmp(footer.magic, DEMOFILE_INDEX_MAGIC, sizeof(footer.magic)) != 0)
+		return false;
+	if (footer.numEntries == 0 || footer.numEntries > DEMOFILE_MAX_INDEX_ENTRIES)
+		return false;
+
+	const size_t entriesSize = footer.numEntries * sizeof(DemoIndexEntry);
+	const long memberPos = fileSize - INDEX_TAIL_SIZE - entriesSize - INDEX_HEAD_SIZE;
+
+	if (memberPos < 0)
+		return false;
+
+	std::vector<std::uint8_t> head(INDEX_HEAD_SIZE);
+
+	fseek(file, memberPos, SEEK_SET);
+
+	if (fread(head.data(), 1, head.size(), file) != head.size())
+		return false;
+	if (head[0] != 0x1f || head[1] != 0x8b || (head[3] & 0x04) == 0)
+		return false;
+	if (head[12] != DEMOFILE_INDEX_SUBFIELD[0] || head[13] != DEMOFILE_INDEX_SUBFIELD[1])
+		return false;
+	if ((head[14] | (head[15] << 8)) != int(entriesSize + sizeof(footer)))
+		return false;
+
+	index.resize(footer.numEntries);
+
+	if (fread(index.data(), sizeof(DemoIndexEntry), index.size(), file) != index.size())
+		return false;
+
+	for (DemoIndexEntry& entry: index) {
+		entry.swab();
+	}
+
+	// entries must be usable for binary searches by position and by frame
+	const auto cmp = [](const DemoIndexEntry& a, const DemoIndexEntry& b) { return (a.streamPos >= b.streamPos || a.frameNum > b.frameNum); };
+	return (std::adjacent_find(index.begin(), index.end(), cmp) == index.end());
+}
+
+
+int CDemoInputStream::Read(void* buf, int length)
+{
+	zstream.next_out  = reinterpret_cast<Bytef*>(buf);
+	zstream.avail_out = length;
+
+	while (!eof && zstream.avail_out > 0) {
+		if (zstream.avail_in == 0) {
+			zstream.next_in  = inBuffer.data();
+			zstream.avail_in = fread(inBuffer.data(), 1, inBuffer.size(), file);
+
+			if (zstream.avail_in == 0) {
+				eof = true;
+				break;
+			}
+		}
+
+		switch (inflate(&zstream, Z_NO_FLUSH)) {
+			case Z_OK: {
+			} break;
+			case Z_STREAM_END: {
+				// continue with the next member
+				inflateReset(&zstream);
+			} break;
+			default: {
+				eof = true;
+			} break;
+		}
+	}
+
+	const int numRead = length - zstream.avail_out;
+	streamPos += numRead;
+	return numRead;
+}
+
+bool CDemoInputStream::Seek(unsigned int pos)
+{
+	if (file == nullptr)
+		return false;
+
+	// last entry at or before <pos>
+	const auto cmp = [](unsigned int pos, const DemoIndexEntry& e) { return (pos < e.streamPos); };
+	const auto iter = std::upper_bound(index.begin(), index.end(), pos, cmp);
+
+	const DemoIndexEntry& entry = (iter == index.begin())? DemoIndexEntry{0, 0, 0}: *(iter - 1);
+
+	// jump unless we are already past the entry (and not past pos)
+	if (pos < streamPos || entry.streamPos > streamPos) {
+		if (!SeekEntry(entry))
+			return false;
+	}
+
+	std::uint8_t skipBuffer[4096];
+
+	while (streamPos < pos && !eof) {
+		Read(skipBuffer, std::min(sizeof(skipBuffer), size_t(pos - streamPos)));
+	}
+
+	return (streamPos == pos);
+}
+
+bool CDemoInputStream::SeekEntry(const DemoIndexEntry& entry)
+{
+	if (fseek(file, entry.filePos, SEEK_SET) != 0)
+		return false;
+
+	inflateReset(&zstream);
+
+	zstream.next_in  = inBuffer.data();
+	zstream.avail_in = 0;
+
+	streamPos = entry.streamPos;
+	eof = false;
+	return true;
+}
+
+
+const DemoIndexEntry* CDemoInputStream::FindEntry(unsigned int frameNum) const
+{
+	const auto cmp = [](unsigned int frameNum, const DemoIndexEntry& e) { return (frameNum < e.frameNum); };
+	const auto iter = std::upper_bound(index.begin(), index.end(), frameNum, cmp);
+
+	if (iter == index.begin())
+		return nullptr;
+
+	return &(*(iter - 1));
+}
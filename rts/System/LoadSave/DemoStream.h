@@ -0,0 +1,105 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef DEMO_STREAM_H
+#define DEMO_STREAM_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "demofile.h"
+
+
+/**
+ * @brief Writes the on-disk (gzip) representation of a demofile
+ *
+ * See DemoIndexEntry for the layout. Not thread-safe; CDemoRecorder drives
+ * this from its writer thread, DemoTool directly.
+ */
+class CDemoOutputStream
+{
+public:
+	CDemoOutputStream() { memset(&zstream, 0, sizeof(zstream)); }
+	~CDemoOutputStream() { Close(); }
+
+	bool Open(const std::string& fileName, int level = 9);
+	bool IsOpen() const { return (file != nullptr); }
+
+	/// finishes the stream, appends the index and closes the file
+	void Close();
+
+	/// header must already be little-endian; the first call reserves its space
+	void WriteHeader(const DemoFileHeader& header);
+	/// if <flush> is true, everything written so far can be inflated afterwards
+	void Write(const void* data, size_t size, bool flush);
+	/// starts a new gzip member (seek-point) at the current position
+	void AddIndexEntry(unsigned int frameNum);
+
+	size_t GetStreamPos() const { return streamPos; }
+	/// true if any write to the file failed since Open (e.g. the disk is full)
+	bool HasWriteError() const { return writeError; }
+
+private:
+	void WriteFile(const void* data, size_t size);
+	void Deflate(const void* data, size_t size, int flush);
+	void WriteIndexMember();
+
+private:
+	FILE* file = nullptr;
+	z_stream zstream;
+
+	size_t streamPos = 0;
+	size_t headerSize = 0;
+	size_t memberSize = 0;
+
+	std::vector<DemoIndexEntry> index;
+
+	bool writeError = false;
+};
+
+
+
+/**
+ * @brief Reads a demofile that carries a seek-index without inflating all of it
+ *
+ * Only keeps one buffer of compressed data in memory; seeking to an arbitrary
+ * position inflates from the nearest preceding index entry.
+ */
+class CDemoInputStream
+{
+public:
+	CDemoInputStream() { memset(&zstream, 0, sizeof(zstream)); }
+	~CDemoInputStream() { Close(); }
+
+	/// fails if <fileName> can not be opened or has no index
+	bool Open(const std::string& fileName);
+	void Close();
+
+	int Read(void* buf, int length);
+	bool Seek(unsigned int pos);
+	bool Eof() const { return eof; }
+
+	unsigned int GetPos() const { return streamPos; }
+
+	/// returns the last entry at or before <frameNum>, or null if there is none
+	const DemoIndexEntry* FindEntry(unsigned int frameNum) const;
+	const std::vector<DemoIndexEntry>& GetIndex() const { return index; }
+
+private:
+	bool ReadIndex();
+	bool SeekEntry(const DemoIndexEntry& entry);
+
+private:
+	FILE* file = nullptr;
+	z_stream zstream;
+
+	std::vector<std::uint8_t> inBuffer;
+	std::vector<DemoIndexEntry> index;
+
+	unsigned int streamPos = 0;
+	bool eof = true;
+};
+
+#endif // DEMO_STREAM_H
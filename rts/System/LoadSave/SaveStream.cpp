@@ -0,0 +1,373 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SaveStream.h"
+#include "System/Threading/ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <zlib.h>
+
+
+// gzip member header with FEXTRA (10 bytes), XLEN and one subfield holding the member size
+static constexpr size_t MEMBER_HEAD_SIZE = 10 + 2 + 4 + 4;
+// CRC32 and ISIZE
+static constexpr size_t MEMBER_TAIL_SIZE = 4 + 4;
+
+static constexpr char MEMBER_SUBFIELD[] = "SB";
+
+
+static void WriteLE32(std::uint8_t* p, std::uint32_t v)
+{
+	p[0] = (v      ) & 0xff;
+	p[1] = (v >>  8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+static std::uint32_t ReadLE32(const std::uint8_t* p)
+{
+	return (p[0] | (p[1] << 8) | (p[2] << 16) | (std::uint32_t(p[3]) << 24));
+}
+
+
+static void DeflateMember(const char* data, size_t size, int level, std::vector<std::uint8_t>& member)
+{
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+
+	// raw deflate, the gzip framing is written here
+	deflateInit2(&zstream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+	member.resize(MEMBER_HEAD_SIZE + deflateBound(&zstream, size) + MEMBER_TAIL_SIZE);
+
+	zstream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	zstream.avail_in  = size;
+	zstream.next_out  = member.data() + MEMBER_HEAD_SIZE;
+	zstream.avail_out = member.size() - MEMBER_HEAD_SIZE - MEMBER_TAIL_SIZE;
+
+	deflate(&zstream, Z_FINISH);
+	member.resize(MEMBER_HEAD_SIZE + zstream.total_out + MEMBER_TAIL_SIZE);
+	deflateEnd(&zstream);
+
+	// magic, CM=deflate, FLG=FEXTRA, MTIME, XFL, OS=unknown
+	const std::uint8_t head[] = {0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 8, 0, MEMBER_SUBFIELD[0], MEMBER_SUBFIELD[1], 4, 0};
+
+	memcpy(member.data(), head, sizeof(head));
+	WriteLE32(member.data() + sizeof(head), member.size());
+
+	std::uint8_t* tail = member.data() + member.size() - MEMBER_TAIL_SIZE;
+
+	WriteLE32(tail + 0, crc32(0, reinterpret_cast<const Bytef*>(data), size));
+	WriteLE32(tail + 4, size);
+}
+
+static bool InflateMember(const std::uint8_t* member, size_t memberSize, char* data, size_t size)
+{
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+	inflateInit2(&zstream, -15);
+
+	zstream.next_in   = const_cast<Bytef*>(member + MEMBER_HEAD_SIZE);
+	zstream.avail_in  = memberSize - MEMBER_HEAD_SIZE - MEMBER_TAIL_SIZE;
+	zstream.next_out  = reinterpret_cast<Bytef*>(data);
+	zstream.avail_out = size;
+
+	const int ret = inflate(&zstream, Z_FINISH);
+	const size_t numOut = zstream.total_out;
+
+	inflateEnd(&zstream);
+
+	if (ret != Z_STREAM_END || numOut != size)
+		return false;
+
+	return (crc32(0, reinterpret_cast<const Bytef*>(data), size) == ReadLE32(member + memberSize - MEMBER_TAIL_SIZE));
+}
+
+
+
+bool CSaveStreamBuf::WriteFile(FILE* file)
+{
+	SyncSize();
+
+	for (size_t n = 0; n < blocks.size(); n++) {
+		if (blocks[n].job == nullptr)
+			CompressBlock(n, (compressionLevel >= 0)? compressionLevel: Z_DEFAULT_COMPRESSION);
+	}
+
+	WaitForBlocks();
+
+	for (const Block& b: blocks) {
+		if (fwrite(b.member.data(), 1, b.member.size(), file) != b.member.size())
+			return false;
+	}
+
+	return true;
+}
+
+bool CSaveStreamBuf::ReadFile(const std::vector<std::uint8_t>& fileData)
+{
+	Clear();
+
+	// files not written by WriteFile (or damaged ones) need a sequential pass
+	if (!InflateMembers(fileData) && !InflateStream(fileData)) {
+		Clear();
+		return false;
+	}
+
+	setp(nullptr, nullptr);
+	return (SetGetPos(0));
+}
+
+void CSaveStreamBuf::Clear()
+{
+	WaitForBlocks();
+
+	blocks.clear();
+
+	setp(nullptr, nullptr);
+	setg(nullptr, nullptr, nullptr);
+
+	dataSize = 0;
+	putBlock = 0;
+	getBlock = 0;
+}
+
+
+
+CSaveStreamBuf::int_type CSaveStreamBuf::overflow(int_type c)
+{
+	// moves to the next block if the current one is full
+	if (!SetPutPos(GetPutPos()))
+		return traits_type::eof();
+
+	if (traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+
+	*pptr() = traits_type::to_char_type(c);
+	pbump(1);
+	return c;
+}
+
+CSaveStreamBuf::int_type CSaveStreamBuf::underflow()
+{
+	if (!SetGetPos(GetGetPos()) || gptr() == egptr())
+		return traits_type::eof();
+
+	return traits_type::to_int_type(*gptr());
+}
+
+
+CSaveStreamBuf::pos_type CSaveStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	SyncSize();
+
+	off_type pos = off;
+
+	switch (dir) {
+		case std::ios_base::cur: { pos += ((which & std::ios_base::out) != 0)? GetPutPos(): GetGetPos(); } break;
+		case std::ios_base::end: { pos += dataSize; } break;
+		default: {} break;
+	}
+
+	return (seekpos(pos_type(pos), which));
+}
+
+CSaveStreamBuf::pos_type CSaveStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	const off_type off = pos;
+
+	if (off < 0)
+		return pos_type(off_type(-1));
+	if ((which & std::ios_base::out) != 0 && !SetPutPos(off))
+		return pos_type(off_type(-1));
+	if ((which & std::ios_base::in) != 0 && !SetGetPos(off))
+		return pos_type(off_type(-1));
+
+	return pos;
+}
+
+
+
+bool CSaveStreamBuf::SetPutPos(size_t pos)
+{
+	SyncSize();
+
+	// no holes
+	if (pos > dataSize)
+		return false;
+
+	const size_t n = pos / BLOCK_SIZE;
+
+	// the writer is done with a full block, unless it seeks back later
+	if (pbase() != nullptr && n != putBlock && compressionLevel >= 0) {
+		if (blocks[putBlock].job == nullptr && (putBlock + 1) * BLOCK_SIZE <= dataSize)
+			CompressBlock(putBlock, compressionLevel);
+	}
+
+	if (n == blocks.size()) {
+		blocks.emplace_back();
+		blocks.back().data.reset(new char[BLOCK_SIZE]);
+	}
+
+	Block& b = blocks[n];
+
+	// block will be modified, compress it again afterwards
+	if (b.job != nullptr) {
+		b.job->Wait();
+		b.job.reset();
+		b.member.clear();
+	}
+
+	putBlock = n;
+
+	setp(b.data.get(), b.data.get() + BLOCK_SIZE);
+	pbump(pos - n * BLOCK_SIZE);
+	return true;
+}
+
+bool CSaveStreamBuf::SetGetPos(size_t pos)
+{
+	SyncSize();
+
+	if (pos > dataSize)
+		return false;
+
+	if (blocks.empty()) {
+		setg(nullptr, nullptr, nullptr);
+		return true;
+	}
+
+	// stay in the last block when at the end of data
+	const size_t n = std::min(pos / BLOCK_SIZE, blocks.size() - 1);
+	const size_t blockSize = std::min(dataSize - n * BLOCK_SIZE, BLOCK_SIZE);
+
+	char* data = blocks[n].data.get();
+
+	getBlock = n;
+
+	setg(data, data + (pos - n * BLOCK_SIZE), data + blockSize);
+	return true;
+}
+
+
+void CSaveStreamBuf::SyncSize()
+{
+	dataSize = std::max(dataSize, GetPutPos());
+}
+
+void CSaveStreamBuf::CompressBlock(size_t n, int level)
+{
+	Block& b = blocks[n];
+
+	const char* data = b.data.get();
+	const size_t size = std::min(dataSize - n * BLOCK_SIZE, BLOCK_SIZE);
+
+	std::vector<std::uint8_t>* member = &b.member;
+	std::shared_ptr<CompressJob> job = std::make_shared<CompressJob>();
+
+	job->task = std::packaged_task<void()>([=]() { DeflateMember(data, size, level, *member); });
+	job->done = job->task.get_future();
+
+	b.job = job;
+
+	ThreadPool::Enqueue([job]() { job->Run(); });
+}
+
+void CSaveStreamBuf::WaitForBlocks()
+{
+	for (Block& b: blocks) {
+		if (b.job != nullptr)
+			b.job->Wait();
+	}
+}
+
+
+bool CSaveStreamBuf::InflateMembers(const std::vector<std::uint8_t>& fileData)
+{
+	std::vector<size_t> memberPositions;
+	std::vector<size_t> memberSizes;
+
+	for (size_t pos = 0; pos < fileData.size(); ) {
+		const std::uint8_t* m = &fileData[pos];
+
+		if ((fileData.size() - pos) < (MEMBER_HEAD_SIZE + MEMBER_TAIL_SIZE))
+			return false;
+		if (m[0] != 0x1f || m[1] != 0x8b || m[2] != 0x08 || m[3] != 0x04 || m[10] != 8 || m[11] != 0)
+			return false;
+		if (m[12] != MEMBER_SUBFIELD[0] || m[13] != MEMBER_SUBFIELD[1] || m[14] != 4 || m[15] != 0)
+			return false;
+
+		const size_t memberSize = ReadLE32(m + 16);
+
+		if (memberSize < (MEMBER_HEAD_SIZE + MEMBER_TAIL_SIZE) || memberSize > (fileData.size() - pos))
+			return false;
+
+		// all blocks but the last are full
+		if (!memberSizes.empty() && ReadLE32(&fileData[memberPositions.back() + memberSizes.back() - 4]) != BLOCK_SIZE)
+			return false;
+		if (ReadLE32(m + memberSize - 4) > BLOCK_SIZE)
+			return false;
+
+		memberPositions.push_back(pos);
+		memberSizes.push_back(memberSize);
+
+		pos += memberSize;
+	}
+
+	if (memberPositions.empty())
+		return false;
+
+	blocks.resize(memberPositions.size());
+
+	for (Block& b: blocks) {
+		b.data.reset(new char[BLOCK_SIZE]);
+	}
+
+	std::vector<std::uint8_t> inflated(blocks.size(), 0);
+
+	for_mt(0, blocks.size(), [&](const int i) {
+		const std::uint8_t* m = &fileData[memberPositions[i]];
+		const size_t size = ReadLE32(m + memberSizes[i] - 4);
+
+		inflated[i] = InflateMember(m, memberSizes[i], blocks[i].data.get(), size);
+	});
+
+	if (std::find(inflated.begin(), inflated.end(), 0) != inflated.end()) {
+		Clear();
+		return false;
+	}
+
+	dataSize = (blocks.size() - 1) * BLOCK_SIZE + ReadLE32(&fileData[memberPositions.back() + memberSizes.back() - 4]);
+	return true;
+}
+
+bool CSaveStreamBuf::InflateStream(const std::vector<std::uint8_t>& fileData)
+{
+	std::vector<char> outBuffer(64 * 1024);
+
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+	inflateInit2(&zstream, 15 + 16);
+
+	zstream.next_in  = const_cast<Bytef*>(fileData.data());
+	zstream.avail_in = fileData.size();
+
+	int ret = Z_OK;
+
+	while (ret == Z_OK) {
+		zstream.next_out  = reinterpret_cast<Bytef*>(outBuffer.data());
+		zstream.avail_out = outBuffer.size();
+
+		// continue with the next member, if any
+		if ((ret = inflate(&zstream, Z_NO_FLUSH)) == Z_STREAM_END && zstream.avail_in > 0)
+			ret = inflateReset(&zstream);
+
+		sputn(outBuffer.data(), outBuffer.size() - zstream.avail_out);
+	}
+
+	inflateEnd(&zstream);
+	SyncSize();
+
+	return (ret == Z_STREAM_END && dataSize > 0);
+}
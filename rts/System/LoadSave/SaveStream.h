@@ -0,0 +1,100 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SAVE_STREAM_H
+#define SAVE_STREAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+
+/**
+ * @brief In-memory savegame state, kept in fixed-size blocks
+ *
+ * Unlike a stringstream, growing never copies the data written so far. With
+ * compression enabled, every block is deflated on the ThreadPool as soon as
+ * the writer moves past it (blocks written to again are redone). Waiting for
+ * a block whose job has not started yet runs it on the waiting thread, so a
+ * pool that was shut down (SpringApp::Kill) can not leave the stream hanging.
+ *
+ * On disk each block is a separate gzip member that records its own size in
+ * an extra subfield, so the file remains readable by gzread while ReadFile can
+ * inflate all members in parallel.
+ */
+class CSaveStreamBuf: public std::streambuf
+{
+public:
+	static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+
+	/// level < 0 means blocks are only kept in memory
+	explicit CSaveStreamBuf(int level = -1): compressionLevel(level) {}
+	~CSaveStreamBuf() override { WaitForBlocks(); }
+
+	CSaveStreamBuf(const CSaveStreamBuf&) = delete;
+	CSaveStreamBuf& operator = (const CSaveStreamBuf&) = delete;
+
+	/// compresses the remaining blocks and writes all of them to <file>
+	bool WriteFile(FILE* file);
+	/// replaces the contents by the inflated <fileData> (any gzip file)
+	bool ReadFile(const std::vector<std::uint8_t>& fileData);
+
+	void Clear();
+
+	size_t GetSize() { SyncSize(); return dataSize; }
+
+protected:
+	int_type overflow(int_type c) override;
+	int_type underflow() override;
+
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+private:
+	struct CompressJob {
+		/// runs the task unless another thread already started it
+		void Run() { if (!started.test_and_set()) task(); }
+		void Wait() { Run(); done.wait(); }
+
+		std::packaged_task<void()> task;
+		std::future<void> done;
+		std::atomic_flag started = ATOMIC_FLAG_INIT;
+	};
+
+	struct Block {
+		std::unique_ptr<char[]> data;
+		// gzip member, valid once the job is done
+		std::vector<std::uint8_t> member;
+		// shared with the ThreadPool, which may drop it without running
+		std::shared_ptr<CompressJob> job;
+	};
+
+	size_t GetPutPos() const { return ((pbase() != nullptr)? (putBlock * BLOCK_SIZE + (pptr() - pbase())): 0); }
+	size_t GetGetPos() const { return ((eback() != nullptr)? (getBlock * BLOCK_SIZE + (gptr() - eback())): 0); }
+
+	bool SetPutPos(size_t pos);
+	bool SetGetPos(size_t pos);
+
+	void SyncSize();
+	void CompressBlock(size_t n, int level);
+	void WaitForBlocks();
+
+	bool InflateMembers(const std::vector<std::uint8_t>& fileData);
+	bool InflateStream(const std::vector<std::uint8_t>& fileData);
+
+private:
+	// deque, pending jobs reference their block
+	std::deque<Block> blocks;
+
+	size_t dataSize = 0;
+	size_t putBlock = 0;
+	size_t getBlock = 0;
+
+	int compressionLevel = -1;
+};
+
+#endif // SAVE_STREAM_H
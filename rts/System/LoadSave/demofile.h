@@ -115,6 +115,49 @@ struct DemoStreamChunkHeader
 	}
 };
 
+
+/**
+ * @brief Spring demo index entry
+ *
+ * On disk, a demofile is a sequence of concatenated gzip members which
+ * together inflate to the layout described above. Since 105.0 the first
+ * member holds only the DemoFileHeader (stored, so it can be rewritten in
+ * place) and the demo stream is split into further members at (some of)
+ * its NETMSG_NEWFRAME packets. Each such split point is recorded as one
+ * DemoIndexEntry; the entries are stored in the extra field (subfield ID
+ * DEMOFILE_INDEX_SUBFIELD) of a trailing empty gzip member, followed by
+ * a DemoIndexFooter. Readers unaware of the index see no extra content.
+ */
+struct DemoIndexEntry
+{
+	std::uint32_t frameNum;  ///< Number of frames preceding the chunk at streamPos.
+	std::uint32_t streamPos; ///< Uncompressed offset of the chunk (from start of file).
+	std::uint32_t filePos;   ///< Compressed offset of the gzip member starting with it.
+
+	void swab() {
+		swabDWordInPlace(frameNum);
+		swabDWordInPlace(streamPos);
+		swabDWordInPlace(filePos);
+	}
+};
+
+/** Follows the DemoIndexEntry array in the index member. */
+struct DemoIndexFooter
+{
+	std::uint32_t numEntries;
+	char magic[4];            ///< DEMOFILE_INDEX_MAGIC (not null-terminated)
+
+	void swab() {
+		swabDWordInPlace(numEntries);
+	}
+};
+
 #pragma pack(pop)
 
+#define DEMOFILE_INDEX_MAGIC "SDFI"
+#define DEMOFILE_INDEX_SUBFIELD "SI"
+
+/** Upper bound so the index fits into a single gzip extra field. */
+#define DEMOFILE_MAX_INDEX_ENTRIES 4096
+
 #endif // DEMO_FILE_H
@@ -0,0 +1,197 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "NetCompression.h"
+#include "RawPacket.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "Sim/Units/CommandAI/Command.h"
+
+#include <zlib.h>
+
+#include <cassert>
+#include <climits>
+
+namespace netcode
+{
+
+// raw deflate, no header or checksum; chunks are already CRC'ed
+static constexpr int WINDOW_BITS = -15;
+
+
+NetCompression::NetCompression(bool compress): compress(compress)
+{
+}
+
+NetCompression::~NetCompression()
+{
+	if (stream == nullptr)
+		return;
+
+	if (compress) {
+		deflateEnd(stream.get());
+	} else {
+		inflateEnd(stream.get());
+	}
+}
+
+
+bool NetCompression::Enable()
+{
+	if (stream != nullptr)
+		return true;
+
+	// value-initialized, zalloc / zfree / opaque are Z_NULL
+	std::unique_ptr<z_stream_s> strm(new z_stream_s());
+
+	const std::vector<std::uint8_t>& dict = GetDictionary();
+
+	if (compress) {
+		if (deflateInit2(strm.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED, WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			return false;
+
+		deflateSetDictionary(strm.get(), dict.data(), dict.size());
+	} else {
+		if (inflateInit2(strm.get(), WINDOW_BITS) != Z_OK)
+			return false;
+
+		inflateSetDictionary(strm.get(), dict.data(), dict.size());
+	}
+
+	stream = std::move(strm);
+	return true;
+}
+
+
+void NetCompression::Compress(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& out)
+{
+	Deflate(data, size, Z_NO_FLUSH, out);
+}
+
+void NetCompression::Flush(std::vector<std::uint8_t>& out)
+{
+	// ends on a byte boundary, the other side can decode everything up to here
+	Deflate(nullptr, 0, Z_SYNC_FLUSH, out);
+}
+
+void NetCompression::Deflate(const std::uint8_t* data, size_t size, int flush, std::vector<std::uint8_t>& out)
+{
+	assert(compress && stream != nullptr);
+
+	const spring_time startTime = spring_gettime();
+	const size_t outSize = out.size();
+
+	stream->next_in = const_cast<Bytef*>(data);
+	stream->avail_in = size;
+
+	// output space left over means all input was consumed (and flushed)
+	do {
+		const size_t pos = out.size();
+		const size_t len = size + 64;
+
+		out.resize(pos + len);
+
+		stream->next_out = &out[pos];
+		stream->avail_out = len;
+
+		deflate(stream.get(), flush);
+
+		out.resize(out.size() - stream->avail_out);
+	} while (stream->avail_out == 0);
+
+	rawBytes += size;
+	packedBytes += (out.size() - outSize);
+	time += (spring_gettime() - startTime);
+}
+
+bool NetCompression::Decompress(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& out)
+{
+	assert(!compress && stream != nullptr);
+
+	const spring_time startTime = spring_gettime();
+	const size_t outSize = out.size();
+
+	stream->next_in = const_cast<Bytef*>(data);
+	stream->avail_in = size;
+
+	int ret = Z_OK;
+
+	do {
+		const size_t pos = out.size();
+		const size_t len = size * 4 + 256;
+
+		out.resize(pos + len);
+
+		stream->next_out = &out[pos];
+		stream->avail_out = len;
+
+		ret = inflate(stream.get(), Z_SYNC_FLUSH);
+
+		out.resize(out.size() - stream->avail_out);
+	} while (ret == Z_OK && stream->avail_out == 0);
+
+	rawBytes += (out.size() - outSize);
+	packedBytes += size;
+	time += (spring_gettime() - startTime);
+
+	// Z_BUF_ERROR only means no progress was possible, i.e. all input consumed
+	return (ret == Z_OK || ret == Z_BUF_ERROR);
+}
+
+
+const std::vector<std::uint8_t>& NetCompression::GetDictionary()
+{
+	// Generated rather than shipped: messages of the kinds that dominate
+	// in-game traffic, packed with typical values. Both ends must produce
+	// the same bytes, which holds for equal protocol versions. zlib finds
+	// matches near the end of the dictionary cheapest, so the most frequent
+	// messages come last.
+	static const std::vector<std::uint8_t> dictionary = []() {
+		CBaseNetProtocol& proto = CBaseNetProtocol::Get();
+
+		const float pos[] = {1024.0f, 64.0f, 1024.0f, 256.0f};
+		const float unitID[] = {1.0f};
+
+		const std::vector<std::int16_t> selection = {1, 2, 3, 4, 5, 6, 7, 8};
+		const std::vector<std::uint8_t> luaMsg = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', ':', ';', ',', '|'};
+
+		const CBaseNetProtocol::PacketType packets[] = {
+			proto.SendMapDrawPoint(0, 1024, 1024, "", false),
+			proto.SendLuaMsg(0, 0, 0, luaMsg),
+			proto.SendSelect(0, selection),
+
+			proto.SendAICommand(0, 0, 0, 1, CMD_STOP, -1, INT_MAX, 0, 0, nullptr),
+			proto.SendAICommand(0, 0, 0, 1, CMD_REPAIR, -1, INT_MAX, 0, 1, unitID),
+			proto.SendAICommand(0, 0, 0, 1, CMD_ATTACK, -1, INT_MAX, 0, 1, unitID),
+			proto.SendAICommand(0, 0, 0, 1, CMD_FIGHT, -1, INT_MAX, 0, 3, pos),
+			proto.SendAICommand(0, 0, 0, 1, CMD_MOVE, -1, INT_MAX, 0, 3, pos),
+
+			proto.SendCommand(0, CMD_STOP, INT_MAX, 0, 0, nullptr),
+			proto.SendCommand(0, CMD_GUARD, INT_MAX, 0, 1, unitID),
+			proto.SendCommand(0, CMD_REPAIR, INT_MAX, 0, 1, unitID),
+			proto.SendCommand(0, CMD_ATTACK, INT_MAX, 0, 1, unitID),
+			proto.SendCommand(0, CMD_PATROL, INT_MAX, 0, 3, pos),
+			proto.SendCommand(0, CMD_FIGHT, INT_MAX, 0, 3, pos),
+			proto.SendCommand(0, CMD_MOVE, INT_MAX, 0, 3, pos),
+
+			proto.SendCPUUsage(0.25f),
+			proto.SendPlayerInfo(0, 0.25f, 64),
+			proto.SendPing(0, 0, 1000.0f),
+			proto.SendSyncResponse(0, 0, 0),
+
+			proto.SendKeyFrame(0),
+			proto.SendNewFrame(),
+			proto.SendNewFrame(),
+		};
+
+		std::vector<std::uint8_t> dict;
+
+		for (const CBaseNetProtocol::PacketType& packet: packets) {
+			dict.insert(dict.end(), packet->data, packet->data + packet->length);
+		}
+
+		return dict;
+	}();
+
+	return dictionary;
+}
+
+}
@@ -0,0 +1,71 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _NET_COMPRESSION_H
+#define _NET_COMPRESSION_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "System/Misc/NonCopyable.h"
+#include "System/Misc/SpringTime.h"
+
+struct z_stream_s;
+
+namespace netcode
+{
+
+/**
+ * @brief zlib stream for one direction of a connection
+ *
+ * Both ends preset the same dictionary of typical protocol messages and the
+ * stream is never reset, so even the smallest messages mostly turn into
+ * back-references. An instance either compresses or decompresses.
+ */
+class NetCompression : spring::noncopyable
+{
+public:
+	/// payload of NETMSG_COMPRESSION
+	enum {
+		MODE_OFFER = 0,
+		MODE_START = 1,
+	};
+
+	NetCompression(bool compress);
+	~NetCompression();
+
+	bool IsEnabled() const { return (stream != nullptr); }
+	/// false if zlib could not be initialized
+	bool Enable();
+
+	/// appends the compressed form of <data> to <out>
+	void Compress(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& out);
+	/// appends whatever is needed to decompress all data passed to Compress so far
+	void Flush(std::vector<std::uint8_t>& out);
+	/// appends the decompressed form of <data> to <out>, false if the stream is corrupt
+	bool Decompress(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& out);
+
+	size_t GetRawBytes() const { return rawBytes; }
+	size_t GetPackedBytes() const { return packedBytes; }
+	/// time spent inside zlib
+	spring_time GetTime() const { return time; }
+
+	static const std::vector<std::uint8_t>& GetDictionary();
+
+private:
+	void Deflate(const std::uint8_t* data, size_t size, int flush, std::vector<std::uint8_t>& out);
+
+private:
+	std::unique_ptr<z_stream_s> stream;
+
+	bool compress;
+
+	size_t rawBytes = 0;
+	size_t packedBytes = 0;
+
+	spring_time time;
+};
+
+}
+
+#endif // _NET_COMPRESSION_H
@@ -69,6 +69,8 @@ private:
 	uint32_t pos;
 };
 
+static_assert(sizeof(PackPacket) <= RawPacket::OBJECT_SIZE, "");
+
 } // namespace netcode
 
 #endif // PACK_PACKET_H
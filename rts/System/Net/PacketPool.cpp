@@ -0,0 +1,102 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "PacketPool.h"
+#include "System/Threading/SpringThreading.h"
+
+#include <atomic>
+#include <new>
+
+namespace netcode
+{
+namespace PacketPool
+{
+
+// MIN_BLOCK_SIZE << i, for i in [0, NUM_CLASSES)
+static constexpr size_t NUM_CLASSES = 10;
+
+static_assert((MIN_BLOCK_SIZE << (NUM_CLASSES - 1)) == MAX_BLOCK_SIZE, "");
+static_assert(MIN_BLOCK_SIZE >= sizeof(void*), "");
+
+
+struct SizeClass {
+	spring::spinlock lock;
+	// intrusive, each free block stores the next one
+	void* freeList = nullptr;
+};
+
+static std::atomic<size_t> numSlabs = {0};
+static std::atomic<size_t> numLargeAllocs = {0};
+
+
+static SizeClass* GetSizeClasses()
+{
+	// packets can be created during static init (protocol singletons, etc)
+	static SizeClass sizeClasses[NUM_CLASSES];
+	return sizeClasses;
+}
+
+static size_t GetClassIndex(size_t size)
+{
+	size_t idx = 0;
+
+	for (size_t blockSize = MIN_BLOCK_SIZE; blockSize < size; blockSize <<= 1)
+		idx++;
+
+	return idx;
+}
+
+
+void* Alloc(size_t size)
+{
+	if (size > MAX_BLOCK_SIZE) {
+		numLargeAllocs += 1;
+		return (::operator new(size));
+	}
+
+	const size_t idx = GetClassIndex(size);
+	const size_t blockSize = MIN_BLOCK_SIZE << idx;
+
+	SizeClass& sc = GetSizeClasses()[idx];
+	std::lock_guard<spring::spinlock> lock(sc.lock);
+
+	if (sc.freeList == nullptr) {
+		std::uint8_t* slab = static_cast<std::uint8_t*>(::operator new(SLAB_SIZE));
+
+		for (size_t offset = 0; offset < SLAB_SIZE; offset += blockSize) {
+			*reinterpret_cast<void**>(slab + offset) = sc.freeList;
+			sc.freeList = slab + offset;
+		}
+
+		numSlabs += 1;
+	}
+
+	void* ptr = sc.freeList;
+	sc.freeList = *reinterpret_cast<void**>(ptr);
+	return ptr;
+}
+
+void Free(void* ptr, size_t size)
+{
+	if (ptr == nullptr)
+		return;
+
+	if (size > MAX_BLOCK_SIZE) {
+		::operator delete(ptr);
+		return;
+	}
+
+	SizeClass& sc = GetSizeClasses()[GetClassIndex(size)];
+	std::lock_guard<spring::spinlock> lock(sc.lock);
+
+	*reinterpret_cast<void**>(ptr) = sc.freeList;
+	sc.freeList = ptr;
+}
+
+
+Stats GetStats()
+{
+	return {numSlabs.load(), numLargeAllocs.load()};
+}
+
+} // namespace PacketPool
+} // namespace netcode
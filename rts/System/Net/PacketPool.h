@@ -0,0 +1,54 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace netcode
+{
+
+/**
+ * @brief Size-class slab allocator for packet payloads and netcode objects
+ *
+ * Blocks are carved out of slabs and recycled through per-class free-lists,
+ * so steady-state traffic does not touch the heap. Slabs are never released.
+ * Requests larger than MAX_BLOCK_SIZE go to operator new. Thread-safe.
+ */
+namespace PacketPool
+{
+	static constexpr size_t MIN_BLOCK_SIZE = 16;
+	static constexpr size_t MAX_BLOCK_SIZE = 8192;
+	static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+	struct Stats {
+		size_t numSlabs;
+		size_t numLargeAllocs;
+	};
+
+	void* Alloc(size_t size);
+	/// <size> must equal the size passed to Alloc
+	void Free(void* ptr, size_t size);
+
+	Stats GetStats();
+}
+
+
+/// std-compatible allocator on top of PacketPool
+template<typename T> struct PacketPoolAllocator {
+	typedef T value_type;
+
+	PacketPoolAllocator() = default;
+	template<typename U> PacketPoolAllocator(const PacketPoolAllocator<U>&) {}
+
+	T* allocate(size_t n) { return static_cast<T*>(PacketPool::Alloc(n * sizeof(T))); }
+	void deallocate(T* p, size_t n) { PacketPool::Free(p, n * sizeof(T)); }
+
+	template<typename U> bool operator == (const PacketPoolAllocator<U>&) const { return true; }
+	template<typename U> bool operator != (const PacketPoolAllocator<U>&) const { return false; }
+};
+
+} // namespace netcode
+
+#endif // PACKET_POOL_H
@@ -3,9 +3,11 @@
 #ifndef RAW_PACKET_H
 #define RAW_PACKET_H
 
+#include <cassert>
 #include <cstdint>
 #include <utility>
 
+#include "PacketPool.h"
 #include "System/Misc/NonCopyable.h"
 
 namespace netcode
@@ -13,6 +15,9 @@ namespace netcode
 
 /**
  * @brief simple structure to hold some data
+ *
+ * Both the payload and (when created with new) the packet itself come from
+ * PacketPool.
  */
 class RawPacket : public spring::noncopyable
 {
@@ -34,13 +39,15 @@ public:
 		if (length == 0)
 			return;
 
-		data = new uint8_t[length];
+		data = static_cast<uint8_t*>(PacketPool::Alloc(length));
 	}
 
 	RawPacket(RawPacket&& p) { *this = std::move(p); }
 	~RawPacket() { Delete(); }
 
 	RawPacket& operator = (RawPacket&& p) {
+		Delete();
+
 		data = p.data;
 		p.data = nullptr;
 
@@ -53,12 +60,18 @@ public:
 		if (length == 0)
 			return;
 
-		delete[] data;
+		PacketPool::Free(data, length);
 		data = nullptr;
 
 		length = 0;
 	}
 
+	// derived packets are also deleted through RawPacket pointers, use one size for all
+	static void* operator new(size_t size) { assert(size <= OBJECT_SIZE); return (PacketPool::Alloc(OBJECT_SIZE)); }
+	static void operator delete(void* p) { PacketPool::Free(p, OBJECT_SIZE); }
+
+	static constexpr size_t OBJECT_SIZE = 32;
+
 	uint8_t* data = nullptr;
 	uint32_t length = 0;
 };
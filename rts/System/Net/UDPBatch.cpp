@@ -0,0 +1,174 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "UDPBatch.h"
+#include "Socket.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace netcode
+{
+
+UDPBatch::UDPBatch(std::shared_ptr<asio::ip::udp::socket> socket, bool enable)
+	: socket(socket)
+	, enabled(enable && IsSupported())
+{
+#if defined(__linux__)
+	msgHeaders.resize(MAX_BATCH_SIZE);
+	msgVectors.resize(MAX_BATCH_SIZE);
+#endif
+
+	if (!enabled)
+		return;
+
+	recvDatagrams.resize(MAX_BATCH_SIZE);
+	recvData.resize(MAX_BATCH_SIZE * MAX_DATAGRAM_SIZE);
+}
+
+
+bool UDPBatch::IsSupported()
+{
+#if defined(__linux__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+void UDPBatch::Send(const asio::ip::udp::endpoint& endpoint, const std::uint8_t* data, size_t size)
+{
+	std::lock_guard<spring::mutex> lock(sendMutex);
+
+	sendQueue.push_back({endpoint, sendData.size(), size});
+	sendData.insert(sendData.end(), data, data + size);
+}
+
+size_t UDPBatch::Flush()
+{
+	std::lock_guard<spring::mutex> lock(sendMutex);
+
+	if (sendQueue.empty())
+		return 0;
+
+	size_t numSent = 0;
+
+#if defined(__linux__)
+	for (size_t i = 0; i < sendQueue.size(); ) {
+		const size_t numMsgs = std::min(sendQueue.size() - i, size_t(MAX_BATCH_SIZE));
+
+		for (size_t n = 0; n < numMsgs; n++) {
+			const QueuedDatagram& dgram = sendQueue[i + n];
+
+			msgVectors[n].iov_base = &sendData[dgram.offset];
+			msgVectors[n].iov_len = dgram.size;
+
+			memset(&msgHeaders[n], 0, sizeof(msgHeaders[n]));
+			msgHeaders[n].msg_hdr.msg_name = const_cast<asio::ip::udp::endpoint::data_type*>(dgram.endpoint.data());
+			msgHeaders[n].msg_hdr.msg_namelen = dgram.endpoint.size();
+			msgHeaders[n].msg_hdr.msg_iov = &msgVectors[n];
+			msgHeaders[n].msg_hdr.msg_iovlen = 1;
+		}
+
+		const int ret = sendmmsg(socket->native_handle(), msgHeaders.data(), numMsgs, 0);
+
+		if (ret > 0) {
+			numSent += ret;
+			i += ret;
+			continue;
+		}
+
+		const int errnum = (ret == 0)? EAGAIN: errno;
+
+		if (errnum == EINTR)
+			continue;
+
+		if (errnum == ENOSYS) {
+			// old kernel, send the rest one by one from now on
+			enabled = false;
+			SendSequential(i);
+			break;
+		}
+
+		// socket buffer full: the unsent rest of the batch is dropped, not
+		// retried here; UDPConnection resends whatever chunks go unacked
+		if (errnum == EAGAIN || errnum == EWOULDBLOCK)
+			break;
+
+		// failure is specific to the first datagram (e.g. unreachable destination)
+		asio::error_code err(errnum, asio::system_category());
+		CheckErrorCode(err);
+
+		i += 1;
+	}
+#else
+	SendSequential(0);
+#endif
+
+	sendQueue.clear();
+	sendData.clear();
+	return numSent;
+}
+
+void UDPBatch::SendSequential(size_t i)
+{
+	for (; i < sendQueue.size(); i++) {
+		const QueuedDatagram& dgram = sendQueue[i];
+
+		asio::ip::udp::socket::message_flags flags = 0;
+		asio::error_code err;
+
+		socket->send_to(asio::buffer(&sendData[dgram.offset], dgram.size), dgram.endpoint, flags, err);
+		CheckErrorCode(err);
+	}
+}
+
+
+size_t UDPBatch::Receive(asio::error_code& err)
+{
+	if (!enabled)
+		return 0;
+
+#if defined(__linux__)
+	for (size_t n = 0; n < MAX_BATCH_SIZE; n++) {
+		msgVectors[n].iov_base = &recvData[n * MAX_DATAGRAM_SIZE];
+		msgVectors[n].iov_len = MAX_DATAGRAM_SIZE;
+
+		memset(&msgHeaders[n], 0, sizeof(msgHeaders[n]));
+		msgHeaders[n].msg_hdr.msg_name = recvDatagrams[n].endpoint.data();
+		msgHeaders[n].msg_hdr.msg_namelen = recvDatagrams[n].endpoint.capacity();
+		msgHeaders[n].msg_hdr.msg_iov = &msgVectors[n];
+		msgHeaders[n].msg_hdr.msg_iovlen = 1;
+	}
+
+	int ret = 0;
+
+	while ((ret = recvmmsg(socket->native_handle(), msgHeaders.data(), MAX_BATCH_SIZE, MSG_DONTWAIT, nullptr)) < 0 && errno == EINTR);
+
+	if (ret < 0) {
+		switch (errno) {
+			case EAGAIN: {} break;
+			case ENOSYS: { enabled = false; } break;
+			default: { err = asio::error_code(errno, asio::system_category()); } break;
+		}
+
+		return 0;
+	}
+
+	for (int n = 0; n < ret; n++) {
+		Datagram& dgram = recvDatagrams[n];
+
+		dgram.endpoint.resize(msgHeaders[n].msg_hdr.msg_namelen);
+		dgram.data = &recvData[n * MAX_DATAGRAM_SIZE];
+		// larger than any packet we send, let it be rejected as too short
+		dgram.size = ((msgHeaders[n].msg_hdr.msg_flags & MSG_TRUNC) == 0)? msgHeaders[n].msg_len: 0;
+	}
+
+	return ret;
+#else
+	return 0;
+#endif
+}
+
+}
@@ -0,0 +1,98 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _UDP_BATCH_H
+#define _UDP_BATCH_H
+
+#include <asio/ip/udp.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "System/Misc/NonCopyable.h"
+#include "System/Threading/SpringThreading.h"
+
+#if defined(__linux__)
+	#include <sys/socket.h>
+#endif
+
+namespace netcode
+{
+
+/**
+ * @brief Batched datagram I/O on one UDP socket
+ *
+ * Send queues datagrams which Flush then writes with as few sendmmsg calls
+ * as possible; Receive reads up to MAX_BATCH_SIZE datagrams per recvmmsg.
+ * Only available on Linux. Becomes disabled when the kernel does not support
+ * these calls, in which case the owner has to use the regular asio path.
+ */
+class UDPBatch : spring::noncopyable
+{
+public:
+	static constexpr unsigned MAX_BATCH_SIZE = 64;
+	/// larger than any MaximumTransmissionUnit, bigger datagrams are received with size 0
+	static constexpr unsigned MAX_DATAGRAM_SIZE = 4096;
+
+	struct Datagram {
+		asio::ip::udp::endpoint endpoint;
+		const std::uint8_t* data;
+		size_t size;
+	};
+
+	UDPBatch(std::shared_ptr<asio::ip::udp::socket> socket, bool enable);
+	~UDPBatch() { Disable(); }
+
+	static bool IsSupported();
+
+	bool IsEnabled() const { return enabled; }
+	/// sends what is still queued, Send must not be called afterwards
+	void Disable() { enabled = false; Flush(); }
+
+	/// thread-safe
+	void Send(const asio::ip::udp::endpoint& endpoint, const std::uint8_t* data, size_t size);
+	/**
+	 * thread-safe, returns the number of datagrams written; the queue is
+	 * always emptied, datagrams the socket has no room for are dropped
+	 */
+	size_t Flush();
+
+	/**
+	 * Receive pending datagrams without blocking, results stay valid until
+	 * the next call.
+	 * @return number of datagrams received, 0 if none are pending or on error
+	 */
+	size_t Receive(asio::error_code& err);
+	const Datagram& GetDatagram(size_t i) const { return recvDatagrams[i]; }
+
+private:
+	void SendSequential(size_t i);
+
+private:
+	struct QueuedDatagram {
+		asio::ip::udp::endpoint endpoint;
+		size_t offset;
+		size_t size;
+	};
+
+	std::shared_ptr<asio::ip::udp::socket> socket;
+
+	std::atomic<bool> enabled;
+
+	spring::mutex sendMutex;
+
+	std::vector<QueuedDatagram> sendQueue;
+	std::vector<std::uint8_t> sendData;
+
+	std::vector<Datagram> recvDatagrams;
+	std::vector<std::uint8_t> recvData;
+
+#if defined(__linux__)
+	std::vector<mmsghdr> msgHeaders;
+	std::vector<iovec> msgVectors;
+#endif
+};
+
+}
+
+#endif // _UDP_BATCH_H
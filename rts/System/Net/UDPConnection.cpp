@@ -7,6 +7,7 @@
 
 #include "Socket.h"
 #include "ProtocolDef.h"
+#include "UDPBatch.h"
 #include "Exception.h"
 #include "Net/Protocol/BaseNetProtocol.h"
 #include "System/Config/ConfigHandler.h"
@@ -24,7 +25,7 @@ CONFIG(bool, UDPConnectionLogDebugMessages).defaultValue(false);
 namespace netcode {
 using namespace asio;
 
-static constexpr unsigned udpMaxPacketSize = 4096;
+static constexpr unsigned udpMaxPacketSize = UDPBatch::MAX_DATAGRAM_SIZE;
 static constexpr int maxChunkSize = 254;
 static constexpr int chunksPerSec = 30;
 
@@ -79,6 +80,19 @@ inline void EMULATE_PACKET_CORRUPTION(std::uint8_t& crc) {}
 #endif
 
 
+static bool IsValidOutgoingPacket(const RawPacket& packet)
+{
+	if (ProtocolDef::GetInstance()->IsValidPacket(packet.data, packet.length))
+		return true;
+
+	LOG_L(L_ERROR,
+		"[UDPConnection::%s] discarding outgoing invalid packet: ID %d, LEN %d",
+		__func__, ((packet.length > 0) ? (int)packet.data[0] : -1), packet.length
+	);
+	return false;
+}
+
+
 class Unpacker
 {
 public:
@@ -96,8 +110,8 @@ public:
 		pos += sizeof(t);
 	}
 
-	void Unpack(std::vector<std::uint8_t>& t, unsigned unpackLength) {
-		std::copy(data + pos, data + pos + unpackLength, std::back_inserter(t));
+	void Unpack(std::uint8_t* t, unsigned unpackLength) {
+		std::copy(data + pos, data + pos + unpackLength, t);
 		pos += unpackLength;
 	}
 
@@ -125,8 +139,8 @@ public:
 		*reinterpret_cast<T*>(&data[pos]) = t;
 	}
 
-	void Pack(std::vector<std::uint8_t>& _data) {
-		std::copy(_data.begin(), _data.end(), std::back_inserter(data));
+	void Pack(const std::uint8_t* _data, unsigned length) {
+		data.insert(data.end(), _data, _data + length);
 	}
 
 private:
@@ -140,8 +154,8 @@ void Chunk::UpdateChecksum(CRC& crc) const {
 	crc << chunkNumber;
 	crc << (unsigned int)chunkSize;
 
-	if (!data.empty()) {
-		crc.Update(&data[0], data.size());
+	if (chunkSize > 0) {
+		crc.Update(&data[0], chunkSize);
 	}
 }
 
@@ -171,7 +185,7 @@ Packet::Packet(const unsigned char* data, unsigned length)
 	chunks.reserve(buf.Remaining() / Chunk::headerSize);
 
 	while (buf.Remaining() > Chunk::headerSize) {
-		ChunkPtr temp(new Chunk);
+		ChunkPtr temp = Chunk::Create();
 		buf.Unpack(temp->chunkNumber);
 		buf.Unpack(temp->chunkSize);
 
@@ -179,7 +193,7 @@ Packet::Packet(const unsigned char* data, unsigned length)
 		if (buf.Remaining() < temp->chunkSize)
 			break;
 
-		buf.Unpack(temp->data, temp->chunkSize);
+		buf.Unpack(temp->data.data(), temp->chunkSize);
 		chunks.push_back(temp);
 	}
 }
@@ -219,22 +233,23 @@ void Packet::Serialize(std::vector<std::uint8_t>& data)
 	buf.Pack(lastContinuous);
 	buf.Pack(nakType);
 	buf.Pack(checksum);
-	buf.Pack(naks);
+	buf.Pack(naks.data(), naks.size());
 
 	for (auto ci = chunks.begin(); ci != chunks.end(); ++ci) {
 		buf.Pack((*ci)->chunkNumber);
 		buf.Pack((*ci)->chunkSize);
-		buf.Pack((*ci)->data);
+		buf.Pack((*ci)->data.data(), (*ci)->chunkSize);
 	}
 }
 
 
 
 
-UDPConnection::UDPConnection(std::shared_ptr<ip::udp::socket> netSocket, const ip::udp::endpoint& myAddr)
+UDPConnection::UDPConnection(std::shared_ptr<ip::udp::socket> netSocket, const ip::udp::endpoint& myAddr, std::shared_ptr<UDPBatch> netBatch)
 	: addr(myAddr)
 	, sharedSocket(true)
 	, mySocket(netSocket)
+	, myBatch(netBatch)
 {
 	Init();
 }
@@ -249,6 +264,7 @@ UDPConnection::UDPConnection(int sourcePort, const std::string& address, const u
 	std::shared_ptr<ip::udp::socket> tempSocket(new ip::udp::socket(
 			netcode::netservice, ip::udp::endpoint(sourceAddr, sourcePort)));
 	mySocket = tempSocket;
+	myBatch.reset(new UDPBatch(mySocket, globalConfig.udpBatchedIO));
 
 	Init();
 }
@@ -276,6 +292,9 @@ void UDPConnection::Init()
 	lastFramePacketRecvTime = spring_gettime();
 	#endif
 
+	outgoingDataOffset = 0;
+	outgoingProcessed = 0;
+
 	lastInOrder = -1;
 	waitingPackets.clear();
 	waitingPackets.reserve(256);
@@ -323,6 +342,10 @@ void UDPConnection::Init()
 #if	NETWORK_TEST
 	lossCounter = 0;
 #endif
+
+	// each end that wants compression offers it, ours starts on receiving the other's offer
+	if (globalConfig.networkCompression)
+		outgoingData.push_back(CBaseNetProtocol::Get().SendCompression(NetCompression::MODE_OFFER));
 }
 
 void UDPConnection::ReconnectTo(CConnection& conn) {
@@ -330,12 +353,13 @@ void UDPConnection::ReconnectTo(CConnection& conn) {
 }
 
 void UDPConnection::CopyConnection(UDPConnection &conn) {
-	conn.InitConnection(addr, mySocket);
+	conn.InitConnection(addr, mySocket, myBatch);
 }
 
-void UDPConnection::InitConnection(ip::udp::endpoint address, std::shared_ptr<ip::udp::socket> socket) {
+void UDPConnection::InitConnection(ip::udp::endpoint address, std::shared_ptr<ip::udp::socket> socket, std::shared_ptr<UDPBatch> batch) {
 	addr = address;
 	mySocket = socket;
+	myBatch = batch;
 }
 
 UDPConnection::~UDPConnection()
@@ -441,9 +465,33 @@ void UDPConnection::Update()
 		// duplicated code with UDPListener
 		netservice.poll();
 
+		if (myBatch->IsEnabled()) {
+			size_t numReceived = 0;
+			asio::error_code err;
+
+			while ((numReceived = myBatch->Receive(err)) > 0) {
+				for (size_t i = 0; i < numReceived; i++) {
+					const UDPBatch::Datagram& dgram = myBatch->GetDatagram(i);
+
+					if (dgram.size < Packet::headerSize)
+						continue;
+
+					Packet data(dgram.data, dgram.size);
+
+					if (IsUsingAddress(dgram.endpoint))
+						ProcessRawPacket(data);
+				}
+
+				if (numReceived < UDPBatch::MAX_BATCH_SIZE || (spring_gettime() - curTime) > spring_msecs(10))
+					break;
+			}
+
+			CheckErrorCode(err);
+		}
+
 		size_t bytesAvailable = 0;
 
-		while ((bytesAvailable = mySocket->available()) > 0) {
+		while (!myBatch->IsEnabled() && (bytesAvailable = mySocket->available()) > 0) {
 			recvBuffer.clear();
 			recvBuffer.resize(bytesAvailable, 0);
 
@@ -600,7 +648,7 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 			continue;
 		}
 
-		waitingPackets.emplace_back(c->chunkNumber, std::move(RawPacket(&c->data[0], c->data.size())));
+		waitingPackets.emplace_back(c->chunkNumber, std::move(RawPacket(&c->data[0], c->chunkSize)));
 		incomingChunkNums.insert(c->chunkNumber);
 	}
 
@@ -624,7 +672,13 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 			fragmentBuffer.Delete();
 		}
 
-		std::copy(wpi->second.data, wpi->second.data + wpi->second.length, std::back_inserter(waitBuffer));
+		if (inflater.IsEnabled()) {
+			// the fragment was already decompressed
+			if (!inflater.Decompress(wpi->second.data, wpi->second.length, waitBuffer))
+				LOG_L(L_ERROR, "\t[%s] corrupt compressed stream in chunk %d", __func__, wpi->first);
+		} else {
+			std::copy(wpi->second.data, wpi->second.data + wpi->second.length, std::back_inserter(waitBuffer));
+		}
 
 		incomingChunkNums.erase(wpi->first);
 		// waitingPackets.erase(wpi);
@@ -644,7 +698,14 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 
 			// this returns false for zero/invalid pktLength
 			if (ProtocolDef::GetInstance()->IsValidLength(pktLength, msgLength)) {
-				msgQueue.emplace_back(new RawPacket(bufp, pktLength));
+				if (*bufp == NETMSG_COMPRESSION) {
+					// link-level, nothing for the client or server to see
+					pos = ProcessCompressionMessage(bufp[1], pos + pktLength)? 0: pos + pktLength;
+					continue;
+				}
+
+				// relayed as-is by the server, keep its control-block out of the heap as well
+				msgQueue.emplace_back(new RawPacket(bufp, pktLength), std::default_delete<const RawPacket>(), PacketPoolAllocator<RawPacket>());
 				std::shared_ptr<const RawPacket>& msgPacket = msgQueue.back();
 
 				#ifdef ENABLE_DEBUG_STATS
@@ -693,6 +754,80 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 	UpdateWaitingPackets();
 }
 
+bool UDPConnection::ProcessCompressionMessage(std::uint8_t mode, unsigned tailPos)
+{
+	switch (mode) {
+		case NetCompression::MODE_OFFER: {
+			if (globalConfig.networkCompression)
+				StartCompression();
+		} break;
+
+		case NetCompression::MODE_START: {
+			if (inflater.IsEnabled() || !inflater.Enable()) {
+				LOG_L(L_ERROR, "\t[UDPConnection::%s] unexpected compression start", __func__);
+				break;
+			}
+
+			// everything behind the marker is compressed
+			compressBuffer.clear();
+
+			if (!inflater.Decompress(waitBuffer.data() + tailPos, waitBuffer.size() - tailPos, compressBuffer))
+				LOG_L(L_ERROR, "\t[UDPConnection::%s] corrupt compressed stream", __func__);
+
+			waitBuffer.swap(compressBuffer);
+			return true;
+		} break;
+
+		default: {
+			LOG_L(L_ERROR, "\t[UDPConnection::%s] unknown compression mode %d", __func__, mode);
+		} break;
+	}
+
+	return false;
+}
+
+void UDPConnection::StartCompression()
+{
+	if (deflater.IsEnabled() || !deflater.Enable())
+		return;
+
+	// what is queued so far goes out as-is, validate it now
+	const auto beg = outgoingData.begin() + (outgoingDataOffset > 0);
+	const auto end = outgoingData.end();
+
+	outgoingData.erase(std::remove_if(beg, end, [](const std::shared_ptr<const RawPacket>& p) { return !IsValidOutgoingPacket(*p); }), end);
+	outgoingData.push_back(CBaseNetProtocol::Get().SendCompression(NetCompression::MODE_START));
+
+	outgoingProcessed = outgoingData.size();
+}
+
+void UDPConnection::CompressOutgoing()
+{
+	if (!deflater.IsEnabled() || outgoingProcessed == outgoingData.size())
+		return;
+
+	unsigned int numCompressed = 0;
+
+	compressBuffer.clear();
+
+	for (auto pi = outgoingData.begin() + outgoingProcessed; pi != outgoingData.end(); ++pi) {
+		if (!IsValidOutgoingPacket(**pi))
+			continue;
+
+		deflater.Compress((*pi)->data, (*pi)->length, compressBuffer);
+		numCompressed += 1;
+	}
+
+	outgoingData.erase(outgoingData.begin() + outgoingProcessed, outgoingData.end());
+
+	if (numCompressed > 0) {
+		deflater.Flush(compressBuffer);
+		outgoingData.emplace_back(new RawPacket(compressBuffer.data(), compressBuffer.size()), std::default_delete<const RawPacket>(), PacketPoolAllocator<RawPacket>());
+	}
+
+	outgoingProcessed = outgoingData.size();
+}
+
 void UDPConnection::Flush(const bool forced)
 {
 	if (muted)
@@ -711,16 +846,23 @@ void UDPConnection::Flush(const bool forced)
 		for (auto pi = outgoingData.begin(); (pi != outgoingData.end()) && (outgoingLength <= requiredLength); ++pi) {
 			outgoingLength += (*pi)->length;
 		}
+
+		outgoingLength -= outgoingDataOffset;
 	}
 
 	if (forced || (!waitMore && outgoingLength > requiredLength)) {
-		std::uint8_t buffer[udpMaxPacketSize];
+		CompressOutgoing();
+
+		ChunkPtr chunk;
 		unsigned pos = 0;
 
 		// Manually fragment packets to respect configured UDP_MTU.
 		// This is an attempt to fix the bug where players drop out
 		// of the game if someone in the game gives a large order.
-		bool partialPacket = false;
+		// Packets are shared between connections, only the offset
+		// into the front one advances; payloads are copied straight
+		// into the chunk that is kept for resends.
+		bool partialPacket = (outgoingDataOffset > 0);
 		bool sendMore = true;
 
 		do {
@@ -730,34 +872,36 @@ void UDPConnection::Flush(const bool forced)
 			if (!outgoingData.empty() && sendMore) {
 				std::shared_ptr<const RawPacket>& packet = *(outgoingData.begin());
 
-				if (!partialPacket && !ProtocolDef::GetInstance()->IsValidPacket(packet->data, packet->length)) {
-					LOG_L(L_ERROR,
-						"[UDPConnection::%s] discarding outgoing invalid packet: ID %d, LEN %d",
-						__func__, ((packet->length > 0) ? (int)packet->data[0] : -1), packet->length
-					);
+				if (!partialPacket && outgoingProcessed == 0 && !IsValidOutgoingPacket(*packet)) {
 					outgoingData.pop_front();
 				} else {
-					const unsigned numBytes = std::min((unsigned)maxChunkSize - pos, packet->length);
+					const unsigned numBytes = std::min((unsigned)maxChunkSize - pos, packet->length - outgoingDataOffset);
 
 					assert(packet->length > 0);
-					memcpy(buffer + pos, packet->data, numBytes);
+
+					if (chunk == nullptr)
+						chunk = Chunk::Create();
+
+					memcpy(chunk->data.data() + pos, packet->data + outgoingDataOffset, numBytes);
 
 					pos += numBytes;
 					sentOverhead += Packet::headerSize;
 
 					outgoing.DataSent(numBytes, true);
 
-					if ((partialPacket = (numBytes != packet->length))) {
+					if ((partialPacket = ((outgoingDataOffset + numBytes) != packet->length))) {
 						// partially transfered
-						packet.reset(new RawPacket(packet->data + numBytes, packet->length - numBytes));
+						outgoingDataOffset += numBytes;
 					} else {
 						// full packet copied
+						outgoingDataOffset = 0;
 						outgoingData.pop_front();
+						outgoingProcessed -= (outgoingProcessed > 0);
 					}
 				}
 			}
 			if ((pos > 0) && (outgoingData.empty() || (pos == maxChunkSize) || !sendMore)) {
-				CreateChunk(buffer, pos, currentPacketChunkNum++);
+				AddChunk(std::move(chunk), pos, currentPacketChunkNum++);
 				pos = 0;
 			}
 		} while (!outgoingData.empty() && sendMore);
@@ -809,6 +953,8 @@ std::string UDPConnection::Statistics() const
 		"\t{%.3fx, %.3fx} relative protocol overhead {up, down}\n",
 		"\t%u incoming chunks dropped, %u outgoing chunks resent\n",
 		"\t%u incoming chunks processed\n",
+		"\t%u bytes compressed   into %u (%.3fx) in %.3fms\n",
+		"\t%u bytes decompressed from %u (%.3fx) in %.3fms\n",
 	};
 
 	std::string msg = "[UDPConnection::Statistics]\n";
@@ -817,6 +963,17 @@ std::string UDPConnection::Statistics() const
 	msg += spring::format(fmts[2], spring::SafeDivide(sentOverhead * 1.0f, dataSent * 1.0f), spring::SafeDivide(recvOverhead * 1.0f, dataRecv * 1.0f));
 	msg += spring::format(fmts[3], droppedChunks, resentChunks);
 	msg += spring::format(fmts[4], lastInOrder + 1);
+
+	for (const NetCompression* nc: {&deflater, &inflater}) {
+		if (!nc->IsEnabled())
+			continue;
+
+		const unsigned int rawBytes = nc->GetRawBytes();
+		const unsigned int packedBytes = nc->GetPackedBytes();
+
+		msg += spring::format(fmts[5 + (nc == &inflater)], rawBytes, packedBytes, spring::SafeDivide(rawBytes * 1.0f, packedBytes * 1.0f), nc->GetTime().toMilliSecsf());
+	}
+
 	return msg;
 }
 
@@ -832,14 +989,12 @@ void UDPConnection::SetMTU(unsigned mtu2)
 	}
 }
 
-void UDPConnection::CreateChunk(const unsigned char* data, const unsigned length, const int packetNum)
+void UDPConnection::AddChunk(ChunkPtr&& chunk, const unsigned length, const int packetNum)
 {
 	assert((length > 0) && (length < 255));
-	ChunkPtr buf(new Chunk);
-	buf->chunkNumber = packetNum;
-	buf->chunkSize = length;
-	std::copy(data, data + length, std::back_inserter(buf->data));
-	newChunks.push_back(buf);
+	chunk->chunkNumber = packetNum;
+	chunk->chunkSize = length;
+	newChunks.push_back(std::move(chunk));
 	lastChunkCreatedTime = spring_gettime();
 }
 
@@ -1032,6 +1187,10 @@ void UDPConnection::SendIfNecessary(bool flushed)
 			break;
 	}
 
+	// shared batches are flushed by the UDPListener
+	if (!sharedSocket)
+		myBatch->Flush();
+
 
 	if (UseMinLossFactor()) {
 		UpdateResendRequests();
@@ -1057,7 +1216,11 @@ void UDPConnection::SendPacket(Packet& pkt)
 	asio::error_code err;
 
 	EMULATE_LATENCY( !EMULATE_PACKET_LOSS( LOSS_COUNTER ) ) {
-		mySocket->send_to(buffer(sendBuffer), addr, flags, err);
+		if (myBatch != nullptr && myBatch->IsEnabled()) {
+			myBatch->Send(addr, sendBuffer.data(), sendBuffer.size());
+		} else {
+			mySocket->send_to(buffer(sendBuffer), addr, flags, err);
+		}
 	}
 
 	if (CheckErrorCode(err))
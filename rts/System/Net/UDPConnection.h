@@ -4,10 +4,13 @@
 #define _UDP_CONNECTION_H
 
 #include <asio/ip/udp.hpp>
+#include <array>
 #include <memory>
 #include <deque>
 
 #include "Connection.h"
+#include "NetCompression.h"
+#include "PacketPool.h"
 #include "System/Misc/SpringTime.h"
 #include "System/UnorderedSet.hpp"
 
@@ -26,16 +29,22 @@ namespace netcode {
 #define PACKET_MAX_LATENCY 1250               // in [milliseconds] maximum latency
 #define ENABLE_DEBUG_STATS
 
+class UDPBatch;
+
 class Chunk
 {
 public:
-	unsigned GetSize() const { return (data.size() + headerSize); }
+	/// chunk and shared_ptr control-block are one PacketPool allocation
+	static std::shared_ptr<Chunk> Create() { return (std::allocate_shared<Chunk>(PacketPoolAllocator<Chunk>())); }
+
+	unsigned GetSize() const { return (chunkSize + headerSize); }
 	void UpdateChecksum(CRC& crc) const;
 	static constexpr unsigned maxSize = 254;
 	static constexpr unsigned headerSize = 5;
 	std::int32_t chunkNumber;
 	std::uint8_t chunkSize;
-	std::vector<std::uint8_t> data;
+	// sized for any chunkSize, incoming chunks are not trusted
+	std::array<std::uint8_t, 255> data;
 };
 typedef std::shared_ptr<Chunk> ChunkPtr;
 
@@ -62,8 +71,8 @@ public:
 	std::int8_t nakType;
 	std::uint8_t checksum;
 
-	std::vector<std::uint8_t> naks;
-	std::vector<ChunkPtr> chunks;
+	std::vector<std::uint8_t, PacketPoolAllocator<std::uint8_t> > naks;
+	std::vector<ChunkPtr, PacketPoolAllocator<ChunkPtr> > chunks;
 };
 
 
@@ -81,7 +90,7 @@ public:
 class UDPConnection : public CConnection
 {
 public:
-	UDPConnection(std::shared_ptr<asio::ip::udp::socket> netSocket, const asio::ip::udp::endpoint& myAddr);
+	UDPConnection(std::shared_ptr<asio::ip::udp::socket> netSocket, const asio::ip::udp::endpoint& myAddr, std::shared_ptr<UDPBatch> netBatch = nullptr);
 	UDPConnection(int sourceport, const std::string& address, const unsigned port);
 	UDPConnection(CConnection& conn);
 	~UDPConnection();
@@ -134,9 +143,13 @@ public:
 
 	const asio::ip::udp::endpoint& GetEndpoint() const { return addr; }
 
+	/// true once both ends agreed to compress what we send
+	bool IsCompressing() const { return deflater.IsEnabled(); }
+
 private:
 	void InitConnection(asio::ip::udp::endpoint address,
-			std::shared_ptr<asio::ip::udp::socket> socket);
+			std::shared_ptr<asio::ip::udp::socket> socket,
+			std::shared_ptr<UDPBatch> batch);
 
 	void CopyConnection(UDPConnection& conn);
 
@@ -145,7 +158,7 @@ private:
 	void Init();
 
 	/// add header to data and send it
-	void CreateChunk(const unsigned char* data, const unsigned length, const int packetNum);
+	void AddChunk(ChunkPtr&& chunk, const unsigned length, const int packetNum);
 	void SendIfNecessary(bool flushed);
 	void AckChunks(int lastAck);
 
@@ -155,6 +168,12 @@ private:
 	void UpdateWaitingPackets();
 	void UpdateResendRequests();
 
+	/// replaces the unprocessed outgoing packets by one compressed block
+	void CompressOutgoing();
+	void StartCompression();
+	/// returns true if the rest of waitBuffer was replaced by its decompressed form
+	bool ProcessCompressionMessage(std::uint8_t mode, unsigned tailPos);
+
 private:
 	spring_time lastChunkCreatedTime;
 	spring_time lastPacketSendTime;
@@ -184,27 +203,36 @@ private:
 	int reconnectTime;
 
 	/// outgoing stuff (pure data without header) waiting to be sent
-	std::deque< std::shared_ptr<const RawPacket> > outgoingData;
+	std::deque< std::shared_ptr<const RawPacket>, PacketPoolAllocator< std::shared_ptr<const RawPacket> > > outgoingData;
+	/// bytes of outgoingData.front() already put into chunks
+	unsigned int outgoingDataOffset;
+	/// leading packets of outgoingData that go into chunks as they are
+	unsigned int outgoingProcessed;
 	/// packets we have received but not yet read
 	std::vector< std::pair<int, RawPacket> > waitingPackets;
 	spring::unordered_set<int> incomingChunkNums;
 
 
 	/// Newly created and not yet sent
-	std::deque<ChunkPtr> newChunks;
+	std::deque<ChunkPtr, PacketPoolAllocator<ChunkPtr> > newChunks;
 	/// packets the other side did not ack'ed until now
-	std::deque<ChunkPtr> unackedChunks;
+	std::deque<ChunkPtr, PacketPoolAllocator<ChunkPtr> > unackedChunks;
 
 	/// Packets the other side missed
 	std::vector< std::pair<std::int32_t, ChunkPtr> > resendRequested;
 	spring::unordered_set<std::int32_t> erasedResendChunks;
 
 	/// complete packets we received but did not yet consume
-	std::deque< std::shared_ptr<const RawPacket> > msgQueue;
+	std::deque< std::shared_ptr<const RawPacket>, PacketPoolAllocator< std::shared_ptr<const RawPacket> > > msgQueue;
 
 	std::vector<std::uint8_t> sendBuffer;
 	std::vector<std::uint8_t> recvBuffer;
 	std::vector<std::uint8_t> waitBuffer;
+	std::vector<std::uint8_t> compressBuffer;
+
+	/// payload streams, enabled per direction through NETMSG_COMPRESSION
+	NetCompression deflater{true};
+	NetCompression inflater{false};
 
 	std::vector<int> droppedPackets;
 
@@ -221,6 +249,8 @@ private:
 
 	/// Our socket
 	std::shared_ptr<asio::ip::udp::socket> mySocket;
+	/// batched I/O on mySocket, flushed by us if the socket is not shared
+	std::shared_ptr<UDPBatch> myBatch;
 
 	RawPacket fragmentBuffer;
 
@@ -14,8 +14,10 @@
 
 
 #include "ProtocolDef.h"
+#include "UDPBatch.h"
 #include "UDPConnection.h"
 #include "Socket.h"
+#include "System/GlobalConfig.h"
 #include "System/Log/ILog.h"
 #include "System/Platform/errorhandler.h"
 #include "System/StringUtil.h" // for IntToString (header only)
@@ -36,10 +38,15 @@ UDPListener::UDPListener(int port, const std::string& ip): acceptNewConnections(
 	socket->non_blocking(true);
 	SetAcceptingConnections(true);
 
-	LOG("[%s] successfully bound socket on port %i", __func__, socket->local_endpoint().port());
+	batch.reset(new UDPBatch(socket, globalConfig.udpBatchedIO));
+
+	LOG("[%s] successfully bound socket on port %i (batched I/O: %d)", __func__, socket->local_endpoint().port(), batch->IsEnabled());
 }
 
 UDPListener::~UDPListener() {
+	// connections can outlive us, make them send directly
+	batch->Disable();
+
 	for (const auto& p: dropMap) {
 		LOG("[%s] dropped %lu packets from unknown IP %s", __func__, (unsigned long) p.second, (p.first).c_str());
 	}
@@ -110,6 +117,48 @@ std::string UDPListener::TryBindSocket(int port, std::shared_ptr<asio::ip::udp::
 void UDPListener::Update() {
 	netservice.poll();
 
+	// recvmmsg may turn out to be unsupported
+	if (batch->IsEnabled())
+		ReceiveBatched();
+	if (!batch->IsEnabled())
+		ReceiveSequential();
+
+	for (auto i = connMap.cbegin(); i != connMap.cend(); ) {
+		if (i->second.expired()) {
+			LOG_L(L_DEBUG, "[UDPListener::%s] connection closed: [%s]:%i", __func__, i->first.address().to_string().c_str(), i->first.port());
+			i = connMap.erase(i);
+			continue;
+		}
+		i->second.lock()->Update();
+		++i;
+	}
+
+	Flush();
+}
+
+void UDPListener::Flush() { batch->Flush(); }
+bool UDPListener::IsBatchedIO() const { return (batch->IsEnabled()); }
+
+
+void UDPListener::ReceiveBatched() {
+	size_t numReceived = 0;
+	asio::error_code err;
+
+	while ((numReceived = batch->Receive(err)) > 0) {
+		for (size_t i = 0; i < numReceived; i++) {
+			const UDPBatch::Datagram& dgram = batch->GetDatagram(i);
+			ProcessPacket(dgram.endpoint, dgram.data, dgram.size);
+		}
+
+		// a partial batch drained the socket
+		if (numReceived < UDPBatch::MAX_BATCH_SIZE)
+			break;
+	}
+
+	CheckErrorCode(err);
+}
+
+void UDPListener::ReceiveSequential() {
 	size_t bytesAvailable = 0;
 
 	while ((bytesAvailable = socket->available()) > 0) {
@@ -122,73 +171,67 @@ void UDPListener::Update() {
 
 		const size_t bytesReceived = socket->receive_from(asio::buffer(recvBuffer), udpEndPoint, msgFlags, err);
 
-		const auto ci = connMap.find(udpEndPoint);
-
-		// known connection but expired
-		if (ci != connMap.end() && ci->second.expired())
-			continue;
-
 		if (CheckErrorCode(err))
 			break;
 
-		if (bytesReceived < Packet::headerSize)
-			continue;
+		ProcessPacket(udpEndPoint, &recvBuffer[0], bytesReceived);
+	}
+}
 
-		Packet data(&recvBuffer[0], bytesReceived);
+void UDPListener::ProcessPacket(const ip::udp::endpoint& udpEndPoint, const std::uint8_t* packetData, size_t packetSize) {
+	const auto ci = connMap.find(udpEndPoint);
 
-		if (ci != connMap.end()) {
-			ci->second.lock()->ProcessRawPacket(data);
-			continue;
-		}
+	// known connection but expired
+	if (ci != connMap.end() && ci->second.expired())
+		return;
 
+	if (packetSize < Packet::headerSize)
+		return;
 
-		// unknown connection but still have the packet, maybe a new client wants to connect from sender's address
-		if (acceptNewConnections && data.lastContinuous == -1 && data.nakType == 0)	{
-			if (!data.chunks.empty() && (*data.chunks.begin())->chunkNumber == 0) {
-				std::shared_ptr<UDPConnection> incoming(new UDPConnection(socket, udpEndPoint));
-				waiting.push(incoming);
-				connMap[udpEndPoint] = incoming;
-				incoming->ProcessRawPacket(data);
-			}
+	Packet data(packetData, packetSize);
 
-			continue;
+	if (ci != connMap.end()) {
+		ci->second.lock()->ProcessRawPacket(data);
+		return;
+	}
+
+
+	// unknown connection but still have the packet, maybe a new client wants to connect from sender's address
+	if (acceptNewConnections && data.lastContinuous == -1 && data.nakType == 0)	{
+		if (!data.chunks.empty() && (*data.chunks.begin())->chunkNumber == 0) {
+			std::shared_ptr<UDPConnection> incoming(new UDPConnection(socket, udpEndPoint, batch));
+			waiting.push(incoming);
+			connMap[udpEndPoint] = incoming;
+			incoming->ProcessRawPacket(data);
 		}
 
+		return;
+	}
 
-		const asio::ip::address& senderAddr = udpEndPoint.address();
-		const std::string& senderIP = senderAddr.to_string();
 
-		if (dropMap.find(senderIP) == dropMap.end()) {
-			LOG_L(L_DEBUG, "[UDPListener::%s] dropping packet from unknown IP: [%s]:%i", __func__, senderIP.c_str(), udpEndPoint.port());
-			dropMap[senderIP] = 0;
-		} else {
-			dropMap[senderIP] += 1;
-		}
+	const asio::ip::address& senderAddr = udpEndPoint.address();
+	const std::string& senderIP = senderAddr.to_string();
 
-	#ifdef DEBUG
-		std::string conns;
-		for (auto it = connMap.cbegin(); it != connMap.cend(); ++it) {
-			conns += spring::format(" [%s]:%i;", it->first.address().to_string().c_str(),it->first.port());
-		}
-		LOG_L(L_DEBUG, "[UDPListener::%s] open connections: %s", __func__, conns.c_str());
-	#endif
+	if (dropMap.find(senderIP) == dropMap.end()) {
+		LOG_L(L_DEBUG, "[UDPListener::%s] dropping packet from unknown IP: [%s]:%i", __func__, senderIP.c_str(), udpEndPoint.port());
+		dropMap[senderIP] = 0;
+	} else {
+		dropMap[senderIP] += 1;
 	}
 
-	for (auto i = connMap.cbegin(); i != connMap.cend(); ) {
-		if (i->second.expired()) {
-			LOG_L(L_DEBUG, "[UDPListener::%s] connection closed: [%s]:%i", __func__, i->first.address().to_string().c_str(), i->first.port());
-			i = connMap.erase(i);
-			continue;
-		}
-		i->second.lock()->Update();
-		++i;
+#ifdef DEBUG
+	std::string conns;
+	for (auto it = connMap.cbegin(); it != connMap.cend(); ++it) {
+		conns += spring::format(" [%s]:%i;", it->first.address().to_string().c_str(),it->first.port());
 	}
+	LOG_L(L_DEBUG, "[UDPListener::%s] open connections: %s", __func__, conns.c_str());
+#endif
 }
 
 
 std::shared_ptr<UDPConnection> UDPListener::SpawnConnection(const std::string& ip, const unsigned port)
 {
-	std::shared_ptr<UDPConnection> newConn(new UDPConnection(socket, ip::udp::endpoint(WrapIP(ip), port)));
+	std::shared_ptr<UDPConnection> newConn(new UDPConnection(socket, ip::udp::endpoint(WrapIP(ip), port), batch));
 	connMap[newConn->GetEndpoint()] = newConn;
 	return newConn;
 }
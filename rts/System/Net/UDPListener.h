@@ -6,12 +6,14 @@
 #include "System/Misc/NonCopyable.h"
 #include <memory>
 #include <asio/ip/udp.hpp>
+#include <cstdint>
 #include <map>
 #include <queue>
 #include <string>
 
 namespace netcode
 {
+class UDPBatch;
 class UDPConnection;
 
 /**
@@ -55,6 +57,15 @@ public:
 	 */
 	void Update();
 
+	/**
+	 * @brief Send what connections have queued for batched I/O
+	 * Called by Update, should also be called once after flushing
+	 * connections outside of it.
+	 */
+	void Flush();
+
+	bool IsBatchedIO() const;
+
 	/**
 	 * Set if we are accepting new connections
 	 * or drop all data from unconnected addresses.
@@ -75,6 +86,12 @@ public:
 	void RejectConnection() { waiting.pop(); }
 	void UpdateConnections(); // Updates connections when the endpoint has been reconnected
 
+private:
+	void ReceiveBatched();
+	void ReceiveSequential();
+
+	void ProcessPacket(const asio::ip::udp::endpoint& udpEndPoint, const std::uint8_t* packetData, size_t packetSize);
+
 private:
 	/**
 	 * @brief Do we accept packets from unknown sources?
@@ -84,6 +101,8 @@ private:
 
 	/// socket being listened on
 	std::shared_ptr<asio::ip::udp::socket> socket;
+	/// shared with all connections on <socket>, used if enabled
+	std::shared_ptr<UDPBatch> batch;
 
 	std::vector<std::uint8_t> recvBuffer;
 
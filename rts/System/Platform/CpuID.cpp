@@ -314,4 +314,43 @@ namespace springproc {
 		}
 	}
 
+
+
+	bool HasAVX2()
+	{
+		uint32_t regs[REG_CNT] = {0, 0, 0, 0};
+
+		ExecCPUID(&regs[REG_EAX], &regs[REG_EBX], &regs[REG_ECX], &regs[REG_EDX]);
+
+		if (regs[REG_EAX] < 7)
+			return false;
+
+		regs[REG_EAX] = 1;
+		regs[REG_ECX] = 0;
+		ExecCPUID(&regs[REG_EAX], &regs[REG_EBX], &regs[REG_ECX], &regs[REG_EDX]);
+
+		// AVX plus OS support for saving the YMM state (OSXSAVE)
+		if (((regs[REG_ECX] >> 27) & 1) == 0 || ((regs[REG_ECX] >> 28) & 1) == 0)
+			return false;
+
+		uint32_t xcr0 = 0;
+
+		#if (__is_x86_arch__ == 1 && defined(__GNUC__))
+		uint32_t xcr0h = 0;
+		__asm__ __volatile__("xgetbv" : "=a" (xcr0), "=d" (xcr0h) : "c" (0));
+		#elif (__is_x86_arch__ == 1 && defined(_MSC_VER))
+		xcr0 = _xgetbv(0);
+		#endif
+
+		// XMM and YMM state both enabled
+		if ((xcr0 & 6) != 6)
+			return false;
+
+		regs[REG_EAX] = 7;
+		regs[REG_ECX] = 0;
+		ExecCPUID(&regs[REG_EAX], &regs[REG_EBX], &regs[REG_ECX], &regs[REG_EDX]);
+
+		return (((regs[REG_EBX] >> 5) & 1) != 0);
+	}
+
 }
@@ -14,6 +14,9 @@
 namespace springproc {
 	_noinline void ExecCPUID(unsigned int* a, unsigned int* b, unsigned int* c, unsigned int* d);
 
+	/** True if the processor and OS both support AVX2 instructions. */
+	bool HasAVX2();
+
 	/** Class to detect the processor topology, more specifically,
 	    for now it can detect the number of real (not hyper threaded
 	    core.
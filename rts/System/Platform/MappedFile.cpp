@@ -0,0 +1,85 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include <cstdint>
+
+#include "MappedFile.h"
+
+
+bool CMappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	const HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart <= 0 || static_cast<unsigned long long>(fileSize.QuadPart) > SIZE_MAX) {
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	// the view keeps the file mapped after both handles are closed
+	const HANDLE mapHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapHandle != nullptr) {
+		data = static_cast<const unsigned char*>(MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0));
+		size = (data != nullptr)? static_cast<size_t>(fileSize.QuadPart): 0;
+
+		CloseHandle(mapHandle);
+	}
+
+	CloseHandle(fileHandle);
+#else
+	const int fileDesc = open(path.c_str(), O_RDONLY);
+
+	if (fileDesc < 0)
+		return false;
+
+	struct stat fileStat;
+
+	if (fstat(fileDesc, &fileStat) != 0 || fileStat.st_size <= 0) {
+		close(fileDesc);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	void* ptr = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fileDesc, 0);
+
+	if (ptr != MAP_FAILED) {
+		data = static_cast<const unsigned char*>(ptr);
+		size = fileStat.st_size;
+	}
+
+	close(fileDesc);
+#endif
+
+	return (data != nullptr);
+}
+
+void CMappedFile::Close()
+{
+	if (data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap(const_cast<unsigned char*>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
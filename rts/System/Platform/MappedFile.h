@@ -0,0 +1,55 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+/**
+ * @brief read-only memory-mapped file
+ *
+ * Maps an entire file into the address space, so its contents
+ * can be used in-place instead of being read into a buffer.
+ * The mapping is released by Close or on destruction.
+ */
+class CMappedFile
+{
+public:
+	CMappedFile() = default;
+	CMappedFile(const CMappedFile&) = delete;
+	CMappedFile(CMappedFile&& f) { *this = std::move(f); }
+	~CMappedFile() { Close(); }
+
+	CMappedFile& operator = (const CMappedFile&) = delete;
+	CMappedFile& operator = (CMappedFile&& f) {
+		if (this != &f) {
+			Close();
+
+			data = f.data; f.data = nullptr;
+			size = f.size; f.size = 0;
+		}
+
+		return *this;
+	}
+
+	/**
+	 * @brief map a file
+	 * @param path absolute path of the file
+	 * @return false if the file does not exist, is empty, or can not be mapped
+	 */
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return (data != nullptr); }
+
+	const unsigned char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+};
+
+#endif // MAPPED_FILE_H
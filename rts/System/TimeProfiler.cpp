@@ -176,6 +176,7 @@ void CTimeProfiler::ResetState() {
 
 	profiles.clear();
 	profiles.reserve(128);
+	counters.clear();
 	sortedProfiles.clear();
 	#ifdef THREADPOOL
 	threadProfiles.clear();
@@ -396,6 +397,32 @@ void CTimeProfiler::AddTimeRaw(
 	}
 }
 
+void CTimeProfiler::SetCounter(const char* name, std::int64_t value)
+{
+	std::lock_guard<spring::spinlock> lock(profileMutex);
+
+	auto& counter = counters[hashString(name)];
+
+	// names need not outlive the counter, e.g. those of Lua handles
+	if (counter.first.empty())
+		counter.first = name;
+
+	counter.second = value;
+}
+
+std::int64_t CTimeProfiler::GetCounter(const char* name) const
+{
+	std::lock_guard<spring::spinlock> lock(profileMutex);
+
+	const auto it = counters.find(hashString(name));
+
+	if (it == counters.end())
+		return 0;
+
+	return ((it->second).second);
+}
+
+
 void CTimeProfiler::PrintProfilingInfo() const
 {
 	if (sortedProfiles.empty())
@@ -409,5 +436,28 @@ void CTimeProfiler::PrintProfilingInfo() const
 
 		LOG("%35s %16.2fms %5.2f%%", name.c_str(), tr.total.toMilliSecsf(), tr.stats.y * 100);
 	}
+
+	std::vector< std::pair<std::string, std::int64_t> > sortedCounters;
+
+	{
+		std::lock_guard<spring::spinlock> lock(profileMutex);
+
+		for (const auto& counter: counters) {
+			sortedCounters.push_back(counter.second);
+		}
+	}
+
+	if (sortedCounters.empty())
+		return;
+
+	std::sort(sortedCounters.begin(), sortedCounters.end(), [](const std::pair<std::string, std::int64_t>& a, const std::pair<std::string, std::int64_t>& b) {
+		return (a.first < b.first);
+	});
+
+	LOG("%35s|%18s", "Counter", "Last Value");
+
+	for (const auto& counter: sortedCounters) {
+		LOG("%35s %18" PRId64, counter.first.c_str(), counter.second);
+	}
 }
 
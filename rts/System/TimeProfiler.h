@@ -4,6 +4,7 @@
 #define TIME_PROFILER_H
 
 #include <atomic>
+#include <cinttypes>
 #include <cstring> // memset
 #include <string>
 #include <deque>
@@ -183,8 +184,14 @@ public:
 		const bool threadTimer
 	);
 
+	// non-time statistics (queue depths, latencies in frames, ...)
+	// sampled by the caller
+	void SetCounter(const char* name, std::int64_t value);
+	std::int64_t GetCounter(const char* name) const;
+
 private:
 	spring::unordered_map<unsigned, TimeRecord> profiles;
+	spring::unordered_map<unsigned, std::pair<std::string, std::int64_t> > counters;
 
 	std::vector< std::pair<std::string, TimeRecord> > sortedProfiles;
 	std::vector< std::deque< std::pair<spring_time, spring_time> > > threadProfiles;
@@ -127,10 +127,43 @@ bool COutputStreamSerializer::IsWriting()
 	return true;
 }
 
+COutputStreamSerializer::ObjectRef* COutputStreamSerializer::AllocObjectRef(void* inst, bool isEmbedded, creg::Class* objClass)
+{
+	// blocks are kept between packages, only the first use allocates
+	if (numObjects == int(objectBlocks.size() * OBJECT_BLOCK_SIZE))
+		objectBlocks.emplace_back(new ObjectRef[OBJECT_BLOCK_SIZE]);
+
+	ObjectRef* obj = GetObjectRef(numObjects);
+	*obj = ObjectRef(inst, numObjects++, isEmbedded, objClass);
+
+	if (inst == nullptr)
+		return obj;
+
+	// append to the chain of objects sharing this address
+	ObjectRef*& ref = ptrToId[inst];
+
+	if (ref == nullptr) {
+		ref = obj;
+	} else {
+		ObjectRef* last = ref;
+
+		while (last->nextRef != nullptr)
+			last = last->nextRef;
+
+		last->nextRef = obj;
+	}
+
+	return obj;
+}
+
 COutputStreamSerializer::ObjectRef* COutputStreamSerializer::FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
 {
-	std::vector<ObjectRef*>& refs = ptrToId[inst];
-	for (auto& obj: refs) {
+	const auto it = ptrToId.find(inst);
+
+	if (it == ptrToId.end())
+		return nullptr;
+
+	for (ObjectRef* obj = it->second; obj != nullptr; obj = obj->nextRef) {
 		if (obj->isThisObject(inst, objClass, isEmbedded))
 			return obj;
 	}
@@ -139,54 +172,34 @@ COutputStreamSerializer::ObjectRef* COutputStreamSerializer::FindObjectRef(void*
 
 void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* objr)
 {
-	const unsigned objstart = stream->tellp();
+	// per-class statistics are only gathered for debug output, tellp is not free
+	const bool gatherStats = LOG_IS_ENABLED(L_DEBUG);
+	const unsigned objstart = gatherStats? unsigned(stream->tellp()): 0u;
 
 	if (c->base())
 		SerializeObject(c->base(), ptr, objr);
 
-	ObjectMemberGroup omg;
-	omg.membersClass = c;
-	omg.size = 0;
-
 	for (uint a = 0; a < c->members.size(); a++)
 	{
 		creg::Class::Member* m = &c->members[a];
 		if (m->flags & CM_NoSerialize)
 			continue;
 
-		ObjectMember om;
-		om.member = m;
-		om.memberId = a;
 		void* memberAddr = ((char*)ptr) + m->offset;
-		unsigned mstart = stream->tellp();
 		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s", c->name, m->name, m->type->GetName().c_str());
 		m->type->Serialize(this, memberAddr);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
-		LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s::%s type:%s size:%d", c->name, m->name, m->type->GetName().c_str(), om.size);
 	}
 
 
-	if (c->HasSerialize()) {
-		ObjectMember om;
-		om.member = nullptr;
-		om.memberId = -1;
-		unsigned mstart = stream->tellp();
+	if (c->HasSerialize())
 		c->CallSerializeProc(ptr, this);
-		unsigned mend = stream->tellp();
-		om.size = mend - mstart;
-		omg.members.push_back(om);
-		omg.size += om.size;
-	}
 
-	objr->memberGroups.push_back(omg);
+	if (!gatherStats)
+		return;
 
-	const unsigned objend = stream->tellp();
-	const int sz = objend - objstart;
-	classSizes[c] += sz;
-	classCounts[c]++;
+	ClassStats& stats = classStats[c];
+	stats.size += (unsigned(stream->tellp()) - objstart);
+	stats.count += 1;
 }
 
 void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* objClass)
@@ -194,18 +207,14 @@ void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* o
 	// register the object, and mark it as embedded if a pointer was already referencing it
 	ObjectRef* obj = FindObjectRef(inst, objClass, true);
 	if (!obj) {
-		objects.emplace_back(inst, objects.size(), true, objClass);
-		obj = &objects.back();
-		ptrToId[inst].push_back(obj);
+		obj = AllocObjectRef(inst, true, objClass);
 	} else if (obj->isEmbedded) {
 		throw std::string("Reserialization of embedded object (") + objClass->name + ")";
+	} else if (!obj->isPending) {
+		throw std::string("Object pointer was serialized (") + objClass->name + ")";
 	} else {
-		std::vector<ObjectRef*>::iterator it = std::find(pendingObjects.begin(), pendingObjects.end(), obj);
-		if (it == pendingObjects.end()) {
-			throw std::string("Object pointer was serialized (") + objClass->name + ")";
-		} else {
-			pendingObjects.erase(it);
-		}
+		// still listed in pendingObjects, but skipped by SavePackage
+		obj->isPending = false;
 	}
 	obj->class_ = objClass;
 	obj->isEmbedded = true;
@@ -221,17 +230,14 @@ void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objCla
 {
 	if (*ptr) {
 		// valid pointer, write a one and the object ID
-		int id;
 		ObjectRef* obj = FindObjectRef(*ptr, objClass, false);
 		if (!obj) {
-			objects.emplace_back(*ptr, objects.size(), false, objClass);
-			obj = &objects.back();
-			ptrToId[*ptr].push_back(obj);
+			obj = AllocObjectRef(*ptr, false, objClass);
+			obj->isPending = true;
 			pendingObjects.push_back(obj);
 		}
-		id = obj->id;
 
-		WriteVarSizeUInt(stream, id);
+		WriteVarSizeUInt(stream, obj->id);
 	} else {
 		// null pointer, write a zero
 		WriteVarSizeUInt(stream, 0);
@@ -279,34 +285,41 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	ph.objDataOffset = (int)stream->tellp();
 
 	// Insert dummy object with id 0
-	objects.emplace_back(nullptr, 0, true, nullptr);
-	ObjectRef* obj = &objects.back();
-	obj->classIndex = 0;
+	AllocObjectRef(nullptr, true, nullptr);
 
 	// Insert the first object that will provide references to everything
-	objects.emplace_back(rootObj, objects.size(), false, rootObjClass);
-	obj = &objects.back();
-	ptrToId[rootObj].push_back(obj);
-	pendingObjects.push_back(obj);
+	ObjectRef* rootRef = AllocObjectRef(rootObj, false, rootObjClass);
+	rootRef->isPending = true;
+	pendingObjects.push_back(rootRef);
+
+	std::vector<ObjectRef*> po;
 
 	// Save until all the referenced objects have been stored
 	while (!pendingObjects.empty())
 	{
-		const std::vector<ObjectRef*> po = pendingObjects;
+		po.clear();
+
+		// skip objects that became embedded after being referenced
+		for (ObjectRef* obj: pendingObjects) {
+			if (!obj->isPending)
+				continue;
+
+			obj->isPending = false;
+			po.push_back(obj);
+		}
+
 		pendingObjects.clear();
 
 		for (ObjectRef* obj: po) {
 			SerializeObject(obj->class_, obj->ptr, obj);
-			//LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG, "Serialized %s size:%i", obj->class_->name.c_str(), sz);
 		}
 	}
 
 	// Collect a set of all used classes
 	std::map<creg::Class*, ClassRef> classMap;
 	std::vector<ClassRef*> classRefs;
-	for (ObjectRef& oRef: objects) {
-		if (oRef.ptr == nullptr)
-			continue;
+	for (int i = 1; i < numObjects; i++) {
+		ObjectRef& oRef = *GetObjectRef(i);
 
 		creg::Class* c = oRef.class_;
 		while (c) {
@@ -326,13 +339,11 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 
 
 	if (LOG_IS_ENABLED(L_DEBUG)) {
-		for (auto &it: classSizes) {
+		for (const auto& it: classStats) {
 			LOG_L(L_DEBUG, "%30s %10u %10u",
 					it.first->name,
-					classCounts[it.first],
-					it.second);
-			it.second = 0;
-			classCounts[it.first] = 0;
+					it.second.count,
+					it.second.size);
 		}
 	}
 
@@ -347,8 +358,9 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 
 	// Write object info
 	ph.objTableOffset = (int)stream->tellp();
-	ph.numObjects = objects.size();
-	for (ObjectRef& oRef: objects) {
+	ph.numObjects = numObjects;
+	for (int i = 0; i < numObjects; i++) {
+		const ObjectRef& oRef = *GetObjectRef(i);
 		int classRefIndex = oRef.classIndex;
 		char isEmbedded = oRef.isEmbedded ? 1 : 0;
 		WriteVarSizeUInt(stream, classRefIndex);
@@ -372,13 +384,13 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 
 	LOG_SL(LOG_SECTION_CREG_SERIALIZER, L_DEBUG,
 			"Checksum: %X\nNumber of objects saved: %i\nNumber of classes involved: %i",
-			ph.metadataChecksum, int(objects.size()), int(classRefs.size()));
+			ph.metadataChecksum, numObjects, int(classRefs.size()));
 
 	stream->seekp(endOffset);
 	ptrToId.clear();
 	pendingObjects.clear();
-	objects.clear();
-	classSizes.clear();
+	classStats.clear();
+	numObjects = 0;
 }
 
 //-------------------------------------------------------------------------
@@ -8,9 +8,12 @@
 
 #ifdef USING_CREG
 
+#include "System/UnorderedMap.hpp"
+
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <vector>
-#include <deque>
 #include <istream>
 
 namespace creg {
@@ -23,43 +26,26 @@ namespace creg {
 	class COutputStreamSerializer : public ISerializer
 	{
 	protected:
-		struct ObjectMember {
-			Class::Member* member;
-			int memberId;
-			int size;
-		};
-		struct ObjectMemberGroup {
-			Class* membersClass;
-			std::vector<COutputStreamSerializer::ObjectMember> members;
-			int size;
-		};
 		struct ObjectRef {
-			ObjectRef() {
-				ptr = 0;
-				id=0;
-				classIndex=0;
-				isEmbedded=false;
-				class_=0;
-			}
+			ObjectRef() = default;
 			ObjectRef(void* ptr, int id, bool isEmbedded, Class* class_) {
 				this->ptr = ptr;
-				this->id=id;
-				classIndex=0;
-				this->isEmbedded=isEmbedded;
-				this->class_=class_;
-			}
-			ObjectRef(const ObjectRef&src) :memberGroups(src.memberGroups){
-				ptr=src.ptr;
-				id=src.id;
-				classIndex=src.classIndex;
-				isEmbedded=src.isEmbedded;
-				class_=src.class_;
+				this->id = id;
+				this->isEmbedded = isEmbedded;
+				this->class_ = class_;
 			}
-			void* ptr;
-			int id, classIndex;
-			bool isEmbedded;
-			Class* class_;
-			std::vector<COutputStreamSerializer::ObjectMemberGroup> memberGroups;
+
+			void* ptr = nullptr;
+			Class* class_ = nullptr;
+			// next object registered at the same address (embedded members)
+			ObjectRef* nextRef = nullptr;
+
+			int id = 0;
+			int classIndex = 0;
+
+			bool isEmbedded = false;
+			bool isPending = false;
+
 			bool isThisObject(void* objPtr, Class* objClass, bool objEmbedded) const
 			{
 				if (ptr != objPtr) return false;
@@ -77,21 +63,39 @@ namespace creg {
 			}
 		};
 
+		struct ClassStats {
+			unsigned int size = 0;
+			unsigned int count = 0;
+		};
+
+		struct PtrHash {
+			// object addresses are aligned, spread them over the whole bucket range
+			size_t operator() (const void* p) const { return (((std::uint64_t(std::uintptr_t(p)) >> 3) * 0x9E3779B97F4A7C15ull) >> 32); }
+		};
+
+		// ObjectRef's are allocated in blocks, their addresses must stay fixed
+		static constexpr int OBJECT_BLOCK_SIZE = 4096;
+
 		// Temporary class reference
 		struct ClassRef;
 
 		std::ostream* stream;
-		std::map<void*,std::vector<ObjectRef*> > ptrToId;
-		std::deque<ObjectRef> objects;
+
+		// first ObjectRef registered at each address
+		spring::unsynced_map<const void*, ObjectRef*, PtrHash> ptrToId;
+		std::vector< std::unique_ptr<ObjectRef[]> > objectBlocks;
 		std::vector<ObjectRef*> pendingObjects; // these objects still have to be saved
-		std::map<Class*, int> classSizes;
-		std::map<Class*, int> classCounts;
+		std::map<Class*, ClassStats> classStats;
+
+		int numObjects = 0;
 
 		// Serialize all class names
 		void WriteObjectInfo();
 		// Helper for instance/ptr saving
 		void WriteObjectRef(void* inst, Class* cls, bool embedded);
 
+		ObjectRef* AllocObjectRef(void* inst, bool isEmbedded, Class* objClass);
+		ObjectRef* GetObjectRef(int id) { return &objectBlocks[id / OBJECT_BLOCK_SIZE][id % OBJECT_BLOCK_SIZE]; }
 		ObjectRef* FindObjectRef(void* inst, Class* objClass, bool isEmbedded);
 
 		void SerializeObject(Class* c, void* ptr, ObjectRef* objr);
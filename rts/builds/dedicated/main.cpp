@@ -11,6 +11,7 @@
 #include "Game/GameData.h"
 #include "Game/GameVersion.h"
 #include "Net/GameServer.h"
+#include "Net/SpectatorRelay.h"
 #include "System/Exceptions.h"
 #include "System/GlobalConfig.h"
 #include "System/GlobalRNG.h"
@@ -48,6 +49,11 @@ DEFINE_bool     (isolation,                            false, "Limit the data-di
 DEFINE_string_EX(isolation_dir,    "isolation-dir",    "",    "Specify the isolation-mode data-dir (see --isolation)");
 DEFINE_bool     (nocolor,                              false, "Disables colorized stdout");
 DEFINE_uint32   (sleeptime,                            1,     "Number of seconds to sleep between game-over checks");
+DEFINE_string   (relay,                                "",    "Relay the game hosted at <ip>:<port> to spectators instead of hosting one");
+DEFINE_uint32   (relayport,                            8453,  "Port on which spectators connect to the relay (the host's default is 8452)");
+DEFINE_uint32   (relayclients,                         256,   "Maximum number of spectators connected to the relay");
+DEFINE_string_EX(relay_name,       "relay-name",       "SpectatorRelay", "Player name of the relay in the relayed game");
+DEFINE_string_EX(relay_password,   "relay-password",   "",    "Password of the relay's player in the relayed game");
 
 #ifdef __cplusplus
 extern "C"
@@ -74,7 +80,7 @@ void ParseCmdLine(int argc, char* argv[], std::string& scriptName)
 	if (argc >= 2)
 		scriptName = argv[1];
 
-	if (scriptName.empty() && !FLAGS_list_config_vars) {
+	if (scriptName.empty() && FLAGS_relay.empty() && !FLAGS_list_config_vars) {
 		gflags::ShowUsageWithFlags(argv[0]);
 		exit(1);
 	}
@@ -106,6 +112,31 @@ void ParseCmdLine(int argc, char* argv[], std::string& scriptName)
 
 
 
+static void RunSpectatorRelay()
+{
+	// <ip>:<port>, IPv6 addresses in brackets
+	const size_t sepPos = FLAGS_relay.rfind(':');
+
+	if (sepPos == std::string::npos)
+		throw content_error("relay address must be given as <ip>:<port>: " + FLAGS_relay);
+
+	std::string hostIP = FLAGS_relay.substr(0, sepPos);
+
+	if (hostIP.size() >= 2 && hostIP.front() == '[' && hostIP.back() == ']')
+		hostIP = hostIP.substr(1, hostIP.size() - 2);
+
+	const int hostPort = std::atoi(FLAGS_relay.c_str() + sepPos + 1);
+
+	LOG("starting spectator relay...");
+
+	CSpectatorRelay relay(hostIP, hostPort, FLAGS_relayport, FLAGS_relay_name, FLAGS_relay_password, FLAGS_relayclients);
+
+	while (!relay.HasFinished()) {
+		spring_secs(FLAGS_sleeptime).sleep(true);
+	}
+}
+
+
 int main(int argc, char* argv[])
 {
 	Threading::SetMainThread();
@@ -121,7 +152,7 @@ int main(int argc, char* argv[])
 		std::string scriptText;
 		std::string binaryName = argv[0];
 
-		gflags::SetUsageMessage("Usage: " + binaryName + " [options] path_to_script.txt");
+		gflags::SetUsageMessage("Usage: " + binaryName + " [options] path_to_script.txt\n       " + binaryName + " [options] --relay <ip>:<port>");
 		gflags::SetVersionString(SpringVersion::GetFull());
 		gflags::ParseCommandLineFlags(&argc, &argv, true);
 		ParseCmdLine(argc, argv, scriptName);
@@ -133,6 +164,18 @@ int main(int argc, char* argv[])
 		// Initialize crash reporting
 		CrashHandler::Install();
 
+		if (!FLAGS_relay.empty()) {
+			RunSpectatorRelay();
+
+			LOG("exiting");
+			FileSystemInitializer::Cleanup();
+			DataDirLocater::FreeInstance();
+
+			spring_clock::PopTickRate();
+			LOG("exited");
+			return 0;
+		}
+
 		LOG("report any errors to Mantis or the forums.");
 		LOG("loading script from file: %s", scriptName.c_str());
 
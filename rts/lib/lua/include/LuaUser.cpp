@@ -310,12 +310,10 @@ void spring_lua_alloc_get_stats(SLuaAllocState* state)
 #endif
 }
 
-bool spring_lua_alloc_skip_gc(float gcLoadMult)
+float spring_lua_alloc_get_load()
 {
-	// randomly skip a GC cycle with probability 1 - (weighted memory load ratio)
-	const float rawLoadRatio = float(gLuaAllocState.allocedBytes.load()) / float(MAX_ALLOC_BYTES[__archBits__ == 64]);
-	const float modLoadRatio = gcLoadMult * rawLoadRatio;
-	return (lguRNG.NextFloat() > modLoadRatio);
+	// fraction of the global allocation limit in use by all states
+	return (float(gLuaAllocState.allocedBytes.load()) / float(MAX_ALLOC_BYTES[__archBits__ == 64]));
 }
 
 bool spring_lua_alloc_get_error(SLuaAllocError* error)
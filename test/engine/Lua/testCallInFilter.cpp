@@ -0,0 +1,398 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "LuaInclude.h"
+#include "Lua/LuaOpenGL.h"
+#include "Sim/Units/Unit.h"
+#include "Sim/Units/UnitDef.h"
+#include "System/EventClient.h"
+#include "System/EventHandler.h"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+// EventHandler.cpp toggles these around draw call-ins, none are run here
+void LuaOpenGL::EnableDrawGenesis() {}
+void LuaOpenGL::ResetDrawGenesis() {}
+void LuaOpenGL::DisableDrawGenesis() {}
+void LuaOpenGL::EnableDrawWorld() {}
+void LuaOpenGL::ResetDrawWorld() {}
+void LuaOpenGL::DisableDrawWorld() {}
+void LuaOpenGL::EnableDrawWorldPreUnit() {}
+void LuaOpenGL::ResetDrawWorldPreUnit() {}
+void LuaOpenGL::DisableDrawWorldPreUnit() {}
+void LuaOpenGL::EnableDrawWorldShadow() {}
+void LuaOpenGL::ResetDrawWorldShadow() {}
+void LuaOpenGL::DisableDrawWorldShadow() {}
+void LuaOpenGL::EnableDrawWorldReflection() {}
+void LuaOpenGL::ResetDrawWorldReflection() {}
+void LuaOpenGL::DisableDrawWorldReflection() {}
+void LuaOpenGL::EnableDrawWorldRefraction() {}
+void LuaOpenGL::ResetDrawWorldRefraction() {}
+void LuaOpenGL::DisableDrawWorldRefraction() {}
+void LuaOpenGL::EnableDrawScreenCommon() {}
+void LuaOpenGL::ResetDrawScreenCommon() {}
+void LuaOpenGL::DisableDrawScreenCommon() {}
+void LuaOpenGL::EnableDrawInMiniMap() {}
+void LuaOpenGL::ResetDrawInMiniMap() {}
+void LuaOpenGL::DisableDrawInMiniMap() {}
+void LuaOpenGL::EnableDrawInMiniMapBackground() {}
+void LuaOpenGL::ResetDrawInMiniMapBackground() {}
+void LuaOpenGL::DisableDrawInMiniMapBackground() {}
+
+
+// gadgets share one handle; B's filter is given as a map, C has none
+static const std::map<std::string, std::string> GADGET_FILES = {
+	{"LuaRules/Gadgets/a.lua",
+		"function gadget:GetInfo() return {name = 'A', layer = 0, enabled = true} end\n"
+		"function gadget:Initialize() gadgetHandler:SetCallInFilter('UnitCreated', {unitDefIDs = {1}}) end\n"
+		"function gadget:UnitCreated(unitID, unitDefID, teamID) table.insert(_G.seen.A, unitDefID) end\n"
+	},
+	{"LuaRules/Gadgets/b.lua",
+		"function gadget:GetInfo() return {name = 'B', layer = 0, enabled = true} end\n"
+		"function gadget:Initialize() gadgetHandler:SetCallInFilter('UnitCreated', {unitDefIDs = {[2] = true}}) end\n"
+		"function gadget:UnitCreated(unitID, unitDefID, teamID) table.insert(_G.seen.B, unitDefID) end\n"
+	},
+	{"LuaRules/Gadgets/c.lua",
+		"function gadget:GetInfo() return {name = 'C', layer = 0, enabled = false} end\n"
+		"function gadget:UnitCreated(unitID, unitDefID, teamID) table.insert(_G.seen.C, unitDefID) end\n"
+	},
+};
+
+
+/// stands in for a CLuaHandle running the stock gadget handler
+class CTestLuaHandle: public CEventClient {
+public:
+	CTestLuaHandle(lua_State* L): CEventClient("LuaRules", 1000, true), L(L) {}
+
+	bool WantsEvent(const std::string& name) override {
+		lua_getglobal(L, name.c_str());
+		const bool isFunc = lua_isfunction(L, -1);
+		lua_pop(L, 1);
+		return isFunc;
+	}
+	bool GetFullRead() const override { return true; }
+
+	void UnitCreated(const CUnit* unit, const CUnit* builder) override {
+		calledFor.push_back(unit->unitDef->id);
+
+		lua_getglobal(L, "UnitCreated");
+		lua_pushnumber(L, unit->id);
+		lua_pushnumber(L, unit->unitDef->id);
+		lua_pushnumber(L, unit->team);
+
+		if (lua_pcall(L, 3, 0, 0) != 0) {
+			FAIL_CHECK(lua_tostring(L, -1));
+			lua_pop(L, 1);
+		}
+	}
+
+	lua_State* L;
+	std::vector<int> calledFor;
+};
+
+/// a handle that never filters
+class CTestClient: public CEventClient {
+public:
+	CTestClient(): CEventClient("Test", 2000, true) { eventHandler.AddClient(this); }
+
+	bool WantsEvent(const std::string& name) override { return (name == "UnitCreated"); }
+	bool GetFullRead() const override { return true; }
+
+	void UnitCreated(const CUnit* unit, const CUnit* builder) override { calledFor.push_back(unit->unitDef->id); }
+
+	std::vector<int> calledFor;
+};
+
+static CTestLuaHandle* testHandle = nullptr;
+static std::vector<std::string> logErrors;
+
+
+static int VFS_Include(lua_State* L)
+{
+	const std::string fileName = std::string(SPRINGCONTENT_DIR) + luaL_checkstring(L, 1);
+
+	if (luaL_loadfile(L, fileName.c_str()) != 0)
+		return luaL_error(L, "%s", lua_tostring(L, -1));
+
+	if (lua_istable(L, 2)) {
+		lua_pushvalue(L, 2);
+		lua_setfenv(L, -2);
+	}
+
+	lua_call(L, 0, 1);
+	return 1;
+}
+
+static int VFS_DirList(lua_State* L)
+{
+	lua_newtable(L);
+
+	int n = 0;
+	for (const auto& p: GADGET_FILES) {
+		lua_pushstring(L, p.first.c_str());
+		lua_rawseti(L, -2, ++n);
+	}
+
+	return 1;
+}
+
+static int VFS_LoadFile(lua_State* L)
+{
+	const auto it = GADGET_FILES.find(luaL_checkstring(L, 1));
+
+	if (it == GADGET_FILES.end())
+		return 0;
+
+	lua_pushstring(L, it->second.c_str());
+	return 1;
+}
+
+static int Spring_Log(lua_State* L)
+{
+	if (lua_tostring(L, 2) != nullptr && strcmp(lua_tostring(L, 2), "error") == 0)
+		logErrors.push_back(luaL_optstring(L, 3, ""));
+
+	return 0;
+}
+
+static int Script_UpdateCallIn(lua_State* L)
+{
+	const std::string name = luaL_checkstring(L, 1);
+
+	if (testHandle->WantsEvent(name)) {
+		eventHandler.InsertEvent(testHandle, name);
+	} else {
+		eventHandler.RemoveEvent(testHandle, name);
+	}
+
+	return 0;
+}
+
+static int Script_SetCallInFilter(lua_State* L)
+{
+	const std::string name = luaL_checkstring(L, 1);
+
+	SUnitEventFilter filter;
+
+	// the handler always passes {[id] = true} maps
+	if (lua_istable(L, 2)) {
+		lua_getfield(L, 2, "unitDefIDs");
+
+		if (lua_istable(L, -1)) {
+			filter.unitDefIDs.resize(1, false);
+
+			for (lua_pushnil(L); lua_next(L, -2) != 0; lua_pop(L, 1)) {
+				const int id = lua_toint(L, -2);
+				filter.unitDefIDs.resize(std::max(filter.unitDefIDs.size(), size_t(id + 1)), false);
+				filter.unitDefIDs[id] = true;
+			}
+		}
+
+		lua_pop(L, 1);
+	}
+
+	lua_pushboolean(L, eventHandler.SetUnitEventFilter(testHandle, name, filter));
+	return 1;
+}
+
+static int ReturnTrue(lua_State* L) { lua_pushboolean(L, true); return 1; }
+static int ReturnFalse(lua_State* L) { lua_pushboolean(L, false); return 1; }
+static int ReturnName(lua_State* L) { lua_pushstring(L, "LuaRules"); return 1; }
+static int DoNothing(lua_State* L) { return 0; }
+
+
+static void SetFunction(lua_State* L, const char* name, lua_CFunction func)
+{
+	lua_pushcfunction(L, func);
+	lua_setfield(L, -2, name);
+}
+
+static void SetupGlobals(lua_State* L)
+{
+	lua_newtable(L);
+	SetFunction(L, "Include", VFS_Include);
+	SetFunction(L, "DirList", VFS_DirList);
+	SetFunction(L, "LoadFile", VFS_LoadFile);
+	lua_pushstring(L, "r"); lua_setfield(L, -2, "RAW_ONLY");
+	lua_pushstring(L, "M"); lua_setfield(L, -2, "ZIP_ONLY");
+	lua_setglobal(L, "VFS");
+
+	lua_newtable(L);
+	SetFunction(L, "Log", Spring_Log);
+	SetFunction(L, "Echo", DoNothing);
+	SetFunction(L, "IsDevLuaEnabled", ReturnFalse);
+	SetFunction(L, "IsCheatingEnabled", ReturnFalse);
+	lua_setglobal(L, "Spring");
+
+	lua_newtable(L);
+	SetFunction(L, "GetName", ReturnName);
+	SetFunction(L, "GetSynced", ReturnTrue);
+	SetFunction(L, "UpdateCallIn", Script_UpdateCallIn);
+	SetFunction(L, "SetCallInFilter", Script_SetCallInFilter);
+	SetFunction(L, "Kill", DoNothing);
+	lua_setglobal(L, "Script");
+
+	lua_newtable(L);
+	lua_pushstring(L, "info"); lua_setfield(L, -2, "INFO");
+	lua_pushstring(L, "warning"); lua_setfield(L, -2, "WARNING");
+	lua_pushstring(L, "error"); lua_setfield(L, -2, "ERROR");
+	lua_setglobal(L, "LOG");
+
+	lua_newtable(L); lua_setglobal(L, "UnitDefs");
+	lua_newtable(L); lua_setglobal(L, "FeatureDefs");
+	lua_newtable(L); lua_setglobal(L, "WeaponDefs");
+
+	lua_pushcfunction(L, DoNothing);
+	lua_setglobal(L, "SendToUnsynced");
+
+	REQUIRE(luaL_dostring(L, "seen = {A = {}, B = {}, C = {}}") == 0);
+}
+
+static void RunLua(lua_State* L, const char* code)
+{
+	const int ret = luaL_dostring(L, code);
+
+	INFO(code << ": " << ((ret != 0)? lua_tostring(L, -1): ""));
+	REQUIRE(ret == 0);
+}
+
+static std::vector<int> GetSeen(lua_State* L, const char* gadgetName)
+{
+	std::vector<int> seen;
+
+	lua_getglobal(L, "seen");
+	lua_getfield(L, -1, gadgetName);
+
+	for (int i = 1; ; i++) {
+		lua_rawgeti(L, -1, i);
+
+		if (lua_isnil(L, -1)) {
+			lua_pop(L, 1);
+			break;
+		}
+
+		seen.push_back(lua_toint(L, -1));
+		lua_pop(L, 1);
+	}
+
+	lua_pop(L, 2);
+	return seen;
+}
+
+
+/// fakes just the parts of units the event handler and filters read
+struct TestUnits {
+	TestUnits() {
+		memset(defStorage, 0, sizeof(defStorage));
+		memset(unitStorage, 0, sizeof(unitStorage));
+
+		for (int i = 0; i < NUM_UNITS; i++) {
+			UnitDef* def = reinterpret_cast<UnitDef*>(&defStorage[i * sizeof(UnitDef)]);
+			CUnit* unit = reinterpret_cast<CUnit*>(&unitStorage[i * sizeof(CUnit)]);
+
+			def->id = i + 1;
+			unit->id = i;
+			unit->unitDef = def;
+		}
+	}
+
+	void CreateAll() {
+		for (int i = 0; i < NUM_UNITS; i++) {
+			eventHandler.UnitCreated(reinterpret_cast<const CUnit*>(&unitStorage[i * sizeof(CUnit)]), nullptr);
+		}
+	}
+
+	static constexpr int NUM_UNITS = 3;
+
+	alignas(UnitDef) unsigned char defStorage[NUM_UNITS * sizeof(UnitDef)];
+	alignas(CUnit) unsigned char unitStorage[NUM_UNITS * sizeof(CUnit)];
+};
+
+
+TEST_CASE("CallInFilter")
+{
+	lua_State* L = luaL_newstate();
+	REQUIRE(L != nullptr);
+	luaL_openlibs(L);
+
+	CTestLuaHandle handle(L);
+	CTestClient client;
+	TestUnits units;
+
+	testHandle = &handle;
+	logErrors.clear();
+
+	SetupGlobals(L);
+	eventHandler.AddClient(&handle);
+
+	const std::string handlerFile = std::string(SPRINGCONTENT_DIR) + "LuaGadgets/gadgets.lua";
+	REQUIRE(luaL_dofile(L, handlerFile.c_str()) == 0);
+
+	CHECK(logErrors.empty());
+	RunLua(L, "assert(Script.SetCallInFilter == nil)");
+	RunLua(L, "for _,g in ipairs(gadgetHandler.gadgets) do _G['gadget' .. g.ghInfo.name] = g end");
+	RunLua(L, "assert(gadgetA and gadgetB and not gadgetC)");
+	RunLua(L, "assert(not gadgetA.gadgetHandler:SetCallInFilter('GameFrame', {}))");
+
+	SECTION("Union") {
+		units.CreateAll();
+
+		// unitDef 3 is wanted by neither gadget and never reaches Lua,
+		// each gadget also gets what the other one asked for
+		CHECK(handle.calledFor == std::vector<int>{1, 2});
+		CHECK(GetSeen(L, "A") == std::vector<int>{1, 2});
+		CHECK(GetSeen(L, "B") == std::vector<int>{1, 2});
+		// filters are per handle
+		CHECK(client.calledFor == std::vector<int>{1, 2, 3});
+	}
+
+	SECTION("Unfiltered") {
+		// one gadget without a filter lifts it for the whole handle
+		RunLua(L, "gadgetHandler:EnableGadget('C')");
+		units.CreateAll();
+
+		CHECK(handle.calledFor == std::vector<int>{1, 2, 3});
+		CHECK(GetSeen(L, "C") == std::vector<int>{1, 2, 3});
+
+		// and removing it brings the union back
+		RunLua(L, "gadgetHandler:DisableGadget('C')");
+		handle.calledFor.clear();
+		units.CreateAll();
+
+		CHECK(handle.calledFor == std::vector<int>{1, 2});
+	}
+
+	SECTION("Remove") {
+		RunLua(L, "gadgetB.gadgetHandler:SetCallInFilter('UnitCreated', nil)");
+		units.CreateAll();
+
+		CHECK(handle.calledFor == std::vector<int>{1, 2, 3});
+
+		// only A's own filter is left once B is gone
+		RunLua(L, "gadgetHandler:RemoveGadget(gadgetB)");
+		handle.calledFor.clear();
+		units.CreateAll();
+
+		CHECK(handle.calledFor == std::vector<int>{1});
+		CHECK(GetSeen(L, "A") == std::vector<int>{1, 2, 3, 1});
+
+		// and none at all once A is as well
+		RunLua(L, "gadgetHandler:RemoveGadget(gadgetA)");
+		RunLua(L, "assert(gadgetHandler.callInFilters.UnitCreated == nil)");
+		handle.calledFor.clear();
+		units.CreateAll();
+
+		CHECK(handle.calledFor.empty());
+	}
+
+	CHECK(logErrors.empty());
+
+	eventHandler.RemoveClient(&handle);
+	lua_close(L);
+}
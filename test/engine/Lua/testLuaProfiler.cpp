@@ -0,0 +1,233 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Lua/LuaProfiler.h"
+#include "LuaInclude.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/Misc/SpringTime.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "System/StringHash.h"
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+InitSpringTime ist;
+
+// the profiler only reads the sample period
+struct TestConfigHandler: public ConfigHandler {
+	void SetString(const std::string& key, const std::string& value, bool) override { values[key] = value; }
+	std::string GetString(const std::string& key) const override { const auto it = values.find(key); return ((it != values.end())? it->second: "0"); }
+	bool IsSet(const std::string& key) const override { return (values.find(key) != values.end()); }
+	bool IsReadOnly(const std::string&) const override { return false; }
+	void Delete(const std::string& key) override { values.erase(key); }
+	std::string GetConfigFile() const override { return ""; }
+	const std::map<std::string, std::string> GetData() const override { return values; }
+	std::map<std::string, std::string> GetDataWithoutDefaults() const override { return values; }
+	void Update() override {}
+	void EnableWriting(bool) override {}
+	void AddObserver(ConfigNotifyCallback, void*, const std::vector<std::string>&) override {}
+	void RemoveObserver(void*) override {}
+
+	std::map<std::string, std::string> values = {{"LuaProfilerSamplePeriod", "50"}};
+};
+
+static TestConfigHandler testConfigHandler;
+ConfigHandler* configHandler = &testConfigHandler;
+
+// Dump writes wherever it is told to
+DataDirsAccess dataDirsAccess;
+std::string DataDirsAccess::LocateFile(std::string file, int flags) const { return file; }
+
+
+static const char* TEST_CHUNK =
+	"local function Inner(n)\n"
+	"  local x = 0\n"
+	"  for i = 1, n do x = x + i % 7 end\n"
+	"  return x\n"
+	"end\n"
+	"local function Outer(n)\n"
+	"  return Inner(n) + 1\n"
+	"end\n"
+	"function Update(n)\n"
+	"  local r = Outer(n)\n"
+	"  return r\n"
+	"end\n";
+
+namespace {
+	struct TempFile {
+		TempFile() {
+			const char* tmpName = tmpnam(NULL);
+			assert(tmpName != NULL);
+			fileName = tmpName;
+		}
+		~TempFile() {
+			remove((fileName + ".txt").c_str());
+			remove((fileName + ".folded").c_str());
+		}
+
+		std::string fileName;
+	};
+}
+
+
+static std::map<std::string, std::int64_t> ReadFolded(const std::string& fileName)
+{
+	std::map<std::string, std::int64_t> stacks;
+	std::ifstream file(fileName.c_str());
+
+	for (std::string line; std::getline(file, line); ) {
+		const size_t pos = line.rfind(' ');
+
+		REQUIRE(pos != std::string::npos);
+		REQUIRE(stacks.find(line.substr(0, pos)) == stacks.end());
+
+		stacks[line.substr(0, pos)] = std::stoll(line.substr(pos + 1));
+	}
+
+	return stacks;
+}
+
+static void RunCallIn(lua_State* L, const std::string& handleName, const char* callIn, int n)
+{
+	luaProfiler.BeginCallIn(L, handleName, true, callIn);
+
+	lua_getglobal(L, "Update");
+	lua_pushnumber(L, n);
+	REQUIRE(lua_pcall(L, 1, 1, 0) == 0);
+	lua_pop(L, 1);
+
+	luaProfiler.EndCallIn();
+}
+
+
+TEST_CASE("LuaProfilerFolded")
+{
+	lua_State* L = luaL_newstate();
+	REQUIRE(L != nullptr);
+	luaL_openlibs(L);
+
+	REQUIRE(luaL_loadbuffer(L, TEST_CHUNK, strlen(TEST_CHUNK), "=test") == 0);
+	REQUIRE(lua_pcall(L, 0, 0, 0) == 0);
+
+	const std::string handleName = "TestHandle";
+
+	luaProfiler.Reset();
+	luaProfiler.Enable(true);
+
+	for (int i = 0; i < 10; i++) {
+		RunCallIn(L, handleName, "Update", 200000);
+	}
+
+	luaProfiler.Enable(false);
+
+	TempFile tmp;
+	REQUIRE(luaProfiler.Dump(tmp.fileName));
+
+	const std::map<std::string, std::int64_t> stacks = ReadFolded(tmp.fileName + ".folded");
+	const std::string prefix = "TestHandle::Synced;Update";
+	// Update is called from C and so has no name
+	const std::string hotStack = prefix + ";? test:9;Outer test:6;Inner test:1";
+
+	// each distinct stack is written once, samples of the hot loop land in the innermost function
+	REQUIRE(stacks.find(hotStack) != stacks.end());
+	CHECK(stacks.at(hotStack) > 0);
+
+	std::int64_t total = 0;
+
+	for (const auto& p: stacks) {
+		INFO(p.first);
+		CHECK(p.first.compare(0, prefix.size(), prefix) == 0);
+		CHECK(p.second > 0);
+		total += p.second;
+	}
+
+	// callin totals are exact, every microsecond ends up in some stack
+	std::ifstream txtFile((tmp.fileName + ".txt").c_str());
+	std::string line;
+
+	REQUIRE(std::getline(txtFile, line));
+	REQUIRE(std::getline(txtFile, line));
+
+	std::istringstream fields(line);
+	std::string handle, callIn;
+	std::uint64_t numCalls = 0;
+	float totalMillis = 0.0f;
+
+	fields >> handle >> callIn >> numCalls >> totalMillis;
+
+	CHECK(handle == "TestHandle::Synced");
+	CHECK(callIn == "Update");
+	CHECK(numCalls == 10);
+	CHECK(std::abs(total * 0.001f - totalMillis) < 1.0f);
+
+	luaProfiler.Reset();
+	lua_close(L);
+}
+
+
+TEST_CASE("LuaProfilerCallInNames")
+{
+	lua_State* L = luaL_newstate();
+	REQUIRE(L != nullptr);
+	luaL_openlibs(L);
+
+	REQUIRE(luaL_loadbuffer(L, TEST_CHUNK, strlen(TEST_CHUNK), "=test") == 0);
+	REQUIRE(lua_pcall(L, 0, 0, 0) == 0);
+
+	// callin keys are hashes of the names, these two must still get separate records
+	static_assert(hashString("Ab") == hashString("BA"), "");
+
+	const std::string handleName = "TestHandle";
+
+	luaProfiler.Reset();
+	luaProfiler.Enable(true);
+
+	RunCallIn(L, handleName, "Ab", 200000);
+	RunCallIn(L, handleName, "BA", 200000);
+	RunCallIn(L, handleName, "BA", 200000);
+
+	luaProfiler.Enable(false);
+
+	TempFile tmp;
+	REQUIRE(luaProfiler.Dump(tmp.fileName));
+
+	std::ifstream txtFile((tmp.fileName + ".txt").c_str());
+	std::map<std::string, std::uint64_t> records;
+
+	for (std::string line; std::getline(txtFile, line) && !line.empty(); ) {
+		if (line[0] == '#')
+			continue;
+
+		std::istringstream fields(line);
+		std::string handle, callIn;
+		std::uint64_t numCalls = 0;
+
+		fields >> handle >> callIn >> numCalls;
+		records[handle + ";" + callIn] = numCalls;
+	}
+
+	const std::map<std::string, std::uint64_t> expected = {{"TestHandle::Synced;Ab", 1}, {"TestHandle::Synced;BA", 2}};
+	CHECK(records == expected);
+
+	std::set<std::string> sampled;
+
+	for (const auto& p: ReadFolded(tmp.fileName + ".folded")) {
+		sampled.insert(p.first.substr(0, p.first.find(';', p.first.find(';') + 1)));
+	}
+
+	CHECK(sampled == std::set<std::string>{"TestHandle::Synced;Ab", "TestHandle::Synced;BA"});
+
+	luaProfiler.Reset();
+	lua_close(L);
+}
@@ -0,0 +1,290 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Net/SpectatorRelay.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "Game/GameVersion.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/Net/UDPConnection.h"
+#include "System/Net/UDPListener.h"
+#include "System/GlobalConfig.h"
+#include "System/Misc/SpringTime.h"
+#include "System/Platform/Misc.h"
+#include "System/Platform/Threading.h"
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+// the relay only reads these
+struct TestConfigHandler: public ConfigHandler {
+	void SetString(const std::string& key, const std::string& value, bool) override { values[key] = value; }
+	std::string GetString(const std::string& key) const override { const auto it = values.find(key); return ((it != values.end())? it->second: "0"); }
+	bool IsSet(const std::string& key) const override { return (values.find(key) != values.end()); }
+	bool IsReadOnly(const std::string&) const override { return false; }
+	void Delete(const std::string& key) override { values.erase(key); }
+	std::string GetConfigFile() const override { return ""; }
+	const std::map<std::string, std::string> GetData() const override { return values; }
+	std::map<std::string, std::string> GetDataWithoutDefaults() const override { return values; }
+	void Update() override {}
+	void EnableWriting(bool) override {}
+	void AddObserver(ConfigNotifyCallback, void*, const std::vector<std::string>&) override {}
+	void RemoveObserver(void*) override {}
+
+	std::map<std::string, std::string> values = {{"ServerSleepTime", "5"}, {"SpectatorRelayCacheSize", "256"}};
+};
+
+static TestConfigHandler testConfigHandler;
+ConfigHandler* configHandler = &testConfigHandler;
+
+namespace Platform { std::string GetPlatformStr() { return "test"; } }
+namespace Threading { void SetThreadName(const std::string&) {} }
+
+
+static void InitTimer()
+{
+	static bool inited = false;
+
+	if (inited)
+		return;
+
+	spring_clock::PushTickRate();
+	spring_time::setstarttime(spring_time::gettime(true));
+	inited = true;
+}
+
+template<typename F> static bool WaitFor(F f, int maxMillis = 5000)
+{
+	for (int n = 0; n < maxMillis; n++) {
+		if (f())
+			return true;
+
+		spring_msecs(1).sleep(true);
+	}
+
+	return false;
+}
+
+
+/// stands in for the game-server the relay connects to
+struct StubHost {
+	StubHost(int port): listener(port, "127.0.0.1") {}
+
+	void Update() {
+		listener.Update();
+
+		if (link == nullptr && listener.HasIncomingConnections()) {
+			link = listener.AcceptConnection();
+			link->Unmute();
+		}
+		if (link == nullptr)
+			return;
+
+		for (std::shared_ptr<const netcode::RawPacket> p; (p = link->GetData()) != nullptr; ) {
+			received.push_back(p);
+		}
+	}
+
+	void Send(std::shared_ptr<const netcode::RawPacket> packet) {
+		link->SendData(packet);
+		link->Flush(true);
+	}
+
+	netcode::UDPListener listener;
+	std::shared_ptr<netcode::UDPConnection> link;
+	std::vector< std::shared_ptr<const netcode::RawPacket> > received;
+};
+
+/// a spectator connected to the relay
+struct Spectator {
+	Spectator(int relayPort, const std::string& name): link(new netcode::UDPConnection(0, "127.0.0.1", relayPort)) {
+		link->Unmute();
+		link->SendData(CBaseNetProtocol::Get().SendAttemptConnect(name, "", SpringVersion::GetSync(), "test", 0));
+		link->Flush(true);
+	}
+
+	void Update() {
+		link->Update();
+
+		for (std::shared_ptr<const netcode::RawPacket> p; (p = link->GetData()) != nullptr; ) {
+			received.push_back(p->data[0]);
+		}
+	}
+
+	void Send(std::shared_ptr<const netcode::RawPacket> packet) {
+		link->SendData(packet);
+		link->Flush(true);
+	}
+
+	std::shared_ptr<netcode::UDPConnection> link;
+	std::vector<int> received;
+};
+
+
+static int GetKeyFrameNum(const netcode::RawPacket& packet)
+{
+	int frameNum = -1;
+	memcpy(&frameNum, packet.data + 1, sizeof(frameNum));
+	return frameNum;
+}
+
+
+TEST_CASE("SpectatorRelay")
+{
+	InitTimer();
+
+	globalConfig.linkOutgoingBandwidth = 0;
+
+	StubHost host(12000);
+	CSpectatorRelay relay("127.0.0.1", 12000, 12001, "relay", "", 8);
+
+	REQUIRE(WaitFor([&]() { host.Update(); return !host.received.empty(); }));
+	CHECK(host.received[0]->data[0] == NETMSG_ATTEMPTCONNECT);
+
+	host.received.clear();
+
+	// what a late joiner of the host would get
+	host.link->SendData(CBaseNetProtocol::Get().SendSystemMessage(0, "gamedata"));
+	host.link->SendData(CBaseNetProtocol::Get().SendSetPlayerNum(3));
+
+	for (int i = 0; i < 10; i++) {
+		host.link->SendData(CBaseNetProtocol::Get().SendNewFrame());
+	}
+
+	// live-only
+	host.Send(CBaseNetProtocol::Get().SendCurrentFrameProgress(10));
+
+	REQUIRE(WaitFor([&]() { host.Update(); return !host.received.empty(); }));
+	CHECK(host.received[0]->data[0] == NETMSG_PLAYERNAME);
+
+	std::vector<int> cached = {NETMSG_SYSTEMMSG, NETMSG_SETPLAYERNUM};
+	cached.insert(cached.end(), 10, NETMSG_NEWFRAME);
+
+	Spectator a(12001, "a");
+
+	REQUIRE(WaitFor([&]() { host.Update(); a.Update(); return (a.received.size() >= cached.size()); }));
+	CHECK(a.received == cached);
+
+	SECTION("PingEcho") {
+		a.received.clear();
+		a.Send(CBaseNetProtocol::Get().SendPing(3, 42, 0.0f));
+
+		REQUIRE(WaitFor([&]() { a.Update(); return !a.received.empty(); }));
+		CHECK(a.received[0] == NETMSG_PING);
+	}
+
+	SECTION("LateJoiner") {
+		a.received.clear();
+
+		for (int i = 0; i < 5; i++) {
+			host.link->SendData(CBaseNetProtocol::Get().SendNewFrame());
+		}
+
+		host.Send(CBaseNetProtocol::Get().SendKeyFrame(15));
+
+		REQUIRE(WaitFor([&]() { host.Update(); a.Update(); return (a.received.size() >= 6); }));
+
+		cached.insert(cached.end(), 5, NETMSG_NEWFRAME);
+		cached.push_back(NETMSG_KEYFRAME);
+
+		// the live stream a got is exactly what b has to catch up on
+		Spectator b(12001, "b");
+
+		REQUIRE(WaitFor([&]() { host.Update(); a.Update(); b.Update(); return (b.received.size() >= cached.size()); }));
+		CHECK(b.received == cached);
+		CHECK(relay.GetNumClients() == 2);
+
+		// name in use
+		Spectator c(12001, "a");
+
+		REQUIRE(WaitFor([&]() { c.Update(); return !c.received.empty(); }));
+		CHECK(c.received[0] == NETMSG_QUIT);
+	}
+
+	SECTION("UpstreamDelegate") {
+		Spectator b(12001, "b");
+
+		REQUIRE(WaitFor([&]() { host.Update(); b.Update(); return (b.received.size() >= cached.size()); }));
+		REQUIRE(relay.GetNumClients() == 2);
+
+		host.received.clear();
+
+		// only clients[0] speaks for the relay
+		b.Send(CBaseNetProtocol::Get().SendKeyFrame(100));
+		b.Send(CBaseNetProtocol::Get().SendSyncResponse(3, 100, 1234));
+		b.Send(CBaseNetProtocol::Get().SendCPUUsage(0.5f));
+		a.Send(CBaseNetProtocol::Get().SendKeyFrame(200));
+		a.Send(CBaseNetProtocol::Get().SendSystemMessage(3, "chat stays at the relay"));
+
+		REQUIRE(WaitFor([&]() { host.Update(); return !host.received.empty(); }));
+		// give anything b sent time to arrive as well
+		WaitFor([&]() { host.Update(); return false; }, 200);
+
+		REQUIRE(host.received.size() == 1);
+		CHECK(host.received[0]->data[0] == NETMSG_KEYFRAME);
+		CHECK(GetKeyFrameNum(*host.received[0]) == 200);
+
+		// b takes over once a leaves
+		a.Send(CBaseNetProtocol::Get().SendQuit("bye"));
+
+		REQUIRE(WaitFor([&]() { return (relay.GetNumClients() == 1); }));
+
+		host.received.clear();
+		b.Send(CBaseNetProtocol::Get().SendKeyFrame(300));
+
+		REQUIRE(WaitFor([&]() { host.Update(); return !host.received.empty(); }));
+		CHECK(host.received[0]->data[0] == NETMSG_KEYFRAME);
+		CHECK(GetKeyFrameNum(*host.received[0]) == 300);
+	}
+
+	host.Send(CBaseNetProtocol::Get().SendQuit("done"));
+
+	CHECK(WaitFor([&]() { host.Update(); return relay.HasFinished(); }));
+}
+
+
+TEST_CASE("SpectatorRelayCacheBound")
+{
+	InitTimer();
+
+	globalConfig.linkOutgoingBandwidth = 0;
+	testConfigHandler.SetString("SpectatorRelayCacheSize", "1", false);
+
+	StubHost host(12010);
+	CSpectatorRelay relay("127.0.0.1", 12010, 12011, "relay", "", 8);
+
+	REQUIRE(WaitFor([&]() { host.Update(); return !host.received.empty(); }));
+
+	host.Send(CBaseNetProtocol::Get().SendSetPlayerNum(3));
+
+	Spectator a(12011, "a");
+
+	REQUIRE(WaitFor([&]() { host.Update(); a.Update(); return !a.received.empty(); }));
+
+	// 1.2MB in total, more than the relay may buffer
+	const std::vector<uint8_t> payload(60000, 1);
+	const size_t numMessages = 20;
+
+	for (size_t n = 0; n < numMessages; n++) {
+		host.Send(CBaseNetProtocol::Get().SendLuaMsg(0, 100, 0, payload));
+	}
+
+	// connected spectators still get the live stream
+	REQUIRE(WaitFor([&]() { host.Update(); a.Update(); return (a.received.size() >= (1 + numMessages)); }, 20000));
+	CHECK(a.received.size() == (1 + numMessages));
+
+	// late joiners could no longer catch up
+	Spectator b(12011, "b");
+
+	REQUIRE(WaitFor([&]() { host.Update(); a.Update(); b.Update(); return !b.received.empty(); }));
+	CHECK(b.received[0] == NETMSG_QUIT);
+	CHECK(relay.GetNumClients() == 1);
+
+	host.Send(CBaseNetProtocol::Get().SendQuit("done"));
+
+	CHECK(WaitFor([&]() { host.Update(); return relay.HasFinished(); }));
+	testConfigHandler.SetString("SpectatorRelayCacheSize", "256", false);
+}
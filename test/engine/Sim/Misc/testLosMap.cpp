@@ -0,0 +1,326 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Map/MapDimensions.h"
+#include "Sim/Misc/LosMap.h"
+#include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
+#include "System/Threading/ThreadPool.h"
+#include "System/Threading/SpringThreading.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+MapDimensions mapDims;
+
+InitSpringTime ist;
+
+
+static constexpr int MAP_SIZE = 1024; // heightmap squares
+static constexpr int MIP_LEVEL = 2;
+static constexpr int LOS_SIZE = MAP_SIZE >> MIP_LEVEL;
+
+static constexpr int NUM_ALLYTEAMS = 4;
+static constexpr int NUM_INSTANCES = 4000;
+static constexpr int NUM_BENCH_RUNS = 20;
+static constexpr int NUM_HEIGHTMAPS = 8;
+
+static const char* KERNEL_NAMES[CLosMap::RAYCAST_KERNEL_COUNT] = {"scalar", "SSE", "AVX2"};
+
+
+struct LosMapFixture {
+	LosMapFixture() {
+		Threading::DetectCores();
+		ThreadPool::SetThreadCount(ThreadPool::GetMaxThreads());
+
+		mapDims.mapx = MAP_SIZE;
+		mapDims.mapy = MAP_SIZE;
+		mapDims.Initialize();
+
+		GenerateHeightMap(1234);
+		GenerateInstances(1234);
+
+		InitMaps(refMaps);
+		InitMaps(mtMaps);
+
+		PrepareInstances();
+	}
+
+	void GenerateHeightMap(unsigned int seed) {
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> hgtDist(0.0f, 1.0f);
+
+		const float fx = 0.01f + hgtDist(rng) * 0.04f;
+		const float fy = 0.01f + hgtDist(rng) * 0.04f;
+		const float amp = 50.0f + hgtDist(rng) * 200.0f;
+
+		// rolling hills plus some noise, enough to produce ragged raycasts
+		ctrHeightMap.resize(MAP_SIZE * MAP_SIZE);
+		mipHeightMap.resize(LOS_SIZE * LOS_SIZE);
+
+		for (int y = 0; y < MAP_SIZE; ++y) {
+			for (int x = 0; x < MAP_SIZE; ++x) {
+				ctrHeightMap[y * MAP_SIZE + x] = amp * (std::sin(x * fx) * std::cos(y * fy) + 1.0f) + hgtDist(rng) * 10.0f;
+			}
+		}
+		for (int y = 0; y < LOS_SIZE; ++y) {
+			for (int x = 0; x < LOS_SIZE; ++x) {
+				mipHeightMap[y * LOS_SIZE + x] = ctrHeightMap[(y << MIP_LEVEL) * MAP_SIZE + (x << MIP_LEVEL)];
+			}
+		}
+	}
+
+	void GenerateInstances(unsigned int seed) {
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> posDist(-8, LOS_SIZE + 8);
+		std::uniform_int_distribution<int> radDist(4, 40);
+		std::uniform_int_distribution<int> atDist(0, NUM_ALLYTEAMS - 1);
+
+		instanceMem.clear();
+		instances.clear();
+
+		for (int i = 0; i < NUM_INSTANCES; ++i) {
+			instanceMem.emplace_back(new SLosInstance(i));
+
+			SLosInstance* li = instanceMem.back().get();
+			li->allyteam = atDist(rng);
+			li->radius = radDist(rng);
+			li->basePos = int2(posDist(rng), posDist(rng));
+
+			const int2 hp = int2(Clamp(li->basePos.x, 0, LOS_SIZE - 1), Clamp(li->basePos.y, 0, LOS_SIZE - 1)) * (1 << MIP_LEVEL);
+			li->baseHeight = ctrHeightMap[hp.y * MAP_SIZE + hp.x] + 20.0f;
+
+			instances.push_back(li);
+		}
+	}
+
+	void PrepareInstances() {
+		for_mt(0, instances.size(), [&](const int i) {
+			instances[i]->squares.clear();
+			refMaps[instances[i]->allyteam].PrepareRaycast(instances[i]);
+		});
+	}
+
+	void InitMaps(std::vector<CLosMap>& maps) {
+		maps.clear();
+		maps.resize(NUM_ALLYTEAMS);
+
+		for (CLosMap& m: maps) {
+			m.Init(int2(LOS_SIZE, LOS_SIZE), int2(MAP_SIZE, MAP_SIZE), &ctrHeightMap[0], &mipHeightMap[0], false);
+		}
+	}
+
+	static bool EqualMaps(const std::vector<CLosMap>& a, const std::vector<CLosMap>& b) {
+		for (int at = 0; at < NUM_ALLYTEAMS; ++at) {
+			for (int y = 0; y < LOS_SIZE; ++y) {
+				for (int x = 0; x < LOS_SIZE; ++x) {
+					if (a[at].At(int2(x, y)) != b[at].At(int2(x, y)))
+						return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	static bool EmptyMaps(const std::vector<CLosMap>& a) {
+		for (int at = 0; at < NUM_ALLYTEAMS; ++at) {
+			for (int y = 0; y < LOS_SIZE; ++y) {
+				for (int x = 0; x < LOS_SIZE; ++x) {
+					if (a[at].At(int2(x, y)) != 0)
+						return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	std::vector<float> ctrHeightMap;
+	std::vector<float> mipHeightMap;
+
+	std::vector<std::unique_ptr<SLosInstance>> instanceMem;
+	std::vector<SLosInstance*> instances;
+
+	std::vector<CLosMap> refMaps;
+	std::vector<CLosMap> mtMaps;
+
+	CLosMap::AddInstancesBuffers addBuffers;
+};
+
+
+
+TEST_CASE_METHOD(LosMapFixture, "LosMapAddInstances")
+{
+	LOG("[%s] {NUM,MAX}_THREADS={%d,%d}", __func__, ThreadPool::GetNumThreads(), ThreadPool::MAX_THREADS);
+
+	for (const bool raycast: {true, false}) {
+		for (SLosInstance* li: instances) {
+			if (raycast) {
+				refMaps[li->allyteam].AddRaycast(li, 1);
+			} else {
+				refMaps[li->allyteam].AddCircle(li, 1);
+			}
+		}
+
+		CLosMap::AddInstances(mtMaps, instances, 1, raycast, addBuffers);
+		CHECK(EqualMaps(refMaps, mtMaps));
+
+		CLosMap::AddInstances(mtMaps, instances, -1, raycast, addBuffers);
+		CHECK(EmptyMaps(mtMaps));
+
+		InitMaps(refMaps);
+	}
+}
+
+
+TEST_CASE_METHOD(LosMapFixture, "LosMapAddInstancesConcurrent")
+{
+	// as in CLosHandler::Update, where every LOS type runs AddInstances at once
+	std::vector<CLosMap> maps[4];
+	CLosMap::AddInstancesBuffers buffers[4];
+
+	for (SLosInstance* li: instances) {
+		refMaps[li->allyteam].AddRaycast(li, 1);
+	}
+	for (std::vector<CLosMap>& m: maps) {
+		InitMaps(m);
+	}
+
+	for_mt(0, 4, [&](const int i) {
+		CLosMap::AddInstances(maps[i], instances, 1, true, buffers[i]);
+	});
+
+	for (const std::vector<CLosMap>& m: maps) {
+		CHECK(EqualMaps(refMaps, m));
+	}
+}
+
+
+TEST_CASE_METHOD(LosMapFixture, "LosMapAddInstancesBenchmark")
+{
+	for (const bool raycast: {true, false}) {
+		const spring_time t0 = spring_gettime();
+
+		for (int n = 0; n < NUM_BENCH_RUNS; ++n) {
+			for (SLosInstance* li: instances) {
+				if (raycast) {
+					refMaps[li->allyteam].AddRaycast(li, 1);
+				} else {
+					refMaps[li->allyteam].AddCircle(li, 1);
+				}
+			}
+			for (SLosInstance* li: instances) {
+				if (raycast) {
+					refMaps[li->allyteam].AddRaycast(li, -1);
+				} else {
+					refMaps[li->allyteam].AddCircle(li, -1);
+				}
+			}
+		}
+
+		const spring_time t1 = spring_gettime();
+
+		for (int n = 0; n < NUM_BENCH_RUNS; ++n) {
+			CLosMap::AddInstances(mtMaps, instances, 1, raycast, addBuffers);
+			CLosMap::AddInstances(mtMaps, instances, -1, raycast, addBuffers);
+		}
+
+		const spring_time t2 = spring_gettime();
+
+		const float serialMs = std::max((t1 - t0).toMilliSecsf(), 0.001f);
+		const float stripedMs = std::max((t2 - t1).toMilliSecsf(), 0.001f);
+		const float numUpdates = NUM_BENCH_RUNS * NUM_INSTANCES * 2.0f;
+
+		LOG("[%s][%s] serial: %.2fms (%.1f instances/ms), striped: %.2fms (%.1f instances/ms)",
+			__func__, raycast? "raycast": "circle",
+			serialMs, numUpdates / serialMs,
+			stripedMs, numUpdates / stripedMs
+		);
+
+		CHECK(EmptyMaps(refMaps));
+		CHECK(EmptyMaps(mtMaps));
+	}
+}
+
+
+TEST_CASE_METHOD(LosMapFixture, "LosMapRaycastKernels")
+{
+	const int defKernel = CLosMap::GetRaycastKernel();
+
+	std::vector<std::vector<SLosInstance::RLE>> refSquares(NUM_INSTANCES);
+
+	for (int k = 0; k < CLosMap::RAYCAST_KERNEL_COUNT; ++k) {
+		LOG("[%s] kernel=%s supported=%d default=%d", __func__, KERNEL_NAMES[k], CLosMap::HasRaycastKernel(k), k == defKernel);
+	}
+
+	for (int h = 0; h < NUM_HEIGHTMAPS; ++h) {
+		GenerateHeightMap(h + 1);
+		GenerateInstances(h + 1);
+
+		REQUIRE(CLosMap::SetRaycastKernel(CLosMap::RAYCAST_KERNEL_SCALAR));
+		PrepareInstances();
+
+		for (int i = 0; i < NUM_INSTANCES; ++i) {
+			refSquares[i] = instances[i]->squares;
+		}
+
+		for (int k = CLosMap::RAYCAST_KERNEL_SCALAR + 1; k < CLosMap::RAYCAST_KERNEL_COUNT; ++k) {
+			if (!CLosMap::SetRaycastKernel(k))
+				continue;
+
+			PrepareInstances();
+
+			int numMismatches = 0;
+
+			for (int i = 0; i < NUM_INSTANCES; ++i) {
+				const auto& a = refSquares[i];
+				const auto& b = instances[i]->squares;
+
+				const auto RLEEq = [](const SLosInstance::RLE& x, const SLosInstance::RLE& y) { return (x.start == y.start && x.length == y.length); };
+
+				numMismatches += (a.size() != b.size() || !std::equal(a.begin(), a.end(), b.begin(), RLEEq));
+			}
+
+			INFO("kernel " << KERNEL_NAMES[k] << ", heightmap " << h);
+			CHECK(numMismatches == 0);
+		}
+	}
+
+	CLosMap::SetRaycastKernel(defKernel);
+}
+
+
+TEST_CASE_METHOD(LosMapFixture, "LosMapRaycastKernelsBenchmark")
+{
+	const int defKernel = CLosMap::GetRaycastKernel();
+
+	// single-threaded so the numbers reflect the kernel alone
+	ThreadPool::SetThreadCount(1);
+
+	for (int k = 0; k < CLosMap::RAYCAST_KERNEL_COUNT; ++k) {
+		if (!CLosMap::SetRaycastKernel(k))
+			continue;
+
+		const spring_time t0 = spring_gettime();
+
+		for (int n = 0; n < NUM_BENCH_RUNS; ++n) {
+			PrepareInstances();
+		}
+
+		const spring_time t1 = spring_gettime();
+
+		const float ms = std::max((t1 - t0).toMilliSecsf(), 0.001f);
+
+		LOG("[%s][%s] %.2fms (%.1f raycasts/ms)", __func__, KERNEL_NAMES[k], ms, (NUM_BENCH_RUNS * NUM_INSTANCES) / ms);
+	}
+
+	CLosMap::SetRaycastKernel(defKernel);
+	ThreadPool::SetThreadCount(ThreadPool::GetMaxThreads());
+}
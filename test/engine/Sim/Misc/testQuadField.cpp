@@ -3,12 +3,21 @@
 #include "Sim/Misc/QuadField.h"
 #include "System/float3.h"
 #include "System/SpringMath.h"
+#include "System/Misc/SpringTime.h"
+#include "System/Log/ILog.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
 #include <stdlib.h>
 #include <time.h>
 
 #define CATCH_CONFIG_MAIN
 #include "lib/catch.hpp"
 
+
+InitSpringTime ist;
+
 static inline float randf()
 {
 	return rand() / float(RAND_MAX);
@@ -99,3 +108,259 @@ TEST_CASE("QuadField")
 	INFO("Too little quads returned!");
 	CHECK_FALSE(fail);
 }
+
+
+
+// stand-in for CUnit; the real one spans several KB, so pointer-chasing
+// layouts touch a new cache line (or page) for every object inspected
+struct MockObject {
+	float3 pos;
+	float radius = 0.0f;
+	int id = 0;
+	unsigned int tempNum = 0;
+	char payload[2048];
+};
+
+
+TEST_CASE("QuadFieldSpanQueries")
+{
+	static constexpr int MAP_SQUARES = 512;
+	static constexpr int NUM_OBJECTS = 20000;
+	static constexpr int NUM_QUERIES = 50000;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> posDist(0.0f, MAP_SQUARES * SQUARE_SIZE);
+	std::uniform_real_distribution<float> radDist(8.0f, 64.0f);
+	std::uniform_real_distribution<float> qryDist(50.0f, 500.0f);
+
+	float3::maxxpos = MAP_SQUARES * SQUARE_SIZE - 1;
+	float3::maxzpos = MAP_SQUARES * SQUARE_SIZE - 1;
+
+	quadField.Kill();
+	quadField.Init(int2(MAP_SQUARES, MAP_SQUARES), CQuadField::BASE_QUAD_SIZE);
+
+	std::vector<std::unique_ptr<MockObject>> objects;
+	std::vector<int> quads;
+
+	for (int i = 0; i < NUM_OBJECTS; ++i) {
+		objects.emplace_back(new MockObject());
+		objects.back()->pos = float3(posDist(rng), 0.0f, posDist(rng));
+		objects.back()->radius = radDist(rng);
+		objects.back()->id = i;
+	}
+
+	// scatter insertion order so quads do not reference objects sequentially
+	std::vector<MockObject*> order;
+	for (auto& o: objects) {
+		order.push_back(o.get());
+	}
+	std::shuffle(order.begin(), order.end(), rng);
+
+	// what MovedUnit does for a new unit, which needs a full CUnit; the span
+	// queries never dereference the pointers so the mocks can stand in
+	for (MockObject* o: order) {
+		quads.clear();
+		quadField.GetQuads(quads, o->pos, o->radius);
+
+		for (const int qi: quads) {
+			CQuadField::Quad& quad = const_cast<CQuadField::Quad&>(quadField.GetQuad(qi));
+
+			quad.units.push_back(reinterpret_cast<CUnit*>(o));
+			quad.unitSpans.push_back({o->pos, o->radius, o->id});
+		}
+	}
+
+	std::vector<std::pair<float3, float>> queries;
+	for (int i = 0; i < NUM_QUERIES; ++i) {
+		queries.emplace_back(float3(posDist(rng), 0.0f, posDist(rng)), qryDist(rng));
+	}
+
+	for (const bool spherical: {true, false}) {
+		std::vector<CUnit*> ptrResults;
+		std::vector<CUnit*> spanResults;
+		std::vector<size_t> ptrCounts;
+		std::vector<size_t> spanCounts;
+
+		unsigned int tempNum = 0;
+
+		// pointer layout, as CQuadField::GetUnitsExact
+		const spring_time t0 = spring_gettime();
+
+		for (const auto& q: queries) {
+			const float3& pos = q.first;
+			const float radius = q.second;
+
+			const size_t base = ptrResults.size();
+
+			quads.clear();
+			quadField.GetQuads(quads, pos, radius);
+
+			tempNum += 1;
+
+			for (const int qi: quads) {
+				for (CUnit* u: quadField.GetQuad(qi).units) {
+					MockObject* o = reinterpret_cast<MockObject*>(u);
+
+					if (o->tempNum == tempNum)
+						continue;
+
+					o->tempNum = tempNum;
+
+					const float dstSq = spherical? pos.SqDistance(o->pos): pos.SqDistance2D(o->pos);
+
+					if (dstSq >= Square(radius + o->radius))
+						continue;
+
+					ptrResults.push_back(u);
+				}
+			}
+
+			ptrCounts.push_back(ptrResults.size() - base);
+		}
+
+		// span layout
+		const spring_time t1 = spring_gettime();
+
+		for (const auto& q: queries) {
+			const size_t base = spanResults.size();
+
+			quadField.GetUnitsExactSpans(spanResults, quads, q.first, q.second, spherical);
+			spanCounts.push_back(spanResults.size() - base);
+		}
+
+		const spring_time t2 = spring_gettime();
+
+		LOG("[QuadFieldSpanQueries][%s] %d objects, %d queries, %lu hits: pointers=%.2fms spans=%.2fms",
+			spherical? "sphere": "cylinder",
+			NUM_OBJECTS, NUM_QUERIES, (unsigned long) ptrResults.size(),
+			(t1 - t0).toMilliSecsf(), (t2 - t1).toMilliSecsf()
+		);
+
+		CHECK(ptrCounts == spanCounts);
+		CHECK(ptrResults == spanResults);
+		CHECK(!ptrResults.empty());
+	}
+
+	{
+		QuadFieldQuery qfQuery;
+		std::vector<CUnit*> units;
+
+		quadField.GetUnitsExactSpans(qfQuery, queries[0].first, queries[0].second);
+		quadField.GetUnitsExactSpans(units, quads, queries[0].first, queries[0].second);
+
+		CHECK(*qfQuery.units == units);
+	}
+
+	// rectangles, as CQuadField::GetUnitsExact(mins, maxs)
+	{
+		std::vector<CUnit*> ptrResults;
+		std::vector<CUnit*> spanResults;
+
+		unsigned int tempNum = 0;
+
+		for (size_t i = 0; i < 1000; ++i) {
+			const float3& pos = queries[i].first;
+			const float3 mins = {pos.x - queries[i].second, 0.0f, pos.z - queries[i].second * 0.5f};
+			const float3 maxs = {pos.x + queries[i].second, 0.0f, pos.z + queries[i].second * 0.5f};
+
+			quads.clear();
+			quadField.GetQuadsRectangle(quads, mins, maxs);
+
+			tempNum += 1;
+
+			for (const int qi: quads) {
+				for (CUnit* u: quadField.GetQuad(qi).units) {
+					MockObject* o = reinterpret_cast<MockObject*>(u);
+
+					if (o->tempNum == tempNum)
+						continue;
+
+					o->tempNum = tempNum;
+
+					if (o->pos.x < mins.x || o->pos.x > maxs.x)
+						continue;
+					if (o->pos.z < mins.z || o->pos.z > maxs.z)
+						continue;
+
+					ptrResults.push_back(u);
+				}
+			}
+
+			quadField.GetUnitsExactSpans(spanResults, quads, mins, maxs);
+		}
+
+		CHECK(ptrResults == spanResults);
+		CHECK(!ptrResults.empty());
+	}
+
+	// batches, as N individual span queries (rays against all objects)
+	{
+		std::uniform_real_distribution<float> dirDist(-1.0f, 1.0f);
+
+		QuadFieldBatchQuery batch;
+		std::vector<CUnit*> results;
+
+		for (size_t i = 0; i < 1000; ++i) {
+			const float3& pos = queries[i].first;
+			const float radius = queries[i].second;
+
+			switch (i % 4) {
+				case 0: { batch.AddSphere(pos, radius, true); } break;
+				case 1: { batch.AddSphere(pos, radius, false); } break;
+				case 2: { batch.AddRectangle(pos - float3(radius, 0.0f, radius * 0.5f), pos + float3(radius, 0.0f, radius * 0.5f)); } break;
+				case 3: { batch.AddRay(pos, float3(dirDist(rng), 0.0f, dirDist(rng)).SafeNormalize(), radius * 2.0f, (i & 4)? radius * 0.1f: 0.0f); } break;
+			}
+		}
+
+		quadField.GetUnitsExact(batch);
+
+		CHECK(batch.GetNumQueries() == 1000);
+		CHECK(batch.offsets.size() == 1001);
+
+		bool equal = true;
+		size_t numResults = 0;
+
+		for (size_t i = 0; i < batch.GetNumQueries(); ++i) {
+			const QuadFieldBatchQuery::Query& q = batch.queries[i];
+
+			results.clear();
+
+			switch (q.type) {
+				case QuadFieldBatchQuery::QUERY_SPHERE:
+				case QuadFieldBatchQuery::QUERY_CYLINDER: {
+					quadField.GetUnitsExactSpans(results, quads, q.p0, q.radius, q.type == QuadFieldBatchQuery::QUERY_SPHERE);
+				} break;
+				case QuadFieldBatchQuery::QUERY_RECTANGLE: {
+					quadField.GetUnitsExactSpans(results, quads, q.p0, q.p1);
+				} break;
+				case QuadFieldBatchQuery::QUERY_RAY: {
+					for (const auto& o: objects) {
+						const float t = Clamp((o->pos - q.p0).dot(q.p1), 0.0f, q.length);
+
+						if ((q.p0 + q.p1 * t).SqDistance(o->pos) >= Square(q.radius + o->radius))
+							continue;
+
+						results.push_back(reinterpret_cast<CUnit*>(o.get()));
+					}
+				} break;
+			}
+
+			std::vector<CUnit*> batchResults(batch.GetResultsBegin(i), batch.GetResultsEnd(i));
+
+			// brute-force ray hits are in object order
+			if (q.type == QuadFieldBatchQuery::QUERY_RAY) {
+				std::sort(batchResults.begin(), batchResults.end());
+				std::sort(results.begin(), results.end());
+			}
+
+			equal &= (batchResults == results);
+			numResults += results.size();
+		}
+
+		CHECK(equal);
+		CHECK(numResults == batch.units.size());
+		CHECK(numResults > 0);
+	}
+
+	quadField.Kill();
+}
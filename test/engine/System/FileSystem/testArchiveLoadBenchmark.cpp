@@ -0,0 +1,143 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/CRC.h"
+#include "System/GlobalConfig.h"
+#include "System/StringUtil.h"
+#include "System/FileSystem/Archives/SevenZipArchive.h"
+#include "System/FileSystem/Archives/ZipArchive.h"
+#include "System/Log/ILog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+// reads every file of an .sdz or .sd7 archive with N threads; set
+// SPRING_TEST_ARCHIVE to benchmark another archive than springcontent
+// (ctest runs this once for the .sdz and once for an .sd7 made of it)
+static const char* ARCHIVE_ENV_VAR = "SPRING_TEST_ARCHIVE";
+
+
+static IArchive* OpenArchive(const std::string& path)
+{
+	const std::string ext = StringToLower(path.substr(std::min(path.size(), path.rfind('.') + 1)));
+
+	if (ext == "sdz")
+		return (new CZipArchive(path));
+	if (ext == "sd7")
+		return (new CSevenZipArchive(path));
+
+	return nullptr;
+}
+
+static float GetElapsedMs(std::chrono::steady_clock::time_point t0, std::chrono::steady_clock::time_point t1)
+{
+	return std::max(std::chrono::duration<float, std::milli>(t1 - t0).count(), 0.001f);
+}
+
+// returns the number of bytes read, per-file digests go into <crcs>
+static size_t ReadAllFiles(IArchive* archive, unsigned int numThreads, std::vector<std::uint32_t>& crcs)
+{
+	std::vector<std::thread> threads;
+	std::atomic<unsigned int> nextFileID = {0};
+	std::atomic<size_t> numBytes = {0};
+
+	crcs.clear();
+	crcs.resize(archive->NumFiles(), 0);
+
+	for (unsigned int n = 0; n < numThreads; n++) {
+		threads.emplace_back([&]() {
+			std::vector<std::uint8_t> buffer;
+
+			for (unsigned int fid; (fid = nextFileID.fetch_add(1)) < archive->NumFiles(); ) {
+				if (!archive->GetFile(fid, buffer))
+					continue;
+
+				crcs[fid] = CRC::CalcDigest(buffer.data(), buffer.size());
+				numBytes += buffer.size();
+			}
+		});
+	}
+
+	for (std::thread& t: threads) {
+		t.join();
+	}
+
+	return numBytes;
+}
+
+
+
+TEST_CASE("ArchiveLoadBenchmark")
+{
+	const char* archivePath = getenv(ARCHIVE_ENV_VAR);
+
+	if (archivePath == nullptr) {
+		WARN(std::string(ARCHIVE_ENV_VAR) + " is not set, skipping");
+		return;
+	}
+
+	std::unique_ptr<IArchive> archive(OpenArchive(archivePath));
+
+	if (archive == nullptr || !archive->IsOpen()) {
+		WARN(std::string("could not open ") + archivePath + ", skipping");
+		return;
+	}
+
+	std::vector<std::uint32_t> refCRCs;
+	std::vector<std::uint32_t> crcs;
+
+	// single-threaded reference
+	const size_t refBytes = ReadAllFiles(archive.get(), 1, refCRCs);
+
+	const unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 4u);
+
+	for (unsigned int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		// fresh instance, nothing cached
+		archive.reset(OpenArchive(archivePath));
+
+		const auto t0 = std::chrono::steady_clock::now();
+		const size_t coldBytes = ReadAllFiles(archive.get(), numThreads, crcs);
+		const auto t1 = std::chrono::steady_clock::now();
+
+		CHECK(coldBytes == refBytes);
+		CHECK(crcs == refCRCs);
+
+		const auto t2 = std::chrono::steady_clock::now();
+		const size_t warmBytes = ReadAllFiles(archive.get(), numThreads, crcs);
+		const auto t3 = std::chrono::steady_clock::now();
+
+		CHECK(warmBytes == refBytes);
+		CHECK(crcs == refCRCs);
+
+		const float coldMs = GetElapsedMs(t0, t1);
+		const float warmMs = GetElapsedMs(t2, t3);
+		const float sizeMB = refBytes / (1024.0f * 1024.0f);
+
+		LOG("[ArchiveLoadBenchmark][threads=%u] files=%u size=%.1fMB cold=%.1fms (%.1fMB/s) warm=%.1fms (%.1fMB/s)",
+			numThreads, archive->NumFiles(), sizeMB,
+			coldMs, sizeMB * 1000.0f / coldMs,
+			warmMs, sizeMB * 1000.0f / warmMs
+		);
+	}
+
+	// concurrent inserts into a cache smaller than the archive, files are evicted while others are read
+	const int vfsCacheArchiveSize = globalConfig.vfsCacheArchiveSize;
+
+	globalConfig.vfsCacheArchiveSize = 1;
+	archive.reset(OpenArchive(archivePath));
+
+	for (int n = 0; n < 2; n++) {
+		CHECK(ReadAllFiles(archive.get(), maxThreads, crcs) == refBytes);
+		CHECK(crcs == refCRCs);
+	}
+
+	globalConfig.vfsCacheArchiveSize = vfsCacheArchiveSize;
+}
@@ -0,0 +1,209 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/creg/creg_cond.h"
+#include "System/creg/Serializer.h"
+#include "System/creg/STL_Map.h"
+#include "System/Log/ILog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+static constexpr int NUM_OBJECTS = 250000;
+static constexpr int NUM_BENCH_RUNS = 3;
+
+
+struct BenchPart {
+	CR_DECLARE_STRUCT(BenchPart)
+
+	int value = 0;
+	float weight = 0.0f;
+};
+
+CR_BIND(BenchPart, )
+CR_REG_METADATA(BenchPart, (
+	CR_MEMBER(value),
+	CR_MEMBER(weight)
+))
+
+
+struct BenchObj {
+	CR_DECLARE_STRUCT(BenchObj)
+
+	// first member, pointers to it share the address of the object
+	BenchPart part;
+
+	int id = 0;
+	std::vector<int> data;
+
+	BenchObj* target = nullptr;
+	BenchPart* targetPart = nullptr;
+};
+
+CR_BIND(BenchObj, )
+CR_REG_METADATA(BenchObj, (
+	CR_MEMBER(part),
+	CR_MEMBER(id),
+	CR_MEMBER(data),
+	CR_MEMBER(target),
+	CR_MEMBER(targetPart)
+))
+
+
+struct BenchRoot {
+	CR_DECLARE_STRUCT(BenchRoot)
+
+	~BenchRoot() {
+		for (BenchObj* o: objects) {
+			delete o;
+		}
+	}
+
+	std::vector<BenchObj*> objects;
+};
+
+CR_BIND(BenchRoot, )
+CR_REG_METADATA(BenchRoot, (
+	CR_MEMBER(objects)
+))
+
+
+
+// high-water mark of the resident set, in KB
+static long GetPeakMemory()
+{
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	#ifdef __APPLE__
+	return (usage.ru_maxrss / 1024);
+	#else
+	return (usage.ru_maxrss);
+	#endif
+#else
+	return 0;
+#endif
+}
+
+static float GetElapsedMs(std::chrono::steady_clock::time_point t0, std::chrono::steady_clock::time_point t1)
+{
+	return std::max(std::chrono::duration<float, std::milli>(t1 - t0).count(), 0.001f);
+}
+
+
+static BenchRoot* CreateGraph(unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> idxDist(0, NUM_OBJECTS - 1);
+
+	BenchRoot* root = new BenchRoot();
+	root->objects.reserve(NUM_OBJECTS);
+
+	for (int i = 0; i < NUM_OBJECTS; ++i) {
+		BenchObj* o = new BenchObj();
+		o->id = i;
+		o->part.value = i * 3;
+		o->part.weight = i * 0.5f;
+		o->data.resize(i & 7, i);
+
+		root->objects.push_back(o);
+	}
+
+	// random links, including pointers to members embedded in other objects
+	for (BenchObj* o: root->objects) {
+		o->target = root->objects[idxDist(rng)];
+		o->targetPart = &root->objects[idxDist(rng)]->part;
+	}
+
+	return root;
+}
+
+static bool EqualGraphs(const BenchRoot* a, const BenchRoot* b)
+{
+	if (a->objects.size() != b->objects.size())
+		return false;
+
+	for (size_t i = 0; i < a->objects.size(); ++i) {
+		const BenchObj* oa = a->objects[i];
+		const BenchObj* ob = b->objects[i];
+
+		if (oa->id != ob->id || oa->data != ob->data)
+			return false;
+		if (oa->part.value != ob->part.value || oa->part.weight != ob->part.weight)
+			return false;
+
+		// links must point at the corresponding loaded objects and members
+		if (ob->target != b->objects[oa->target->id])
+			return false;
+
+		const BenchObj* partOwner = reinterpret_cast<const BenchObj*>(oa->targetPart);
+
+		if (ob->targetPart != &b->objects[partOwner->id]->part)
+			return false;
+	}
+
+	return true;
+}
+
+
+
+TEST_CASE("CregLoadSaveBenchmark")
+{
+	BenchRoot* srcRoot = CreateGraph(1234);
+
+	for (int n = 0; n < NUM_BENCH_RUNS; ++n) {
+		std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+
+		const long peakMem0 = GetPeakMemory();
+		const auto t0 = std::chrono::steady_clock::now();
+
+		{
+			creg::COutputStreamSerializer os;
+			os.SavePackage(&ss, srcRoot, srcRoot->GetClass());
+		}
+
+		const auto t1 = std::chrono::steady_clock::now();
+		const long peakMem1 = GetPeakMemory();
+
+		void* dstRootPtr = nullptr;
+		creg::Class* dstRootCls = nullptr;
+
+		{
+			creg::CInputStreamSerializer is;
+			is.LoadPackage(&ss, dstRootPtr, dstRootCls);
+		}
+
+		const auto t2 = std::chrono::steady_clock::now();
+		const long peakMem2 = GetPeakMemory();
+
+		BenchRoot* dstRoot = static_cast<BenchRoot*>(dstRootPtr);
+
+		// each object also carries an embedded part
+		const float numObjects = NUM_OBJECTS * 2.0f;
+		const float saveMs = GetElapsedMs(t0, t1);
+		const float loadMs = GetElapsedMs(t1, t2);
+
+		LOG("[%s][run=%d] objects=%d package=%uKB save=%.1fms (%.0f objects/s, peak +%ldKB) load=%.1fms (%.0f objects/s, peak +%ldKB)",
+			__func__, n, int(numObjects), unsigned(ss.str().size() / 1024),
+			saveMs, numObjects * 1000.0f / saveMs, peakMem1 - peakMem0,
+			loadMs, numObjects * 1000.0f / loadMs, peakMem2 - peakMem1
+		);
+
+		REQUIRE(dstRootCls == BenchRoot::StaticClass());
+		CHECK(EqualGraphs(srcRoot, dstRoot));
+
+		delete dstRoot;
+	}
+
+	delete srcRoot;
+}
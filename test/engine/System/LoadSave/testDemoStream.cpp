@@ -0,0 +1,205 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/LoadSave/DemoStream.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+static constexpr size_t NUM_BLOCKS = 256;
+static constexpr size_t BLOCK_SIZE = 4096;
+static constexpr size_t INDEX_INTERVAL = 16;
+
+namespace {
+	struct TempDemo {
+		TempDemo() {
+			const char* tmpName = tmpnam(NULL);
+			assert(tmpName != NULL);
+			fileName = tmpName;
+		}
+		~TempDemo() {
+			remove(fileName.c_str());
+		}
+
+		std::string fileName;
+	};
+}
+
+
+static DemoFileHeader MakeHeader(int demoStreamSize)
+{
+	DemoFileHeader header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, DEMOFILE_MAGIC);
+	header.version = DEMOFILE_VERSION;
+	header.headerSize = sizeof(header);
+	header.demoStreamSize = demoStreamSize;
+	header.swab();
+	return header;
+}
+
+static std::vector<std::uint8_t> MakeData()
+{
+	// poorly compressible, so members span many deflate blocks
+	std::vector<std::uint8_t> data(NUM_BLOCKS * BLOCK_SIZE);
+	std::uint32_t x = 12345;
+
+	for (std::uint8_t& b: data) {
+		b = (x = x * 1664525 + 1013904223) >> 24;
+	}
+
+	return data;
+}
+
+static std::vector<DemoIndexEntry> WriteDemo(const std::string& fileName, const std::vector<std::uint8_t>& data)
+{
+	std::vector<DemoIndexEntry> entries;
+	CDemoOutputStream out;
+
+	REQUIRE(out.Open(fileName));
+	out.WriteHeader(MakeHeader(0));
+
+	for (size_t i = 0; i < NUM_BLOCKS; i++) {
+		if (i > 0 && (i % INDEX_INTERVAL) == 0) {
+			const size_t streamPos = out.GetStreamPos();
+			out.AddIndexEntry(i * 10);
+			// duplicates are dropped
+			out.AddIndexEntry(i * 10 + 1);
+			entries.push_back({std::uint32_t(i * 10), std::uint32_t(streamPos), 0});
+		}
+
+		out.Write(&data[i * BLOCK_SIZE], BLOCK_SIZE, (i % 3) == 0);
+	}
+
+	out.WriteHeader(MakeHeader(data.size()));
+	out.Close();
+
+	CHECK_FALSE(out.HasWriteError());
+	return entries;
+}
+
+
+TEST_CASE("DemoStreamIndex")
+{
+	TempDemo demo;
+
+	const std::vector<std::uint8_t> data = MakeData();
+	const std::vector<DemoIndexEntry> entries = WriteDemo(demo.fileName, data);
+
+	CDemoInputStream in;
+	REQUIRE(in.Open(demo.fileName));
+
+	// ReadIndex must recover exactly what WriteIndexMember stored
+	const std::vector<DemoIndexEntry>& index = in.GetIndex();
+	REQUIRE(index.size() == entries.size());
+
+	for (size_t i = 0; i < index.size(); i++) {
+		CHECK(index[i].frameNum == entries[i].frameNum);
+		CHECK(index[i].streamPos == entries[i].streamPos);
+		CHECK(index[i].filePos > 0);
+	}
+
+	CHECK(in.FindEntry(0) == nullptr);
+	CHECK(in.FindEntry(index.front().frameNum - 1) == nullptr);
+	CHECK(in.FindEntry(index.front().frameNum) == &index.front());
+	CHECK(in.FindEntry(index[1].frameNum - 1) == &index.front());
+	CHECK(in.FindEntry(index[1].frameNum + 1) == &index[1]);
+	CHECK(in.FindEntry(-1u) == &index.back());
+}
+
+
+TEST_CASE("DemoStreamRoundTrip")
+{
+	TempDemo demo;
+
+	const std::vector<std::uint8_t> data = MakeData();
+	const std::vector<DemoIndexEntry> entries = WriteDemo(demo.fileName, data);
+
+	CDemoInputStream in;
+	REQUIRE(in.Open(demo.fileName));
+
+	// the rewritten header is read back, not the placeholder
+	DemoFileHeader header;
+	const DemoFileHeader expHeader = MakeHeader(data.size());
+	REQUIRE(in.Read(&header, sizeof(header)) == sizeof(header));
+	CHECK(memcmp(&header, &expHeader, sizeof(header)) == 0);
+
+	std::vector<std::uint8_t> buf(data.size());
+	REQUIRE(in.Read(buf.data(), buf.size()) == int(buf.size()));
+	CHECK(buf == data);
+
+	// nothing but the (empty) index member follows
+	std::uint8_t tail[16];
+	CHECK(in.Read(tail, sizeof(tail)) == 0);
+	CHECK(in.Eof());
+
+	SECTION("Seek") {
+		// backwards, forwards, exactly on and around entries, within the header
+		std::vector<unsigned int> positions = {7, unsigned(data.size() / 2), 0, unsigned(data.size() - 100), 1234};
+
+		for (const DemoIndexEntry& e: entries) {
+			positions.push_back(e.streamPos);
+			positions.push_back(e.streamPos - 1);
+			positions.push_back(e.streamPos + 1);
+		}
+
+		std::vector<std::uint8_t> exp(sizeof(header) + data.size());
+		memcpy(exp.data(), &expHeader, sizeof(header));
+		memcpy(exp.data() + sizeof(header), data.data(), data.size());
+
+		for (unsigned int pos: positions) {
+			INFO("pos=" << pos);
+			REQUIRE(in.Seek(pos));
+			CHECK(in.GetPos() == pos);
+
+			const size_t len = std::min(size_t(100), exp.size() - pos);
+			REQUIRE(in.Read(buf.data(), len) == int(len));
+			CHECK(memcmp(buf.data(), &exp[pos], len) == 0);
+		}
+
+		CHECK_FALSE(in.Seek(exp.size() + 1));
+	}
+}
+
+
+TEST_CASE("DemoStreamPlainGzip")
+{
+	TempDemo demo;
+
+	const std::vector<std::uint8_t> data = MakeData();
+	WriteDemo(demo.fileName, data);
+
+	// readers unaware of the index must see header and data only
+	gzFile file = gzopen(demo.fileName.c_str(), "rb");
+	REQUIRE(file != nullptr);
+
+	std::vector<std::uint8_t> buf(sizeof(DemoFileHeader) + data.size() + 16);
+	const int numRead = gzread(file, buf.data(), buf.size());
+	gzclose(file);
+
+	REQUIRE(numRead == int(sizeof(DemoFileHeader) + data.size()));
+	CHECK(memcmp(buf.data() + sizeof(DemoFileHeader), data.data(), data.size()) == 0);
+}
+
+
+TEST_CASE("DemoStreamNoIndex")
+{
+	TempDemo demo;
+
+	{
+		CDemoOutputStream out;
+		REQUIRE(out.Open(demo.fileName));
+		out.WriteHeader(MakeHeader(0));
+		out.Close();
+	}
+
+	CDemoInputStream in;
+	CHECK_FALSE(in.Open(demo.fileName));
+}
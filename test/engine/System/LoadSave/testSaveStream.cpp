@@ -0,0 +1,224 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/LoadSave/SaveStream.h"
+#include "System/Misc/SpringTime.h"
+#include "System/Platform/Threading.h"
+#include "System/Threading/ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+InitSpringTime ist;
+
+static constexpr size_t DATA_SIZE = CSaveStreamBuf::BLOCK_SIZE * 7 / 2;
+
+namespace {
+	struct TempFile {
+		TempFile() {
+			const char* tmpName = tmpnam(NULL);
+			assert(tmpName != NULL);
+			fileName = tmpName;
+		}
+		~TempFile() {
+			remove(fileName.c_str());
+		}
+
+		std::vector<std::uint8_t> ReadAll() const {
+			std::vector<std::uint8_t> data;
+			FILE* file = fopen(fileName.c_str(), "rb");
+
+			if (file == nullptr)
+				return data;
+
+			fseek(file, 0, SEEK_END);
+			data.resize(ftell(file));
+			fseek(file, 0, SEEK_SET);
+
+			if (fread(data.data(), 1, data.size(), file) != data.size())
+				data.clear();
+
+			fclose(file);
+			return data;
+		}
+
+		std::string fileName;
+	};
+}
+
+
+static std::string MakeData()
+{
+	std::string data(DATA_SIZE, 0);
+	std::uint32_t x = 12345;
+
+	// half random, half compressible
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = ((i / 1000) & 1)? char((x = x * 1664525 + 1013904223) >> 24): char(i / 1000);
+	}
+
+	return data;
+}
+
+static void WriteStream(CSaveStreamBuf& buf, const std::string& data)
+{
+	std::iostream ios(&buf);
+
+	// overwrite data in an already compressed block after the writer moved on
+	const size_t patchPos = CSaveStreamBuf::BLOCK_SIZE / 2;
+
+	const size_t tailSize = std::min(data.size(), size_t(1000));
+
+	ios.write(data.data(), data.size() - tailSize);
+
+	if (data.size() > CSaveStreamBuf::BLOCK_SIZE) {
+		ios.seekp(patchPos);
+		ios.write(std::string(100, 'x').data(), 100);
+		ios.seekp(patchPos);
+		ios.write(data.data() + patchPos, 100);
+		ios.seekp(0, std::ios_base::end);
+	}
+
+	ios.write(data.data() + data.size() - tailSize, tailSize);
+
+	REQUIRE(ios.good());
+	REQUIRE(buf.GetSize() == data.size());
+}
+
+static std::string ReadStream(CSaveStreamBuf& buf)
+{
+	std::iostream ios(&buf);
+	std::string data(buf.GetSize() + 1, 0);
+
+	ios.read(&data[0], data.size());
+	data.resize(ios.gcount());
+	return data;
+}
+
+static void CheckRoundTrip(const std::string& data)
+{
+	TempFile tmp;
+
+	{
+		CSaveStreamBuf buf(1);
+		WriteStream(buf, data);
+
+		FILE* file = fopen(tmp.fileName.c_str(), "wb");
+		REQUIRE(file != nullptr);
+		CHECK(buf.WriteFile(file));
+		fclose(file);
+	}
+
+	const std::vector<std::uint8_t> fileData = tmp.ReadAll();
+	REQUIRE(!fileData.empty());
+
+	// members are inflated in parallel
+	CSaveStreamBuf buf;
+	REQUIRE(buf.ReadFile(fileData));
+	CHECK(buf.GetSize() == data.size());
+	CHECK(ReadStream(buf) == data);
+
+	// readers unaware of the member sizes see one gzip stream
+	gzFile file = gzopen(tmp.fileName.c_str(), "rb");
+	REQUIRE(file != nullptr);
+
+	std::string gzData(data.size() + 1, 0);
+	gzData.resize(std::max(0, gzread(file, &gzData[0], gzData.size())));
+	gzclose(file);
+
+	CHECK(gzData == data);
+}
+
+
+TEST_CASE("SaveStreamRoundTrip")
+{
+	Threading::DetectCores();
+	ThreadPool::SetThreadCount(ThreadPool::GetMaxThreads());
+
+	CheckRoundTrip(MakeData());
+	CheckRoundTrip(MakeData().substr(0, CSaveStreamBuf::BLOCK_SIZE * 2));
+	CheckRoundTrip("x");
+}
+
+
+TEST_CASE("SaveStreamPlainGzip")
+{
+	const std::string data = MakeData();
+
+	std::vector<std::uint8_t> fileData(compressBound(data.size()) + 32);
+
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+	deflateInit2(&zstream, 1, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+	zstream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+	zstream.avail_in  = data.size();
+	zstream.next_out  = fileData.data();
+	zstream.avail_out = fileData.size();
+
+	REQUIRE(deflate(&zstream, Z_FINISH) == Z_STREAM_END);
+	fileData.resize(zstream.total_out);
+	deflateEnd(&zstream);
+
+	// savegames written by older versions take the sequential path
+	CSaveStreamBuf buf;
+	REQUIRE(buf.ReadFile(fileData));
+	CHECK(ReadStream(buf) == data);
+
+	fileData.resize(fileData.size() / 2);
+	CHECK_FALSE(buf.ReadFile(fileData));
+}
+
+
+TEST_CASE("SaveStreamBusyPool")
+{
+	Threading::DetectCores();
+	ThreadPool::SetThreadCount(ThreadPool::GetMaxThreads());
+
+	if (ThreadPool::GetNumThreads() < 2)
+		return;
+
+	std::promise<void> unblock;
+	std::shared_future<void> blocked = unblock.get_future().share();
+
+	// occupy every worker; the block jobs queued behind these would never
+	// run if the pool were shut down, so the waiter has to compress them
+	for (int i = 1; i < ThreadPool::GetNumThreads(); i++) {
+		ThreadPool::Enqueue([blocked]() { blocked.wait(); });
+	}
+
+	const std::string data = MakeData();
+	TempFile tmp;
+
+	{
+		CSaveStreamBuf buf(1);
+		WriteStream(buf, data);
+
+		FILE* file = fopen(tmp.fileName.c_str(), "wb");
+		REQUIRE(file != nullptr);
+		CHECK(buf.WriteFile(file));
+		fclose(file);
+	}
+	{
+		// destructor waits for the queued jobs
+		CSaveStreamBuf buf(1);
+		WriteStream(buf, data);
+	}
+
+	unblock.set_value();
+
+	CSaveStreamBuf buf;
+	REQUIRE(buf.ReadFile(tmp.ReadAll()));
+	CHECK(ReadStream(buf) == data);
+
+	ThreadPool::SetThreadCount(0);
+}
@@ -0,0 +1,164 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "System/Net/PacketPool.h"
+#include "System/Net/Socket.h"
+#include "System/Net/UDPConnection.h"
+#include "System/GlobalConfig.h"
+#include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
+
+#include <asio/ip/udp.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "lib/catch.hpp"
+
+
+static constexpr int NUM_CONNECTIONS = 16;
+static constexpr int NUM_BROADCASTS = 2000;
+
+static std::atomic<size_t> numHeapAllocs = {0};
+
+void* operator new(size_t size)
+{
+	numHeapAllocs += 1;
+
+	if (void* p = std::malloc(size))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+
+
+struct Link {
+	Link()
+		: serverSocket(std::make_shared<asio::ip::udp::socket>(netcode::netservice, asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), 0)))
+		, clientSocket(std::make_shared<asio::ip::udp::socket>(netcode::netservice, asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), 0)))
+		, server(serverSocket, clientSocket->local_endpoint())
+		, client(clientSocket, serverSocket->local_endpoint())
+	{
+		server.Unmute();
+		client.Unmute();
+
+		// clients speak first, otherwise their acks look like reconnects
+		client.SendData(CBaseNetProtocol::Get().SendNewFrame());
+		client.Flush(true);
+		Receive(*serverSocket, server);
+		server.GetData();
+	}
+
+	static void Receive(asio::ip::udp::socket& socket, netcode::UDPConnection& conn) {
+		std::uint8_t buffer[4096];
+
+		while (socket.available() > 0) {
+			netcode::Packet packet(buffer, socket.receive(asio::buffer(buffer)));
+			conn.ProcessRawPacket(packet);
+		}
+	}
+
+	size_t Pump() {
+		size_t numMessages = 0;
+
+		Receive(*clientSocket, client);
+
+		while (client.GetData() != nullptr)
+			numMessages++;
+
+		// send acks so the server can release its chunks
+		client.Flush(true);
+		Receive(*serverSocket, server);
+		return numMessages;
+	}
+
+	std::shared_ptr<asio::ip::udp::socket> serverSocket;
+	std::shared_ptr<asio::ip::udp::socket> clientSocket;
+
+	netcode::UDPConnection server;
+	netcode::UDPConnection client;
+};
+
+
+struct BroadcastBench {
+	BroadcastBench() {
+		for (int n = 0; n < NUM_CONNECTIONS; n++) {
+			links.emplace_back(new Link());
+		}
+	}
+
+	~BroadcastBench() {
+		for (Link* link: links) {
+			delete link;
+		}
+	}
+
+	// returns heap allocations per broadcast
+	float Run(const std::string& msg) {
+		const size_t numAllocs = numHeapAllocs;
+
+		for (int n = 0; n < NUM_BROADCASTS; n++) {
+			// mirrors CGameServer::Broadcast, one packet for all links
+			const CBaseNetProtocol::PacketType packet = msg.empty()?
+				CBaseNetProtocol::Get().SendNewFrame():
+				CBaseNetProtocol::Get().SendSystemMessage(0, msg);
+
+			for (Link* link: links) {
+				link->server.SendData(packet);
+				link->server.Flush(true);
+			}
+			for (Link* link: links) {
+				numReceived += link->Pump();
+			}
+		}
+
+		return ((numHeapAllocs - numAllocs) * 1.0f / NUM_BROADCASTS);
+	}
+
+	std::vector<Link*> links;
+
+	size_t numReceived = 0;
+};
+
+
+
+TEST_CASE("NetBroadcast")
+{
+	spring_clock::PushTickRate();
+	spring_time::setstarttime(spring_time::gettime(true));
+
+	// measure the netcode, not the rate-limiter
+	globalConfig.linkOutgoingBandwidth = 0;
+
+	BroadcastBench bench;
+
+	// warm up the pool; the first broadcasts carve slabs
+	bench.Run("");
+	bench.Run(std::string(4000, 'x'));
+
+	const netcode::PacketPool::Stats stats = netcode::PacketPool::GetStats();
+
+	// NEWFRAME fits a single chunk, a 4K message spans many on every link
+	const float smallAllocs = bench.Run("");
+	const float largeAllocs = bench.Run(std::string(4000, 'x'));
+
+	LOG("[%s] %d connections, %d broadcasts per payload, %u messages received", __func__, NUM_CONNECTIONS, NUM_BROADCASTS, unsigned(bench.numReceived));
+	LOG("[%s] heap allocations per broadcast: %.2f (small), %.2f (large)", __func__, smallAllocs, largeAllocs);
+	LOG("[%s] packet-pool slabs: %u (large allocations: %u)", __func__, unsigned(netcode::PacketPool::GetStats().numSlabs), unsigned(netcode::PacketPool::GetStats().numLargeAllocs));
+
+	// every broadcast arrives on every link, twice per payload (warm-up and measurement)
+	CHECK(bench.numReceived == size_t(NUM_CONNECTIONS * NUM_BROADCASTS * 2 * 2));
+	// the pool must have reached steady state after warm-up
+	CHECK(netcode::PacketPool::GetStats().numSlabs == stats.numSlabs);
+	// shared_ptr control-block of each broadcast packet (plus the string copy
+	// made by SendSystemMessage), independent of the number of connections
+	CHECK(smallAllocs <= 1.0f);
+	CHECK(largeAllocs <= 2.0f);
+}
@@ -1,6 +1,20 @@
 
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "System/Net/UDPBatch.h"
+#include "System/Net/UDPConnection.h"
 #include "System/Net/UDPListener.h"
+#include "System/GlobalConfig.h"
 #include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#if defined(__linux__)
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
 
 
 #define CATCH_CONFIG_MAIN
@@ -89,3 +103,263 @@ TEST_CASE("TryBindSocket")
 	t.TestPort(-1, false);
 }
 
+
+
+#if defined(__linux__)
+// emulates kernels without sendmmsg/recvmmsg; these take precedence over libc's
+static bool noMultiMsgCalls = false;
+
+extern "C" int sendmmsg(int fd, struct mmsghdr* msgs, unsigned int n, int flags)
+{
+	if (noMultiMsgCalls) {
+		errno = ENOSYS;
+		return -1;
+	}
+
+	return (syscall(SYS_sendmmsg, fd, msgs, n, flags));
+}
+
+extern "C" int recvmmsg(int fd, struct mmsghdr* msgs, unsigned int n, int flags, struct timespec* timeout)
+{
+	if (noMultiMsgCalls) {
+		errno = ENOSYS;
+		return -1;
+	}
+
+	return (syscall(SYS_recvmmsg, fd, msgs, n, flags, timeout));
+}
+#endif
+
+
+
+static void InitTimer()
+{
+	static bool inited = false;
+
+	if (inited)
+		return;
+
+	spring_clock::PushTickRate();
+	spring_time::setstarttime(spring_time::gettime(true));
+	inited = true;
+}
+
+static size_t ReceiveAll(netcode::UDPListener& listener, netcode::UDPConnection& client, netcode::CConnection& receiver, size_t count)
+{
+	size_t numReceived = 0;
+
+	for (int n = 0; n < 1000 && numReceived < count; n++) {
+		listener.Update();
+		client.Update();
+
+		while (receiver.GetData() != nullptr)
+			numReceived++;
+
+		spring_msecs(1).sleep(true);
+	}
+
+	return numReceived;
+}
+
+TEST_CASE("BatchedIO")
+{
+	InitTimer();
+
+	// more datagrams than fit into one batch
+	const size_t numMessages = netcode::UDPBatch::MAX_BATCH_SIZE * 3;
+
+	globalConfig.linkOutgoingBandwidth = 0;
+
+	for (const bool batched: {false, true}) {
+		LOG("\nbatched I/O: %d", batched);
+
+		globalConfig.udpBatchedIO = batched;
+
+		netcode::UDPListener listener(11112, "127.0.0.1");
+		netcode::UDPConnection client(0, "127.0.0.1", 11112);
+
+		CHECK(listener.IsBatchedIO() == (batched && netcode::UDPBatch::IsSupported()));
+
+		// the first datagram opens the connection
+		client.Unmute();
+		client.SendData(CBaseNetProtocol::Get().SendNewFrame());
+		client.Flush(true);
+
+		for (int n = 0; n < 1000 && !listener.HasIncomingConnections(); n++) {
+			listener.Update();
+			spring_msecs(1).sleep(true);
+		}
+
+		REQUIRE(listener.HasIncomingConnections());
+
+		std::shared_ptr<netcode::UDPConnection> server = listener.AcceptConnection();
+		server->Unmute();
+
+		CHECK(server->GetData() != nullptr);
+
+		// one datagram per message in both directions, server speaks first
+		for (size_t n = 0; n < numMessages; n++) {
+			server->SendData(CBaseNetProtocol::Get().SendNewFrame());
+			server->Flush(true);
+		}
+
+		listener.Flush();
+
+		CHECK(ReceiveAll(listener, client, client, numMessages) == numMessages);
+
+		for (size_t n = 0; n < numMessages; n++) {
+			client.SendData(CBaseNetProtocol::Get().SendNewFrame());
+			client.Flush(true);
+		}
+
+		CHECK(ReceiveAll(listener, client, *server, numMessages) == numMessages);
+	}
+}
+
+
+#if defined(__linux__)
+TEST_CASE("BatchedIOFallback")
+{
+	InitTimer();
+
+	const size_t numMessages = netcode::UDPBatch::MAX_BATCH_SIZE * 2;
+
+	globalConfig.linkOutgoingBandwidth = 0;
+	globalConfig.udpBatchedIO = true;
+
+	// ENOSYS from the first sendmmsg or from the first recvmmsg call
+	for (const bool failSend: {true, false}) {
+		LOG("\nfailing call: %s", failSend? "sendmmsg": "recvmmsg");
+
+		netcode::UDPListener listener(11114, "127.0.0.1");
+		netcode::UDPConnection client(0, "127.0.0.1", 11114);
+
+		REQUIRE(listener.IsBatchedIO());
+
+		client.Unmute();
+		client.SendData(CBaseNetProtocol::Get().SendNewFrame());
+		client.Flush(true);
+
+		for (int n = 0; n < 1000 && !listener.HasIncomingConnections(); n++) {
+			listener.Update();
+			spring_msecs(1).sleep(true);
+		}
+
+		REQUIRE(listener.HasIncomingConnections());
+
+		std::shared_ptr<netcode::UDPConnection> server = listener.AcceptConnection();
+		server->Unmute();
+
+		CHECK(server->GetData() != nullptr);
+
+		for (size_t n = 0; n < numMessages; n++) {
+			server->SendData(CBaseNetProtocol::Get().SendNewFrame());
+			server->Flush(true);
+		}
+
+		// queued datagrams must still go out once the kernel turns out not to support batching
+		noMultiMsgCalls = failSend;
+		listener.Flush();
+		noMultiMsgCalls = true;
+
+		CHECK(listener.IsBatchedIO() == !failSend);
+		CHECK(ReceiveAll(listener, client, client, numMessages) == numMessages);
+
+		for (size_t n = 0; n < numMessages; n++) {
+			client.SendData(CBaseNetProtocol::Get().SendNewFrame());
+			client.Flush(true);
+		}
+
+		CHECK(ReceiveAll(listener, client, *server, numMessages) == numMessages);
+		CHECK_FALSE(listener.IsBatchedIO());
+
+		noMultiMsgCalls = false;
+	}
+
+	globalConfig.udpBatchedIO = false;
+}
+#endif
+
+
+TEST_CASE("Compression")
+{
+	InitTimer();
+
+	const size_t numMessages = 64;
+
+	globalConfig.linkOutgoingBandwidth = 0;
+
+	unsigned int bytesRecv[2] = {0, 0};
+
+	for (const bool compressed: {false, true}) {
+		LOG("\ncompression: %d", compressed);
+
+		globalConfig.networkCompression = compressed;
+
+		netcode::UDPListener listener(11113, "127.0.0.1");
+		netcode::UDPConnection client(0, "127.0.0.1", 11113);
+
+		client.Unmute();
+		client.SendData(CBaseNetProtocol::Get().SendNewFrame());
+		client.Flush(true);
+
+		for (int n = 0; n < 1000 && !listener.HasIncomingConnections(); n++) {
+			listener.Update();
+			spring_msecs(1).sleep(true);
+		}
+
+		REQUIRE(listener.HasIncomingConnections());
+
+		std::shared_ptr<netcode::UDPConnection> server = listener.AcceptConnection();
+		server->Unmute();
+
+		// offers are consumed by the connections
+		CHECK(server->GetData()->data[0] == NETMSG_NEWFRAME);
+
+		// typical command traffic, sizes vary across chunk boundaries
+		std::vector< std::shared_ptr<const netcode::RawPacket> > sent;
+
+		for (size_t n = 0; n < numMessages; n++) {
+			const float params[] = {n * 8.0f, 100.0f, n * 16.0f};
+
+			sent.push_back(CBaseNetProtocol::Get().SendAICommand(1, 0, 2, n, 10 + (n % 8), -1, 1000, 0, n % 4, params));
+			sent.push_back(CBaseNetProtocol::Get().SendNewFrame());
+			sent.push_back(CBaseNetProtocol::Get().SendLuaMsg(1, 100, 0, std::vector<uint8_t>(n * 5, n)));
+
+			for (size_t i = sent.size() - 3; i < sent.size(); i++) {
+				server->SendData(sent[i]);
+			}
+
+			server->Flush(true);
+		}
+
+		listener.Flush();
+
+		size_t numReceived = 0;
+		size_t numMatching = 0;
+
+		for (int n = 0; n < 1000 && numReceived < sent.size(); n++) {
+			listener.Update();
+			client.Update();
+
+			for (std::shared_ptr<const netcode::RawPacket> pkt; (pkt = client.GetData()) != nullptr; numReceived++) {
+				const netcode::RawPacket& ref = *sent[numReceived];
+				numMatching += (pkt->length == ref.length && std::equal(pkt->data, pkt->data + pkt->length, ref.data));
+			}
+
+			spring_msecs(1).sleep(true);
+		}
+
+		CHECK(numReceived == sent.size());
+		CHECK(numMatching == sent.size());
+		CHECK(server->IsCompressing() == compressed);
+		CHECK(client.IsCompressing() == compressed);
+
+		bytesRecv[compressed] = client.GetDataReceived();
+		LOG("%s", server->Statistics().c_str());
+	}
+
+	globalConfig.networkCompression = false;
+
+	CHECK(bytesRecv[1] < bytesRecv[0]);
+}
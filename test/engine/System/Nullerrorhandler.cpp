@@ -1,7 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
-#include <string>
+#include "System/Platform/errorhandler.h"
 
-void ErrorMessageBox(const std::string& msg, const std::string& caption, unsigned int flags, bool)
+void ErrorMessageBox(const char* msg, const char* caption, unsigned int flags)
 {
 }
@@ -0,0 +1,21 @@
+#!/bin/sh
+
+# runs a validation game (see run.sh) and prints how fast the game's own
+# COB unit scripts were interpreted, as logged by the engine at shutdown
+# (needs an engine built with CMAKE_BUILD_TYPE=PROFILE, others do not count)
+
+set -e
+
+if [ $# -le 0 ]; then
+	echo "Usage: $0 /path/to/spring-headless testScript [parameters]"
+	exit 1
+fi
+
+test/validation/run.sh "$@"
+
+INFOLOG=~/.config/spring/infolog.txt
+
+if ! grep "\[COBEngine::LogStatistics\]" $INFOLOG; then
+	echo "no COB statistics in $INFOLOG, is this a PROFILE build and does the game use COB scripts?"
+	exit 1
+fi
@@ -3,13 +3,16 @@
 #include <string>
 #include <map>
 #include <iostream>
+#include <cstring>
 #include <gflags/gflags.h>
 #include <iomanip> //hex
 
 #include "StringSerializer.h"
 
 #include "Net/Protocol/BaseNetProtocol.h"
+#include "System/FileSystem/GZFileHandler.h"
 #include "System/LoadSave/DemoReader.h"
+#include "System/LoadSave/DemoStream.h"
 #include "System/Net/RawPacket.h"
 #include "Sim/Units/CommandAI/Command.h"
 
@@ -32,10 +35,14 @@ no console output (you still could use this.exe > z.tzt though).
 	DEFINE_bool  (teamstats,    false, "Print teamstats");
 	DEFINE_int32 (team,         -1,    "Select team");
 	DEFINE_string(teamsstatcsv, "",    "Write teamstats in a csv file");
+	DEFINE_string(convert,      "",    "Write a copy of the demo with a seek-index to this file");
+	DEFINE_int32 (interval,     30,    "Game-time in seconds between seek-points (with --convert)");
+	DEFINE_bool  (index,        false, "Print the seek-index of the demo");
 
 
 void TrafficDump(CDemoReader& reader, bool trafficStats);
 void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string& file);
+bool ConvertDemo(const std::string& inFile, const std::string& outFile, int interval);
 
 int main (int argc, char* argv[])
 {
@@ -52,8 +59,23 @@ int main (int argc, char* argv[])
 		gflags::ShowUsageWithFlags(argv[0]);
 	}
 
+	if (!FLAGS_convert.empty())
+		return (ConvertDemo(filename, FLAGS_convert, FLAGS_interval)? 0: 1);
+
 	CDemoReader reader(filename, 0.0f);
 	reader.LoadStats();
+	if (FLAGS_index)
+	{
+		const std::vector<DemoIndexEntry>* index = reader.GetIndex();
+		if (index == nullptr) {
+			std::cout << "Demo has no seek-index" << std::endl;
+			return 0;
+		}
+		for (const DemoIndexEntry& entry: *index) {
+			std::cout << "frame " << entry.frameNum << " stream-offset " << entry.streamPos << " file-offset " << entry.filePos << std::endl;
+		}
+		return 0;
+	}
 	if (FLAGS_dump)
 	{
 		TrafficDump(reader, true);
@@ -114,6 +136,103 @@ int main (int argc, char* argv[])
 }
 
 
+/**
+ * Rewrites any (possibly crash-truncated) demo into the indexed format;
+ * a missing demoStreamSize is restored from the complete chunks found.
+ */
+bool ConvertDemo(const std::string& inFile, const std::string& outFile, int interval)
+{
+	CGZFileHandler inDemo(inFile, SPRING_VFS_PWD_ALL);
+	CDemoOutputStream outDemo;
+
+	if (!inDemo.FileExists()) {
+		std::cout << "Demofile not found: " << inFile << std::endl;
+		return false;
+	}
+
+	const std::vector<std::uint8_t>& buffer = inDemo.GetBuffer();
+
+	DemoFileHeader header;
+
+	if (buffer.size() < sizeof(header)) {
+		std::cout << "Demofile too small: " << inFile << std::endl;
+		return false;
+	}
+
+	memcpy(&header, buffer.data(), sizeof(header));
+	header.swab();
+
+	const size_t streamBeg = header.headerSize + header.scriptSize;
+	const size_t streamEnd = (header.demoStreamSize != 0)? (streamBeg + header.demoStreamSize): buffer.size();
+
+	if (header.headerSize != sizeof(header) || streamBeg > buffer.size() || streamEnd > buffer.size()) {
+		std::cout << "Demofile corrupt: " << inFile << std::endl;
+		return false;
+	}
+
+	if (!outDemo.Open(outFile)) {
+		std::cout << "Can not write to " << outFile << std::endl;
+		return false;
+	}
+
+	size_t pos = streamBeg;
+	unsigned int numFrames = 0;
+	float lastIndexTime = 0.0f;
+
+	// header is rewritten at the end, once demoStreamSize is known
+	outDemo.WriteHeader(*reinterpret_cast<const DemoFileHeader*>(buffer.data()));
+	outDemo.Write(buffer.data() + sizeof(header), header.scriptSize, false);
+
+	while ((pos + sizeof(DemoStreamChunkHeader)) <= streamEnd) {
+		DemoStreamChunkHeader chunkHeader;
+		memcpy(&chunkHeader, &buffer[pos], sizeof(chunkHeader));
+		chunkHeader.swab();
+
+		const size_t chunkSize = sizeof(chunkHeader) + chunkHeader.length;
+
+		// truncated by a crash
+		if ((pos + chunkSize) > streamEnd)
+			break;
+
+		if (chunkHeader.length > 0 && (buffer[pos + sizeof(chunkHeader)] == NETMSG_NEWFRAME || buffer[pos + sizeof(chunkHeader)] == NETMSG_KEYFRAME)) {
+			if (interval > 0 && (chunkHeader.modGameTime - lastIndexTime) >= interval) {
+				outDemo.AddIndexEntry(numFrames);
+				lastIndexTime = chunkHeader.modGameTime;
+			}
+
+			numFrames += 1;
+		}
+
+		outDemo.Write(&buffer[pos], chunkSize, false);
+		pos += chunkSize;
+	}
+
+	if (header.demoStreamSize == 0) {
+		// stats were never written
+		header.demoStreamSize = pos - streamBeg;
+		header.winningAllyTeamsSize = 0;
+		header.numPlayers = 0;
+		header.playerStatSize = 0;
+		header.numTeams = 0;
+		header.teamStatSize = 0;
+	} else {
+		outDemo.Write(buffer.data() + streamEnd, buffer.size() - streamEnd, false);
+	}
+
+	header.swab();
+	outDemo.WriteHeader(header);
+	outDemo.Close();
+
+	if (outDemo.HasWriteError()) {
+		std::cout << "Error writing to " << outFile << std::endl;
+		return false;
+	}
+
+	std::cout << "Wrote " << outFile << " (" << numFrames << " frames)" << std::endl;
+	return true;
+}
+
+
 static std::map<int, std::string> cmdIdToName;
 
 void InitCommandNames()